@@ -2,22 +2,48 @@
 // Handles: gc_collect, gc_stats, gc_count, gc_pin, gc_unpin, gc_add_root, gc_remove_root,
 //          set_allocator, reset_allocator, allocator_stats, allocator_peak
 
-#include "backend/codegen/codegen_base.h"
+#include "backend/codegen/codegen_gc_layout.h"
 
 namespace tyl {
 
 void NativeCodeGen::emitGCCollect(CallExpr& node) {
     (void)node;
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_rel32(gcCollectLabel_);
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallRelWithOptimizedStack(gcLockLabel_);
+    emitCallRelWithOptimizedStack(gcCollectLabel_);
+    emitGCUnlock();
     asm_.xor_rax_rax();
 }
 
+// gc_stats() is the live heap in bytes; gc_stats(phase) the pause time
+// spent in one phase so far, in microseconds: 1 waiting for threads to park,
+// 2 minor collections, 3 major marking, 4 major sweeping, 5 the longest
+// single collection. Other phases read 0.
 void NativeCodeGen::emitGCStats(CallExpr& node) {
-    (void)node;
-    asm_.lea_rax_rip_fixup(gcDataRVA_ + 8);
-    asm_.mov_rax_mem_rax();
+    if (node.args.empty()) {
+        emitCallRelWithOptimizedStack(gcLockLabel_);
+        emitCallRelWithOptimizedStack(gcHeapBytesLabel_);
+        emitGCUnlock();
+        return;
+    }
+
+    std::string zeroLabel = newLabel("gc_stats_zero");
+    std::string doneLabel = newLabel("gc_stats_done");
+    node.args[0]->accept(*this);
+    asm_.emit(X64Op::SUB, X64Operand::r(X64Reg::RAX), X64Operand::immediate(1));
+    asm_.emit(X64Op::CMP, X64Operand::r(X64Reg::RAX), X64Operand::immediate(kGCPhaseCount));
+    asm_.jcc(X64Cond::AE, zeroLabel);
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RCX), X64Operand::ripRVA(gcDataRVA_ + kGCTimerFreq));
+    asm_.emit(X64Op::TEST, X64Operand::r(X64Reg::RCX), X64Operand::r(X64Reg::RCX));
+    asm_.jz_rel32(zeroLabel);
+    asm_.emit(X64Op::LEA, X64Operand::r(X64Reg::RDX), X64Operand::ripRVA(gcDataRVA_ + kGCPauses));
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), X64Operand::mem(X64Reg::RDX, X64Reg::RAX, 8));
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RDX), X64Operand::immediate(1000000));
+    asm_.emit(X64Op::MUL, X64Operand::r(X64Reg::RDX));
+    asm_.emit(X64Op::DIV, X64Operand::r(X64Reg::RCX));
+    asm_.jmp_rel32(doneLabel);
+    asm_.label(zeroLabel);
+    asm_.xor_rax_rax();
+    asm_.label(doneLabel);
 }
 
 void NativeCodeGen::emitGCCount(CallExpr& node) {
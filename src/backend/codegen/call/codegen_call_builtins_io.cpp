@@ -215,9 +215,7 @@ void NativeCodeGen::emitFileClose(CallExpr& node) {
     node.args[0]->accept(*this);
     asm_.mov_rcx_rax();  // rcx = handle
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-    asm_.call_mem_rip(pe_.getImportRVA("CloseHandle"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CloseHandle"));
     
     // rax = result (non-zero on success)
 }
@@ -231,9 +229,7 @@ void NativeCodeGen::emitFileSize(CallExpr& node) {
     // xor edx, edx (zero rdx for lpFileSizeHigh = NULL)
     asm_.code.push_back(0x31); asm_.code.push_back(0xD2);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-    asm_.call_mem_rip(pe_.getImportRVA("GetFileSize"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetFileSize"));
     
     // rax = file size (low 32 bits, but sufficient for most files)
 }
@@ -251,32 +247,24 @@ void NativeCodeGen::emitRead(CallExpr& node) {
         if (tryEvalConstantString(node.args[0].get(), prompt)) {
             uint32_t rva = addString(prompt);
             asm_.lea_rcx_rip_fixup(rva);
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_mem_rip(pe_.getImportRVA("printf"));
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+            emitCallWithOptimizedStack(pe_.getImportRVA("printf"));
         } else {
             node.args[0]->accept(*this);
             asm_.mov_rcx_rax();
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_mem_rip(pe_.getImportRVA("printf"));
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+            emitCallWithOptimizedStack(pe_.getImportRVA("printf"));
         }
     }
     
     // fgets(buffer, size, stdin)
     // First get stdin handle
     asm_.lea_rcx_rip_fixup(pe_.getImportRVA("__iob_func"));
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("__iob_func"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("__iob_func"));
     // stdin is at offset 0 from __iob_func result
     asm_.mov_r8_rax();
     
     asm_.lea_rcx_rbp(bufOffset);
     asm_.mov_rdx_imm64(255);
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("fgets"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("fgets"));
     
     // Strip trailing newline
     asm_.lea_rax_rbp(bufOffset);
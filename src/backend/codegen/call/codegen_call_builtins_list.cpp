@@ -29,7 +29,7 @@ void NativeCodeGen::emitListPush(CallExpr& node) {
         
         emitGCAllocList(newSize);
         
-        allocLocal("$push_newlist");
+        allocTemp("$push_newlist");
         asm_.mov_mem_rbp_rax(locals["$push_newlist"]);
         
         for (size_t i = 0; i < oldSize; i++) {
@@ -62,10 +62,10 @@ void NativeCodeGen::emitListPush(CallExpr& node) {
             listSizes[listName] = newSize;
         }
     } else {
-        allocLocal("$push_oldlist");
-        allocLocal("$push_element");
-        allocLocal("$push_oldsize");
-        allocLocal("$push_newlist");
+        allocTemp("$push_oldlist");
+        allocTemp("$push_element");
+        allocTemp("$push_oldsize");
+        allocTemp("$push_newlist");
         
         asm_.pop_rax();
         asm_.mov_mem_rbp_rax(locals["$push_element"]);
@@ -80,14 +80,12 @@ void NativeCodeGen::emitListPush(CallExpr& node) {
         asm_.code.push_back(0xE0); asm_.code.push_back(0x03);
         asm_.push_rax();
         
-        if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-        asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+        emitCallWithOptimizedStack(pe_.getImportRVA("GetProcessHeap"));
         asm_.mov_rcx_rax();
         asm_.xor_rax_rax();
         asm_.mov_rdx_rax();
         asm_.code.push_back(0x41); asm_.code.push_back(0x58);
-        asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
-        if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+        emitCallWithOptimizedStack(pe_.getImportRVA("HeapAlloc"));
         
         asm_.mov_mem_rbp_rax(locals["$push_newlist"]);
         
@@ -95,7 +93,7 @@ void NativeCodeGen::emitListPush(CallExpr& node) {
         asm_.inc_rcx();
         asm_.mov_mem_rax_rcx();
         
-        allocLocal("$push_idx");
+        allocTemp("$push_idx");
         asm_.xor_rax_rax();
         asm_.mov_mem_rbp_rax(locals["$push_idx"]);
         
@@ -124,6 +122,7 @@ void NativeCodeGen::emitListPush(CallExpr& node) {
         asm_.add_rax_rcx();
         asm_.pop_rcx();
         asm_.mov_mem_rax_rcx();
+        emitWriteBarrier(X64Reg::RAX, X64Reg::RCX);
         
         asm_.mov_rax_mem_rbp(locals["$push_idx"]);
         asm_.inc_rax();
@@ -140,6 +139,7 @@ void NativeCodeGen::emitListPush(CallExpr& node) {
         asm_.add_rax_rcx();
         asm_.mov_rcx_mem_rbp(locals["$push_element"]);
         asm_.mov_mem_rax_rcx();
+        emitWriteBarrier(X64Reg::RAX, X64Reg::RCX);
         
         asm_.mov_rax_mem_rbp(locals["$push_newlist"]);
     }
@@ -168,7 +168,7 @@ void NativeCodeGen::emitListPop(CallExpr& node) {
             listSizes[listName] = listSize - 1;
         }
     } else {
-        allocLocal("$pop_list");
+        allocTemp("$pop_list");
         asm_.mov_mem_rbp_rax(locals["$pop_list"]);
         
         asm_.mov_rcx_mem_rax();
@@ -81,7 +81,7 @@ void NativeCodeGen::emitListReverse(CallExpr& node) {
     if (knownSize && listSize > 0) {
         // Allocate new list
         emitGCAllocList(listSize);
-        allocLocal("$rev_list");
+        allocTemp("$rev_list");
         asm_.mov_mem_rbp_rax(locals["$rev_list"]);
         
         node.args[0]->accept(*this);
@@ -150,7 +150,7 @@ void NativeCodeGen::emitListTake(CallExpr& node) {
         }
         
         emitGCAllocList(takeCount);
-        allocLocal("$take_list");
+        allocTemp("$take_list");
         asm_.mov_mem_rbp_rax(locals["$take_list"]);
         
         node.args[0]->accept(*this);
@@ -207,7 +207,7 @@ void NativeCodeGen::emitListDrop(CallExpr& node) {
         size_t newSize = listSize - dropCount;
         
         emitGCAllocList(newSize);
-        allocLocal("$drop_list");
+        allocTemp("$drop_list");
         asm_.mov_mem_rbp_rax(locals["$drop_list"]);
         
         node.args[0]->accept(*this);
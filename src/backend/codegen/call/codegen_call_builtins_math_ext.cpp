@@ -24,7 +24,7 @@ void NativeCodeGen::emitMathSin(CallExpr& node) {
     }
     
     // Store xmm0 to stack, load to x87, compute sin, store back
-    allocLocal("$sin_tmp");
+    allocTemp("$sin_tmp");
     asm_.movsd_mem_rbp_xmm0(locals["$sin_tmp"]);
     asm_.code.push_back(0xDD); asm_.code.push_back(0x85); // fld qword [rbp+offset]
     int32_t offset = locals["$sin_tmp"];
@@ -58,7 +58,7 @@ void NativeCodeGen::emitMathCos(CallExpr& node) {
         asm_.cvtsi2sd_xmm0_rax();
     }
     
-    allocLocal("$cos_tmp");
+    allocTemp("$cos_tmp");
     asm_.movsd_mem_rbp_xmm0(locals["$cos_tmp"]);
     asm_.code.push_back(0xDD); asm_.code.push_back(0x85);
     int32_t offset = locals["$cos_tmp"];
@@ -92,7 +92,7 @@ void NativeCodeGen::emitMathTan(CallExpr& node) {
         asm_.cvtsi2sd_xmm0_rax();
     }
     
-    allocLocal("$tan_tmp");
+    allocTemp("$tan_tmp");
     asm_.movsd_mem_rbp_xmm0(locals["$tan_tmp"]);
     asm_.code.push_back(0xDD); asm_.code.push_back(0x85);
     int32_t offset = locals["$tan_tmp"];
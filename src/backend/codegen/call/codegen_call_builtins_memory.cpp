@@ -9,25 +9,21 @@ void NativeCodeGen::emitMemAlloc(CallExpr& node) {
     node.args[0]->accept(*this);
     asm_.mov_r8_rax();
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetProcessHeap"));
     asm_.mov_rcx_rax();
     asm_.mov_rdx_imm64(0x08);
-    asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("HeapAlloc"));
 }
 
 void NativeCodeGen::emitMemFree(CallExpr& node) {
     node.args[0]->accept(*this);
     asm_.mov_r8_rax();
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetProcessHeap"));
     asm_.mov_rcx_rax();
     asm_.xor_rax_rax();
     asm_.mov_rdx_rax();
-    asm_.call_mem_rip(pe_.getImportRVA("HeapFree"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("HeapFree"));
     
     asm_.xor_rax_rax();
 }
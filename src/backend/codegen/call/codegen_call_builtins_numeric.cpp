@@ -529,7 +529,7 @@ void NativeCodeGen::emitFixedNew(CallExpr& node) {
 // fixed_add(a, b) -> Fixed
 void NativeCodeGen::emitFixedAdd(CallExpr& node) {
     node.args[0]->accept(*this);
-    allocLocal("$fixed_a");
+    allocTemp("$fixed_a");
     asm_.mov_mem_rbp_rax(locals["$fixed_a"]);
     
     node.args[1]->accept(*this);
@@ -546,7 +546,7 @@ void NativeCodeGen::emitFixedAdd(CallExpr& node) {
 // fixed_sub(a, b) -> Fixed
 void NativeCodeGen::emitFixedSub(CallExpr& node) {
     node.args[0]->accept(*this);
-    allocLocal("$fixed_a");
+    allocTemp("$fixed_a");
     asm_.mov_mem_rbp_rax(locals["$fixed_a"]);
     
     node.args[1]->accept(*this);
@@ -568,7 +568,7 @@ void NativeCodeGen::emitFixedSub(CallExpr& node) {
 // fixed_mul(a, b) -> Fixed
 void NativeCodeGen::emitFixedMul(CallExpr& node) {
     node.args[0]->accept(*this);
-    allocLocal("$fixed_a");
+    allocTemp("$fixed_a");
     asm_.mov_mem_rbp_rax(locals["$fixed_a"]);
     
     node.args[1]->accept(*this);
@@ -643,7 +643,7 @@ void NativeCodeGen::emitFixedToFloat(CallExpr& node) {
 void NativeCodeGen::emitVec3New(CallExpr& node) {
     // Allocate 24 bytes for 3 doubles
     emitGCAllocRaw(24);
-    allocLocal("$vec3_ptr");
+    allocTemp("$vec3_ptr");
     asm_.mov_mem_rbp_rax(locals["$vec3_ptr"]);
     
     // Evaluate and store x
@@ -704,17 +704,17 @@ void NativeCodeGen::emitVec3New(CallExpr& node) {
 void NativeCodeGen::emitVec3Add(CallExpr& node) {
     // Evaluate first vector
     node.args[0]->accept(*this);
-    allocLocal("$vec3_a");
+    allocTemp("$vec3_a");
     asm_.mov_mem_rbp_rax(locals["$vec3_a"]);
     
     // Evaluate second vector
     node.args[1]->accept(*this);
-    allocLocal("$vec3_b");
+    allocTemp("$vec3_b");
     asm_.mov_mem_rbp_rax(locals["$vec3_b"]);
     
     // Allocate result
     emitGCAllocRaw(24);
-    allocLocal("$vec3_result");
+    allocTemp("$vec3_result");
     asm_.mov_mem_rbp_rax(locals["$vec3_result"]);
     
     // Load and add x components
@@ -814,12 +814,12 @@ void NativeCodeGen::emitVec3Add(CallExpr& node) {
 void NativeCodeGen::emitVec3Dot(CallExpr& node) {
     // Evaluate first vector
     node.args[0]->accept(*this);
-    allocLocal("$vec3_a");
+    allocTemp("$vec3_a");
     asm_.mov_mem_rbp_rax(locals["$vec3_a"]);
     
     // Evaluate second vector
     node.args[1]->accept(*this);
-    allocLocal("$vec3_b");
+    allocTemp("$vec3_b");
     asm_.mov_mem_rbp_rax(locals["$vec3_b"]);
 
     // x*x
@@ -20,9 +20,16 @@ void NativeCodeGen::emitSystemExit(CallExpr& node) {
         }
     }
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    // Instrumented builds write the profile before leaving
+    if (!profileFile_.empty()) {
+        asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), X64Operand::r(X64Reg::RCX));
+        if (!stackAllocated_) asm_.sub_rsp_imm32(8);
+        emitProfileDumpCall();
+        if (!stackAllocated_) asm_.add_rsp_imm32(8);
+        asm_.mov_rcx_rax();
+    }
+    
+    emitCallWithOptimizedStack(pe_.getImportRVA("ExitProcess"));
 }
 
 void NativeCodeGen::emitSystemSleep(CallExpr& node) {
@@ -34,9 +41,7 @@ void NativeCodeGen::emitSystemSleep(CallExpr& node) {
         asm_.mov_rcx_rax();
     }
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("Sleep"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitBlockingCall(pe_.getImportRVA("Sleep"));
     
     asm_.xor_rax_rax();
 }
@@ -67,9 +72,7 @@ void NativeCodeGen::emitSystemHostname(CallExpr& node) {
     asm_.lea_rcx_rbp(bufOffset);
     asm_.lea_rdx_rbp_offset(locals["$hostname_size"]);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetComputerNameA"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetComputerNameA"));
     
     asm_.lea_rax_rbp(bufOffset);
 }
@@ -88,9 +91,7 @@ void NativeCodeGen::emitSystemUsername(CallExpr& node) {
     asm_.lea_rcx_rbp(bufOffset);
     asm_.lea_rdx_rbp_offset(locals["$username_size"]);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetUserNameA"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetUserNameA"));
     
     asm_.lea_rax_rbp(bufOffset);
 }
@@ -104,9 +105,7 @@ void NativeCodeGen::emitSystemCpuCount(CallExpr& node) {
     
     asm_.lea_rcx_rbp(locals["$sysinfo"]);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetSystemInfo"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetSystemInfo"));
     
     // dwNumberOfProcessors is at offset 32 in SYSTEM_INFO
     asm_.mov_rax_mem_rbp(locals["$sysinfo"]);
@@ -127,9 +126,7 @@ void NativeCodeGen::emitTimeNow(CallExpr& node) {
     
     asm_.lea_rcx_rbp(locals["$filetime"]);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetSystemTimeAsFileTime"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetSystemTimeAsFileTime"));
     
     // FILETIME is 100-nanosecond intervals since Jan 1, 1601
     // Convert to seconds since Unix epoch (Jan 1, 1970)
@@ -151,9 +148,7 @@ void NativeCodeGen::emitTimeNowMs(CallExpr& node) {
     
     asm_.lea_rcx_rbp(locals["$filetime_ms"]);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetSystemTimeAsFileTime"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetSystemTimeAsFileTime"));
     
     asm_.mov_rax_mem_rbp(locals["$filetime_ms"]);
     asm_.mov_rcx_imm64(116444736000000000LL);
@@ -204,9 +199,7 @@ void NativeCodeGen::emitGetLocalTimeField(int32_t fieldOffset) {
     
     asm_.lea_rcx_rbp(locals[systimeName]);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetLocalTime"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetLocalTime"));
     
     // Load the WORD field and zero-extend
     int32_t offset = locals[systimeName] + fieldOffset;
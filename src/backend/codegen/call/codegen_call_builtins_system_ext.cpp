@@ -16,9 +16,7 @@ void NativeCodeGen::emitSystemEnv(CallExpr& node) {
     asm_.lea_rdx_rbp_offset(bufOffset);
     asm_.mov_r8_imm64(1024);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetEnvironmentVariableA"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetEnvironmentVariableA"));
     
     // If failed, return empty string
     asm_.test_rax_rax();
@@ -44,9 +42,7 @@ void NativeCodeGen::emitSystemSetEnv(CallExpr& node) {
     asm_.mov_rdx_rax();
     asm_.pop_rcx();
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("SetEnvironmentVariableA"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("SetEnvironmentVariableA"));
     
     // Return 1 on success, 0 on failure
     asm_.test_rax_rax();
@@ -67,9 +63,7 @@ void NativeCodeGen::emitSystemHomeDir(CallExpr& node) {
     asm_.lea_rdx_rbp_offset(bufOffset);
     asm_.mov_r8_imm64(512);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetEnvironmentVariableA"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetEnvironmentVariableA"));
     
     asm_.test_rax_rax();
     std::string emptyLabel = newLabel("home_empty");
@@ -96,9 +90,7 @@ void NativeCodeGen::emitSystemTempDir(CallExpr& node) {
     asm_.mov_ecx_imm32(512);
     asm_.lea_rdx_rbp_offset(bufOffset);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetTempPathA"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetTempPathA"));
     
     asm_.lea_rax_rbp(bufOffset);
 }
@@ -108,59 +100,37 @@ void NativeCodeGen::emitSystemAssert(CallExpr& node) {
     node.args[0]->accept(*this);
     asm_.test_rax_rax();
     
-    std::string passLabel = newLabel("assert_pass");
-    
-    asm_.jnz_rel32(passLabel);
-    
-    // Assertion failed - print message and exit
+    // Assertion failed - print message and exit, out of line
+    std::string message = "Assertion failed!";
     if (node.args.size() > 1) {
-        uint32_t prefixRva = addString("Assertion failed: ");
-        emitWriteConsole(prefixRva, 18);
-        
+        message = "Assertion failed: ";
         std::string msg;
         if (tryEvalConstantString(node.args[1].get(), msg)) {
-            uint32_t msgRva = addString(msg);
-            emitWriteConsole(msgRva, (uint32_t)msg.size());
+            message += msg;
         }
-    } else {
-        uint32_t msgRva = addString("Assertion failed!");
-        emitWriteConsole(msgRva, 17);
     }
+    message += "\r\n";
     
-    uint32_t nlRva = addString("\r\n");
-    emitWriteConsole(nlRva, 2);
-    
-    // Exit with code 1
-    asm_.mov_ecx_imm32(1);
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
-    
-    asm_.label(passLabel);
+    std::string failLabel = deferColdBlock("assert_fail", [this, message]() {
+        emitFatalError(message);
+    });
+    asm_.jz_rel32(failLabel);
     asm_.xor_rax_rax();
 }
 
 // panic(message) -> nil - Exit with error message
 void NativeCodeGen::emitSystemPanic(CallExpr& node) {
-    uint32_t prefixRva = addString("Panic: ");
-    emitWriteConsole(prefixRva, 7);
-    
     std::string msg;
     if (tryEvalConstantString(node.args[0].get(), msg)) {
-        uint32_t msgRva = addString(msg);
-        emitWriteConsole(msgRva, (uint32_t)msg.size());
-    } else {
-        node.args[0]->accept(*this);
-        // Would need to print runtime string here
+        emitFatalError("Panic: " + msg + "\r\n");
+        return;
     }
     
-    uint32_t nlRva = addString("\r\n");
-    emitWriteConsole(nlRva, 2);
-    
-    asm_.mov_ecx_imm32(1);
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    uint32_t prefixRva = addString("Panic: ");
+    emitWriteConsole(prefixRva, 7);
+    node.args[0]->accept(*this);
+    // Would need to print runtime string here
+    emitFatalError("\r\n");
 }
 
 // debug(value) -> value - Print debug info and return value
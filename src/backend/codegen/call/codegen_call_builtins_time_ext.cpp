@@ -13,9 +13,7 @@ void NativeCodeGen::emitTimeNowUs(CallExpr& node) {
     
     asm_.lea_rcx_rbp(locals["$filetime_us"]);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetSystemTimeAsFileTime"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetSystemTimeAsFileTime"));
     
     asm_.mov_rax_mem_rbp(locals["$filetime_us"]);
     asm_.mov_rcx_imm64(116444736000000000LL);
@@ -8,6 +8,8 @@
 namespace tyl {
 
 void NativeCodeGen::visit(CallExpr& node) {
+    emitProfileCounter(&node);
+    
     // First, try to evaluate comptime function calls at compile time
     if (auto* id = dynamic_cast<Identifier*>(node.callee.get())) {
         if (ctfe_.isComptimeFunction(id->name)) {
@@ -411,9 +413,7 @@ void NativeCodeGen::visit(CallExpr& node) {
                     asm_.code.push_back(0x41); asm_.code.push_back(0x59);
                 }
                 
-                if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-                asm_.call_rel32(mangledName);
-                if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+                emitCallRelWithOptimizedStack(mangledName);
                 return;
             }
             
@@ -436,9 +436,7 @@ void NativeCodeGen::visit(CallExpr& node) {
                             asm_.code.push_back(0x41); asm_.code.push_back(0x59);
                         }
                         
-                        if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-                        asm_.call_rel32(methodIt->second);
-                        if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+                        emitCallRelWithOptimizedStack(methodIt->second);
                         return;
                     }
                 }
@@ -488,9 +486,7 @@ void NativeCodeGen::visit(CallExpr& node) {
                     asm_.code.push_back(0x41); asm_.code.push_back(0x59);  // pop r9
                 }
                 
-                if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-                asm_.call_rel32(methodIt->second);
-                if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+                emitCallRelWithOptimizedStack(methodIt->second);
                 return;
             }
         }
@@ -525,9 +521,7 @@ void NativeCodeGen::visit(CallExpr& node) {
                 asm_.code.push_back(0x41); asm_.code.push_back(0x59);  // pop r9
             }
             
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-            asm_.call_rel32(funcName);
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+            emitCallRelWithOptimizedStack(funcName);
             return;
         }
     }
@@ -550,9 +544,7 @@ void NativeCodeGen::visit(CallExpr& node) {
                 asm_.code.push_back(0x41); asm_.code.push_back(0x59);
             }
             
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-            asm_.call_mem_rip(pe_.getImportRVA(id->name));
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+            emitCallWithOptimizedStack(pe_.getImportRVA(id->name));
             return;
         }
         
@@ -1093,7 +1085,7 @@ void NativeCodeGen::visit(CallExpr& node) {
             emitGCCollect(node);
             return;
         }
-        if (id->name == "gc_stats" && node.args.empty()) {
+        if (id->name == "gc_stats" && node.args.size() <= 1) {
             emitGCStats(node);
             return;
         }
@@ -49,9 +49,7 @@ void NativeCodeGen::emitStandardFunctionCall(CallExpr& node, const std::string&
         asm_.code.push_back(0x41); asm_.code.push_back(0x59); // pop r9
     }
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-    asm_.call_rel32(callTarget);
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+    emitCallRelWithOptimizedStack(callTarget);
 }
 
 void NativeCodeGen::emitFloatFunctionCall(CallExpr& node, const std::string& callTarget) {
@@ -103,9 +101,7 @@ void NativeCodeGen::emitFloatFunctionCall(CallExpr& node, const std::string& cal
         }
     }
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-    asm_.call_rel32(callTarget);
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+    emitCallRelWithOptimizedStack(callTarget);
     
     // Result is in xmm0, move to rax as bit pattern
     asm_.code.push_back(0x66); asm_.code.push_back(0x48);
@@ -187,9 +183,7 @@ void NativeCodeGen::emitFunctionPointerCall(CallExpr& node, const std::string& v
     asm_.mov_rax_mem_rcx();
     
     // Call through function pointer
-    asm_.sub_rsp_imm32(0x20);
-    asm_.call_rax();
-    asm_.add_rsp_imm32(0x20);
+    emitCallRaxWithOptimizedStack();
 }
 
 void NativeCodeGen::emitClosureCall(CallExpr& node) {
@@ -222,9 +216,7 @@ void NativeCodeGen::emitClosureCall(CallExpr& node) {
     // Load function pointer from closure (first field)
     asm_.mov_rax_mem_rcx();
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-    asm_.call_rax();
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+    emitCallRaxWithOptimizedStack();
 }
 
 } // namespace tyl
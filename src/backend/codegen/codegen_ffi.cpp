@@ -81,8 +81,8 @@ void NativeCodeGen::emitCallbackTrampoline(const std::string& fnName, const Call
     asm_.push_rbp();
     asm_.mov_rbp_rsp();
     
-    // Allocate shadow space for the call
-    asm_.sub_rsp_imm32(0x28);  // 32 bytes shadow + 8 for alignment
+    // Allocate shadow space for the call; push rbp already realigned rsp
+    asm_.sub_rsp_imm32(0x20);
     
     // Parameters are already in the right registers for Windows x64 ABI
     // RCX, RDX, R8, R9 for first 4 integer/pointer args
@@ -92,7 +92,7 @@ void NativeCodeGen::emitCallbackTrampoline(const std::string& fnName, const Call
     asm_.call_rel32(fnName);
     
     // Epilogue
-    asm_.add_rsp_imm32(0x28);
+    asm_.add_rsp_imm32(0x20);
     asm_.pop_rbp();
     asm_.ret();
 }
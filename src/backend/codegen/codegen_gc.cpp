@@ -1,39 +1,54 @@
 // Tyl Compiler - Native Code Generator GC Support
-// Full mark-and-sweep garbage collection with automatic collection by default
+// Generational garbage collection with automatic collection by default:
+// a bump-pointer nursery emptied by copying minor collections, and an old
+// space of size-class regions marked in side bitmaps and swept lazily
 // Manual control available via gc_disable(), gc_enable(), gc_collect()
 
-#include "codegen_base.h"
+#include "codegen_gc_layout.h"
+#include <cstring>
 
 namespace tyl {
 
-// GC Data Section Layout (offsets from gcDataRVA_):
-// Offset 0:   gc_alloc_head (8 bytes)     - Head of allocation linked list
-// Offset 8:   gc_total_bytes (8 bytes)    - Total bytes currently allocated
-// Offset 16:  gc_threshold (8 bytes)      - Collection threshold (default 1MB)
-// Offset 24:  gc_enabled (8 bytes)        - GC enabled flag (1 = enabled, default)
-// Offset 32:  gc_collections (8 bytes)    - Number of collections performed
-// Offset 40:  gc_stack_bottom (8 bytes)   - Bottom of stack for root scanning
-// Total: 48 bytes
-
-// GC Object Header Layout (16 bytes, before user data):
-// Offset -16: size (4 bytes)   - Size of user data
-// Offset -12: type (2 bytes)   - Object type for tracing
-// Offset -10: marked (1 byte)  - Mark bit
-// Offset -9:  flags (1 byte)   - Flags (pinned, etc.)
-// Offset -8:  next (8 bytes)   - Next object in allocation list
-// Offset 0:   User data starts here
-
-// Initialize GC data section - called once during compile
+constexpr size_t kMaxStackAllocBytes = 256;  // Larger noEscape objects still go to the heap
+
+// Add the GC data block to .data
+void NativeCodeGen::initGCData() {
+    std::vector<uint8_t> gcData(kGCDataSize, 0);
+    memcpy(&gcData[kGCThreshold], &gcHeapSizing_.minBytes, 8);
+    memcpy(&gcData[kGCHeapMin], &gcHeapSizing_.minBytes, 8);
+    memcpy(&gcData[kGCHeapMax], &gcHeapSizing_.maxBytes, 8);
+    memcpy(&gcData[kGCHeapGrowth], &gcHeapSizing_.growthPercent, 8);
+    uint64_t enabled = 1;
+    memcpy(&gcData[kGCEnabled], &enabled, 8);
+
+    // Size classes: 16-byte steps up to 128, then four per power of two
+    std::vector<uint64_t> cells;
+    for (uint64_t bytes = 16; bytes <= 128; bytes += 16) cells.push_back(bytes);
+    for (uint64_t base = 128; base < kMaxSizeClassBytes; base *= 2) {
+        for (uint64_t step = 1; step <= 4; step++) cells.push_back(base + base / 4 * step);
+    }
+    size_t sizeClass = 0;
+    for (size_t i = 0; i < cells.size(); i++) {
+        memcpy(&gcData[kSizeClassTable + i * kSizeClassEntry + kSizeClassCell], &cells[i], 8);
+    }
+    for (size_t slot = 0; slot < kMaxSizeClassBytes / 16; slot++) {
+        while (cells[sizeClass] < (slot + 1) * 16) sizeClass++;
+        gcData[kSizeClassMap + slot] = static_cast<uint8_t>(sizeClass);
+    }
+
+    gcDataRVA_ = pe_.addData(gcData.data(), gcData.size());
+    gcCollectLabel_ = "__TYL_gc_collect";
+}
+
+// Initialize GC at program start
 void NativeCodeGen::emitGCInit() {
     if (gcInitEmitted_ || !useGC_) return;
-    
-    // Store stack bottom (RSP at program start) for conservative scanning
-    // mov rax, rsp
-    asm_.code.push_back(0x48); asm_.code.push_back(0x89); asm_.code.push_back(0xE0);
-    // Store to gc_stack_bottom
-    asm_.lea_rcx_rip_fixup(gcDataRVA_ + 40);
-    asm_.mov_mem_rcx_rax();
-    
+
+    // The root walk ends at _start's frame pointer, so top-level locals and
+    // the saved global registers are roots too
+    asm_.emit(X64Op::MOV, X64Operand::ripRVA(gcDataRVA_ + kGCStackBottom), gpr(X64Reg::RBP));
+    asm_.call_rel32(gcInitLabel_);
+
     gcInitEmitted_ = true;
 }
 
@@ -45,365 +60,1501 @@ void NativeCodeGen::emitGCShutdown() {
 }
 
 
-// Emit GC allocation with automatic collection
+// Emit GC allocation
 // size: bytes to allocate (user data only)
 // type: object type for tracing
-// Result: pointer to user data in RAX
-void NativeCodeGen::emitGCAlloc(size_t size, GCObjectType type) {
+// old: allocate in the old space, where a minor collection never moves it
+// (objects whose address the OS keeps, such as SRW locks)
+// Result: pointer to zeroed user data in RAX (clobbers RCX, RDX and, on the
+// slow path, the other volatile registers)
+//
+// The fast path bumps the thread's TLAB with no synchronization; refilling
+// it from the shared nursery, collecting and old-space allocation happen in
+// __TYL_gc_alloc_slow under the GC lock.
+void NativeCodeGen::emitGCAlloc(size_t size, GCObjectType type, bool old) {
     // Calculate total size: header (16 bytes) + user data, aligned to 8
     size_t totalSize = 16 + size;
     totalSize = (totalSize + 7) & ~7;
-    
-    // Labels for control flow
-    std::string skipCollectLabel = newLabel("gc_skip_collect");
-    std::string afterCollectLabel = newLabel("gc_after_collect");
-    
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    
-    // Check if we should collect: gc_total_bytes + size > gc_threshold && gc_enabled
-    // Load gc_total_bytes
-    asm_.lea_rax_rip_fixup(gcDataRVA_ + 8);
-    asm_.mov_rax_mem_rax();
-    asm_.add_rax_imm32(static_cast<int32_t>(totalSize));
-    asm_.push_rax();  // Save new total
-    
-    // Load gc_threshold
-    asm_.lea_rax_rip_fixup(gcDataRVA_ + 16);
-    asm_.mov_rcx_mem_rax();
-    
-    // Compare: if new_total <= threshold, skip collection
-    asm_.pop_rax();
-    asm_.cmp_rax_rcx();
-    asm_.jle_rel32(skipCollectLabel);
-    
-    // Check if GC is enabled
-    asm_.lea_rax_rip_fixup(gcDataRVA_ + 24);
-    asm_.mov_rax_mem_rax();
-    asm_.test_rax_rax();
-    asm_.jz_rel32(skipCollectLabel);
-    
-    // Trigger collection
-    asm_.call_rel32(gcCollectLabel_);
-    
-    asm_.label(skipCollectLabel);
-    
-    // Allocate memory via HeapAlloc
-    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
-    asm_.mov_rcx_rax();
-    asm_.mov_rdx_imm64(0x08);  // HEAP_ZERO_MEMORY
-    asm_.mov_r8d_imm32(static_cast<int32_t>(totalSize));
-    asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
-    
-    // RAX = pointer to header
-    // Check for allocation failure
-    asm_.test_rax_rax();
-    std::string allocOkLabel = newLabel("gc_alloc_ok");
-    asm_.jnz_rel32(allocOkLabel);
-    
-    // Allocation failed - try collecting and retry
-    asm_.call_rel32(gcCollectLabel_);
-    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
-    asm_.mov_rcx_rax();
-    asm_.mov_rdx_imm64(0x08);
-    asm_.mov_r8d_imm32(static_cast<int32_t>(totalSize));
-    asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
-    
-    asm_.label(allocOkLabel);
-    asm_.push_rax();  // Save header pointer
-    
-    // Initialize header fields
-    // [rax+0] = size (4 bytes)
-    asm_.code.push_back(0xC7);
-    asm_.code.push_back(0x00);
-    asm_.code.push_back(size & 0xFF);
-    asm_.code.push_back((size >> 8) & 0xFF);
-    asm_.code.push_back((size >> 16) & 0xFF);
-    asm_.code.push_back((size >> 24) & 0xFF);
-    
-    // [rax+4] = type (2 bytes)
-    asm_.code.push_back(0x66);
-    asm_.code.push_back(0xC7);
-    asm_.code.push_back(0x40);
-    asm_.code.push_back(0x04);
-    asm_.code.push_back(static_cast<uint16_t>(type) & 0xFF);
-    asm_.code.push_back((static_cast<uint16_t>(type) >> 8) & 0xFF);
-    
-    // [rax+6] = marked = 0, [rax+7] = flags = 0 (already zeroed)
-    
-    // Link into allocation list: header->next = gc_alloc_head; gc_alloc_head = header
-    // Load current head
-    asm_.lea_rcx_rip_fixup(gcDataRVA_);  // gc_alloc_head address
-    // mov rdx, [rcx]
-    asm_.code.push_back(0x48); asm_.code.push_back(0x8B); asm_.code.push_back(0x11);
-    
-    // Store current head in header->next [rax+8]
-    asm_.code.push_back(0x48);
-    asm_.code.push_back(0x89);
-    asm_.code.push_back(0x50);
-    asm_.code.push_back(0x08);  // mov [rax+8], rdx
-    
-    // Store header as new head
-    asm_.mov_mem_rcx_rax();  // gc_alloc_head = header
-    
-    // Update gc_total_bytes
-    asm_.lea_rcx_rip_fixup(gcDataRVA_ + 8);
-    // mov rax, [rcx]
-    asm_.code.push_back(0x48); asm_.code.push_back(0x8B); asm_.code.push_back(0x01);
-    asm_.add_rax_imm32(static_cast<int32_t>(totalSize));
-    asm_.mov_mem_rcx_rax();
-    
-    // Return pointer to user data (header + 16)
-    asm_.pop_rax();
+
+    uint64_t header = static_cast<uint32_t>(size) | (static_cast<uint64_t>(type) << 32);
+
+    // The slow path returns the block in RAX and its generation flags in RDX
+    auto emitSlowCall = [this, totalSize, header](const std::string& routine) {
+        asm_.mov_ecx_imm32(static_cast<int32_t>(totalSize));
+        asm_.call_rel32(routine);
+        asm_.mov_rcx_imm64(static_cast<int64_t>(header));
+        asm_.emit(X64Op::OR, gpr(X64Reg::RCX), gpr(X64Reg::RDX));
+    };
+
+    if (old || totalSize > static_cast<size_t>(kNurseryMaxObject)) {
+        emitSlowCall(old ? gcAllocOldLabel_ : gcAllocSlowLabel_);
+        asm_.mov_mem_rax_rcx();
+        asm_.add_rax_imm32(16);
+        return;
+    }
+
+    std::string headerLabel = newLabel("gc_alloc_header");
+    std::string slowLabel = deferColdBlock("gc_alloc_slow", [this, emitSlowCall, headerLabel]() {
+        emitSlowCall(gcAllocSlowLabel_);
+        asm_.jmp_rel32(headerLabel);
+    });
+
+    emitGCThreadRecord(X64Reg::RDX);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RDX, kThreadTop));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), at(X64Reg::RAX, static_cast<int32_t>(totalSize)));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), at(X64Reg::RDX, kThreadEnd));
+    asm_.jcc(X64Cond::A, slowLabel);
+    asm_.emit(X64Op::MOV, at(X64Reg::RDX, kThreadTop), gpr(X64Reg::RCX));
+    asm_.mov_rcx_imm64(static_cast<int64_t>(header | headerFlags(GC_FLAG_NURSERY)));
+
+    asm_.label(headerLabel);
+    asm_.mov_mem_rax_rcx();
     asm_.add_rax_imm32(16);
-    
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
 }
 
+// Write barrier for a pointer-sized store of `value` to [slot], emitted after
+// the store. A nursery pointer stored outside the nursery is logged in the
+// remembered set, which the next minor collection treats as roots. Only the
+// young-value test is inline; the slot checks run in the cold region.
+// Clobbers R11 and flags.
+void NativeCodeGen::emitWriteBarrier(X64Reg slot, X64Reg value) {
+    emitWriteBarrier(X64Operand::mem(slot), value);
+}
+
+// slot is the store's memory operand; its registers must still be intact
+void NativeCodeGen::emitWriteBarrier(X64Operand slot, X64Reg value) {
+    if (!useGC_) return;
+
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+    slot.size = 8;
+    std::string doneLabel = newLabel("gc_barrier_done");
+    std::string rememberLabel = deferColdBlock("gc_barrier", [this, slot, doneLabel, gcVar]() {
+        // Stores into the nursery itself need no logging; the low bit of an
+        // entry tags whole objects, so only aligned slots are recorded
+        asm_.emit(X64Op::LEA, gpr(X64Reg::R11), slot);
+        asm_.emit(X64Op::SUB, gpr(X64Reg::R11), gcVar(kNurseryStart));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::R11), imm(kNurserySize));
+        asm_.jcc(X64Cond::B, doneLabel);
+        asm_.emit(X64Op::TEST, gpr(X64Reg::R11, 1), imm(7));
+        asm_.jcc(X64Cond::NE, doneLabel);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::R11), slot);
+        asm_.call_rel32(gcRememberLabel_);
+        asm_.jmp_rel32(doneLabel);
+    });
+
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R11), gpr(value));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::R11), gcVar(kNurseryStart));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::R11), imm(kNurserySize));
+    asm_.jcc(X64Cond::B, rememberLabel);
+    asm_.label(doneLabel);
+}
 
-// Emit the GC collection routine (mark-and-sweep)
-// This is called as a function: call gcCollectLabel_
+// Emit the GC runtime: full collection (minor then major), the old-space
+// marker, the nursery collector and the allocation/barrier slow paths
+//
+// Collections run on the thread that holds the GC lock, once every other
+// thread is parked (see codegen_gc_threads.cpp).
+//
+// The major collection marks from the stack roots and traces the heap with
+// the marker pool (codegen_gc_mark.cpp), so objects reachable only from the
+// heap survive. Region cells are marked in their region's bitmap and left for
+// the allocator to sweep; the gc_alloc_head list is swept here.
+//
+// Both collections time their phases into gc_pauses for gc_stats(phase).
 void NativeCodeGen::emitGCCollectRoutine() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+
+    // gc_collect() and the allocation threshold: empty the nursery first so
+    // every live object is in the old space, then mark-and-sweep it
     asm_.label(gcCollectLabel_);
-    
+    asm_.call_rel32(gcMinorLabel_);
+
+    asm_.label(gcMajorLabel_);
+
     // Prologue - save callee-saved registers FIRST, then set up frame
     asm_.push_rbp();
     asm_.mov_rbp_rsp();
-    
-    // Save callee-saved registers we'll use
+
+    // Save every callee-saved register: they may hold the mutator's pointers,
+    // and the stack scan below only sees them once they are pushed
     asm_.push_rbx();
     asm_.push_r12();
     asm_.push_r13();
     asm_.push_r14();
-    
-    // Allocate local space AFTER saving registers
-    asm_.sub_rsp_imm32(0x40);
-    
-    // ===== MARK PHASE =====
-    // First, clear all mark bits
-    // r12 = current object (walks allocation list)
-    asm_.lea_rax_rip_fixup(gcDataRVA_);
-    asm_.mov_rax_mem_rax();  // rax = gc_alloc_head
-    asm_.mov_r12_rax();
-    
-    std::string clearLoopLabel = newLabel("gc_clear_loop");
-    std::string clearDoneLabel = newLabel("gc_clear_done");
-    
-    asm_.label(clearLoopLabel);
-    // if (r12 == NULL) break
-    asm_.code.push_back(0x4D); asm_.code.push_back(0x85); asm_.code.push_back(0xE4);  // test r12, r12
-    asm_.jz_rel32(clearDoneLabel);
-    
-    // Clear mark bit: [r12+6] = 0
-    asm_.code.push_back(0x41); asm_.code.push_back(0xC6);
-    asm_.code.push_back(0x44); asm_.code.push_back(0x24); asm_.code.push_back(0x06);
-    asm_.code.push_back(0x00);  // mov byte [r12+6], 0
-    
-    // r12 = r12->next ([r12+8])
-    asm_.code.push_back(0x4D); asm_.code.push_back(0x8B);
-    asm_.code.push_back(0x64); asm_.code.push_back(0x24); asm_.code.push_back(0x08);  // mov r12, [r12+8]
-    asm_.jmp_rel32(clearLoopLabel);
-    
-    asm_.label(clearDoneLabel);
-    
-    // ===== CONSERVATIVE STACK SCANNING =====
-    // Scan from current RSP to gc_stack_bottom
-    // For each potential pointer, check if it points into our heap
-    
-    // r13 = current stack position (RSP)
-    // r14 = stack bottom
-    asm_.code.push_back(0x49); asm_.code.push_back(0x89); asm_.code.push_back(0xE5);  // mov r13, rsp
-    asm_.lea_rax_rip_fixup(gcDataRVA_ + 40);
-    asm_.mov_rax_mem_rax();
-    asm_.mov_r14_rax();
-    
-    std::string scanLoopLabel = newLabel("gc_scan_loop");
-    std::string scanDoneLabel = newLabel("gc_scan_done");
-    std::string notPtrLabel = newLabel("gc_not_ptr");
-    
-    asm_.label(scanLoopLabel);
-    // if (r13 >= r14) done
-    asm_.code.push_back(0x4D); asm_.code.push_back(0x39); asm_.code.push_back(0xF5);  // cmp r13, r14
-    asm_.jge_rel32(scanDoneLabel);
-    
-    // Load potential pointer from stack: rbx = [r13]
-    asm_.code.push_back(0x49); asm_.code.push_back(0x8B); asm_.code.push_back(0x5D); asm_.code.push_back(0x00);  // mov rbx, [r13]
-    
-    // Check if this looks like a pointer (non-null, aligned)
-    asm_.test_rax_rax();  // Actually test rbx
-    asm_.code.push_back(0x48); asm_.code.push_back(0x85); asm_.code.push_back(0xDB);  // test rbx, rbx
-    asm_.jz_rel32(notPtrLabel);
-    
-    // Check alignment (must be 8-byte aligned for our allocations)
-    asm_.code.push_back(0xF6); asm_.code.push_back(0xC3); asm_.code.push_back(0x07);  // test bl, 7
-    asm_.jnz_rel32(notPtrLabel);
-    
-    // Walk allocation list to see if rbx points to any object's user data
-    // rbx should equal header + 16 for some header in our list
-    // So check if (rbx - 16) is in our allocation list
-    asm_.mov_rax_rbx();
-    asm_.sub_rax_imm32(16);  // rax = potential header
-    
-    // Walk list to find this header
-    asm_.push_r13();  // Save scan position
-    asm_.lea_rcx_rip_fixup(gcDataRVA_);
-    // mov rcx, [rcx] - load gc_alloc_head
-    asm_.code.push_back(0x48); asm_.code.push_back(0x8B); asm_.code.push_back(0x09);
-    
-    std::string findLoopLabel = newLabel("gc_find_loop");
-    std::string foundLabel = newLabel("gc_found");
-    std::string notFoundLabel = newLabel("gc_not_found");
-    
-    asm_.label(findLoopLabel);
-    asm_.code.push_back(0x48); asm_.code.push_back(0x85); asm_.code.push_back(0xC9);  // test rcx, rcx
-    asm_.jz_rel32(notFoundLabel);
-    
-    // if (rcx == rax) found!
-    asm_.cmp_rax_rcx();
-    asm_.code.push_back(0x0F); asm_.code.push_back(0x84);  // je found
-    asm_.fixupLabel(foundLabel);;
-    
-    // rcx = rcx->next
-    asm_.code.push_back(0x48); asm_.code.push_back(0x8B);
-    asm_.code.push_back(0x49); asm_.code.push_back(0x08);  // mov rcx, [rcx+8]
-    asm_.jmp_rel32(findLoopLabel);
-    
-    asm_.label(foundLabel);
-    // Mark this object: [rcx+6] = 1
-    asm_.code.push_back(0xC6); asm_.code.push_back(0x41);
-    asm_.code.push_back(0x06); asm_.code.push_back(0x01);  // mov byte [rcx+6], 1
-    
-    // Note: Recursive tracing of children (LIST, RECORD, CLOSURE) is handled
-    // by the conservative stack scan which will find pointers to child objects
-    // stored on the stack or in registers.
-    
-    asm_.label(notFoundLabel);
-    asm_.pop_r13();  // Restore scan position
-    
-    asm_.label(notPtrLabel);
-    // r13 += 8 (next stack slot)
-    asm_.code.push_back(0x49); asm_.code.push_back(0x83); asm_.code.push_back(0xC5); asm_.code.push_back(0x08);  // add r13, 8
-    asm_.jmp_rel32(scanLoopLabel);
-    
-    asm_.label(scanDoneLabel);
-
-    
-    // ===== SWEEP PHASE =====
-    // Walk allocation list, free unmarked objects, rebuild list
-    // r12 = previous (for relinking), r13 = current
-    // rbx = new head
-    
-    asm_.xor_rbx_rbx();  // new_head = NULL
-    asm_.xor_r12_r12();  // prev = NULL
-    asm_.lea_rax_rip_fixup(gcDataRVA_);
-    asm_.mov_rax_mem_rax();
-    asm_.mov_r13_rax();  // current = gc_alloc_head
-    
-    // r14 = bytes freed (for updating gc_total_bytes)
-    asm_.xor_r14_r14();
-    
-    std::string sweepLoopLabel = newLabel("gc_sweep_loop");
-    std::string sweepDoneLabel = newLabel("gc_sweep_done");
-    std::string keepObjLabel = newLabel("gc_keep_obj");
-    std::string freeObjLabel = newLabel("gc_free_obj");
-    
-    asm_.label(sweepLoopLabel);
-    // if (r13 == NULL) done
-    asm_.code.push_back(0x4D); asm_.code.push_back(0x85); asm_.code.push_back(0xED);  // test r13, r13
-    asm_.jz_rel32(sweepDoneLabel);
-    
-    // Save next pointer before potentially freeing: [rbp-8] = r13->next
-    asm_.code.push_back(0x4D); asm_.code.push_back(0x8B);
-    asm_.code.push_back(0x45); asm_.code.push_back(0x08);  // mov r8, [r13+8] (next)
-    asm_.code.push_back(0x4C); asm_.code.push_back(0x89);
-    asm_.code.push_back(0x45); asm_.code.push_back(0xF8);  // mov [rbp-8], r8
-    
-    // Check mark bit: if ([r13+6] != 0) keep
-    asm_.code.push_back(0x41); asm_.code.push_back(0x80);
-    asm_.code.push_back(0x7D); asm_.code.push_back(0x06); asm_.code.push_back(0x00);  // cmp byte [r13+6], 0
-    asm_.jnz_rel32(keepObjLabel);
-    
-    // ===== FREE THIS OBJECT =====
-    asm_.label(freeObjLabel);
-    
-    // Add size to bytes freed: r14 += [r13+0] (size) + 16 (header)
-    asm_.code.push_back(0x41); asm_.code.push_back(0x8B);
-    asm_.code.push_back(0x45); asm_.code.push_back(0x00);  // mov eax, [r13+0] (size, 32-bit)
-    asm_.code.push_back(0x48); asm_.code.push_back(0x98);  // cdqe (sign extend to 64-bit)
-    asm_.add_rax_imm32(16);  // + header size
-    // Round up to 8-byte alignment
-    asm_.add_rax_imm32(7);
-    asm_.code.push_back(0x48); asm_.code.push_back(0x83); asm_.code.push_back(0xE0); asm_.code.push_back(0xF8);  // and rax, ~7
-    asm_.code.push_back(0x49); asm_.code.push_back(0x01); asm_.code.push_back(0xC6);  // add r14, rax
-    
-    // HeapFree(GetProcessHeap(), 0, r13)
-    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
-    asm_.mov_rcx_rax();
-    asm_.xor_rax_rax();
-    asm_.mov_rdx_rax();  // flags = 0
-    asm_.code.push_back(0x4D); asm_.code.push_back(0x89); asm_.code.push_back(0xE8);  // mov r8, r13
-    asm_.call_mem_rip(pe_.getImportRVA("HeapFree"));
-    
-    // Move to next (don't update prev since we removed current)
-    asm_.code.push_back(0x4C); asm_.code.push_back(0x8B);
-    asm_.code.push_back(0x6D); asm_.code.push_back(0xF8);  // mov r13, [rbp-8] (saved next)
-    asm_.jmp_rel32(sweepLoopLabel);
-    
-    asm_.label(keepObjLabel);
-    // Keep this object - add to new list
-    // Clear mark bit for next collection
-    asm_.code.push_back(0x41); asm_.code.push_back(0xC6);
-    asm_.code.push_back(0x45); asm_.code.push_back(0x06); asm_.code.push_back(0x00);  // mov byte [r13+6], 0
-    
-    // Link: current->next = new_head; new_head = current
-    asm_.code.push_back(0x49); asm_.code.push_back(0x89);
-    asm_.code.push_back(0x5D); asm_.code.push_back(0x08);  // mov [r13+8], rbx
-    asm_.code.push_back(0x4C); asm_.code.push_back(0x89); asm_.code.push_back(0xEB);  // mov rbx, r13
-    
-    // Move to next
-    asm_.code.push_back(0x4C); asm_.code.push_back(0x8B);
-    asm_.code.push_back(0x6D); asm_.code.push_back(0xF8);  // mov r13, [rbp-8]
-    asm_.jmp_rel32(sweepLoopLabel);
-    
-    asm_.label(sweepDoneLabel);
-    
-    // Update gc_alloc_head = new_head (rbx)
-    asm_.lea_rax_rip_fixup(gcDataRVA_);
-    asm_.code.push_back(0x48); asm_.code.push_back(0x89); asm_.code.push_back(0x18);  // mov [rax], rbx
-    
-    // Update gc_total_bytes -= bytes_freed (r14)
-    asm_.lea_rax_rip_fixup(gcDataRVA_ + 8);
-    asm_.mov_rcx_mem_rax();
-    asm_.code.push_back(0x4C); asm_.code.push_back(0x29); asm_.code.push_back(0xF1);  // sub rcx, r14
-    asm_.mov_mem_rax_rcx();
-    
+    asm_.push_r15();
+    asm_.emit(X64Op::PUSH, gpr(X64Reg::RSI));
+    asm_.push_rdi();
+
+    // Allocate local space AFTER saving registers ([rbp-64] = saved next,
+    // [rbp-72] = start, [rbp-80] and [rbp-88] = phase ends)
+    asm_.sub_rsp_imm32(0x48);
+    asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+    emitGCClock(-72);
+    asm_.call_rel32(gcStopLabel_);
+    emitGCClock(-80);
+    emitGCPhaseTime(kGCPhaseSafepoint, -72, -80);
+
+    // ===== CLEAR MARKS =====
+    // Region bitmaps are cleared whole; list objects keep their mark in the
+    // header, and their address range bounds the list search in __TYL_gc_mark
+    {
+        std::string regionLoopLabel = newLabel("gc_clear_regions");
+        std::string regionsDoneLabel = newLabel("gc_clear_regions_done");
+        std::string clearLoopLabel = newLabel("gc_clear_loop");
+        std::string notLowLabel = newLabel("gc_clear_not_low");
+        std::string notHighLabel = newLabel("gc_clear_not_high");
+        std::string clearDoneLabel = newLabel("gc_clear_done");
+
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R12), gcVar(kRegionsBase));
+        asm_.label(regionLoopLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::R12), gcVar(kRegionsTop));
+        asm_.jcc(X64Cond::AE, regionsDoneLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), at(X64Reg::R12));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RDI), imm(kRegionMarks));
+        asm_.mov_ecx_imm32(kRegionMarkBytes / 8);
+        asm_.xor_rax_rax();
+        asm_.code.push_back(0xF3); asm_.code.push_back(0x48); asm_.code.push_back(0xAB);  // rep stosq
+        asm_.emit(X64Op::ADD, gpr(X64Reg::R12), imm(8));
+        asm_.jmp_rel32(regionLoopLabel);
+        asm_.label(regionsDoneLabel);
+
+        // r12 = current object, r8 = lowest user pointer, r9 = highest
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R12), gcVar(kGCAllocHead));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R8), imm(-1));
+        asm_.emit(X64Op::XOR, gpr(X64Reg::R9, 4), gpr(X64Reg::R9, 4));
+        asm_.label(clearLoopLabel);
+        asm_.emit(X64Op::TEST, gpr(X64Reg::R12), gpr(X64Reg::R12));
+        asm_.jz_rel32(clearDoneLabel);
+        asm_.emit(X64Op::MOV, at(X64Reg::R12, 6, 1), imm(0));
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), at(X64Reg::R12, 16));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::R8));
+        asm_.jcc(X64Cond::AE, notLowLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::RAX));
+        asm_.label(notLowLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::R9));
+        asm_.jcc(X64Cond::BE, notHighLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R9), gpr(X64Reg::RAX));
+        asm_.label(notHighLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R12), at(X64Reg::R12, 8));
+        asm_.jmp_rel32(clearLoopLabel);
+        asm_.label(clearDoneLabel);
+        asm_.emit(X64Op::MOV, gcVar(kListLow), gpr(X64Reg::R8));
+        asm_.emit(X64Op::MOV, gcVar(kListHigh), gpr(X64Reg::R9));
+    }
+
+    // ===== WAKE THE MARKERS =====
+    // Empty every mark stack, then let the helpers start stealing; this
+    // thread is marker 0 (r14) from here on
+    {
+        std::string startedLabel = newLabel("gc_markers_started");
+        std::string resetLabel = newLabel("gc_markers_reset");
+        std::string wakeLabel = newLabel("gc_markers_wake");
+        std::string wokenLabel = newLabel("gc_markers_woken");
+
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGCMarkerCount));
+        asm_.test_rax_rax();
+        asm_.jnz_rel32(startedLabel);
+        asm_.call_rel32(gcMarkersStartLabel_);
+        asm_.label(startedLabel);
+
+        asm_.emit(X64Op::LEA, gpr(X64Reg::R14), gcVar(kGCMarkers));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::R14));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), gcVar(kGCMarkerCount));
+        asm_.label(resetLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, at(X64Reg::RCX, kBufferTop), gpr(X64Reg::RAX));
+        asm_.emit(X64Op::MOV, at(X64Reg::RCX, kMarkerHead), imm(0));
+        asm_.emit(X64Op::MOV, at(X64Reg::RCX, kMarkerBytes), imm(0));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), imm(kMarkerSize));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RDX), imm(1));
+        asm_.jnz_rel32(resetLabel);
+        asm_.emit(X64Op::XOR, gpr(X64Reg::R11, 4), gpr(X64Reg::R11, 4));
+        asm_.emit(X64Op::MOV, gcVar(kGCMarkersIdle), gpr(X64Reg::R11));
+        asm_.emit(X64Op::MOV, gcVar(kGCMarkersDone), gpr(X64Reg::R11));
+
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RBX), at(X64Reg::R14, kMarkerSize));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R12), gcVar(kGCMarkerCount));
+        asm_.label(wakeLabel);
+        asm_.emit(X64Op::SUB, gpr(X64Reg::R12), imm(1));
+        asm_.jz_rel32(wokenLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RBX, kMarkerEvent));
+        asm_.call_mem_rip(pe_.getImportRVA("SetEvent"));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RBX), imm(kMarkerSize));
+        asm_.jmp_rel32(wakeLabel);
+        asm_.label(wokenLabel);
+    }
+
+    // ===== STACK ROOTS =====
+    // Any word of a non-scalar slot that points into an old object marks it
+    emitGCRootWalk(56, [this](const std::string& nextLabel) {
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX, 1), imm(GC_SLOT_SCALAR));
+        asm_.jz_rel32(nextLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBX));
+        asm_.call_rel32(gcMarkLabel_);
+    });
+
+    // ===== TRACE =====
+    // Mark alongside the helpers until all are idle, wait for each to be
+    // done with the collection, then total what they marked
+    {
+        std::string waitLabel = newLabel("gc_markers_wait");
+        std::string doneLabel = newLabel("gc_markers_all_done");
+        std::string sumLabel = newLabel("gc_markers_sum");
+
+        asm_.call_rel32(gcMarkDrainLabel_);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCMarkerCount));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), imm(1));
+        asm_.label(waitLabel);
+        asm_.emit(X64Op::CMP, gcVar(kGCMarkersDone), gpr(X64Reg::RCX));
+        asm_.jcc(X64Cond::AE, doneLabel);
+        asm_.code.push_back(0xF3); asm_.code.push_back(0x90);  // pause
+        asm_.jmp_rel32(waitLabel);
+        asm_.label(doneLabel);
+
+        asm_.xor_rax_rax();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::R14));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), gcVar(kGCMarkerCount));
+        asm_.label(sumLabel);
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RAX), at(X64Reg::RCX, kMarkerBytes));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), imm(kMarkerSize));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RDX), imm(1));
+        asm_.jnz_rel32(sumLabel);
+        asm_.emit(X64Op::MOV, gcVar(kGCMarkedBytes), gpr(X64Reg::RAX));
+    }
+    emitGCClock(-88);
+    emitGCPhaseTime(kGCPhaseMark, -80, -88);
+
+    // ===== SWEEP THE LIST =====
+    // Region cells are swept lazily by __TYL_gc_old_alloc. The list is
+    // rebuilt here: r13 = current, rbx = new head, r14 = bytes kept
+    {
+        std::string sweepLoopLabel = newLabel("gc_sweep_loop");
+        std::string sweepDoneLabel = newLabel("gc_sweep_done");
+        std::string keepObjLabel = newLabel("gc_keep_obj");
+        std::string heapFreeLabel = newLabel("gc_heap_free");
+        std::string nextObjLabel = newLabel("gc_sweep_next");
+
+        asm_.xor_rbx_rbx();
+        asm_.xor_r14_r14();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R13), gcVar(kGCAllocHead));
+
+        asm_.label(sweepLoopLabel);
+        asm_.emit(X64Op::TEST, gpr(X64Reg::R13), gpr(X64Reg::R13));
+        asm_.jz_rel32(sweepDoneLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::R13, 8));
+        asm_.emit(X64Op::MOV, at(X64Reg::RBP, -64), gpr(X64Reg::RAX));
+
+        // rax = total bytes of the object
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX, 4), at(X64Reg::R13, 0, 4));
+        asm_.add_rax_imm32(16 + 7);
+        asm_.emit(X64Op::AND, gpr(X64Reg::RAX), imm(-8));
+
+        asm_.emit(X64Op::CMP, at(X64Reg::R13, 6, 1), imm(0));
+        asm_.jnz_rel32(keepObjLabel);
+        // gc_pin()ned objects are never collected
+        asm_.emit(X64Op::TEST, at(X64Reg::R13, 7, 1), imm(GC_FLAG_PINNED));
+        asm_.jnz_rel32(keepObjLabel);
+
+        // Objects promoted in place still live in the nursery: zeroing them
+        // hands the space back to the bump allocator
+        asm_.emit(X64Op::TEST, at(X64Reg::R13, 7, 1), imm(GC_FLAG_NURSERY));
+        asm_.jz_rel32(heapFreeLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::RAX));
+        asm_.emit(X64Op::SHR, gpr(X64Reg::RCX), imm(3));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), gpr(X64Reg::R13));
+        asm_.xor_rax_rax();
+        asm_.code.push_back(0xF3); asm_.code.push_back(0x48); asm_.code.push_back(0xAB);  // rep stosq
+        asm_.jmp_rel32(nextObjLabel);
+
+        asm_.label(heapFreeLabel);
+        asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+        asm_.mov_rcx_rax();
+        asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::R13));
+        asm_.call_mem_rip(pe_.getImportRVA("HeapFree"));
+        asm_.jmp_rel32(nextObjLabel);
+
+        // Keep: clear the mark for next time and link into the new list
+        asm_.label(keepObjLabel);
+        asm_.emit(X64Op::ADD, gpr(X64Reg::R14), gpr(X64Reg::RAX));
+        asm_.emit(X64Op::MOV, at(X64Reg::R13, 6, 1), imm(0));
+        asm_.emit(X64Op::MOV, at(X64Reg::R13, 8), gpr(X64Reg::RBX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gpr(X64Reg::R13));
+
+        asm_.label(nextObjLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R13), at(X64Reg::RBP, -64));
+        asm_.jmp_rel32(sweepLoopLabel);
+        asm_.label(sweepDoneLabel);
+        asm_.emit(X64Op::MOV, gcVar(kGCAllocHead), gpr(X64Reg::RBX));
+    }
+
+    // The old space now holds what was marked plus the kept list objects
+    asm_.emit(X64Op::ADD, gpr(X64Reg::R14), gcVar(kGCMarkedBytes));
+    asm_.emit(X64Op::MOV, gcVar(kGCTotalBytes), gpr(X64Reg::R14));
+
+    // Next threshold: gc_heap_growth percent of what survived, saturating,
+    // then kept within gc_heap_min and gc_heap_max
+    {
+        std::string fitsLabel = newLabel("gc_threshold_fits");
+        std::string aboveMinLabel = newLabel("gc_threshold_above_min");
+        std::string belowMaxLabel = newLabel("gc_threshold_below_max");
+
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::R14));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCHeapGrowth));
+        asm_.emit(X64Op::MUL, gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), imm(100));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RDX), gpr(X64Reg::RCX));
+        asm_.jcc(X64Cond::B, fitsLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), imm(-1));
+        asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+        asm_.label(fitsLabel);
+        asm_.emit(X64Op::DIV, gpr(X64Reg::RCX));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kGCHeapMin));
+        asm_.jcc(X64Cond::AE, aboveMinLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGCHeapMin));
+        asm_.label(aboveMinLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCHeapMax));
+        asm_.emit(X64Op::TEST, gpr(X64Reg::RCX), gpr(X64Reg::RCX));
+        asm_.jz_rel32(belowMaxLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::RCX));
+        asm_.jcc(X64Cond::BE, belowMaxLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::RCX));
+        asm_.label(belowMaxLabel);
+        asm_.emit(X64Op::MOV, gcVar(kGCThreshold), gpr(X64Reg::RAX));
+    }
+
+    // Every size class starts over: no free cells until its first region is swept
+    {
+        std::string resetLabel = newLabel("gc_reset_class");
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), X64Operand::ripRVA(gcDataRVA_ + kSizeClassTable));
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), X64Operand::ripRVA(gcDataRVA_ + kSizeClassMap));
+        asm_.label(resetLabel);
+        asm_.emit(X64Op::MOV, at(X64Reg::RCX, kSizeClassFree), imm(0));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RCX, kSizeClassRegions));
+        asm_.emit(X64Op::MOV, at(X64Reg::RCX, kSizeClassSweep), gpr(X64Reg::RAX));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), imm(kSizeClassEntry));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), gpr(X64Reg::RDX));
+        asm_.jcc(X64Cond::B, resetLabel);
+    }
+
     // Increment gc_collections counter
     asm_.lea_rax_rip_fixup(gcDataRVA_ + 32);
     asm_.mov_rcx_mem_rax();
     asm_.inc_rcx();
     asm_.mov_mem_rax_rcx();
-    
-    // Epilogue - deallocate local space first, then restore registers
-    asm_.add_rsp_imm32(0x40);  // Deallocate local space
-    
-    // Restore callee-saved registers (in reverse order of saving)
+
+    emitGCClock(-80);
+    emitGCPhaseTime(kGCPhaseSweep, -88, -80);
+    emitGCPhaseTime(kGCPhaseLongest, -72, -80);
+
+    // Epilogue - restore callee-saved registers (in reverse order of saving)
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RSP), at(X64Reg::RBP, -56));
+    asm_.pop_rdi();
+    asm_.emit(X64Op::POP, gpr(X64Reg::RSI));
+    asm_.pop_r15();
     asm_.pop_r14();
     asm_.pop_r13();
     asm_.pop_r12();
     asm_.pop_rbx();
-    
+
     // Restore frame pointer and return
     asm_.pop_rbp();
     asm_.ret();
+
+    emitGCMinorRoutine();
+    emitGCOldAllocRoutine();
+    emitGCMarkRoutine();
+    emitGCGrayPushRoutine();
+    emitGCGrowRoutine();
+    emitGCThreadRoutines();
+    emitGCMarkerRoutines();
+    emitGCAllocSlowRoutine();
+    emitGCRememberRoutine();
+    emitGCInitRoutine();
+    emitGCEnvSizeRoutine();
+    emitGCHeapBytesRoutine();
+    emitGCFrameMapRoutine();
+}
+
+// __TYL_gc_init: register the main thread, apply the TYL_GC_HEAP_*
+// overrides, then reserve the nursery, its start bitmap and the remembered
+// set in one block. If that fails nursery_start stays 0 and every
+// allocation takes the old-space path.
+void NativeCodeGen::emitGCInitRoutine() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+    std::string tlsLabel = newLabel("gc_init_tls");
+    std::string doneLabel = newLabel("gc_init_done");
+
+    asm_.label(gcInitLabel_);
+    asm_.push_rbp();
+    asm_.mov_rbp_rsp();
+    asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+    asm_.sub_rsp_imm32(0x20);
+
+    // The allocation fast path reads the slot straight from the TEB, so it
+    // must be one of the first 64
+    asm_.call_mem_rip(pe_.getImportRVA("TlsAlloc"));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX, 4), imm(kTebTlsSlotCount));
+    asm_.jcc(X64Cond::B, tlsLabel);
+    asm_.mov_ecx_imm32(1);
+    asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
+    asm_.label(tlsLabel);
+    asm_.emit(X64Op::MOV, gcVar(kGCTlsIndex), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), gcVar(kGCMainThread));
+    asm_.emit(X64Op::MOV, gcVar(kGCThreads), gpr(X64Reg::RDX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCStackBottom));
+    asm_.emit(X64Op::MOV, at(X64Reg::RDX, kThreadStackBottom), gpr(X64Reg::RCX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), gpr(X64Reg::RAX, 4));
+    asm_.call_mem_rip(pe_.getImportRVA("TlsSetValue"));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), gcVar(kGCTimerFreq));
+    asm_.call_mem_rip(pe_.getImportRVA("QueryPerformanceFrequency"));
+
+    const std::pair<const char*, int32_t> sizingVars[] = {
+        {"TYL_GC_HEAP_MIN", kGCHeapMin}, {"TYL_GC_HEAP_MAX", kGCHeapMax}, {"TYL_GC_HEAP_GROWTH", kGCHeapGrowth}};
+    for (const auto& [name, slot] : sizingVars) {
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), X64Operand::ripRVA(addString(name)));
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), gcVar(slot));
+        asm_.call_rel32(gcEnvSizeLabel_);
+    }
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGCHeapMin));
+    asm_.emit(X64Op::MOV, gcVar(kGCThreshold), gpr(X64Reg::RAX));
+
+    // VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)
+    asm_.emit(X64Op::XOR, gpr(X64Reg::RCX, 4), gpr(X64Reg::RCX, 4));
+    asm_.mov_edx_imm32(kNurserySize + kNurseryStartsBytes + kRememberedBytes);
+    asm_.mov_r8d_imm32(0x3000);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R9, 4), imm(0x04));
+    asm_.call_mem_rip(pe_.getImportRVA("VirtualAlloc"));
+    asm_.test_rax_rax();
+    asm_.jz_rel32(doneLabel);
+
+    // The whole nursery is one free run; the first allocation takes a TLAB
+    asm_.emit(X64Op::MOV, gcVar(kNurseryStart), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gcVar(kNurseryCursor), gpr(X64Reg::RAX));
+    asm_.add_rax_imm32(kNurserySize);
+    asm_.emit(X64Op::MOV, gcVar(kNurseryLimit), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gcVar(kNurseryStarts), gpr(X64Reg::RAX));
+    asm_.add_rax_imm32(kNurseryStartsBytes);
+    asm_.emit(X64Op::MOV, gcVar(kRememberedBase), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gcVar(kRememberedTop), gpr(X64Reg::RAX));
+    asm_.add_rax_imm32(kRememberedBytes);
+    asm_.emit(X64Op::MOV, gcVar(kRememberedEnd), gpr(X64Reg::RAX));
+
+    asm_.label(doneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RSP), gpr(X64Reg::RBP));
+    asm_.pop_rbp();
+    asm_.ret();
+}
+
+// __TYL_gc_env_size
+// Input: RCX = environment variable name, RDX = data block qword
+// A decimal count with an optional K, M or G suffix replaces the qword;
+// anything else (or no variable) leaves it alone.
+void NativeCodeGen::emitGCEnvSizeRoutine() {
+    std::string digitLabel = newLabel("gc_env_digit");
+    std::string suffixLabel = newLabel("gc_env_suffix");
+    std::string notKiloLabel = newLabel("gc_env_not_k");
+    std::string notMegaLabel = newLabel("gc_env_not_m");
+    std::string unitLabel = newLabel("gc_env_unit");
+    std::string storeLabel = newLabel("gc_env_store");
+    std::string doneLabel = newLabel("gc_env_done");
+    constexpr int32_t kBufferBytes = 32;
+
+    asm_.label(gcEnvSizeLabel_);
+    asm_.push_rbp();
+    asm_.mov_rbp_rsp();
+    asm_.push_rbx();
+    asm_.sub_rsp_imm32(0x48);
+    asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gpr(X64Reg::RDX));
+
+    // GetEnvironmentVariableA(name, buffer, size): 0 if unset, size or more
+    // if it does not fit
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), at(X64Reg::RSP, 0x20));
+    asm_.mov_r8d_imm32(kBufferBytes);
+    asm_.call_mem_rip(pe_.getImportRVA("GetEnvironmentVariableA"));
+    asm_.emit(X64Op::TEST, gpr(X64Reg::RAX, 4), gpr(X64Reg::RAX, 4));
+    asm_.jz_rel32(doneLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX, 4), imm(kBufferBytes));
+    asm_.jcc(X64Cond::AE, doneLabel);
+
+    // rax = value, rcx = next character
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), at(X64Reg::RSP, 0x20));
+    asm_.xor_rax_rax();
+    asm_.label(digitLabel);
+    asm_.emit(X64Op::MOVZX, gpr(X64Reg::RDX, 4), at(X64Reg::RCX, 0, 1));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RDX, 4), imm('0'));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RDX, 4), imm(9));
+    asm_.jcc(X64Cond::A, suffixLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), X64Operand::mem(X64Reg::RAX, X64Reg::RAX, 4, 0));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RAX), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RAX), gpr(X64Reg::RDX));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), imm(1));
+    asm_.jmp_rel32(digitLabel);
+
+    // At least one digit, then the end or one suffix letter (either case)
+    asm_.label(suffixLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), at(X64Reg::RSP, 0x20));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), gpr(X64Reg::RDX));
+    asm_.jz_rel32(doneLabel);
+    asm_.emit(X64Op::MOVZX, gpr(X64Reg::RDX, 4), at(X64Reg::RCX, 0, 1));
+    asm_.emit(X64Op::TEST, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+    asm_.jz_rel32(storeLabel);
+    asm_.emit(X64Op::OR, gpr(X64Reg::RDX, 4), imm(0x20));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RDX, 4), imm('k'));
+    asm_.jnz_rel32(notKiloLabel);
+    asm_.emit(X64Op::SHL, gpr(X64Reg::RAX), imm(10));
+    asm_.jmp_rel32(unitLabel);
+    asm_.label(notKiloLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RDX, 4), imm('m'));
+    asm_.jnz_rel32(notMegaLabel);
+    asm_.emit(X64Op::SHL, gpr(X64Reg::RAX), imm(20));
+    asm_.jmp_rel32(unitLabel);
+    asm_.label(notMegaLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RDX, 4), imm('g'));
+    asm_.jnz_rel32(doneLabel);
+    asm_.emit(X64Op::SHL, gpr(X64Reg::RAX), imm(30));
+    asm_.label(unitLabel);
+    asm_.emit(X64Op::CMP, at(X64Reg::RCX, 1, 1), imm(0));
+    asm_.jnz_rel32(doneLabel);
+
+    asm_.label(storeLabel);
+    asm_.emit(X64Op::MOV, at(X64Reg::RBX), gpr(X64Reg::RAX));
+    asm_.label(doneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), at(X64Reg::RBP, -8));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RSP), gpr(X64Reg::RBP));
+    asm_.pop_rbp();
+    asm_.ret();
+}
+
+// Advance cursor from a zero qword to the next nonzero one (an object
+// header) or to limit. Clobbers RAX, RCX, RDI.
+void NativeCodeGen::emitNurserySkipFree(X64Reg cursor, X64Reg limit) {
+    std::string foundLabel = newLabel("gc_free_run_end");
+    std::string doneLabel = newLabel("gc_free_run_done");
+
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), gpr(cursor));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(limit));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), gpr(cursor));
+    asm_.emit(X64Op::SHR, gpr(X64Reg::RCX), imm(3));
+    asm_.xor_rax_rax();
+    asm_.code.push_back(0xF3); asm_.code.push_back(0x48); asm_.code.push_back(0xAF);  // repe scasq
+    asm_.jnz_rel32(foundLabel);
+    asm_.emit(X64Op::MOV, gpr(cursor), gpr(limit));
+    asm_.jmp_rel32(doneLabel);
+    asm_.label(foundLabel);
+    asm_.emit(X64Op::LEA, gpr(cursor), at(X64Reg::RDI, -8));
+    asm_.label(doneLabel);
+}
+
+// Read the performance counter into [rbp+slot], which must be above the
+// frame's shadow space. Clobbers the volatile registers.
+void NativeCodeGen::emitGCClock(int32_t slot) {
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), at(X64Reg::RBP, slot));
+    asm_.call_mem_rip(pe_.getImportRVA("QueryPerformanceCounter"));
+}
+
+// Add the ticks from [rbp+from] to [rbp+to] to a phase's pause total, or
+// for kGCPhaseLongest keep them if they beat it. Clobbers RAX.
+void NativeCodeGen::emitGCPhaseTime(int32_t phase, int32_t from, int32_t to) {
+    auto total = X64Operand::ripRVA(gcDataRVA_ + kGCPauses + phase * 8);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBP, to));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RAX), at(X64Reg::RBP, from));
+    if (phase == kGCPhaseLongest) {
+        std::string shorterLabel = newLabel("gc_pause_shorter");
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), total);
+        asm_.jcc(X64Cond::BE, shorterLabel);
+        asm_.emit(X64Op::MOV, total, gpr(X64Reg::RAX));
+        asm_.label(shorterLabel);
+    } else {
+        asm_.emit(X64Op::ADD, total, gpr(X64Reg::RAX));
+    }
+}
+
+// __TYL_gc_alloc_slow
+// Input: RCX = total bytes (header included, 8-aligned)
+// Output: RAX = zeroed block, RDX = generation flags for the header's top byte
+//
+// Runs under the GC lock. Small objects take a new TLAB of up to kTLABSize
+// from the next free run in the nursery that fits, past nursery_cursor,
+// running a minor collection (and a major one once the old space passes
+// gc_threshold) when the nursery is exhausted. Large objects, or any object
+// when the nursery is unavailable or full with GC disabled, are allocated
+// old: in a size-class cell up to kMaxSizeClassBytes, else from the process
+// heap onto the gc_alloc_head list. Their initializing stores have no
+// barrier, so they go in the remembered set whole.
+//
+// __TYL_gc_alloc_old enters the same routine straight at the old-space path.
+void NativeCodeGen::emitGCAllocSlowRoutine() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+    std::string retryLabel = newLabel("gc_refill");
+    std::string searchLabel = newLabel("gc_refill_search");
+    std::string skipObjectLabel = newLabel("gc_refill_skip");
+    std::string exhaustedLabel = newLabel("gc_refill_exhausted");
+    std::string oldLabel = newLabel("gc_alloc_old");
+    std::string allocOldLabel = newLabel("gc_alloc_old_cell");
+    std::string heapAllocLabel = newLabel("gc_alloc_old_heap");
+    std::string failedLabel = newLabel("gc_alloc_old_failed");
+    std::string gotOldLabel = newLabel("gc_alloc_old_ok");
+    std::string entryLabel = newLabel("gc_alloc_slow_entry");
+    std::string doneLabel = newLabel("gc_alloc_slow_done");
+
+    asm_.label(gcAllocOldLabel_);
+    asm_.mov_rax_imm32(1);
+    asm_.jmp_rel32(entryLabel);
+
+    asm_.label(gcAllocSlowLabel_);
+    asm_.xor_rax_rax();
+    asm_.label(entryLabel);
+    asm_.push_rbp();
+    asm_.mov_rbp_rsp();
+    asm_.push_rbx();
+    asm_.push_r12();
+    asm_.push_rdi();
+    asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+    asm_.sub_rsp_imm32(0x20);
+
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gpr(X64Reg::RCX));      // rbx = bytes
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R12), gpr(X64Reg::RAX));
+    asm_.call_rel32(gcLockLabel_);
+    asm_.emit(X64Op::TEST, gpr(X64Reg::R12), gpr(X64Reg::R12));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R12, 4), imm(0));               // r12 = collected already
+    asm_.jnz_rel32(oldLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kNurseryStart));
+    asm_.test_rax_rax();
+    asm_.jz_rel32(oldLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RBX), imm(kNurseryMaxObject));
+    asm_.jcc(X64Cond::A, oldLabel);
+
+    // Resume the search where the last TLAB ended; r8 = nursery limit
+    asm_.label(retryLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), gcVar(kNurseryCursor));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gcVar(kNurseryLimit));
+
+    asm_.label(searchLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RDX), gpr(X64Reg::R8));
+    asm_.jcc(X64Cond::AE, exhaustedLabel);
+    asm_.emit(X64Op::CMP, at(X64Reg::RDX), imm(0));
+    asm_.jnz_rel32(skipObjectLabel);
+
+    // Free run [rdx, r9), scanned no further than kTLABSize: if the object
+    // fits, the run is the TLAB and the object the start of it. A run cut
+    // short by that cap holds kTLABSize bytes, more than any nursery object.
+    std::string capLabel = newLabel("gc_refill_cap");
+    std::string tooSmallLabel = newLabel("gc_refill_small");
+    asm_.emit(X64Op::LEA, gpr(X64Reg::R10), at(X64Reg::RDX, kTLABSize));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::R10), gpr(X64Reg::R8));
+    asm_.jcc(X64Cond::BE, capLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R10), gpr(X64Reg::R8));
+    asm_.label(capLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R9), gpr(X64Reg::RDX));
+    emitNurserySkipFree(X64Reg::R9, X64Reg::R10);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::R9));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RAX), gpr(X64Reg::RDX));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::RBX));
+    asm_.jcc(X64Cond::B, tooSmallLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::R9));
+    asm_.emit(X64Op::MOV, gcVar(kNurseryCursor), gpr(X64Reg::RAX));
+    emitGCThreadRecord(X64Reg::RCX);
+    asm_.emit(X64Op::MOV, at(X64Reg::RCX, kThreadEnd), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), X64Operand::mem(X64Reg::RDX, X64Reg::RBX, 1, 0));
+    asm_.emit(X64Op::MOV, at(X64Reg::RCX, kThreadTop), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::RDX));
+    asm_.mov_rdx_imm64(static_cast<int64_t>(headerFlags(GC_FLAG_NURSERY)));
+    asm_.jmp_rel32(doneLabel);
+
+    asm_.label(tooSmallLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), gpr(X64Reg::R9));
+    asm_.jmp_rel32(searchLabel);
+
+    // Live (promoted) object: skip header + size
+    asm_.label(skipObjectLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX, 4), at(X64Reg::RDX, 0, 4));
+    asm_.add_rax_imm32(16 + 7);
+    asm_.emit(X64Op::AND, gpr(X64Reg::RAX), imm(-8));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RDX), gpr(X64Reg::RAX));
+    asm_.jmp_rel32(searchLabel);
+
+    // Nursery exhausted: collect once, then start over from its beginning
+    asm_.label(exhaustedLabel);
+    asm_.emit(X64Op::TEST, gpr(X64Reg::R12), gpr(X64Reg::R12));
+    asm_.jnz_rel32(oldLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGCEnabled));
+    asm_.test_rax_rax();
+    asm_.jz_rel32(oldLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R12, 4), imm(1));
+    asm_.call_rel32(gcMinorLabel_);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGCTotalBytes));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kGCThreshold));
+    asm_.jcc(X64Cond::BE, retryLabel);
+    asm_.call_rel32(gcMajorLabel_);
+    asm_.jmp_rel32(retryLabel);
+
+    // Old-space allocation, collecting first if it would pass the threshold
+    asm_.label(oldLabel);
+    asm_.emit(X64Op::TEST, gpr(X64Reg::R12), gpr(X64Reg::R12));
+    asm_.jnz_rel32(allocOldLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGCTotalBytes));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RAX), gpr(X64Reg::RBX));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kGCThreshold));
+    asm_.jcc(X64Cond::BE, allocOldLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGCEnabled));
+    asm_.test_rax_rax();
+    asm_.jz_rel32(allocOldLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R12, 4), imm(1));
+    asm_.call_rel32(gcCollectLabel_);
+
+    // A size-class cell, zeroed up to the object's size; r8 = cell, r9 = cell size
+    asm_.label(allocOldLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RBX), imm(kMaxSizeClassBytes));
+    asm_.jcc(X64Cond::A, heapAllocLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::RBX));
+    asm_.call_rel32(gcOldAllocLabel_);
+    asm_.test_rax_rax();
+    asm_.jz_rel32(failedLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R9), gpr(X64Reg::RDX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::RBX));
+    asm_.emit(X64Op::SHR, gpr(X64Reg::RCX), imm(3));
+    asm_.xor_rax_rax();
+    asm_.code.push_back(0xF3); asm_.code.push_back(0x48); asm_.code.push_back(0xAB);  // rep stosq
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::R8));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCTotalBytes));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), gpr(X64Reg::R9));
+    asm_.emit(X64Op::MOV, gcVar(kGCTotalBytes), gpr(X64Reg::RCX));
+    asm_.jmp_rel32(gotOldLabel);
+
+    asm_.label(heapAllocLabel);
+    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+    asm_.mov_rcx_rax();
+    asm_.mov_edx_imm32(0x08);  // HEAP_ZERO_MEMORY
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::RBX));
+    asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
+    asm_.test_rax_rax();
+    asm_.jz_rel32(failedLabel);
+
+    // Link into the old-space list and account for it
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCAllocHead));
+    asm_.emit(X64Op::MOV, at(X64Reg::RAX, 8), gpr(X64Reg::RCX));
+    asm_.emit(X64Op::MOV, gcVar(kGCAllocHead), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCTotalBytes));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), gpr(X64Reg::RBX));
+    asm_.emit(X64Op::MOV, gcVar(kGCTotalBytes), gpr(X64Reg::RCX));
+    asm_.jmp_rel32(gotOldLabel);
+
+    // Allocation failed - collect and retry once
+    asm_.label(failedLabel);
+    asm_.emit(X64Op::TEST, gpr(X64Reg::R12), gpr(X64Reg::R12));
+    asm_.jnz_rel32(doneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R12, 4), imm(1));
+    asm_.call_rel32(gcCollectLabel_);
+    asm_.jmp_rel32(allocOldLabel);
+
+    asm_.label(gotOldLabel);
+    // Remember the whole object (user pointer | 1)
+    asm_.emit(X64Op::LEA, gpr(X64Reg::R11), at(X64Reg::RAX, 16 + 1));
+    asm_.call_rel32(gcRememberLabel_);
+    asm_.mov_rdx_imm64(static_cast<int64_t>(headerFlags(GC_FLAG_OLD)));
+
+    asm_.label(doneLabel);
+    emitGCUnlock();
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RSP), at(X64Reg::RBP, -24));
+    asm_.pop_rdi();
+    asm_.pop_r12();
+    asm_.pop_rbx();
+    asm_.pop_rbp();
+    asm_.ret();
+}
+
+// __TYL_gc_remember: append R11 (a slot address) to the remembered set.
+// Called from write barriers in the middle of expressions, so it preserves
+// every register except R11 and flags. Threads claim entries with an atomic
+// add and do not take the GC lock; a full set flags an overflow rather than
+// collecting here, and remembered_top may then pass remembered_end.
+void NativeCodeGen::emitGCRememberRoutine() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+    std::string overflowLabel = newLabel("gc_remember_overflow");
+
+    asm_.label(gcRememberLabel_);
+    asm_.push_rax();
+    asm_.push_rcx();
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), gcVar(kRememberedTop));
+    asm_.mov_rax_imm32(8);
+    asm_.code.push_back(0xF0); asm_.code.push_back(0x48); asm_.code.push_back(0x0F);
+    asm_.code.push_back(0xC1); asm_.code.push_back(0x01);  // lock xadd [rcx], rax
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kRememberedEnd));
+    asm_.jcc(X64Cond::AE, overflowLabel);
+    asm_.emit(X64Op::MOV, at(X64Reg::RAX), gpr(X64Reg::R11));
+    asm_.pop_rcx();
+    asm_.pop_rax();
+    asm_.ret();
+
+    asm_.label(overflowLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX, 4), imm(1));
+    asm_.emit(X64Op::MOV, gcVar(kRememberedOverflow), gpr(X64Reg::RAX));
+    asm_.pop_rcx();
+    asm_.pop_rax();
+    asm_.ret();
+}
+
+// __TYL_gc_heap_bytes: bytes held by live objects (gc_stats). Old space is
+// counted as it grows; young objects since the last minor collection are
+// found by walking the nursery, once the other threads have stopped so every
+// object there is complete. Called with the GC lock held; clobbers the
+// volatile registers.
+void NativeCodeGen::emitGCHeapBytesRoutine() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+    std::string loopLabel = newLabel("gc_bytes_walk");
+    std::string objectLabel = newLabel("gc_bytes_obj");
+    std::string nextLabel = newLabel("gc_bytes_next");
+    std::string doneLabel = newLabel("gc_bytes_done");
+
+    asm_.label(gcHeapBytesLabel_);
+    asm_.push_rdi();
+    asm_.call_rel32(gcStopLabel_);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), gcVar(kGCTotalBytes));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gcVar(kNurseryStart));
+    asm_.emit(X64Op::TEST, gpr(X64Reg::R8), gpr(X64Reg::R8));
+    asm_.jz_rel32(doneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R9), gcVar(kNurseryLimit));
+
+    asm_.label(loopLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::R8), gpr(X64Reg::R9));
+    asm_.jcc(X64Cond::AE, doneLabel);
+    asm_.emit(X64Op::CMP, at(X64Reg::R8), imm(0));
+    asm_.jnz_rel32(objectLabel);
+    emitNurserySkipFree(X64Reg::R8, X64Reg::R9);
+    asm_.jmp_rel32(loopLabel);
+
+    // Promoted residents are already in gc_total_bytes
+    asm_.label(objectLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX, 4), at(X64Reg::R8, 0, 4));
+    asm_.add_rax_imm32(16 + 7);
+    asm_.emit(X64Op::AND, gpr(X64Reg::RAX), imm(-8));
+    asm_.emit(X64Op::TEST, at(X64Reg::R8, 7, 1), imm(GC_FLAG_OLD));
+    asm_.jnz_rel32(nextLabel);
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RDX), gpr(X64Reg::RAX));
+    asm_.label(nextLabel);
+    asm_.emit(X64Op::ADD, gpr(X64Reg::R8), gpr(X64Reg::RAX));
+    asm_.jmp_rel32(loopLabel);
+
+    asm_.label(doneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::RDX));
+    asm_.pop_rdi();
+    asm_.ret();
+}
+
+// __TYL_gc_minor: empty the nursery (mostly-copying, in the style of Bartlett)
+//
+// 1. Rebuild the object-start bitmap by walking the nursery.
+// 2. Walk the stack and saved registers through the frame maps (see
+//    emitGCRootWalk). Scalar slots are skipped. Anything another root points
+//    into - exact or interior - is pinned as a survivor, as are gc_pin()ned
+//    objects: those roots cannot be rewritten, so these stay put.
+// 3. Promote the survivors in place (flag OLD, link into the old list) and
+//    scan objects promoted by earlier collections, which still live here.
+// 4. Treat REFERENCE slots holding an exact object pointer as heap slots.
+// 5. Scan the remembered set - or, after an overflow, every old object.
+// 6. Copy each unpinned young object a scanned slot points at into an
+//    old-space cell, leave a forwarding address and rewrite the slot. Copies
+//    and promotions go on the gray stack, which is scanned until empty.
+// 7. Zero everything in the nursery that is not old. Every thread's TLAB is
+//    dropped, and refills resume at the first free run.
+//
+// The other threads are stopped first: the stack walks cover each of them.
+//
+// Registers: r12 = nursery_start, r13 = start bitmap, r14 = nursery_limit,
+// rbx = slot being processed, r15 = end of the object being scanned (or, in
+// the stack walks, the frame map).
+// Locals: [rbp-64] region table offset, [rbp-72] end of its cells, [rbp-80]
+// word, [rbp-88] young object, [rbp-96] its size, [rbp-104] size of its
+// copy's cell, [rbp-112] the region's cell size, [rbp-120] start, [rbp-128]
+// and [rbp-136] phase ends.
+void NativeCodeGen::emitGCMinorRoutine() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+    std::string findLabel = newLabel("gc_find_young");
+    std::string finishLabel = newLabel("gc_minor_finish");
+
+    // Advance walker past the object whose header it points at
+    auto emitNextObject = [this](X64Reg walker) {
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX, 4), at(walker, 0, 4));
+        asm_.add_rax_imm32(16 + 7);
+        asm_.emit(X64Op::AND, gpr(X64Reg::RAX), imm(-8));
+        asm_.emit(X64Op::ADD, gpr(walker), gpr(X64Reg::RAX));
+    };
+
+    // Walk every object in the nursery: body sees the header in RSI and may
+    // clobber anything but RSI and the nursery registers. A body that frees
+    // the object sets RSI past it and jumps to the loop label it is given.
+    auto emitNurseryWalk = [this, emitNextObject](const std::function<void(const std::string&)>& body) {
+        std::string loopLabel = newLabel("gc_walk");
+        std::string objectLabel = newLabel("gc_walk_obj");
+        std::string doneLabel = newLabel("gc_walk_done");
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), gpr(X64Reg::R12));
+        asm_.label(loopLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RSI), gpr(X64Reg::R14));
+        asm_.jcc(X64Cond::AE, doneLabel);
+        asm_.emit(X64Op::CMP, at(X64Reg::RSI), imm(0));
+        asm_.jnz_rel32(objectLabel);
+        emitNurserySkipFree(X64Reg::RSI, X64Reg::R14);
+        asm_.jmp_rel32(loopLabel);
+        asm_.label(objectLabel);
+        body(loopLabel);
+        emitNextObject(X64Reg::RSI);
+        asm_.jmp_rel32(loopLabel);
+        asm_.label(doneLabel);
+    };
+
+    // Process the heap slot at [rbx]: forward or copy the young object it
+    // points into
+    auto emitProcessSlot = [this, gcVar, findLabel]() {
+        std::string doneLabel = newLabel("gc_slot_done");
+        std::string forwardLabel = newLabel("gc_slot_forward");
+        std::string inPlaceLabel = newLabel("gc_slot_in_place");
+        std::string copyLabel = newLabel("gc_slot_copy");
+
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBX));
+        asm_.emit(X64Op::MOV, at(X64Reg::RBP, -80), gpr(X64Reg::RAX));
+        asm_.call_rel32(findLabel);
+        asm_.test_rax_rax();
+        asm_.jz_rel32(doneLabel);
+        asm_.emit(X64Op::TEST, at(X64Reg::RAX, -9, 1), imm(GC_FLAG_OLD | GC_FLAG_SURVIVOR));
+        asm_.jnz_rel32(doneLabel);
+        asm_.emit(X64Op::TEST, at(X64Reg::RAX, -9, 1), imm(GC_FLAG_FORWARDED));
+        asm_.jnz_rel32(forwardLabel);
+
+        // Copy header and data to an old-space cell (nursery objects always
+        // fit a size class)
+        asm_.emit(X64Op::MOV, at(X64Reg::RBP, -88), gpr(X64Reg::RAX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), at(X64Reg::RAX, -16, 4));
+        asm_.add_rcx_imm32(16 + 7);
+        asm_.emit(X64Op::AND, gpr(X64Reg::RCX), imm(-8));
+        asm_.emit(X64Op::MOV, at(X64Reg::RBP, -96), gpr(X64Reg::RCX));
+        asm_.call_rel32(gcOldAllocLabel_);
+        asm_.emit(X64Op::MOV, at(X64Reg::RBP, -104), gpr(X64Reg::RDX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), at(X64Reg::RBP, -88));
+        asm_.test_rax_rax();
+        asm_.jz_rel32(inPlaceLabel);
+
+        asm_.emit(X64Op::LEA, gpr(X64Reg::R9), at(X64Reg::RDX, -16));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RBP, -96));
+        asm_.label(copyLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R8), X64Operand::mem(X64Reg::R9, X64Reg::RCX, 1, -8));
+        asm_.emit(X64Op::MOV, X64Operand::mem(X64Reg::RAX, X64Reg::RCX, 1, -8), gpr(X64Reg::R8));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), imm(8));
+        asm_.jnz_rel32(copyLabel);
+
+        asm_.emit(X64Op::AND, at(X64Reg::RAX, 7, 1), imm(static_cast<uint8_t>(~GC_FLAG_NURSERY)));
+        asm_.emit(X64Op::OR, at(X64Reg::RAX, 7, 1), imm(GC_FLAG_OLD));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCTotalBytes));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), at(X64Reg::RBP, -104));
+        asm_.emit(X64Op::MOV, gcVar(kGCTotalBytes), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), at(X64Reg::RAX, 16));
+        asm_.emit(X64Op::MOV, at(X64Reg::RDX, -8), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::OR, at(X64Reg::RDX, -9, 1), imm(GC_FLAG_FORWARDED));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::RCX));
+        asm_.call_rel32(gcGrayPushLabel_);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBP, -88));
+
+        // Rewrite the slot, keeping any interior offset
+        asm_.label(forwardLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RBP, -80));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), gpr(X64Reg::RAX));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), at(X64Reg::RAX, -8));
+        asm_.emit(X64Op::MOV, at(X64Reg::RBX), gpr(X64Reg::RCX));
+        asm_.jmp_rel32(doneLabel);
+
+        // Out of memory for the copy: promote it where it is instead
+        asm_.label(inPlaceLabel);
+        asm_.emit(X64Op::OR, at(X64Reg::RDX, -9, 1), imm(GC_FLAG_OLD));
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), at(X64Reg::RDX, -16));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCAllocHead));
+        asm_.emit(X64Op::MOV, at(X64Reg::RAX, 8), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, gcVar(kGCAllocHead), gpr(X64Reg::RAX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCTotalBytes));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), at(X64Reg::RBP, -96));
+        asm_.emit(X64Op::MOV, gcVar(kGCTotalBytes), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::RDX));
+        asm_.call_rel32(gcGrayPushLabel_);
+
+        asm_.label(doneLabel);
+    };
+
+    // Scan every pointer-sized word of the object whose user data is at
+    // RDI (strings hold no pointers)
+    auto emitScanObject = [this, emitProcessSlot]() {
+        std::string loopLabel = newLabel("gc_scan_obj");
+        std::string doneLabel = newLabel("gc_scan_obj_done");
+        asm_.emit(X64Op::CMP, at(X64Reg::RDI, -12, 2), imm(static_cast<int>(GCObjectType::STRING)));
+        asm_.jz_rel32(doneLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R15, 4), at(X64Reg::RDI, -16, 4));
+        asm_.emit(X64Op::AND, gpr(X64Reg::R15), imm(-8));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::R15), gpr(X64Reg::RDI));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gpr(X64Reg::RDI));
+        asm_.label(loopLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RBX), gpr(X64Reg::R15));
+        asm_.jcc(X64Cond::AE, doneLabel);
+        emitProcessSlot();
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RBX), imm(8));
+        asm_.jmp_rel32(loopLabel);
+        asm_.label(doneLabel);
+    };
+
+    asm_.label(gcMinorLabel_);
+    asm_.push_rbp();
+    asm_.mov_rbp_rsp();
+    asm_.push_rbx();
+    asm_.emit(X64Op::PUSH, gpr(X64Reg::RSI));
+    asm_.push_rdi();
+    asm_.push_r12();
+    asm_.push_r13();
+    asm_.push_r14();
+    asm_.push_r15();
+    asm_.sub_rsp_imm32(0x78);
+    asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+    emitGCClock(-120);
+    asm_.call_rel32(gcStopLabel_);
+    emitGCClock(-128);
+    emitGCPhaseTime(kGCPhaseSafepoint, -120, -128);
+
+    // Barriers that lost the race for the last entries moved remembered_top
+    // past the end
+    {
+        std::string inRangeLabel = newLabel("gc_remembered_in_range");
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kRememberedEnd));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kRememberedTop));
+        asm_.jcc(X64Cond::AE, inRangeLabel);
+        asm_.emit(X64Op::MOV, gcVar(kRememberedTop), gpr(X64Reg::RAX));
+        asm_.label(inRangeLabel);
+    }
+
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R12), gcVar(kNurseryStart));
+    asm_.emit(X64Op::TEST, gpr(X64Reg::R12), gpr(X64Reg::R12));
+    asm_.jz_rel32(finishLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R13), gcVar(kNurseryStarts));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R14), gcVar(kNurseryLimit));
+
+    // ===== 1. START BITMAP =====
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), gpr(X64Reg::R13));
+    asm_.mov_ecx_imm32(kNurseryStartsBytes / 8);
+    asm_.xor_rax_rax();
+    asm_.code.push_back(0xF3); asm_.code.push_back(0x48); asm_.code.push_back(0xAB);  // rep stosq
+    emitNurseryWalk([this](const std::string&) {
+        std::string nextLabel = newLabel("gc_bitmap_next");
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), at(X64Reg::RSI, 16));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RAX), gpr(X64Reg::R12));
+        asm_.emit(X64Op::SHR, gpr(X64Reg::RAX), imm(3));
+        asm_.code.push_back(0x49); asm_.code.push_back(0x0F);
+        asm_.code.push_back(0xAB); asm_.code.push_back(0x45); asm_.code.push_back(0x00);  // bts [r13], rax
+        asm_.emit(X64Op::TEST, at(X64Reg::RSI, 7, 1), imm(GC_FLAG_OLD));
+        asm_.jnz_rel32(nextLabel);
+        asm_.emit(X64Op::TEST, at(X64Reg::RSI, 7, 1), imm(GC_FLAG_PINNED));
+        asm_.jz_rel32(nextLabel);
+        asm_.emit(X64Op::OR, at(X64Reg::RSI, 7, 1), imm(GC_FLAG_SURVIVOR));
+        asm_.label(nextLabel);
+    });
+
+    // ===== 2. PIN WHAT THE STACK POINTS AT =====
+    // An exact pointer in a REFERENCE slot is left for step 4
+    emitGCRootWalk(56, [this, findLabel](const std::string& nextLabel) {
+        std::string pinLabel = newLabel("gc_minor_pin");
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX, 1), imm(GC_SLOT_SCALAR));
+        asm_.jz_rel32(nextLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R8, 4), gpr(X64Reg::RAX, 4));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R9), gpr(X64Reg::RAX));
+        asm_.call_rel32(findLabel);
+        asm_.test_rax_rax();
+        asm_.jz_rel32(nextLabel);
+        asm_.emit(X64Op::TEST, at(X64Reg::RAX, -9, 1), imm(GC_FLAG_OLD));
+        asm_.jnz_rel32(nextLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::R8, 1), imm(GC_SLOT_REFERENCE));
+        asm_.jnz_rel32(pinLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::R9));
+        asm_.jz_rel32(nextLabel);
+        asm_.label(pinLabel);
+        asm_.emit(X64Op::OR, at(X64Reg::RAX, -9, 1), imm(GC_FLAG_SURVIVOR));
+    });
+
+    // ===== 3. PROMOTE SURVIVORS, SCAN EARLIER PROMOTIONS =====
+    emitNurseryWalk([this, gcVar, emitScanObject](const std::string&) {
+        std::string residentLabel = newLabel("gc_resident");
+        std::string nextLabel = newLabel("gc_promote_next");
+        asm_.emit(X64Op::TEST, at(X64Reg::RSI, 7, 1), imm(GC_FLAG_OLD));
+        asm_.jnz_rel32(residentLabel);
+        asm_.emit(X64Op::TEST, at(X64Reg::RSI, 7, 1), imm(GC_FLAG_SURVIVOR));
+        asm_.jz_rel32(nextLabel);
+
+        asm_.emit(X64Op::XOR, at(X64Reg::RSI, 7, 1), imm(GC_FLAG_SURVIVOR | GC_FLAG_OLD));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCAllocHead));
+        asm_.emit(X64Op::MOV, at(X64Reg::RSI, 8), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, gcVar(kGCAllocHead), gpr(X64Reg::RSI));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), at(X64Reg::RSI, 0, 4));
+        asm_.add_rcx_imm32(16 + 7);
+        asm_.emit(X64Op::AND, gpr(X64Reg::RCX), imm(-8));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), gcVar(kGCTotalBytes));
+        asm_.emit(X64Op::MOV, gcVar(kGCTotalBytes), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), at(X64Reg::RSI, 16));
+        asm_.call_rel32(gcGrayPushLabel_);
+        asm_.jmp_rel32(nextLabel);
+
+        asm_.label(residentLabel);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RDI), at(X64Reg::RSI, 16));
+        emitScanObject();
+        asm_.label(nextLabel);
+    });
+
+    // ===== 4. PRECISE STACK ROOTS =====
+    emitGCRootWalk(56, [this, emitProcessSlot](const std::string& nextLabel) {
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX, 1), imm(GC_SLOT_REFERENCE));
+        asm_.jnz_rel32(nextLabel);
+        emitProcessSlot();
+    });
+
+    // ===== 5. REMEMBERED SET =====
+    {
+        std::string loopLabel = newLabel("gc_remembered");
+        std::string objectLabel = newLabel("gc_remembered_obj");
+        std::string nextLabel = newLabel("gc_remembered_next");
+        std::string doneLabel = newLabel("gc_remembered_done");
+        std::string overflowLoopLabel = newLabel("gc_overflow_scan");
+        std::string overflowDoneLabel = newLabel("gc_overflow_done");
+
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), gcVar(kRememberedBase));
+        asm_.label(loopLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RSI), gcVar(kRememberedTop));
+        asm_.jcc(X64Cond::AE, doneLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), at(X64Reg::RSI));
+        asm_.emit(X64Op::TEST, gpr(X64Reg::RBX, 1), imm(1));
+        asm_.jnz_rel32(objectLabel);
+        emitProcessSlot();
+        asm_.jmp_rel32(nextLabel);
+        asm_.label(objectLabel);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RDI), at(X64Reg::RBX, -1));
+        emitScanObject();
+        asm_.label(nextLabel);
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RSI), imm(8));
+        asm_.jmp_rel32(loopLabel);
+        asm_.label(doneLabel);
+
+        // After an overflow every old object is a potential root: the list,
+        // then each occupied cell of every region. The region cursor is kept
+        // as an offset, since copying can insert regions and move the table.
+        std::string regionsLabel = newLabel("gc_overflow_regions");
+        std::string regionLoopLabel = newLabel("gc_overflow_region");
+        std::string cellLoopLabel = newLabel("gc_overflow_cell");
+        std::string cellNextLabel = newLabel("gc_overflow_cell_next");
+        std::string regionNextLabel = newLabel("gc_overflow_region_next");
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kRememberedOverflow));
+        asm_.test_rax_rax();
+        asm_.jz_rel32(overflowDoneLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), gcVar(kGCAllocHead));
+        asm_.label(overflowLoopLabel);
+        asm_.emit(X64Op::TEST, gpr(X64Reg::RSI), gpr(X64Reg::RSI));
+        asm_.jz_rel32(regionsLabel);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RDI), at(X64Reg::RSI, 16));
+        emitScanObject();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), at(X64Reg::RSI, 8));
+        asm_.jmp_rel32(overflowLoopLabel);
+
+        asm_.label(regionsLabel);
+        asm_.emit(X64Op::MOV, at(X64Reg::RBP, -64), imm(0));
+        asm_.label(regionLoopLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBP, -64));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RAX), gcVar(kRegionsBase));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kRegionsTop));
+        asm_.jcc(X64Cond::AE, overflowDoneLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RAX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RAX, kRegionCellSize));
+        asm_.emit(X64Op::MOV, at(X64Reg::RBP, -112), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RAX, kRegionCellsEnd));
+        asm_.emit(X64Op::MOV, at(X64Reg::RBP, -72), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), at(X64Reg::RAX, kRegionCells));
+        asm_.label(cellLoopLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RSI), at(X64Reg::RBP, -72));
+        asm_.jcc(X64Cond::AE, regionNextLabel);
+        asm_.emit(X64Op::CMP, at(X64Reg::RSI), imm(0));
+        asm_.jz_rel32(cellNextLabel);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RDI), at(X64Reg::RSI, 16));
+        emitScanObject();
+        asm_.label(cellNextLabel);
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RSI), at(X64Reg::RBP, -112));
+        asm_.jmp_rel32(cellLoopLabel);
+        asm_.label(regionNextLabel);
+        asm_.emit(X64Op::ADD, at(X64Reg::RBP, -64), imm(8));
+        asm_.jmp_rel32(regionLoopLabel);
+        asm_.label(overflowDoneLabel);
+    }
+
+    // ===== 6. SCAN GRAY OBJECTS UNTIL NONE ARE LEFT =====
+    {
+        std::string loopLabel = newLabel("gc_drain");
+        std::string doneLabel = newLabel("gc_drain_done");
+
+        asm_.label(loopLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGrayTop));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kGrayBase));
+        asm_.jz_rel32(doneLabel);
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RAX), imm(8));
+        asm_.emit(X64Op::MOV, gcVar(kGrayTop), gpr(X64Reg::RAX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), at(X64Reg::RAX));
+        emitScanObject();
+        asm_.jmp_rel32(loopLabel);
+        asm_.label(doneLabel);
+    }
+
+    // ===== 7. ZERO DEAD AND FORWARDED OBJECTS =====
+    emitNurseryWalk([this](const std::string& loopLabel) {
+        std::string keepLabel = newLabel("gc_nursery_keep");
+        asm_.emit(X64Op::TEST, at(X64Reg::RSI, 7, 1), imm(GC_FLAG_OLD));
+        asm_.jnz_rel32(keepLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), at(X64Reg::RSI, 0, 4));
+        asm_.add_rcx_imm32(16 + 7);
+        asm_.emit(X64Op::SHR, gpr(X64Reg::RCX), imm(3));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), gpr(X64Reg::RSI));
+        asm_.xor_rax_rax();
+        asm_.code.push_back(0xF3); asm_.code.push_back(0x48); asm_.code.push_back(0xAB);  // rep stosq
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), gpr(X64Reg::RDI));
+        asm_.jmp_rel32(loopLabel);
+        asm_.label(keepLabel);
+    });
+
+    asm_.label(finishLabel);
+    {
+        std::string threadLabel = newLabel("gc_minor_tlab_reset");
+        std::string threadsDoneLabel = newLabel("gc_minor_tlab_reset_done");
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCThreads));
+        asm_.label(threadLabel);
+        asm_.emit(X64Op::TEST, gpr(X64Reg::RCX), gpr(X64Reg::RCX));
+        asm_.jz_rel32(threadsDoneLabel);
+        asm_.emit(X64Op::MOV, at(X64Reg::RCX, kThreadTop), imm(0));
+        asm_.emit(X64Op::MOV, at(X64Reg::RCX, kThreadEnd), imm(0));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RCX, kThreadNext));
+        asm_.jmp_rel32(threadLabel);
+        asm_.label(threadsDoneLabel);
+    }
+    asm_.emit(X64Op::MOV, gcVar(kNurseryCursor), gpr(X64Reg::R12));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kRememberedBase));
+    asm_.emit(X64Op::MOV, gcVar(kRememberedTop), gpr(X64Reg::RAX));
+    asm_.xor_rax_rax();
+    asm_.emit(X64Op::MOV, gcVar(kRememberedOverflow), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGCMinorCollections));
+    asm_.inc_rax();
+    asm_.emit(X64Op::MOV, gcVar(kGCMinorCollections), gpr(X64Reg::RAX));
+    emitGCClock(-136);
+    emitGCPhaseTime(kGCPhaseMinor, -128, -136);
+    emitGCPhaseTime(kGCPhaseLongest, -120, -136);
+
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RSP), at(X64Reg::RBP, -56));
+    asm_.pop_r15();
+    asm_.pop_r14();
+    asm_.pop_r13();
+    asm_.pop_r12();
+    asm_.pop_rdi();
+    asm_.emit(X64Op::POP, gpr(X64Reg::RSI));
+    asm_.pop_rbx();
+    asm_.pop_rbp();
+    asm_.ret();
+
+    // Find the young object RAX points into (user data start through its
+    // last byte). Returns its user pointer in RAX, or 0; clobbers RCX, RDX.
+    // Objects larger than kNurseryMaxObject are never in the nursery, which
+    // bounds the backwards bitmap search.
+    {
+        std::string searchLabel = newLabel("gc_find_search");
+        std::string foundLabel = newLabel("gc_find_found");
+        std::string hitLabel = newLabel("gc_find_hit");
+        std::string noneLabel = newLabel("gc_find_none");
+
+        asm_.label(findLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::RAX));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), gpr(X64Reg::R12));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), imm(kNurserySize));
+        asm_.jcc(X64Cond::AE, noneLabel);
+        asm_.emit(X64Op::SHR, gpr(X64Reg::RCX), imm(3));
+        asm_.mov_edx_imm32(kNurseryMaxObject / 8 + 2);
+        asm_.label(searchLabel);
+        asm_.code.push_back(0x49); asm_.code.push_back(0x0F);
+        asm_.code.push_back(0xA3); asm_.code.push_back(0x4D); asm_.code.push_back(0x00);  // bt [r13], rcx
+        asm_.jcc(X64Cond::B, foundLabel);
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), imm(1));
+        asm_.jcc(X64Cond::B, noneLabel);
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RDX, 4), imm(1));
+        asm_.jz_rel32(noneLabel);
+        asm_.jmp_rel32(searchLabel);
+
+        asm_.label(foundLabel);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), X64Operand::mem(X64Reg::R12, X64Reg::RCX, 8));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::RDX));
+        asm_.jz_rel32(hitLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), at(X64Reg::RDX, -16, 4));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), gpr(X64Reg::RDX));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::RCX));
+        asm_.jcc(X64Cond::AE, noneLabel);
+        asm_.label(hitLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::RDX));
+        asm_.ret();
+        asm_.label(noneLabel);
+        asm_.xor_rax_rax();
+        asm_.ret();
+    }
 }
 
+// Visit every stack word that can hold a root, on every registered thread.
+// The calling GC routine's own thread counts as parked at its rbp, so each
+// stack is walked from the savedBytes of callee-saved registers pushed below
+// the parked frame pointer up to the thread's stack bottom. Frame k covers
+// [its callee's rbp + 16, its rbp) and is described by the map of the code
+// its callee returns to. A link that does not move up the stack ends the
+// walk with one conservative sweep to the bottom. A thread's spawn argument
+// is visited too, as a conservative word, until the thread has started.
+//
+// body sees the word's address in RBX and its GCSlotKind in AL; it may
+// clobber anything but RBX, RSI (the thread), RDI (end of the frame) and R15
+// (its map), and may jump to the label it is given to skip to the next word.
+void NativeCodeGen::emitGCRootWalk(int32_t savedBytes, const std::function<void(const std::string&)>& body) {
+    auto stackBottom = at(X64Reg::RSI, kThreadStackBottom);
+    std::string threadLabel = newLabel("gc_roots_thread");
+    std::string argDoneLabel = newLabel("gc_roots_arg_done");
+    std::string frameLabel = newLabel("gc_roots_frame");
+    std::string brokenLabel = newLabel("gc_roots_broken");
+    std::string wordLabel = newLabel("gc_roots_word");
+    std::string visitLabel = newLabel("gc_roots_visit");
+    std::string nextLabel = newLabel("gc_roots_next");
+    std::string doneLabel = newLabel("gc_roots_done");
+    std::string threadsDoneLabel = newLabel("gc_roots_threads_done");
+
+    emitGCThreadRecord(X64Reg::RSI);
+    asm_.emit(X64Op::MOV, at(X64Reg::RSI, kThreadFrame), gpr(X64Reg::RBP));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), X64Operand::ripRVA(gcDataRVA_ + kGCThreads));
+
+    asm_.label(threadLabel);
+    asm_.emit(X64Op::TEST, gpr(X64Reg::RSI), gpr(X64Reg::RSI));
+    asm_.jz_rel32(threadsDoneLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RBX), at(X64Reg::RSI, kThreadArg));
+    asm_.emit(X64Op::XOR, gpr(X64Reg::RAX, 4), gpr(X64Reg::RAX, 4));
+    body(argDoneLabel);
+    asm_.label(argDoneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), at(X64Reg::RSI, kThreadFrame));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RDI), imm(1));
+    asm_.jcc(X64Cond::BE, doneLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RBX), at(X64Reg::RDI, -savedBytes));
+    asm_.emit(X64Op::XOR, gpr(X64Reg::R15, 4), gpr(X64Reg::R15, 4));
+    asm_.jmp_rel32(wordLabel);
+
+    // RDI = frame pointer whose region was just walked
+    asm_.label(frameLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RDI), stackBottom);
+    asm_.jcc(X64Cond::AE, doneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RDI));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::RDI));
+    asm_.jcc(X64Cond::BE, brokenLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), stackBottom);
+    asm_.jcc(X64Cond::A, brokenLabel);
+    asm_.emit(X64Op::TEST, gpr(X64Reg::RAX, 1), imm(7));
+    asm_.jnz_rel32(brokenLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RBX), at(X64Reg::RDI, 16));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RDI, 8));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), gpr(X64Reg::RAX));
+    asm_.call_rel32(gcFrameMapLabel_);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R15), gpr(X64Reg::RAX));
+    asm_.jmp_rel32(wordLabel);
+
+    asm_.label(brokenLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RBX), at(X64Reg::RDI, 16));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), stackBottom);
+    asm_.emit(X64Op::XOR, gpr(X64Reg::R15, 4), gpr(X64Reg::R15, 4));
+
+    // kinds[i] describes [rbp - 8 * (i + 1)]; words past the map are
+    // conservative
+    asm_.label(wordLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RBX), gpr(X64Reg::RDI));
+    asm_.jcc(X64Cond::AE, frameLabel);
+    asm_.emit(X64Op::XOR, gpr(X64Reg::RAX, 4), gpr(X64Reg::RAX, 4));
+    asm_.emit(X64Op::TEST, gpr(X64Reg::R15), gpr(X64Reg::R15));
+    asm_.jz_rel32(visitLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::RDI));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), gpr(X64Reg::RBX));
+    asm_.emit(X64Op::SHR, gpr(X64Reg::RCX), imm(3));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RCX, 4), at(X64Reg::R15, 0, 4));
+    asm_.jcc(X64Cond::A, visitLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX, 1), X64Operand::mem(X64Reg::R15, X64Reg::RCX, 1, 3, 1));
+
+    asm_.label(visitLabel);
+    body(nextLabel);
+
+    asm_.label(nextLabel);
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RBX), imm(8));
+    asm_.jmp_rel32(wordLabel);
+
+    asm_.label(doneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), at(X64Reg::RSI, kThreadNext));
+    asm_.jmp_rel32(threadLabel);
+
+    asm_.label(threadsDoneLabel);
+    emitGCThreadRecord(X64Reg::RAX);
+    asm_.emit(X64Op::MOV, at(X64Reg::RAX, kThreadFrame), imm(0));
+}
+
+// __TYL_gc_frame_map: RCX = return address; returns the frame map of the
+// code range holding it in RAX, or 0. Clobbers RCX, RDX, R8-R10.
+//
+// Table entries are distances back from the table itself, ordered nearest
+// first: {table - start, table - end, map offset from the table}. The
+// entry for an address is the first whose start distance reaches it.
+void NativeCodeGen::emitGCFrameMapRoutine() {
+    std::string searchLabel = newLabel("gc_frame_search");
+    std::string upperLabel = newLabel("gc_frame_upper");
+    std::string foundLabel = newLabel("gc_frame_found");
+    std::string noneLabel = newLabel("gc_frame_none");
+
+    asm_.label(gcFrameMapLabel_);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), X64Operand::ripLabel(gcFrameTableLabel_));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::RDX));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::R8), gpr(X64Reg::RCX));        // r8 = distance
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), at(X64Reg::RDX, 0, 4));  // rcx = hi
+    asm_.emit(X64Op::XOR, gpr(X64Reg::R9, 4), gpr(X64Reg::R9, 4));    // r9 = lo
+
+    asm_.label(searchLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::R9), gpr(X64Reg::RCX));
+    asm_.jcc(X64Cond::AE, foundLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), X64Operand::mem(X64Reg::R9, X64Reg::RCX, 1));
+    asm_.emit(X64Op::SHR, gpr(X64Reg::RAX), imm(1));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::R10), X64Operand::mem(X64Reg::RAX, X64Reg::RAX, 2));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R10, 4), X64Operand::mem(X64Reg::RDX, X64Reg::R10, 4, 8, 4));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::R10), gpr(X64Reg::R8));
+    asm_.jcc(X64Cond::AE, upperLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::R9), at(X64Reg::RAX, 1));
+    asm_.jmp_rel32(searchLabel);
+    asm_.label(upperLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::RAX));
+    asm_.jmp_rel32(searchLabel);
+
+    asm_.label(foundLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::R9, 4), at(X64Reg::RDX, 0, 4));
+    asm_.jcc(X64Cond::AE, noneLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), X64Operand::mem(X64Reg::R9, X64Reg::R9, 2));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), X64Operand::mem(X64Reg::RDX, X64Reg::RAX, 4, 8));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), at(X64Reg::RAX, 4, 4));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::R8), gpr(X64Reg::RCX));
+    asm_.jcc(X64Cond::BE, noneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), at(X64Reg::RAX, 8, 4));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), X64Operand::mem(X64Reg::RDX, X64Reg::RCX, 1));
+    asm_.ret();
+
+    asm_.label(noneLabel);
+    asm_.xor_rax_rax();
+    asm_.ret();
+}
 
 // Emit list allocation via GC
 // capacity: initial capacity (number of elements)
 // Result: pointer to list data in RAX
 // List layout: [count:8][capacity:8][elements:capacity*8]
-void NativeCodeGen::emitGCAllocList(size_t capacity) {
+void NativeCodeGen::emitGCAllocList(size_t capacity, bool onStack) {
     size_t size = 16 + capacity * 8;  // count + capacity + elements
-    emitGCAlloc(size, GCObjectType::LIST);
+    if (!onStack || !emitStackAlloc(size)) emitGCAlloc(size, GCObjectType::LIST);
     
     // Initialize list header
     asm_.push_rax();
@@ -435,9 +1586,9 @@ void NativeCodeGen::emitGCAllocList(size_t capacity) {
 // typeId: unique type identifier for RTTI (0 = anonymous/unknown)
 // Result: pointer to record data in RAX
 // Record layout: [fieldCount:8][typeId:8][fields:fieldCount*8]
-void NativeCodeGen::emitGCAllocRecord(size_t fieldCount, uint64_t typeId) {
+void NativeCodeGen::emitGCAllocRecord(size_t fieldCount, uint64_t typeId, bool onStack) {
     size_t size = 16 + fieldCount * 8;  // fieldCount + typeId + fields
-    emitGCAlloc(size, GCObjectType::RECORD);
+    if (!onStack || !emitStackAlloc(size)) emitGCAlloc(size, GCObjectType::RECORD);
     
     asm_.push_rax();
     
@@ -464,9 +1615,9 @@ void NativeCodeGen::emitGCAllocRecord(size_t fieldCount, uint64_t typeId) {
 // captureCount: number of captured variables
 // Result: pointer to closure data in RAX
 // Closure layout: [fnPtr:8][captureCount:8][captures:captureCount*8]
-void NativeCodeGen::emitGCAllocClosure(size_t captureCount) {
+void NativeCodeGen::emitGCAllocClosure(size_t captureCount, bool onStack) {
     size_t size = 16 + captureCount * 8;
-    emitGCAlloc(size, GCObjectType::CLOSURE);
+    if (!onStack || !emitStackAlloc(size)) emitGCAlloc(size, GCObjectType::CLOSURE);
     
     asm_.push_rax();
     
@@ -524,8 +1675,29 @@ void NativeCodeGen::emitGCAllocMapEntry() {
 // Emit raw allocation via GC (for general purpose allocations)
 // size: bytes to allocate
 // Result: pointer to data in RAX
-void NativeCodeGen::emitGCAllocRaw(size_t size) {
-    emitGCAlloc(size, GCObjectType::RAW);
+void NativeCodeGen::emitGCAllocRaw(size_t size, bool onStack) {
+    if (!onStack || !emitStackAlloc(size)) emitGCAlloc(size, GCObjectType::RAW);
+}
+
+// Place an allocation escape analysis proved local (noEscape) in the frame.
+// The block is zeroed like a fresh GC object; the conservative stack scan
+// still sees any heap pointers stored in it, and the collector never tries
+// to free it since it is not on the allocation list. Oversized objects
+// return false and go to the heap.
+// Result: pointer to the block in RAX
+bool NativeCodeGen::emitStackAlloc(size_t size) {
+    if (size > kMaxStackAllocBytes) return false;
+    
+    int32_t bytes = static_cast<int32_t>((size + 7) & ~static_cast<size_t>(7));
+    stackOffset -= bytes;
+    int32_t base = stackOffset;
+    
+    asm_.xor_rax_rax();
+    for (int32_t offset = 0; offset < bytes; offset += 8) {
+        asm_.mov_mem_rbp_rax(base + offset);
+    }
+    asm_.lea_rax_rbp(base);
+    return true;
 }
 
 // Emit stack frame push for GC (conservative stack scanning)
@@ -551,12 +1723,12 @@ void NativeCodeGen::emitGCPopFrame() {
 // List layout: [count:8][capacity:8][elements:capacity*8]
 void NativeCodeGen::emitListClone() {
     // Save source pointer
-    allocLocal("$clone_src");
+    allocTemp("$clone_src");
     asm_.mov_mem_rbp_rax(locals["$clone_src"]);
     
     // Get count from source: [rax+0]
     asm_.mov_rcx_mem_rax();  // rcx = count
-    allocLocal("$clone_count");
+    allocTemp("$clone_count");
     asm_.mov_rax_rcx();
     asm_.mov_mem_rbp_rax(locals["$clone_count"]);
     
@@ -564,7 +1736,7 @@ void NativeCodeGen::emitListClone() {
     asm_.mov_rax_mem_rbp(locals["$clone_src"]);
     asm_.add_rax_imm32(8);
     asm_.mov_rax_mem_rax();  // rax = capacity
-    allocLocal("$clone_cap");
+    allocTemp("$clone_cap");
     asm_.mov_mem_rbp_rax(locals["$clone_cap"]);
     
     // Calculate allocation size: 16 + 16 + capacity * 8 (GC header + list header + elements)
@@ -579,13 +1751,11 @@ void NativeCodeGen::emitListClone() {
     asm_.code.push_back(0xE0); asm_.code.push_back(0xF8);  // and rax, -8
     
     // Save total size
-    allocLocal("$clone_size");
+    allocTemp("$clone_size");
     asm_.mov_mem_rbp_rax(locals["$clone_size"]);
     
     // Call HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, size)
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetProcessHeap"));
     
     asm_.mov_rcx_rax();  // heap handle
     asm_.mov_rdx_imm64(0x08);  // HEAP_ZERO_MEMORY
@@ -593,16 +1763,14 @@ void NativeCodeGen::emitListClone() {
     asm_.mov_rax_mem_rbp(locals["$clone_size"]);
     asm_.mov_r8_rax();  // r8 = size
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x20);
-    asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x20);
+    emitCallWithOptimizedStack(pe_.getImportRVA("HeapAlloc"));
     
     // RAX now has allocated memory pointer
     // Skip GC header (16 bytes) to get user data pointer
     asm_.add_rax_imm32(16);
     
     // Save new list pointer
-    allocLocal("$clone_dst");
+    allocTemp("$clone_dst");
     asm_.mov_mem_rbp_rax(locals["$clone_dst"]);
     
     // Initialize new list header
@@ -623,7 +1791,7 @@ void NativeCodeGen::emitListClone() {
     asm_.jz_rel32(endLabel);  // Skip if count == 0
     
     // Initialize loop counter
-    allocLocal("$clone_i");
+    allocTemp("$clone_i");
     asm_.xor_rax_rax();
     asm_.mov_mem_rbp_rax(locals["$clone_i"]);
     
@@ -649,6 +1817,7 @@ void NativeCodeGen::emitListClone() {
     asm_.code.push_back(0x48); asm_.code.push_back(0x01); asm_.code.push_back(0xC8);  // add rax, rcx
     asm_.pop_rcx();  // Restore element value
     asm_.mov_mem_rax_rcx();  // dst[i] = element
+    emitWriteBarrier(X64Reg::RAX, X64Reg::RCX);
     
     // Increment counter
     asm_.mov_rax_mem_rbp(locals["$clone_i"]);
@@ -672,7 +1841,7 @@ void NativeCodeGen::emitListClone() {
 // Output: RAX = new GC-allocated list pointer (with proper header)
 void NativeCodeGen::emitConstListClone(size_t count) {
     // Save source pointer
-    allocLocal("$cclone_src");
+    allocTemp("$cclone_src");
     asm_.mov_mem_rbp_rax(locals["$cclone_src"]);
     
     // Allocate a proper GC list with header
@@ -680,7 +1849,7 @@ void NativeCodeGen::emitConstListClone(size_t count) {
     emitGCAllocList(capacity);
     
     // Save new list pointer
-    allocLocal("$cclone_dst");
+    allocTemp("$cclone_dst");
     asm_.mov_mem_rbp_rax(locals["$cclone_dst"]);
     
     // Set count: [dst+0] = count
@@ -718,7 +1887,7 @@ void NativeCodeGen::emitRecordClone(const std::string& typeName) {
     size_t fieldCount = typeInfo.fieldNames.size();
     
     // Save source pointer
-    allocLocal("$rec_clone_src");
+    allocTemp("$rec_clone_src");
     asm_.mov_mem_rbp_rax(locals["$rec_clone_src"]);
     
     // Allocate new record
@@ -726,7 +1895,7 @@ void NativeCodeGen::emitRecordClone(const std::string& typeName) {
     emitGCAllocRaw(recordSize);
     
     // Save new record pointer
-    allocLocal("$rec_clone_dst");
+    allocTemp("$rec_clone_dst");
     asm_.mov_mem_rbp_rax(locals["$rec_clone_dst"]);
     
     // Copy header (fieldCount and typeId)
@@ -0,0 +1,354 @@
+// Tyl Compiler - Native Code Generator GC Old Space
+// Handles: size-class regions, lazy sweeping, mark bitmaps and the gray stack
+//
+// Old objects of up to 16 KB live in 256 KB regions whose cells all have one
+// size class. Each region keeps its mark bits in a bitmap ahead of its cells,
+// so a major collection clears them with one memset per region and finds an
+// object from any pointer into it with a region table lookup and a divide.
+// Sweeping is left to allocation: a major collection only resets each class
+// to its first region, and the next allocation that finds the class's free
+// list empty sweeps one more region onto it. Bigger objects and nursery
+// residents stay on the gc_alloc_head list, which is swept eagerly.
+
+#include "codegen_gc_layout.h"
+
+namespace tyl {
+
+// __TYL_gc_old_alloc
+// Input: RCX = total bytes (header included, 8-aligned, at most kMaxSizeClassBytes)
+// Output: RAX = cell (not zeroed; free cells only have a zero first qword),
+//         RDX = cell size; RAX = 0 if no region could be added
+// Clobbers the volatile registers.
+void NativeCodeGen::emitGCOldAllocRoutine() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+    std::string loopLabel = newLabel("gc_old_alloc");
+    std::string sweepNextLabel = newLabel("gc_old_sweep_next");
+    std::string newRegionLabel = newLabel("gc_old_region");
+    std::string insertLabel = newLabel("gc_old_region_insert");
+    std::string placeLabel = newLabel("gc_old_region_place");
+    std::string sweepLabel = newLabel("gc_sweep");
+    std::string sweepCellLabel = newLabel("gc_sweep_cell");
+    std::string freeCellLabel = newLabel("gc_sweep_free");
+    std::string failLabel = newLabel("gc_old_alloc_fail");
+    std::string doneLabel = newLabel("gc_old_alloc_done");
+
+    asm_.label(gcOldAllocLabel_);
+    asm_.push_rbp();
+    asm_.mov_rbp_rsp();
+    asm_.push_rbx();
+    asm_.emit(X64Op::PUSH, gpr(X64Reg::RSI));
+    asm_.push_rdi();
+    asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+    asm_.sub_rsp_imm32(0x20);
+
+    // rbx = the size class entry
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), at(X64Reg::RCX, -1));
+    asm_.emit(X64Op::SHR, gpr(X64Reg::RAX), imm(4));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), X64Operand::ripRVA(gcDataRVA_ + kSizeClassMap));
+    asm_.emit(X64Op::MOVZX, gpr(X64Reg::RAX, 4), X64Operand::mem(X64Reg::RDX, X64Reg::RAX, 1, 0, 1));
+    asm_.emit(X64Op::SHL, gpr(X64Reg::RAX), imm(5));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RBX), X64Operand::ripRVA(gcDataRVA_ + kSizeClassTable));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RBX), gpr(X64Reg::RAX));
+
+    // Pop the free list
+    asm_.label(loopLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBX, kSizeClassFree));
+    asm_.test_rax_rax();
+    asm_.jz_rel32(sweepNextLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RAX, 8));
+    asm_.emit(X64Op::MOV, at(X64Reg::RBX, kSizeClassFree), gpr(X64Reg::RCX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), at(X64Reg::RBX, kSizeClassCell));
+    asm_.jmp_rel32(doneLabel);
+
+    // Empty: sweep the next region the last major collection left behind
+    asm_.label(sweepNextLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), at(X64Reg::RBX, kSizeClassSweep));
+    asm_.emit(X64Op::TEST, gpr(X64Reg::RSI), gpr(X64Reg::RSI));
+    asm_.jz_rel32(newRegionLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RSI, kRegionNext));
+    asm_.emit(X64Op::MOV, at(X64Reg::RBX, kSizeClassSweep), gpr(X64Reg::RAX));
+    asm_.jmp_rel32(sweepLabel);
+
+    // All swept: add a region. VirtualAlloc(NULL, kRegionSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE)
+    asm_.label(newRegionLabel);
+    asm_.emit(X64Op::XOR, gpr(X64Reg::RCX, 4), gpr(X64Reg::RCX, 4));
+    asm_.mov_edx_imm32(kRegionSize);
+    asm_.mov_r8d_imm32(0x3000);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R9, 4), imm(0x04));
+    asm_.call_mem_rip(pe_.getImportRVA("VirtualAlloc"));
+    asm_.test_rax_rax();
+    asm_.jz_rel32(failLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), gpr(X64Reg::RAX));
+
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RBX, kSizeClassCell));
+    asm_.emit(X64Op::MOV, at(X64Reg::RSI, kRegionCellSize), gpr(X64Reg::RCX));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), at(X64Reg::RSI, kRegionFirstCell));
+    asm_.emit(X64Op::MOV, at(X64Reg::RSI, kRegionCells), gpr(X64Reg::RAX));
+    asm_.mov_rax_imm32(kRegionSize - kRegionFirstCell);
+    asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+    asm_.emit(X64Op::DIV, gpr(X64Reg::RCX));
+    asm_.emit(X64Op::IMUL, gpr(X64Reg::RAX), gpr(X64Reg::RCX));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), X64Operand::mem(X64Reg::RSI, X64Reg::RAX, 1, kRegionFirstCell));
+    asm_.emit(X64Op::MOV, at(X64Reg::RSI, kRegionCellsEnd), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBX, kSizeClassRegions));
+    asm_.emit(X64Op::MOV, at(X64Reg::RSI, kRegionNext), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, at(X64Reg::RBX, kSizeClassRegions), gpr(X64Reg::RSI));
+
+    // Insert it into the sorted region table
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kRegionsTop));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kRegionsEnd));
+    asm_.jcc(X64Cond::B, insertLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), X64Operand::ripRVA(gcDataRVA_ + kRegionsBase));
+    asm_.call_rel32(gcGrowLabel_);
+    asm_.label(insertLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), gcVar(kRegionsTop));
+    std::string shiftLabel = newLabel("gc_old_region_shift");
+    asm_.label(shiftLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RDX), gcVar(kRegionsBase));
+    asm_.jz_rel32(placeLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RDX, -8));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::RSI));
+    asm_.jcc(X64Cond::B, placeLabel);
+    asm_.emit(X64Op::MOV, at(X64Reg::RDX), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RDX), imm(8));
+    asm_.jmp_rel32(shiftLabel);
+    asm_.label(placeLabel);
+    asm_.emit(X64Op::MOV, at(X64Reg::RDX), gpr(X64Reg::RSI));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kRegionsTop));
+    asm_.add_rax_imm32(8);
+    asm_.emit(X64Op::MOV, gcVar(kRegionsTop), gpr(X64Reg::RAX));
+    // A fresh region sweeps to all free cells
+
+    // Sweep region RSI onto the free list, last cell first so the list runs
+    // in address order: unmarked objects are dead unless gc_pin()ned.
+    // r8 = cell index, r9 = cell size, rdi = cell
+    asm_.label(sweepLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R9), at(X64Reg::RSI, kRegionCellSize));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), at(X64Reg::RSI, kRegionCellsEnd));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::RDI));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RAX), at(X64Reg::RSI, kRegionCells));
+    asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+    asm_.emit(X64Op::DIV, gpr(X64Reg::R9));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::RAX));
+    asm_.label(sweepCellLabel);
+    asm_.emit(X64Op::SUB, gpr(X64Reg::R8), imm(1));
+    asm_.jcc(X64Cond::B, loopLabel);
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RDI), gpr(X64Reg::R9));
+    asm_.code.push_back(0x4C); asm_.code.push_back(0x0F);
+    asm_.code.push_back(0xA3); asm_.code.push_back(0x46); asm_.code.push_back(kRegionMarks);  // bt [rsi+64], r8
+    asm_.jcc(X64Cond::B, sweepCellLabel);
+    asm_.emit(X64Op::CMP, at(X64Reg::RDI), imm(0));
+    asm_.jz_rel32(freeCellLabel);
+    asm_.emit(X64Op::TEST, at(X64Reg::RDI, 7, 1), imm(GC_FLAG_PINNED));
+    asm_.jnz_rel32(sweepCellLabel);
+    asm_.emit(X64Op::MOV, at(X64Reg::RDI), imm(0));
+    asm_.label(freeCellLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBX, kSizeClassFree));
+    asm_.emit(X64Op::MOV, at(X64Reg::RDI, 8), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, at(X64Reg::RBX, kSizeClassFree), gpr(X64Reg::RDI));
+    asm_.jmp_rel32(sweepCellLabel);
+
+    asm_.label(failLabel);
+    asm_.xor_rax_rax();
+    asm_.label(doneLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RSP), at(X64Reg::RBP, -24));
+    asm_.pop_rdi();
+    asm_.emit(X64Op::POP, gpr(X64Reg::RSI));
+    asm_.pop_rbx();
+    asm_.pop_rbp();
+    asm_.ret();
+}
+
+// __TYL_gc_mark: RAX = any word, R14 = the calling marker's record. If it
+// points into a region cell holding an object, or is the user pointer of a
+// gc_alloc_head object, and that object is not marked yet: mark it, count a
+// region cell in the marker's bytes, and push it on the marker's stack unless
+// it is a string. Markers run in parallel, so the mark bits are set with a
+// locked bts: exactly one of them wins each object. Clobbers RAX, RCX, RDX,
+// R8-R11.
+void NativeCodeGen::emitGCMarkRoutine() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+    std::string searchLabel = newLabel("gc_mark_search");
+    std::string upperLabel = newLabel("gc_mark_upper");
+    std::string regionLabel = newLabel("gc_mark_region");
+    std::string listLabel = newLabel("gc_mark_list");
+    std::string listLoopLabel = newLabel("gc_mark_list_walk");
+    std::string listHitLabel = newLabel("gc_mark_list_hit");
+    std::string noneLabel = newLabel("gc_mark_none");
+
+    asm_.label(gcMarkLabel_);
+    asm_.test_rax_rax();
+    asm_.jz_rel32(noneLabel);
+
+    // Binary search the region table for the last region at or below RAX:
+    // r8 = lo, r9 = hi (entry addresses)
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gcVar(kRegionsBase));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R9), gcVar(kRegionsTop));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::R8), gpr(X64Reg::R9));
+    asm_.jz_rel32(listLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), at(X64Reg::R8));
+    asm_.jcc(X64Cond::B, listLabel);
+    asm_.label(searchLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::R9));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), gpr(X64Reg::R8));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), imm(8));
+    asm_.jcc(X64Cond::BE, regionLabel);
+    asm_.emit(X64Op::SHR, gpr(X64Reg::RCX), imm(4));
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), X64Operand::mem(X64Reg::R8, X64Reg::RCX, 8));
+    asm_.emit(X64Op::CMP, at(X64Reg::RDX), gpr(X64Reg::RAX));
+    asm_.jcc(X64Cond::A, upperLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::RDX));
+    asm_.jmp_rel32(searchLabel);
+    asm_.label(upperLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R9), gpr(X64Reg::RDX));
+    asm_.jmp_rel32(searchLabel);
+
+    // r8 = region; r9 = its first cell; rcx = the cell RAX falls in
+    asm_.label(regionLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), at(X64Reg::R8));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), gpr(X64Reg::R8));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), imm(kRegionSize));
+    asm_.jcc(X64Cond::AE, listLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R9), at(X64Reg::R8, kRegionCells));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::R9));
+    asm_.jcc(X64Cond::B, noneLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), at(X64Reg::R8, kRegionCellsEnd));
+    asm_.jcc(X64Cond::AE, noneLabel);
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RAX), gpr(X64Reg::R9));
+    asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+    asm_.emit(X64Op::DIV, at(X64Reg::R8, kRegionCellSize));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::IMUL, gpr(X64Reg::RCX), at(X64Reg::R8, kRegionCellSize));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RCX), gpr(X64Reg::R9));
+    asm_.emit(X64Op::CMP, at(X64Reg::RCX), imm(0));
+    asm_.jz_rel32(noneLabel);
+    asm_.code.push_back(0xF0); asm_.code.push_back(0x49); asm_.code.push_back(0x0F);
+    asm_.code.push_back(0xAB); asm_.code.push_back(0x40); asm_.code.push_back(kRegionMarks);  // lock bts [r8+64], rax
+    asm_.jcc(X64Cond::B, noneLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), at(X64Reg::R8, kRegionCellSize));
+    asm_.emit(X64Op::ADD, at(X64Reg::R14, kMarkerBytes), gpr(X64Reg::RDX));
+    asm_.emit(X64Op::CMP, at(X64Reg::RCX, 4, 2), imm(static_cast<int>(GCObjectType::STRING)));
+    asm_.jz_rel32(noneLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RAX), at(X64Reg::RCX, 16));
+    asm_.jmp_rel32(gcMarkPushLabel_);
+
+    // Not in a region: only exact user pointers of list objects count
+    asm_.label(listLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kListLow));
+    asm_.jcc(X64Cond::B, noneLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kListHigh));
+    asm_.jcc(X64Cond::A, noneLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RDX), at(X64Reg::RAX, -16));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCAllocHead));
+    asm_.label(listLoopLabel);
+    asm_.emit(X64Op::TEST, gpr(X64Reg::RCX), gpr(X64Reg::RCX));
+    asm_.jz_rel32(noneLabel);
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), gpr(X64Reg::RDX));
+    asm_.jz_rel32(listHitLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RCX, 8));
+    asm_.jmp_rel32(listLoopLabel);
+    asm_.label(listHitLabel);
+    asm_.code.push_back(0xF0); asm_.code.push_back(0x48); asm_.code.push_back(0x0F);
+    asm_.code.push_back(0xBA); asm_.code.push_back(0x29); asm_.code.push_back(48);  // lock bts qword [rcx], 48 (the mark byte)
+    asm_.jcc(X64Cond::B, noneLabel);
+    asm_.emit(X64Op::CMP, at(X64Reg::RCX, 4, 2), imm(static_cast<int>(GCObjectType::STRING)));
+    asm_.jz_rel32(noneLabel);
+    asm_.jmp_rel32(gcMarkPushLabel_);
+
+    asm_.label(noneLabel);
+    asm_.ret();
+}
+
+// __TYL_gc_gray_push: push RAX (a user pointer) onto the gray stack.
+// Clobbers RCX, RDX, R8-R11.
+void NativeCodeGen::emitGCGrayPushRoutine() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+    std::string pushLabel = newLabel("gc_gray_store");
+
+    asm_.label(gcGrayPushLabel_);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGrayTop));
+    asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), gcVar(kGrayEnd));
+    asm_.jcc(X64Cond::B, pushLabel);
+    asm_.push_rax();
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), X64Operand::ripRVA(gcDataRVA_ + kGrayBase));
+    asm_.call_rel32(gcGrowLabel_);
+    asm_.pop_rax();
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGrayTop));
+    asm_.label(pushLabel);
+    asm_.emit(X64Op::MOV, at(X64Reg::RCX), gpr(X64Reg::RAX));
+    asm_.add_rcx_imm32(8);
+    asm_.emit(X64Op::MOV, gcVar(kGrayTop), gpr(X64Reg::RCX));
+    asm_.ret();
+}
+
+// __TYL_gc_grow: RCX = address of a base/top/end buffer in the GC data
+// block. Moves it to a block twice the size (64 KB the first time). Running
+// out of memory here ends the process. Clobbers RAX, RCX, RDX, R8-R11.
+void NativeCodeGen::emitGCGrowRoutine() {
+    std::string sizedLabel = newLabel("gc_grow_sized");
+    std::string copiedLabel = newLabel("gc_grow_copied");
+    std::string oomLabel = newLabel("gc_grow_oom");
+
+    asm_.label(gcGrowLabel_);
+    asm_.push_rbp();
+    asm_.mov_rbp_rsp();
+    asm_.push_rbx();
+    asm_.emit(X64Op::PUSH, gpr(X64Reg::RSI));
+    asm_.push_rdi();
+    asm_.push_r12();
+    asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+    asm_.sub_rsp_imm32(0x20);
+
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gpr(X64Reg::RCX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R12), at(X64Reg::RBX, kBufferEnd));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::R12), at(X64Reg::RBX));
+    asm_.emit(X64Op::SHL, gpr(X64Reg::R12), imm(1));
+    asm_.jnz_rel32(sizedLabel);
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R12, 4), imm(64 * 1024));
+    asm_.label(sizedLabel);
+
+    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+    asm_.mov_rcx_rax();
+    asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::R12));
+    asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
+    asm_.test_rax_rax();
+    asm_.jz_rel32(oomLabel);
+
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RDI), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), at(X64Reg::RBX));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::RBX, kBufferTop));
+    asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), gpr(X64Reg::RSI));
+    asm_.emit(X64Op::SHR, gpr(X64Reg::RCX), imm(3));
+    asm_.code.push_back(0xF3); asm_.code.push_back(0x48); asm_.code.push_back(0xA5);  // rep movsq
+    asm_.emit(X64Op::MOV, gpr(X64Reg::RSI), at(X64Reg::RBX));
+    asm_.emit(X64Op::MOV, at(X64Reg::RBX), gpr(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, at(X64Reg::RBX, kBufferTop), gpr(X64Reg::RDI));
+    asm_.emit(X64Op::ADD, gpr(X64Reg::RAX), gpr(X64Reg::R12));
+    asm_.emit(X64Op::MOV, at(X64Reg::RBX, kBufferEnd), gpr(X64Reg::RAX));
+
+    // HeapFree(GetProcessHeap(), 0, old block)
+    asm_.emit(X64Op::TEST, gpr(X64Reg::RSI), gpr(X64Reg::RSI));
+    asm_.jz_rel32(copiedLabel);
+    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+    asm_.mov_rcx_rax();
+    asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+    asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::RSI));
+    asm_.call_mem_rip(pe_.getImportRVA("HeapFree"));
+
+    asm_.label(copiedLabel);
+    asm_.emit(X64Op::LEA, gpr(X64Reg::RSP), at(X64Reg::RBP, -32));
+    asm_.pop_r12();
+    asm_.pop_rdi();
+    asm_.emit(X64Op::POP, gpr(X64Reg::RSI));
+    asm_.pop_rbx();
+    asm_.pop_rbp();
+    asm_.ret();
+
+    asm_.label(oomLabel);
+    asm_.mov_ecx_imm32(1);
+    asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
+}
+
+} // namespace tyl
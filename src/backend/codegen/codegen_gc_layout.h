@@ -0,0 +1,196 @@
+// Tyl Compiler - Native Code Generator GC Layout
+// Data block offsets, heap geometry and emit helpers shared by the GC
+// runtime emitters (codegen_gc.cpp, codegen_gc_heap.cpp, codegen_gc_mark.cpp,
+// codegen_gc_threads.cpp)
+#ifndef TYL_CODEGEN_GC_LAYOUT_H
+#define TYL_CODEGEN_GC_LAYOUT_H
+
+#include "backend/codegen/codegen_base.h"
+
+namespace tyl {
+
+// GC Data Section Layout (offsets from gcDataRVA_):
+// Offset 0:   gc_alloc_head (8 bytes)     - List of old objects outside the regions (large
+//                                            objects, nursery residents)
+// Offset 8:   gc_total_bytes (8 bytes)    - Total bytes held by the old space
+// Offset 16:  gc_threshold (8 bytes)      - Old-space size that triggers a major collection, reset
+//                                            from the survivors by each one (starts at gc_heap_min)
+// Offset 24:  gc_enabled (8 bytes)        - GC enabled flag (1 = enabled, default)
+// Offset 32:  gc_collections (8 bytes)    - Number of major collections performed
+// Offset 40:  gc_stack_bottom (8 bytes)   - Bottom of stack for root scanning
+// Offset 48:  allocator_fn (8 bytes)      - set_allocator() function
+// Offset 56:  allocator_ctx (8 bytes)     - set_allocator() context
+// Offset 64:  nursery_start (8 bytes)     - Nursery base (0 if it could not be reserved)
+// Offset 72:  nursery_cursor (8 bytes)    - Where the next TLAB refill starts looking for free space
+// Offset 80:  gc_tls_index (8 bytes)      - TLS slot holding the current thread's record
+// Offset 88:  nursery_limit (8 bytes)     - nursery_start + kNurserySize
+// Offset 96:  nursery_starts (8 bytes)    - Object-start bitmap, rebuilt by each minor collection
+// Offset 104: remembered_base (8 bytes)   - Remembered set: old-space slots holding nursery pointers
+// Offset 112: remembered_top (8 bytes)
+// Offset 120: remembered_end (8 bytes)
+// Offset 128: remembered_overflow (8 bytes) - Set when the remembered set fills; the next minor
+//                                              collection scans every old object instead
+// Offset 136: gc_minor_collections (8 bytes)
+// Offset 144: regions_base (8 bytes)      - Old-space region addresses, sorted
+// Offset 152: regions_top (8 bytes)
+// Offset 160: regions_end (8 bytes)
+// Offset 168: gray_base (8 bytes)         - Objects marked or copied but not yet scanned
+// Offset 176: gray_top (8 bytes)
+// Offset 184: gray_end (8 bytes)
+// Offset 192: list_low (8 bytes)          - Address range of the gc_alloc_head objects,
+// Offset 200: list_high (8 bytes)           taken by each major collection
+// Offset 208: gc_marked_bytes (8 bytes)   - Region bytes marked by the current major collection
+// Offset 216: gc_lock (8 bytes)           - 1 while a thread refills, allocates old or collects
+// Offset 224: gc_threads (8 bytes)        - Records of the threads that allocate, linked
+// Offset 232: main thread record (48 bytes)
+// Offset 280: gc_marker_count (8 bytes)   - Markers in the pool, 0 until the first major collection
+// Offset 288: gc_markers_idle (8 bytes)   - Markers that found nothing to scan or steal
+// Offset 296: gc_markers_done (8 bytes)   - Helpers finished with the current collection
+// Offset 304: gc_timer_freq (8 bytes)     - QueryPerformanceFrequency
+// Offset 312: gc_pauses (8 bytes per phase) - Pause time per phase, in timer ticks
+// Offset 352: gc_heap_min (8 bytes)       - Lowest threshold (--gc-heap-min, TYL_GC_HEAP_MIN)
+// Offset 360: gc_heap_max (8 bytes)       - Highest threshold, 0 for none (--gc-heap-max, TYL_GC_HEAP_MAX)
+// Offset 368: gc_heap_growth (8 bytes)    - Threshold as a percentage of the bytes that survive a
+//                                            major collection (--gc-heap-growth, TYL_GC_HEAP_GROWTH)
+// Offset 376: markers (64 bytes each)
+// Then:       size classes (32 bytes each): free list, region list, next region to
+//             sweep, cell size
+// Then:       size class map - one byte per 16 bytes of object size
+constexpr int32_t kGCAllocHead = 0;
+constexpr int32_t kGCTotalBytes = 8;
+constexpr int32_t kGCThreshold = 16;
+constexpr int32_t kGCEnabled = 24;
+constexpr int32_t kGCStackBottom = 40;
+constexpr int32_t kNurseryStart = 64;
+constexpr int32_t kNurseryCursor = 72;
+constexpr int32_t kGCTlsIndex = 80;
+constexpr int32_t kNurseryLimit = 88;
+constexpr int32_t kNurseryStarts = 96;
+constexpr int32_t kRememberedBase = 104;
+constexpr int32_t kRememberedTop = 112;
+constexpr int32_t kRememberedEnd = 120;
+constexpr int32_t kRememberedOverflow = 128;
+constexpr int32_t kGCMinorCollections = 136;
+constexpr int32_t kRegionsBase = 144;
+constexpr int32_t kRegionsTop = 152;
+constexpr int32_t kRegionsEnd = 160;
+constexpr int32_t kGrayBase = 168;
+constexpr int32_t kGrayTop = 176;
+constexpr int32_t kGrayEnd = 184;
+constexpr int32_t kListLow = 192;
+constexpr int32_t kListHigh = 200;
+constexpr int32_t kGCMarkedBytes = 208;
+constexpr int32_t kGCLock = 216;
+constexpr int32_t kGCThreads = 224;
+constexpr int32_t kGCMainThread = 232;
+constexpr int32_t kGCMarkerCount = 280;
+constexpr int32_t kGCMarkersIdle = 288;
+constexpr int32_t kGCMarkersDone = 296;
+constexpr int32_t kGCTimerFreq = 304;
+constexpr int32_t kGCPauses = 312;
+constexpr int32_t kGCHeapMin = 352;
+constexpr int32_t kGCHeapMax = 360;
+constexpr int32_t kGCHeapGrowth = 368;
+constexpr int32_t kGCMarkers = 376;
+
+// A growable buffer in the data block is three pointers: base, top, end
+constexpr int32_t kBufferTop = 8;
+constexpr int32_t kBufferEnd = 16;
+
+// Pause phases, in gc_stats(phase) order from 1: waiting for the other
+// threads to park, minor collections, major marking, major sweeping, and the
+// longest single collection (all phases of it)
+constexpr int32_t kGCPhaseSafepoint = 0;
+constexpr int32_t kGCPhaseMinor = 1;
+constexpr int32_t kGCPhaseMark = 2;
+constexpr int32_t kGCPhaseSweep = 3;
+constexpr int32_t kGCPhaseLongest = 4;
+constexpr int32_t kGCPhaseCount = 5;
+
+// Marker records. Marker 0 is the collecting thread, the others are helper
+// threads started by the first major collection. Each has a mark stack the
+// owner pushes and pops at the top and other markers steal from at the
+// head; all three move only under the record's lock.
+constexpr int32_t kMarkerLock = 24;    // 1 while the stack is being changed
+constexpr int32_t kMarkerHead = 32;    // Byte offset of the oldest entry not yet stolen
+constexpr int32_t kMarkerEvent = 40;   // Auto-reset event a helper waits on between collections
+constexpr int32_t kMarkerBytes = 48;   // Region bytes this marker marked
+constexpr int32_t kMarkerSize = 64;    // One cache line each; base/top/end first, as a buffer
+constexpr int32_t kMaxMarkers = 8;
+constexpr int32_t kSizeClassTable = kGCMarkers + kMaxMarkers * kMarkerSize;
+
+// Size class entries
+constexpr int32_t kSizeClassFree = 0;     // Free cells, linked through their header's next field
+constexpr int32_t kSizeClassRegions = 8;  // Regions of this class, linked through their first qword
+constexpr int32_t kSizeClassSweep = 16;   // First region the lazy sweep has not reached
+constexpr int32_t kSizeClassCell = 24;    // Cell size, header included
+constexpr int32_t kSizeClassEntry = 32;
+// 16-byte steps up to 128, then four classes per power of two up to 16 KB
+constexpr int32_t kSizeClassCount = 36;
+constexpr int32_t kMaxSizeClassBytes = 16 * 1024;
+constexpr int32_t kSizeClassMap = kSizeClassTable + kSizeClassCount * kSizeClassEntry;
+constexpr size_t kGCDataSize = kSizeClassMap + kMaxSizeClassBytes / 16;
+
+// The nursery, its start bitmap and the remembered set are one VirtualAlloc
+// reservation made at startup
+constexpr int32_t kNurserySize = 1024 * 1024;
+constexpr int32_t kNurseryStartsBytes = kNurserySize / 64;    // One bit per qword
+constexpr int32_t kRememberedBytes = 4096 * 8;
+constexpr int32_t kNurseryMaxObject = 16 * 1024;              // Bigger objects are allocated old
+
+// Thread record (the main thread's is in the data block, others come from
+// the process heap). The current thread's is in TEB TLS slot gc_tls_index.
+// A thread is parked while its frame field is nonzero: it is waiting for
+// the GC lock or in a blocking call, its callee-saved registers are pushed
+// in the kParkedBytes below that frame pointer, and it touches no GC memory
+// until it holds the lock again.
+constexpr int32_t kThreadTop = 0;           // Bump pointer into the thread's TLAB
+constexpr int32_t kThreadEnd = 8;           // TLAB end; 0 sends the next allocation to the slow path
+constexpr int32_t kThreadNext = 16;         // Next record in gc_threads
+constexpr int32_t kThreadStackBottom = 24;  // Where the root walk of its stack ends
+constexpr int32_t kThreadFrame = 32;        // Parked frame pointer, 1 until started, 0 while running
+constexpr int32_t kThreadArg = 40;          // Spawn argument, a root until the thread has started
+constexpr int32_t kThreadRecordSize = 48;
+constexpr int32_t kParkedBytes = 56;        // rbx, r12-r15, rsi, rdi
+constexpr int32_t kTLABSize = 32 * 1024;    // Nursery carved per refill: each thread's allocation budget
+constexpr int32_t kTebTlsSlots = 0x1480;    // TEB.TlsSlots (x64)
+constexpr int32_t kTebTlsSlotCount = 64;
+
+// Old-space region (one VirtualAlloc each, all cells one size class):
+// Offset 0:    next region of the class
+// Offset 8:    cell size
+// Offset 16:   first cell
+// Offset 24:   end of the last cell
+// Offset 64:   mark bitmap, one bit per cell
+// Offset 2112: cells
+constexpr int32_t kRegionSize = 256 * 1024;
+constexpr int32_t kRegionNext = 0;
+constexpr int32_t kRegionCellSize = 8;
+constexpr int32_t kRegionCells = 16;
+constexpr int32_t kRegionCellsEnd = 24;
+constexpr int32_t kRegionMarks = 64;
+constexpr int32_t kRegionMarkBytes = kRegionSize / 16 / 8;
+constexpr int32_t kRegionFirstCell = kRegionMarks + kRegionMarkBytes;
+
+// GC Object Header Layout (16 bytes, before user data):
+// Offset -16: size (4 bytes)   - Size of user data
+// Offset -12: type (2 bytes)   - Object type for tracing
+// Offset -10: marked (1 byte)  - Mark bit (gc_alloc_head objects; region cells use the bitmap)
+// Offset -9:  flags (1 byte)   - Flags (pinned, generation, etc.)
+// Offset -8:  next (8 bytes)   - Next object in the gc_alloc_head list / forwarding address
+// Offset 0:   User data starts here
+//
+// Nursery objects carry GC_FLAG_NURSERY, so a header qword is never zero and
+// the nursery is always a sequence of objects and zeroed free qwords. Free
+// region cells likewise have a zero first qword.
+
+namespace {
+inline X64Operand gpr(X64Reg r, uint8_t size = 8) { return X64Operand::r(r, size); }
+inline X64Operand imm(int64_t value) { return X64Operand::immediate(value); }
+inline X64Operand at(X64Reg base, int32_t disp = 0, uint8_t size = 8) { return X64Operand::mem(base, disp, size); }
+inline uint64_t headerFlags(uint8_t flags) { return static_cast<uint64_t>(flags) << 56; }
+}
+
+} // namespace tyl
+
+#endif // TYL_CODEGEN_GC_LAYOUT_H
@@ -0,0 +1,294 @@
+// Tyl Compiler - Native Code Generator GC Parallel Marking
+// Handles: the marker thread pool, per-marker mark stacks and work stealing
+//
+// A major collection traces the old space with every marker in the pool.
+// The collecting thread is marker 0: it pushes what the roots mark onto its
+// own stack while the helpers, woken first, steal from it. Each marker pops
+// its own stack and, once that is empty, steals the oldest entry of another.
+// A marker that finds nothing to scan or steal counts itself idle and keeps
+// looking; when every marker is idle, every stack is empty and no object is
+// being scanned, so marking is complete.
+
+#include "codegen_gc_layout.h"
+
+namespace tyl {
+
+void NativeCodeGen::emitGCMarkerRoutines() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+
+    auto emitPause = [this]() {
+        asm_.code.push_back(0xF3); asm_.code.push_back(0x90);  // pause
+    };
+    auto emitMarkerLock = [this, emitPause](X64Reg marker) {
+        std::string spinLabel = newLabel("gc_marker_lock");
+        std::string gotLabel = newLabel("gc_marker_locked");
+        asm_.label(spinLabel);
+        asm_.mov_rax_imm32(1);
+        asm_.emit(X64Op::XCHG, at(marker, kMarkerLock), gpr(X64Reg::RAX));
+        asm_.test_rax_rax();
+        asm_.jz_rel32(gotLabel);
+        emitPause();
+        asm_.jmp_rel32(spinLabel);
+        asm_.label(gotLabel);
+    };
+    auto emitMarkerUnlock = [this](X64Reg marker) {
+        asm_.emit(X64Op::MOV, at(marker, kMarkerLock), imm(0));
+    };
+    // Jump to target if the marker's stack holds an entry not yet stolen
+    // (unlocked, this is only a hint). Clobbers RAX.
+    auto emitJumpIfWork = [this](X64Reg marker, const std::string& target) {
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(marker, kBufferTop));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RAX), at(marker));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), at(marker, kMarkerHead));
+        asm_.jnz_rel32(target);
+    };
+
+    // __TYL_gc_mark_push: push RAX (a user pointer) onto the mark stack of
+    // the marker in R14. Clobbers RCX, RDX, R8-R11.
+    {
+        std::string storeLabel = newLabel("gc_mark_push_store");
+
+        asm_.label(gcMarkPushLabel_);
+        asm_.push_rax();
+        emitMarkerLock(X64Reg::R14);
+        asm_.pop_rax();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::R14, kBufferTop));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), at(X64Reg::R14, kBufferEnd));
+        asm_.jcc(X64Cond::B, storeLabel);
+        asm_.push_rax();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::R14));
+        asm_.call_rel32(gcGrowLabel_);
+        asm_.pop_rax();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::R14, kBufferTop));
+        asm_.label(storeLabel);
+        asm_.emit(X64Op::MOV, at(X64Reg::RCX), gpr(X64Reg::RAX));
+        asm_.add_rcx_imm32(8);
+        asm_.emit(X64Op::MOV, at(X64Reg::R14, kBufferTop), gpr(X64Reg::RCX));
+        emitMarkerUnlock(X64Reg::R14);
+        asm_.ret();
+    }
+
+    // __TYL_gc_mark_drain: mark with the marker in R14 until every marker is
+    // idle. Clobbers RBX, R12, R13, R15 and the volatile registers.
+    {
+        std::string popLabel = newLabel("gc_drain_pop");
+        std::string emptyLabel = newLabel("gc_drain_empty");
+        std::string stealLabel = newLabel("gc_drain_steal");
+        std::string stealLoopLabel = newLabel("gc_drain_steal_loop");
+        std::string stealTryLabel = newLabel("gc_drain_steal_try");
+        std::string stealNextLabel = newLabel("gc_drain_steal_next");
+        std::string idleLabel = newLabel("gc_drain_idle");
+        std::string idleWaitLabel = newLabel("gc_drain_idle_wait");
+        std::string idleScanLabel = newLabel("gc_drain_idle_scan");
+        std::string wakeLabel = newLabel("gc_drain_wake");
+        std::string scanLabel = newLabel("gc_drain_scan");
+        std::string scanLoopLabel = newLabel("gc_drain_scan_loop");
+        std::string doneLabel = newLabel("gc_drain_done");
+
+        asm_.label(gcMarkDrainLabel_);
+
+        // Own stack, newest first
+        asm_.label(popLabel);
+        emitMarkerLock(X64Reg::R14);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::R14, kBufferTop));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RDX), at(X64Reg::R14));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RDX), at(X64Reg::R14, kMarkerHead));
+        asm_.jz_rel32(emptyLabel);
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), imm(8));
+        asm_.emit(X64Op::MOV, at(X64Reg::R14, kBufferTop), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), at(X64Reg::RCX));
+        emitMarkerUnlock(X64Reg::R14);
+        asm_.jmp_rel32(scanLabel);
+
+        // Everything pushed was popped or stolen: start the stack over
+        asm_.label(emptyLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::R14));
+        asm_.emit(X64Op::MOV, at(X64Reg::R14, kBufferTop), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, at(X64Reg::R14, kMarkerHead), imm(0));
+        emitMarkerUnlock(X64Reg::R14);
+
+        // Steal the oldest entry of the first other marker that has one and
+        // is not busy: r12 = marker, r13 = markers left
+        asm_.label(stealLabel);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::R12), gcVar(kGCMarkers));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R13), gcVar(kGCMarkerCount));
+        asm_.label(stealLoopLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::R12), gpr(X64Reg::R14));
+        asm_.jz_rel32(stealNextLabel);
+        emitJumpIfWork(X64Reg::R12, stealTryLabel);
+        asm_.jmp_rel32(stealNextLabel);
+        asm_.label(stealTryLabel);
+        asm_.mov_rax_imm32(1);
+        asm_.emit(X64Op::XCHG, at(X64Reg::R12, kMarkerLock), gpr(X64Reg::RAX));
+        asm_.test_rax_rax();
+        asm_.jnz_rel32(stealNextLabel);
+        {
+            std::string stolenLabel = newLabel("gc_drain_stolen");
+            asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), at(X64Reg::R12, kBufferTop));
+            asm_.emit(X64Op::SUB, gpr(X64Reg::RDX), at(X64Reg::R12));
+            asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::R12, kMarkerHead));
+            asm_.emit(X64Op::CMP, gpr(X64Reg::RDX), gpr(X64Reg::RCX));
+            asm_.jnz_rel32(stolenLabel);
+            emitMarkerUnlock(X64Reg::R12);
+            asm_.jmp_rel32(stealNextLabel);
+            asm_.label(stolenLabel);
+            asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), at(X64Reg::R12));
+            asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), X64Operand::mem(X64Reg::RDX, X64Reg::RCX, 1));
+            asm_.add_rcx_imm32(8);
+            asm_.emit(X64Op::MOV, at(X64Reg::R12, kMarkerHead), gpr(X64Reg::RCX));
+            emitMarkerUnlock(X64Reg::R12);
+            asm_.jmp_rel32(scanLabel);
+        }
+        asm_.label(stealNextLabel);
+        asm_.emit(X64Op::ADD, gpr(X64Reg::R12), imm(kMarkerSize));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::R13), imm(1));
+        asm_.jnz_rel32(stealLoopLabel);
+
+        // Idle until some stack has work again or every marker is idle. Only
+        // a marker that is not idle pushes, so none can when all are.
+        asm_.label(idleLabel);
+        asm_.mov_rax_imm32(1);
+        asm_.code.push_back(0xF0);
+        asm_.emit(X64Op::ADD, gcVar(kGCMarkersIdle), gpr(X64Reg::RAX));  // lock add
+        asm_.label(idleWaitLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gcVar(kGCMarkersIdle));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gcVar(kGCMarkerCount));
+        asm_.jz_rel32(doneLabel);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::R12), gcVar(kGCMarkers));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R13), gcVar(kGCMarkerCount));
+        asm_.label(idleScanLabel);
+        emitJumpIfWork(X64Reg::R12, wakeLabel);
+        asm_.emit(X64Op::ADD, gpr(X64Reg::R12), imm(kMarkerSize));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::R13), imm(1));
+        asm_.jnz_rel32(idleScanLabel);
+        emitPause();
+        asm_.jmp_rel32(idleWaitLabel);
+        asm_.label(wakeLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), imm(-1));
+        asm_.code.push_back(0xF0);
+        asm_.emit(X64Op::ADD, gcVar(kGCMarkersIdle), gpr(X64Reg::RAX));  // lock add
+        asm_.jmp_rel32(stealLabel);
+
+        // Mark every word of the object in RBX
+        asm_.label(scanLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R15, 4), at(X64Reg::RBX, -16, 4));
+        asm_.emit(X64Op::AND, gpr(X64Reg::R15), imm(-8));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::R15), gpr(X64Reg::RBX));
+        asm_.label(scanLoopLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RBX), gpr(X64Reg::R15));
+        asm_.jcc(X64Cond::AE, popLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBX));
+        asm_.call_rel32(gcMarkLabel_);
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RBX), imm(8));
+        asm_.jmp_rel32(scanLoopLabel);
+
+        asm_.label(doneLabel);
+        asm_.ret();
+    }
+
+    // __TYL_gc_marker_thread: thread procedure of helper marker RCX. Waits
+    // for each major collection, marks until it is done, reports back.
+    {
+        std::string waitLabel = newLabel("gc_marker_wait");
+
+        asm_.label(gcMarkerThreadLabel_);
+        asm_.push_rbp();
+        asm_.mov_rbp_rsp();
+        asm_.push_rbx();
+        asm_.push_r12();
+        asm_.push_r13();
+        asm_.push_r14();
+        asm_.push_r15();
+        asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+        asm_.sub_rsp_imm32(0x20);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R14), gpr(X64Reg::RCX));
+
+        asm_.label(waitLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), at(X64Reg::R14, kMarkerEvent));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDX, 4), imm(-1));  // INFINITE
+        asm_.call_mem_rip(pe_.getImportRVA("WaitForSingleObject"));
+        asm_.call_rel32(gcMarkDrainLabel_);
+        asm_.mov_rax_imm32(1);
+        asm_.code.push_back(0xF0);
+        asm_.emit(X64Op::ADD, gcVar(kGCMarkersDone), gpr(X64Reg::RAX));  // lock add
+        asm_.jmp_rel32(waitLabel);
+    }
+
+    // __TYL_gc_markers_start: size the pool by the processor count (at most
+    // kMaxMarkers) and start its helpers. A helper that cannot be created
+    // just leaves the pool smaller.
+    {
+        std::string countedLabel = newLabel("gc_markers_counted");
+        std::string someLabel = newLabel("gc_markers_some");
+        std::string loopLabel = newLabel("gc_markers_loop");
+        std::string doneLabel = newLabel("gc_markers_done");
+
+        asm_.label(gcMarkersStartLabel_);
+        asm_.push_rbp();
+        asm_.mov_rbp_rsp();
+        asm_.push_rbx();
+        asm_.emit(X64Op::PUSH, gpr(X64Reg::RSI));
+        asm_.push_rdi();
+        asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+        asm_.sub_rsp_imm32(0x60);
+
+        // GetSystemInfo into [rsp+0x30]; dwNumberOfProcessors is at +32
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), at(X64Reg::RSP, 0x30));
+        asm_.call_mem_rip(pe_.getImportRVA("GetSystemInfo"));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RSI, 4), at(X64Reg::RSP, 0x30 + 32, 4));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RSI), imm(kMaxMarkers));
+        asm_.jcc(X64Cond::BE, countedLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RSI, 4), imm(kMaxMarkers));
+        asm_.label(countedLabel);
+        asm_.emit(X64Op::TEST, gpr(X64Reg::RSI), gpr(X64Reg::RSI));
+        asm_.jnz_rel32(someLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RSI, 4), imm(1));
+        asm_.label(someLabel);
+
+        // rbx = markers so far, rdi = the next one's record
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX, 4), imm(1));
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RDI), gcVar(kGCMarkers + kMarkerSize));
+        asm_.label(loopLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RBX), gpr(X64Reg::RSI));
+        asm_.jcc(X64Cond::AE, doneLabel);
+
+        // CreateEventA(NULL, FALSE, FALSE, NULL): auto-reset
+        asm_.emit(X64Op::XOR, gpr(X64Reg::RCX, 4), gpr(X64Reg::RCX, 4));
+        asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+        asm_.emit(X64Op::XOR, gpr(X64Reg::R8, 4), gpr(X64Reg::R8, 4));
+        asm_.emit(X64Op::XOR, gpr(X64Reg::R9, 4), gpr(X64Reg::R9, 4));
+        asm_.call_mem_rip(pe_.getImportRVA("CreateEventA"));
+        asm_.test_rax_rax();
+        asm_.jz_rel32(doneLabel);
+        asm_.emit(X64Op::MOV, at(X64Reg::RDI, kMarkerEvent), gpr(X64Reg::RAX));
+
+        // CreateThread(NULL, 0, __TYL_gc_marker_thread, record, 0, NULL)
+        asm_.emit(X64Op::XOR, gpr(X64Reg::RCX, 4), gpr(X64Reg::RCX, 4));
+        asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+        asm_.emit(X64Op::LEA, gpr(X64Reg::R8), X64Operand::ripLabel(gcMarkerThreadLabel_));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R9), gpr(X64Reg::RDI));
+        asm_.emit(X64Op::MOV, at(X64Reg::RSP, 0x20), imm(0));
+        asm_.emit(X64Op::MOV, at(X64Reg::RSP, 0x28), imm(0));
+        asm_.call_mem_rip(pe_.getImportRVA("CreateThread"));
+        asm_.test_rax_rax();
+        asm_.jz_rel32(doneLabel);
+        asm_.mov_rcx_rax();
+        asm_.call_mem_rip(pe_.getImportRVA("CloseHandle"));
+
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RBX), imm(1));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RDI), imm(kMarkerSize));
+        asm_.jmp_rel32(loopLabel);
+
+        asm_.label(doneLabel);
+        asm_.emit(X64Op::MOV, gcVar(kGCMarkerCount), gpr(X64Reg::RBX));
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RSP), at(X64Reg::RBP, -24));
+        asm_.pop_rdi();
+        asm_.emit(X64Op::POP, gpr(X64Reg::RSI));
+        asm_.pop_rbx();
+        asm_.pop_rbp();
+        asm_.ret();
+    }
+}
+
+} // namespace tyl
@@ -0,0 +1,172 @@
+// Tyl Compiler - Native Code Generator GC Root Maps
+// Handles: per-function frame maps and the frame table the collectors read
+//
+// Every function, lambda and _start has a frame map giving the GCSlotKind of
+// the named locals whose contents their declaration pins down: lists,
+// records, closures and strings are REFERENCE slots, declared or literal
+// scalars are SCALAR. Code ranges tie return addresses - including the cold
+// blocks a function queues - to the map of the frame they run on. Slots the
+// map does not cover (saved registers, temporaries, outgoing arguments,
+// untyped locals) and frames of unmapped code are still scanned
+// conservatively.
+//
+// The stack walk that reads them is emitGCRootWalk in codegen_gc.cpp.
+
+#include "backend/codegen/codegen_base.h"
+#include <algorithm>
+
+namespace tyl {
+
+namespace {
+bool isScalarTypeName(const std::string& t) {
+    static const char* const kScalars[] = {
+        "int", "i8", "i16", "i32", "i64", "u8", "u16", "u32", "u64", "isize", "usize",
+        "float", "f16", "f32", "f64", "bool", "char", "byte",
+    };
+    for (const char* name : kScalars) {
+        if (t == name) return true;
+    }
+    return false;
+}
+}
+
+// Open a frame map for the function whose code starts here. A function
+// emitted inside another (a lambda) splits the enclosing code range.
+int32_t NativeCodeGen::beginGCFrameMap() {
+    int32_t enclosing = gcFrameMap_;
+    if (!useGC_) return enclosing;
+    if (enclosing >= 0) closeGCCodeRange();
+    gcFrameMap_ = static_cast<int32_t>(gcFrameMaps_.size());
+    gcFrameMaps_.emplace_back();
+    openGCCodeRange();
+    return enclosing;
+}
+
+void NativeCodeGen::endGCFrameMap(int32_t enclosing) {
+    if (!useGC_) return;
+    closeGCCodeRange();
+    gcFrameMap_ = enclosing;
+    if (enclosing >= 0) openGCCodeRange();
+}
+
+void NativeCodeGen::openGCCodeRange() {
+    gcRangeStart_ = newLabel("gc_range");
+    asm_.label(gcRangeStart_);
+}
+
+void NativeCodeGen::closeGCCodeRange() {
+    std::string end = newLabel("gc_range_end");
+    asm_.label(end);
+    gcCodeRanges_.push_back({gcRangeStart_, end, gcFrameMap_});
+}
+
+void NativeCodeGen::beginGCSlotDecl(const std::string& name, uint8_t kind) {
+    gcPendingSlot_ = {name, kind};
+    gcPendingOffset_ = stackOffset;
+}
+
+// Only the first slot allocated since the declaration began is its own;
+// anything its initializer allocated comes before it
+void NativeCodeGen::noteGCSlot(const std::string& name, int32_t offset) {
+    if (gcPendingSlot_.first.empty() || name != gcPendingSlot_.first) return;
+    if (gcFrameMap_ >= 0 && offset == gcPendingOffset_ - 8 &&
+        gcPendingSlot_.second != GC_SLOT_CONSERVATIVE) {
+        gcFrameMaps_[gcFrameMap_][offset] = gcPendingSlot_.second;
+    }
+    gcPendingSlot_.first.clear();
+}
+
+uint8_t NativeCodeGen::gcSlotKindForType(const std::string& typeName) {
+    if (typeName.empty()) return GC_SLOT_CONSERVATIVE;
+    if (isScalarTypeName(typeName)) return GC_SLOT_SCALAR;
+    if (typeName == "str" || typeName == "string" || typeName == "String") return GC_SLOT_REFERENCE;
+    if (typeName[0] == '[' && typeName.find(';') == std::string::npos) return GC_SLOT_REFERENCE;
+    std::string base = typeName.substr(0, typeName.find('['));
+    if (recordTypes_.count(base)) return GC_SLOT_REFERENCE;
+    return GC_SLOT_CONSERVATIVE;
+}
+
+uint8_t NativeCodeGen::gcSlotKindFor(VarDecl& node) {
+    if (!node.typeName.empty()) return gcSlotKindForType(node.typeName);
+    Expression* init = node.initializer.get();
+    if (auto* unary = dynamic_cast<UnaryExpr*>(init)) {
+        if (unary->op == TokenType::MINUS) init = unary->operand.get();
+    }
+    if (dynamic_cast<IntegerLiteral*>(init) || dynamic_cast<FloatLiteral*>(init) ||
+        dynamic_cast<BoolLiteral*>(init) || dynamic_cast<CharLiteral*>(init)) {
+        return GC_SLOT_SCALAR;
+    }
+    if (dynamic_cast<ListExpr*>(init) || dynamic_cast<RecordExpr*>(init) ||
+        dynamic_cast<LambdaExpr*>(init)) {
+        return GC_SLOT_REFERENCE;
+    }
+    return GC_SLOT_CONSERVATIVE;
+}
+
+// Append the frame table to the code. Runs once instruction-level
+// optimization is done, so label offsets are final. Ranges whose labels were
+// rolled back, and maps with nothing known, are left out.
+//
+// Layout: count (4), pad (4), count entries of 12 bytes, then each map as
+// its word count (4) and one GCSlotKind byte per word below rbp.
+void NativeCodeGen::emitGCFrameTable() {
+    if (!useGC_) return;
+
+    struct Segment {
+        size_t start;
+        size_t end;
+        int32_t map;
+    };
+    std::vector<Segment> segments;
+    for (const auto& range : gcCodeRanges_) {
+        auto startIt = asm_.labels.find(range.start);
+        auto endIt = asm_.labels.find(range.end);
+        if (startIt == asm_.labels.end() || endIt == asm_.labels.end()) continue;
+        if (startIt->second >= endIt->second || gcFrameMaps_[range.map].empty()) continue;
+        segments.push_back({startIt->second, endIt->second, range.map});
+    }
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment& a, const Segment& b) { return a.start > b.start; });
+
+    std::map<int32_t, std::vector<uint8_t>> words;
+    for (const auto& segment : segments) {
+        if (words.count(segment.map)) continue;
+        std::vector<uint8_t> kinds;
+        for (const auto& [offset, kind] : gcFrameMaps_[segment.map]) {
+            if (offset >= 0) continue;
+            size_t index = static_cast<size_t>(-offset / 8 - 1);
+            if (index >= kinds.size()) kinds.resize(index + 1, GC_SLOT_CONSERVATIVE);
+            kinds[index] = kind;
+        }
+        words[segment.map] = kinds;
+    }
+
+    auto emit32 = [this](uint32_t value) {
+        for (int i = 0; i < 4; i++) asm_.code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    };
+
+    while (asm_.code.size() % 8) asm_.code.push_back(0xCC);
+    asm_.label(gcFrameTableLabel_);
+    size_t table = asm_.code.size();
+
+    std::map<int32_t, uint32_t> mapOffsets;
+    uint32_t mapOffset = static_cast<uint32_t>(8 + segments.size() * 12);
+    for (const auto& [map, kinds] : words) {
+        mapOffsets[map] = mapOffset;
+        mapOffset += static_cast<uint32_t>(4 + kinds.size());
+    }
+
+    emit32(static_cast<uint32_t>(segments.size()));
+    emit32(0);
+    for (const auto& segment : segments) {
+        emit32(static_cast<uint32_t>(table - segment.start));
+        emit32(static_cast<uint32_t>(table - segment.end));
+        emit32(mapOffsets[segment.map]);
+    }
+    for (const auto& [map, kinds] : words) {
+        emit32(static_cast<uint32_t>(kinds.size()));
+        asm_.code.insert(asm_.code.end(), kinds.begin(), kinds.end());
+    }
+}
+
+} // namespace tyl
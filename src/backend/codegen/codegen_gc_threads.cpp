@@ -0,0 +1,251 @@
+// Tyl Compiler - Native Code Generator GC Threads
+// Handles: the GC lock, stop-the-world, thread registration and TLAB access
+//
+// Every thread that allocates has a record on gc_threads holding its TLAB,
+// a slice of the nursery it bumps into without synchronization. Everything
+// else about the heap (refilling a TLAB, old-space allocation, collecting)
+// happens under the GC lock. A collection needs the other threads parked:
+// the collector clears their TLAB ends so their next allocation comes to the
+// lock, and waits until each is either waiting for the lock or inside a
+// blocking call. Threads never stop anywhere else, so one that loops
+// without allocating or blocking holds a collection up until it does.
+
+#include "codegen_gc_layout.h"
+
+namespace tyl {
+
+// Load the current thread's record into dst from its TEB TLS slot:
+// mov dst32, [rip+gc_tls_index]; mov dst, gs:[kTebTlsSlots + dst*8]
+void NativeCodeGen::emitGCThreadRecord(X64Reg dst) {
+    uint8_t r = static_cast<uint8_t>(dst);
+    asm_.emit(X64Op::MOV, gpr(dst, 4), X64Operand::ripRVA(gcDataRVA_ + kGCTlsIndex, 4));
+    asm_.code.push_back(0x65);
+    asm_.code.push_back(static_cast<uint8_t>(0x48 | (r >= 8 ? 0x06 : 0)));
+    asm_.code.push_back(0x8B);
+    asm_.code.push_back(static_cast<uint8_t>(0x04 | ((r & 7) << 3)));
+    asm_.code.push_back(static_cast<uint8_t>(0xC5 | ((r & 7) << 3)));
+    for (int i = 0; i < 4; i++) asm_.code.push_back(static_cast<uint8_t>((kTebTlsSlots >> (8 * i)) & 0xFF));
+}
+
+void NativeCodeGen::emitGCUnlock() {
+    asm_.emit(X64Op::XOR, gpr(X64Reg::R11, 4), gpr(X64Reg::R11, 4));
+    asm_.emit(X64Op::MOV, X64Operand::ripRVA(gcDataRVA_ + kGCLock), gpr(X64Reg::R11));
+}
+
+void NativeCodeGen::emitGCThreadRoutines() {
+    auto gcVar = [this](int32_t offset) { return X64Operand::ripRVA(gcDataRVA_ + offset); };
+
+    // Frame of the routines a thread parks in: every callee-saved register
+    // pushed in the kParkedBytes below rbp, where the root walk finds them
+    auto emitParkedPrologue = [this]() {
+        asm_.push_rbp();
+        asm_.mov_rbp_rsp();
+        asm_.push_rbx();
+        asm_.push_r12();
+        asm_.push_r13();
+        asm_.push_r14();
+        asm_.push_r15();
+        asm_.emit(X64Op::PUSH, gpr(X64Reg::RSI));
+        asm_.push_rdi();
+        asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+        asm_.sub_rsp_imm32(0x20);
+    };
+    auto emitParkedEpilogue = [this]() {
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RSP), at(X64Reg::RBP, -kParkedBytes));
+        asm_.pop_rdi();
+        asm_.emit(X64Op::POP, gpr(X64Reg::RSI));
+        asm_.pop_r15();
+        asm_.pop_r14();
+        asm_.pop_r13();
+        asm_.pop_r12();
+        asm_.pop_rbx();
+        asm_.pop_rbp();
+        asm_.ret();
+    };
+
+    // Frame of the registration routines: rbx and rdi saved
+    auto emitSmallPrologue = [this]() {
+        asm_.push_rbp();
+        asm_.mov_rbp_rsp();
+        asm_.push_rbx();
+        asm_.push_rdi();
+        asm_.emit(X64Op::AND, gpr(X64Reg::RSP), imm(-16));
+        asm_.sub_rsp_imm32(0x20);
+    };
+    auto emitSmallEpilogue = [this]() {
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RSP), at(X64Reg::RBP, -16));
+        asm_.pop_rdi();
+        asm_.pop_rbx();
+        asm_.pop_rbp();
+        asm_.ret();
+    };
+
+    // __TYL_gc_lock: take the GC lock, parked until it is ours. Clobbers the
+    // volatile registers.
+    {
+        std::string spinLabel = newLabel("gc_lock_spin");
+        std::string gotLabel = newLabel("gc_lock_got");
+
+        asm_.label(gcLockLabel_);
+        emitParkedPrologue();
+        emitGCThreadRecord(X64Reg::RDI);
+        asm_.emit(X64Op::MOV, at(X64Reg::RDI, kThreadFrame), gpr(X64Reg::RBP));
+        asm_.label(spinLabel);
+        asm_.mov_rax_imm32(1);
+        asm_.emit(X64Op::XCHG, gcVar(kGCLock), gpr(X64Reg::RAX));
+        asm_.test_rax_rax();
+        asm_.jz_rel32(gotLabel);
+        asm_.emit(X64Op::XOR, gpr(X64Reg::RCX, 4), gpr(X64Reg::RCX, 4));
+        asm_.call_mem_rip(pe_.getImportRVA("Sleep"));
+        asm_.jmp_rel32(spinLabel);
+        asm_.label(gotLabel);
+        asm_.emit(X64Op::MOV, at(X64Reg::RDI, kThreadFrame), imm(0));
+        emitParkedEpilogue();
+    }
+
+    // __TYL_gc_stop: with the GC lock held, send every other thread's next
+    // allocation to the slow path and wait until all of them are parked.
+    // Clobbers the volatile registers.
+    {
+        std::string endLoopLabel = newLabel("gc_stop_ends");
+        std::string endNextLabel = newLabel("gc_stop_ends_next");
+        std::string waitLabel = newLabel("gc_stop_wait");
+        std::string waitLoopLabel = newLabel("gc_stop_wait_loop");
+        std::string waitNextLabel = newLabel("gc_stop_wait_next");
+        std::string doneLabel = newLabel("gc_stop_done");
+
+        asm_.label(gcStopLabel_);
+        emitSmallPrologue();
+        emitGCThreadRecord(X64Reg::RDI);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gcVar(kGCThreads));
+        asm_.label(endLoopLabel);
+        asm_.emit(X64Op::TEST, gpr(X64Reg::RBX), gpr(X64Reg::RBX));
+        asm_.jz_rel32(waitLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RBX), gpr(X64Reg::RDI));
+        asm_.jz_rel32(endNextLabel);
+        asm_.emit(X64Op::MOV, at(X64Reg::RBX, kThreadEnd), imm(0));
+        asm_.label(endNextLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), at(X64Reg::RBX, kThreadNext));
+        asm_.jmp_rel32(endLoopLabel);
+
+        asm_.label(waitLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gcVar(kGCThreads));
+        asm_.label(waitLoopLabel);
+        asm_.emit(X64Op::TEST, gpr(X64Reg::RBX), gpr(X64Reg::RBX));
+        asm_.jz_rel32(doneLabel);
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RBX), gpr(X64Reg::RDI));
+        asm_.jz_rel32(waitNextLabel);
+        asm_.emit(X64Op::CMP, at(X64Reg::RBX, kThreadFrame), imm(0));
+        asm_.jnz_rel32(waitNextLabel);
+        asm_.emit(X64Op::XOR, gpr(X64Reg::RCX, 4), gpr(X64Reg::RCX, 4));
+        asm_.call_mem_rip(pe_.getImportRVA("Sleep"));
+        asm_.jmp_rel32(waitLoopLabel);
+        asm_.label(waitNextLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), at(X64Reg::RBX, kThreadNext));
+        asm_.jmp_rel32(waitLoopLabel);
+
+        asm_.label(doneLabel);
+        emitSmallEpilogue();
+    }
+
+    // __TYL_gc_thread_new: RCX = spawn argument. Registers a record for a
+    // thread about to be created and returns it in RAX, to be passed to
+    // __TYL_gc_thread_start. Until then the thread counts as parked with
+    // only its argument as a root.
+    {
+        std::string allocatedLabel = newLabel("gc_thread_new_ok");
+
+        asm_.label(gcThreadNewLabel_);
+        emitSmallPrologue();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gpr(X64Reg::RCX));
+        asm_.call_rel32(gcLockLabel_);
+        asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+        asm_.mov_rcx_rax();
+        asm_.mov_edx_imm32(0x08);  // HEAP_ZERO_MEMORY
+        asm_.mov_r8d_imm32(kThreadRecordSize);
+        asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
+        asm_.test_rax_rax();
+        asm_.jnz_rel32(allocatedLabel);
+        asm_.mov_ecx_imm32(1);
+        asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
+        asm_.label(allocatedLabel);
+        asm_.emit(X64Op::MOV, at(X64Reg::RAX, kThreadArg), gpr(X64Reg::RBX));
+        asm_.emit(X64Op::MOV, at(X64Reg::RAX, kThreadFrame), imm(1));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gcVar(kGCThreads));
+        asm_.emit(X64Op::MOV, at(X64Reg::RAX, kThreadNext), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, gcVar(kGCThreads), gpr(X64Reg::RAX));
+        emitGCUnlock();
+        emitSmallEpilogue();
+    }
+
+    // __TYL_gc_thread_start: RCX = the record, RDX = the new thread's stack
+    // bottom. Makes the record the thread's own and returns the spawn
+    // argument in RAX, which from then on is the thread's to keep alive.
+    {
+        asm_.label(gcThreadStartLabel_);
+        emitSmallPrologue();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gpr(X64Reg::RCX));
+        asm_.emit(X64Op::MOV, at(X64Reg::RBX, kThreadStackBottom), gpr(X64Reg::RDX));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RCX, 4), gcVar(kGCTlsIndex));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), gpr(X64Reg::RBX));
+        asm_.call_mem_rip(pe_.getImportRVA("TlsSetValue"));
+        asm_.call_rel32(gcLockLabel_);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RBX, kThreadArg));
+        asm_.emit(X64Op::MOV, at(X64Reg::RBX, kThreadArg), imm(0));
+        emitGCUnlock();
+        emitSmallEpilogue();
+    }
+
+    // __TYL_gc_thread_exit: unregister the current thread and free its
+    // record. Preserves RAX (the thread's result); the thread must not touch
+    // GC memory afterwards.
+    {
+        std::string findLabel = newLabel("gc_thread_exit_find");
+        std::string foundLabel = newLabel("gc_thread_exit_found");
+
+        asm_.label(gcThreadExitLabel_);
+        emitSmallPrologue();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gpr(X64Reg::RAX));
+        asm_.call_rel32(gcLockLabel_);
+        emitGCThreadRecord(X64Reg::RDI);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), gcVar(kGCThreads));
+        asm_.label(findLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RCX));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RAX), gpr(X64Reg::RDI));
+        asm_.jz_rel32(foundLabel);
+        asm_.emit(X64Op::LEA, gpr(X64Reg::RCX), at(X64Reg::RAX, kThreadNext));
+        asm_.jmp_rel32(findLabel);
+        asm_.label(foundLabel);
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), at(X64Reg::RDI, kThreadNext));
+        asm_.emit(X64Op::MOV, at(X64Reg::RCX), gpr(X64Reg::RAX));
+        emitGCUnlock();
+
+        asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+        asm_.mov_rcx_rax();
+        asm_.emit(X64Op::XOR, gpr(X64Reg::RDX, 4), gpr(X64Reg::RDX, 4));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R8), gpr(X64Reg::RDI));
+        asm_.call_mem_rip(pe_.getImportRVA("HeapFree"));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::RBX));
+        emitSmallEpilogue();
+    }
+
+    // __TYL_gc_blocking_call: RAX = function, RCX/RDX/R8/R9 = its arguments.
+    // The thread is parked for the call, so a collection can run while it
+    // waits on another thread; afterwards it waits out any collection in
+    // progress. Returns the function's RAX.
+    {
+        asm_.label(gcBlockingCallLabel_);
+        emitParkedPrologue();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::R11), gpr(X64Reg::RAX));
+        emitGCThreadRecord(X64Reg::RDI);
+        asm_.emit(X64Op::MOV, at(X64Reg::RDI, kThreadFrame), gpr(X64Reg::RBP));
+        asm_.emit(X64Op::CALL, gpr(X64Reg::R11));
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RBX), gpr(X64Reg::RAX));
+        asm_.call_rel32(gcLockLabel_);
+        emitGCUnlock();
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RAX), gpr(X64Reg::RBX));
+        emitParkedEpilogue();
+    }
+}
+
+} // namespace tyl
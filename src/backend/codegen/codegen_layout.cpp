@@ -0,0 +1,220 @@
+// Tyl Compiler - Native Code Generator Code Layout
+// Handles: hot/cold function ordering, the cold text region, shared fatal-error exit
+//
+// Error paths (panic, assert and refinement failures) and GC slow paths are
+// queued with deferColdBlock and emitted after every function and runtime
+// routine, so the hot code they interrupt stays contiguous. Functions are
+// ordered hot first - callers followed by the callees they hit hardest - then
+// untouched ones in source order, then cold ones.
+
+#include "backend/codegen/codegen_base.h"
+
+namespace tyl {
+
+std::string NativeCodeGen::deferColdBlock(const std::string& prefix, std::function<void()> body) {
+    std::string label = newLabel(prefix);
+    coldBlocks_.push_back({label, std::move(body), gcFrameMap_});
+    return label;
+}
+
+// Loads the message and enters __TYL_fatal_error, which never returns
+void NativeCodeGen::emitFatalError(const std::string& message) {
+    asm_.emit(X64Op::LEA, X64Operand::r(X64Reg::RCX), X64Operand::ripRVA(addString(message)));
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RDX, 4), X64Operand::immediate(static_cast<int64_t>(message.size())));
+    asm_.call_rel32(fatalErrorLabel_);
+    fatalErrorUsed_ = true;
+}
+
+void NativeCodeGen::emitColdBlocks() {
+    // Blocks may queue further blocks, so walk by index. Each runs on the
+    // frame of the function that queued it and shares its frame map.
+    for (size_t i = 0; i < coldBlocks_.size(); i++) {
+        asm_.label(coldBlocks_[i].label);
+        gcFrameMap_ = coldBlocks_[i].gcFrameMap;
+        if (gcFrameMap_ >= 0) openGCCodeRange();
+        auto body = std::move(coldBlocks_[i].body);
+        body();
+        if (gcFrameMap_ >= 0) closeGCCodeRange();
+    }
+    coldBlocks_.clear();
+    gcFrameMap_ = -1;
+
+    if (!fatalErrorUsed_) return;
+
+    // __TYL_fatal_error(rcx = message, rdx = length): write to stdout, exit(1).
+    // Entered from arbitrary stack depths, so it realigns rsp itself.
+    asm_.label(fatalErrorLabel_);
+    asm_.emit(X64Op::AND, X64Operand::r(X64Reg::RSP), X64Operand::immediate(-16));
+    asm_.sub_rsp_imm32(0x30);
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RBX), X64Operand::r(X64Reg::RCX));
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RSI), X64Operand::r(X64Reg::RDX));
+    asm_.mov_ecx_imm32(-11);  // STD_OUTPUT_HANDLE
+    asm_.call_mem_rip(pe_.getImportRVA("GetStdHandle"));
+    asm_.mov_rcx_rax();
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RDX), X64Operand::r(X64Reg::RBX));
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::R8), X64Operand::r(X64Reg::RSI));
+    asm_.emit(X64Op::LEA, X64Operand::r(X64Reg::R9), X64Operand::mem(X64Reg::RSP, 0x28));
+    asm_.emit(X64Op::MOV, X64Operand::mem(X64Reg::RSP, 0x20), X64Operand::immediate(0));
+    asm_.call_mem_rip(pe_.getImportRVA("WriteConsoleA"));
+    asm_.mov_ecx_imm32(1);
+    asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
+}
+
+// Orders top-level functions for emission. Without hot/cold marks
+// (from PGO or partial inlining) source order is kept.
+std::vector<FnDecl*> NativeCodeGen::layoutFunctions(const std::vector<FnDecl*>& functions) {
+    if (optLevel_ == CodeGenOptLevel::O0 || optLevel_ == CodeGenOptLevel::O1) return functions;
+
+    bool hasTemperature = false;
+    for (auto* fn : functions) {
+        if (fn->isHot || fn->isCold) hasTemperature = true;
+    }
+    if (!hasTemperature) return functions;
+
+    std::map<std::string, FnDecl*> byName;
+    for (auto* fn : functions) byName[fn->name] = fn;
+
+    // Static call-graph weights: a call inside a loop counts 10x, a call site
+    // the profile marked hot 100x. Callees keep first-call order for ties.
+    std::map<FnDecl*, std::vector<std::pair<FnDecl*, int>>> edges;
+    for (auto* fn : functions) {
+        auto& out = edges[fn];
+        int loopDepth = 0;
+
+        auto addEdge = [&](CallExpr* call) {
+            auto* id = dynamic_cast<Identifier*>(call->callee.get());
+            if (!id) return;
+            auto it = byName.find(id->name);
+            if (it == byName.end() || it->second == fn) return;
+            int weight = (call->isHotCallSite ? 100 : 1) * (loopDepth > 0 ? 10 : 1);
+            for (auto& edge : out) {
+                if (edge.first == it->second) {
+                    edge.second += weight;
+                    return;
+                }
+            }
+            out.push_back({it->second, weight});
+        };
+
+        std::function<void(Expression*)> walkExpr = [&](Expression* expr) {
+            if (!expr) return;
+            if (auto* call = dynamic_cast<CallExpr*>(expr)) {
+                addEdge(call);
+                walkExpr(call->callee.get());
+                for (auto& arg : call->args) walkExpr(arg.get());
+            } else if (auto* binary = dynamic_cast<BinaryExpr*>(expr)) {
+                walkExpr(binary->left.get());
+                walkExpr(binary->right.get());
+            } else if (auto* unary = dynamic_cast<UnaryExpr*>(expr)) {
+                walkExpr(unary->operand.get());
+            } else if (auto* ternary = dynamic_cast<TernaryExpr*>(expr)) {
+                walkExpr(ternary->condition.get());
+                walkExpr(ternary->thenExpr.get());
+                walkExpr(ternary->elseExpr.get());
+            } else if (auto* assign = dynamic_cast<AssignExpr*>(expr)) {
+                walkExpr(assign->target.get());
+                walkExpr(assign->value.get());
+            } else if (auto* index = dynamic_cast<IndexExpr*>(expr)) {
+                walkExpr(index->object.get());
+                walkExpr(index->index.get());
+            } else if (auto* member = dynamic_cast<MemberExpr*>(expr)) {
+                walkExpr(member->object.get());
+            } else if (auto* list = dynamic_cast<ListExpr*>(expr)) {
+                for (auto& element : list->elements) walkExpr(element.get());
+            }
+        };
+
+        std::function<void(Statement*)> walkStmt = [&](Statement* stmt) {
+            if (!stmt) return;
+            if (auto* block = dynamic_cast<Block*>(stmt)) {
+                for (auto& s : block->statements) walkStmt(s.get());
+            } else if (auto* exprStmt = dynamic_cast<ExprStmt*>(stmt)) {
+                walkExpr(exprStmt->expr.get());
+            } else if (auto* varDecl = dynamic_cast<VarDecl*>(stmt)) {
+                walkExpr(varDecl->initializer.get());
+            } else if (auto* assign = dynamic_cast<AssignStmt*>(stmt)) {
+                walkExpr(assign->target.get());
+                walkExpr(assign->value.get());
+            } else if (auto* ret = dynamic_cast<ReturnStmt*>(stmt)) {
+                walkExpr(ret->value.get());
+            } else if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt)) {
+                walkExpr(ifStmt->condition.get());
+                walkStmt(ifStmt->thenBranch.get());
+                for (auto& [cond, body] : ifStmt->elifBranches) {
+                    walkExpr(cond.get());
+                    walkStmt(body.get());
+                }
+                walkStmt(ifStmt->elseBranch.get());
+            } else if (auto* whileStmt = dynamic_cast<WhileStmt*>(stmt)) {
+                loopDepth++;
+                walkExpr(whileStmt->condition.get());
+                walkStmt(whileStmt->body.get());
+                loopDepth--;
+            } else if (auto* forStmt = dynamic_cast<ForStmt*>(stmt)) {
+                walkExpr(forStmt->iterable.get());
+                loopDepth++;
+                walkStmt(forStmt->body.get());
+                loopDepth--;
+            }
+        };
+
+        walkStmt(fn->body.get());
+        std::stable_sort(out.begin(), out.end(),
+            [](const auto& a, const auto& b) { return a.second > b.second; });
+    }
+
+    // Hot set: marked functions, what they call from loops or hot sites, and
+    // whoever calls them that way (a once-called main with a hot loop is
+    // hot for layout even if its call count says cold)
+    std::set<FnDecl*> hot;
+    for (auto* fn : functions) {
+        if (fn->isHot && !fn->isCold) hot.insert(fn);
+    }
+    bool changed = !hot.empty();
+    while (changed) {
+        changed = false;
+        for (auto* fn : functions) {
+            for (auto& [callee, weight] : edges[fn]) {
+                if (weight < 10) continue;
+                if (hot.count(fn) && !callee->isCold && hot.insert(callee).second) changed = true;
+                if (hot.count(callee) && hot.insert(fn).second) changed = true;
+            }
+        }
+    }
+    
+    // Depth-first from the hot entry points (hot functions no other hot
+    // function calls heavily) so a caller sits next to its heaviest callees
+    std::set<FnDecl*> hotCallees;
+    for (auto* fn : hot) {
+        for (auto& [callee, weight] : edges[fn]) {
+            if (weight >= 10) hotCallees.insert(callee);
+        }
+    }
+    std::vector<FnDecl*> order;
+    std::set<FnDecl*> placed;
+    std::function<void(FnDecl*)> place = [&](FnDecl* fn) {
+        if (!placed.insert(fn).second) return;
+        order.push_back(fn);
+        for (auto& [callee, weight] : edges[fn]) {
+            if (hot.count(callee)) place(callee);
+        }
+    };
+    for (auto* fn : functions) {
+        if (hot.count(fn) && !hotCallees.count(fn)) place(fn);
+    }
+    for (auto* fn : functions) {
+        if (hot.count(fn)) place(fn);
+    }
+    for (auto* fn : functions) {
+        if (!fn->isCold && !placed.count(fn)) {
+            placed.insert(fn);
+            order.push_back(fn);
+        }
+    }
+    for (auto* fn : functions) {
+        if (!placed.count(fn)) order.push_back(fn);
+    }
+    return order;
+}
+
+} // namespace tyl
@@ -0,0 +1,138 @@
+// Tyl Compiler - Native Code Generator Profile Instrumentation
+// Handles: --profile-generate counters and the profile file written at exit
+//
+// ProfileCollector assigns every instrumented site (function entry, if/elif
+// arm, loop, call site) one or two 64-bit counters in the data section. The
+// increments are a single `inc qword [rip+counter]`, which touches no
+// registers, so they can go anywhere between statements. __TYL_profile_dump
+// writes the counters in the text format ProfileReader loads, so the
+// profile feeds straight into --profile-use.
+
+#include "backend/codegen/codegen_base.h"
+
+namespace tyl {
+
+void NativeCodeGen::emitProfileCounter(const ASTNode* site, int slot) {
+    if (profileFile_.empty()) return;
+    int counter = profileCollector_.counterFor(site);
+    if (counter < 0) return;
+
+    asm_.emit(X64Op::INC, X64Operand::ripRVA(profileCountersRVA_ + (counter + slot) * 8));
+}
+
+// Preserves rax (the exit code) around the dump
+void NativeCodeGen::emitProfileDumpCall() {
+    if (profileFile_.empty()) return;
+
+    asm_.push_rax();
+    asm_.sub_rsp_imm32(8);
+    asm_.call_rel32(profileDumpLabel_);
+    asm_.add_rsp_imm32(8);
+    asm_.pop_rax();
+}
+
+// __TYL_profile_dump: CreateFileA the profile, one WriteFile per field.
+// rbx holds the file handle; write_num/write_buf are local subroutines
+// sharing the dump's frame layout.
+void NativeCodeGen::emitProfileDumpRoutine() {
+    if (profileFile_.empty()) return;
+
+    auto r32 = [](X64Reg r) { return X64Operand::r(r, 4); };
+    auto imm = [](int64_t v) { return X64Operand::immediate(v); };
+    auto counter = [&](int index) { return X64Operand::ripRVA(profileCountersRVA_ + index * 8); };
+    std::string writeNumLabel = newLabel("prof_write_num");
+    std::string writeBufLabel = newLabel("prof_write_buf");
+    std::string doneLabel = newLabel("prof_done");
+
+    auto writeString = [&](const std::string& text) {
+        asm_.emit(X64Op::LEA, X64Operand::r(X64Reg::RDX), X64Operand::ripRVA(addString(text)));
+        asm_.emit(X64Op::MOV, r32(X64Reg::R8), imm(static_cast<int64_t>(text.size())));
+        asm_.call_rel32(writeBufLabel);
+    };
+
+    asm_.label(profileDumpLabel_);
+    asm_.push_rbp();
+    asm_.mov_rbp_rsp();
+    asm_.push_rbx();
+    asm_.sub_rsp_imm32(0x48);
+
+    // CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL)
+    asm_.emit(X64Op::LEA, X64Operand::r(X64Reg::RCX), X64Operand::ripRVA(addString(profileFile_)));
+    asm_.emit(X64Op::MOV, r32(X64Reg::RDX), imm(0x40000000));
+    asm_.emit(X64Op::XOR, r32(X64Reg::R8), r32(X64Reg::R8));
+    asm_.emit(X64Op::XOR, r32(X64Reg::R9), r32(X64Reg::R9));
+    asm_.emit(X64Op::MOV, X64Operand::mem(X64Reg::RSP, 0x20), imm(2));
+    asm_.emit(X64Op::MOV, X64Operand::mem(X64Reg::RSP, 0x28), imm(0x80));
+    asm_.emit(X64Op::MOV, X64Operand::mem(X64Reg::RSP, 0x30), imm(0));
+    asm_.call_mem_rip(pe_.getImportRVA("CreateFileA"));
+    asm_.emit(X64Op::CMP, X64Operand::r(X64Reg::RAX), imm(-1));       // INVALID_HANDLE_VALUE
+    asm_.jcc(X64Cond::E, doneLabel);
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RBX), X64Operand::r(X64Reg::RAX));
+
+    writeString("# Tyl Profile Data v1.0\n");
+    for (const auto& record : profileCollector_.records()) {
+        switch (record.kind) {
+            case ProfileRecord::Kind::Function:
+                // No cycle counts yet: the reader ranks functions by calls alone
+                writeString("\nFUNC " + record.function + " ");
+                asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), counter(record.counter));
+                asm_.call_rel32(writeNumLabel);
+                writeString(" 0\n");
+                break;
+            case ProfileRecord::Kind::Branch:
+                // Counters: [executed, taken]
+                writeString("BRANCH " + std::to_string(record.line) + " ");
+                asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), counter(record.counter + 1));
+                asm_.call_rel32(writeNumLabel);
+                writeString(" ");
+                asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), counter(record.counter));
+                asm_.emit(X64Op::SUB, X64Operand::r(X64Reg::RAX), counter(record.counter + 1));
+                asm_.call_rel32(writeNumLabel);
+                writeString("\n");
+                break;
+            case ProfileRecord::Kind::Loop:
+                // Counters: [entries, iterations]
+                writeString("LOOP " + std::to_string(record.line) + " ");
+                asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), counter(record.counter + 1));
+                asm_.call_rel32(writeNumLabel);
+                writeString(" ");
+                asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), counter(record.counter));
+                asm_.call_rel32(writeNumLabel);
+                writeString("\n");
+                break;
+            case ProfileRecord::Kind::CallSite:
+                writeString("CALL " + record.callee + " " + std::to_string(record.line) + " ");
+                asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), counter(record.counter));
+                asm_.call_rel32(writeNumLabel);
+                writeString("\n");
+                break;
+        }
+    }
+
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RCX), X64Operand::r(X64Reg::RBX));
+    asm_.call_mem_rip(pe_.getImportRVA("CloseHandle"));
+
+    asm_.label(doneLabel);
+    asm_.add_rsp_imm32(0x48);
+    asm_.pop_rbx();
+    asm_.pop_rbp();
+    asm_.ret();
+
+    // write_num: rax = value; formats it and falls through to write_buf
+    asm_.label(writeNumLabel);
+    emitItoa();
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RDX), X64Operand::r(X64Reg::RAX));
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::R8), X64Operand::r(X64Reg::RCX));
+
+    // write_buf: WriteFile(rbx, rdx, r8d, &written, NULL)
+    asm_.label(writeBufLabel);
+    asm_.sub_rsp_imm32(0x38);
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RCX), X64Operand::r(X64Reg::RBX));
+    asm_.emit(X64Op::LEA, X64Operand::r(X64Reg::R9), X64Operand::mem(X64Reg::RSP, 0x30));
+    asm_.emit(X64Op::MOV, X64Operand::mem(X64Reg::RSP, 0x20), imm(0));
+    asm_.call_mem_rip(pe_.getImportRVA("WriteFile"));
+    asm_.add_rsp_imm32(0x38);
+    asm_.ret();
+}
+
+} // namespace tyl
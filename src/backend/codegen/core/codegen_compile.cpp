@@ -3,6 +3,8 @@
 
 #include "backend/codegen/codegen_base.h"
 #include "backend/x64/peephole.h"
+#include "semantic/optimizer/analysis/instruction_scheduler.h"
+#include <algorithm>
 #include <cstring>
 
 namespace tyl {
@@ -23,6 +25,7 @@ bool NativeCodeGen::compile(Program& program, const std::string& outputFile) {
     pe_.addImport("kernel32.dll", "GetProcessHeap");
     pe_.addImport("kernel32.dll", "HeapAlloc");
     pe_.addImport("kernel32.dll", "HeapFree");
+    pe_.addImport("kernel32.dll", "VirtualAlloc");
     pe_.addImport("kernel32.dll", "GetComputerNameA");
     pe_.addImport("kernel32.dll", "GetSystemInfo");
     pe_.addImport("kernel32.dll", "Sleep");
@@ -39,6 +42,8 @@ bool NativeCodeGen::compile(Program& program, const std::string& outputFile) {
     pe_.addImport("kernel32.dll", "WaitForSingleObject");
     pe_.addImport("kernel32.dll", "GetExitCodeThread");
     pe_.addImport("kernel32.dll", "CloseHandle");
+    pe_.addImport("kernel32.dll", "TlsAlloc");
+    pe_.addImport("kernel32.dll", "TlsSetValue");
     // Channel/synchronization support
     pe_.addImport("kernel32.dll", "CreateMutexA");
     pe_.addImport("kernel32.dll", "ReleaseMutex");
@@ -90,20 +95,20 @@ bool NativeCodeGen::compile(Program& program, const std::string& outputFile) {
     std::vector<uint8_t> itoaBuf(32, 0);
     itoaBufferRVA_ = pe_.addData(itoaBuf.data(), itoaBuf.size());
     
-    // Initialize GC data section globals (48 bytes)
-    // Layout: gc_alloc_head(8), gc_total_bytes(8), gc_threshold(8), gc_enabled(8), gc_collections(8), gc_stack_bottom(8)
-    if (useGC_) {
-        std::vector<uint8_t> gcData(48, 0);
-        // Set gc_threshold to 1MB (1048576 bytes) at offset 16
-        uint64_t threshold = 1048576;
-        memcpy(&gcData[16], &threshold, 8);
-        // Set gc_enabled to 1 at offset 24
-        uint64_t enabled = 1;
-        memcpy(&gcData[24], &enabled, 8);
-        gcDataRVA_ = pe_.addData(gcData.data(), gcData.size());
-        gcCollectLabel_ = "__TYL_gc_collect";
+    // Vector loop dispatch flag, set by the startup cpuid probe
+    uint64_t cpuHasAVX2 = 0;
+    cpuHasAVX2RVA_ = pe_.addData(&cpuHasAVX2, sizeof(cpuHasAVX2));
+    
+    // Profile counters (--profile-generate), zeroed; dumped at exit
+    if (!profileFile_.empty()) {
+        profileCollector_.instrument(program);
+        std::vector<uint8_t> counters(static_cast<size_t>(std::max(profileCollector_.counterCount(), 1)) * 8, 0);
+        profileCountersRVA_ = pe_.addData(counters.data(), counters.size());
     }
     
+    // GC data section globals (layout in codegen_gc.cpp)
+    if (useGC_) initGCData();
+    
     // First pass: scan for record declarations to populate recordTypes_
     for (auto& stmt : program.statements) {
         if (auto* rec = dynamic_cast<RecordDecl*>(stmt.get())) {
@@ -307,6 +312,12 @@ bool NativeCodeGen::compile(Program& program, const std::string& outputFile) {
     // Emit shared runtime routines (itoa, ftoa, etc.) at end of code section
     // This must be done BEFORE label resolution
     emitRuntimeRoutines();
+    emitProfileDumpRoutine();
+    emitColdBlocks();
+    
+    // Optimize at the instruction level while labels are still symbolic
+    optimizeMachineCode();
+    emitGCFrameTable();
     
     // Finalize vtables with actual function addresses
     finalizeVtables();
@@ -314,15 +325,38 @@ bool NativeCodeGen::compile(Program& program, const std::string& outputFile) {
     // Resolve label fixups
     asm_.resolve(PEGenerator::CODE_RVA);
     
-    // Apply peephole optimizations
-    PeepholeOptimizer peephole;
-    peephole.optimize(asm_.code);
-    
     // Add code to PE and write output
     pe_.addCodeWithFixups(asm_.code, asm_.ripFixups);
     return pe_.write(outputFile);
 }
 
+void NativeCodeGen::optimizeMachineCode() {
+    if (optLevel_ == CodeGenOptLevel::O0) return;
+    
+    // Lift the byte stream into instructions; streams that cannot be decoded
+    // exactly are emitted as-is
+    MachineCode machineCode;
+    if (!machineCode.lift(asm_)) return;
+    
+    bool sizeMode = optLevel_ == CodeGenOptLevel::Os || optLevel_ == CodeGenOptLevel::Oz;
+    bool speedMode = optLevel_ == CodeGenOptLevel::O3 || optLevel_ == CodeGenOptLevel::Ofast;
+    
+    PeepholeOptimizer peephole;
+    peephole.setOptimizeForSize(sizeMode);
+    peephole.optimize(machineCode);
+    
+    if (speedMode) {
+        MachineCodeScheduler scheduler;
+        scheduler.schedule(machineCode);
+    }
+    
+    // Re-encode; if a short branch no longer fits keep the original code
+    X64Assembler lowered;
+    if (machineCode.lower(lowered)) {
+        asm_ = std::move(lowered);
+    }
+}
+
 bool NativeCodeGen::compileToObject(Program& program, const std::string& outputFile) {
     // Initialize imports (same as compile)
     pe_.addImport("kernel32.dll", "GetStdHandle");
@@ -331,6 +365,7 @@ bool NativeCodeGen::compileToObject(Program& program, const std::string& outputF
     pe_.addImport("kernel32.dll", "GetProcessHeap");
     pe_.addImport("kernel32.dll", "HeapAlloc");
     pe_.addImport("kernel32.dll", "HeapFree");
+    pe_.addImport("kernel32.dll", "VirtualAlloc");
     pe_.addImport("kernel32.dll", "GetComputerNameA");
     pe_.addImport("kernel32.dll", "GetSystemInfo");
     pe_.addImport("kernel32.dll", "Sleep");
@@ -346,6 +381,8 @@ bool NativeCodeGen::compileToObject(Program& program, const std::string& outputF
     pe_.addImport("kernel32.dll", "WaitForSingleObject");
     pe_.addImport("kernel32.dll", "GetExitCodeThread");
     pe_.addImport("kernel32.dll", "CloseHandle");
+    pe_.addImport("kernel32.dll", "TlsAlloc");
+    pe_.addImport("kernel32.dll", "TlsSetValue");
     pe_.addImport("kernel32.dll", "CreateMutexA");
     pe_.addImport("kernel32.dll", "ReleaseMutex");
     pe_.addImport("kernel32.dll", "CreateEventA");
@@ -389,16 +426,12 @@ bool NativeCodeGen::compileToObject(Program& program, const std::string& outputF
     std::vector<uint8_t> itoaBuf(32, 0);
     itoaBufferRVA_ = pe_.addData(itoaBuf.data(), itoaBuf.size());
     
-    // Initialize GC data section globals
-    if (useGC_) {
-        std::vector<uint8_t> gcData(48, 0);
-        uint64_t threshold = 1048576;
-        memcpy(&gcData[16], &threshold, 8);
-        uint64_t enabled = 1;
-        memcpy(&gcData[24], &enabled, 8);
-        gcDataRVA_ = pe_.addData(gcData.data(), gcData.size());
-        gcCollectLabel_ = "__TYL_gc_collect";
-    }
+    // Vector loop dispatch flag, set by the startup cpuid probe
+    uint64_t cpuHasAVX2 = 0;
+    cpuHasAVX2RVA_ = pe_.addData(&cpuHasAVX2, sizeof(cpuHasAVX2));
+    
+    // GC data section globals (layout in codegen_gc.cpp)
+    if (useGC_) initGCData();
     
     // First pass: scan for record declarations
     for (auto& stmt : program.statements) {
@@ -570,6 +603,11 @@ bool NativeCodeGen::compileToObject(Program& program, const std::string& outputF
     
     // Visit the program to generate code
     program.accept(*this);
+    emitColdBlocks();
+    
+    // Optimize at the instruction level while labels are still symbolic
+    optimizeMachineCode();
+    emitGCFrameTable();
     
     // Finalize vtables
     finalizeVtables();
@@ -577,10 +615,6 @@ bool NativeCodeGen::compileToObject(Program& program, const std::string& outputF
     // Resolve label fixups
     asm_.resolve(PEGenerator::CODE_RVA);
     
-    // Apply peephole optimizations
-    PeepholeOptimizer peephole;
-    peephole.optimize(asm_.code);
-    
     // Create ObjectFile from generated code
     ObjectFile obj;
     obj.moduleName = outputFile;
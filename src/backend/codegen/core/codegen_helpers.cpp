@@ -36,6 +36,98 @@ uint32_t NativeCodeGen::addFloatConstant(double value) {
 void NativeCodeGen::allocLocal(const std::string& name) {
     stackOffset -= 8;
     locals[name] = stackOffset;
+    noteGCSlot(name, stackOffset);
+}
+
+// Scratch slots for builtin/codegen temporaries. A temp is only read within
+// the statement that allocated it, so visit(Block) releases it when that
+// statement ends and later statements pack into the same slot. Buffers whose
+// address escapes (or that need contiguous pads) must stay on allocLocal.
+int32_t NativeCodeGen::allocTemp(const std::string& name) {
+    int32_t slot;
+    if (!frameSlots_.freeTemps.empty()) {
+        slot = frameSlots_.freeTemps.back();
+        frameSlots_.freeTemps.pop_back();
+    } else {
+        stackOffset -= 8;
+        slot = stackOffset;
+    }
+    frameSlots_.liveTemps.push_back(slot);
+    locals[name] = slot;
+    return slot;
+}
+
+void NativeCodeGen::releaseTemps(size_t mark) {
+    while (frameSlots_.liveTemps.size() > mark) {
+        frameSlots_.freeTemps.push_back(frameSlots_.liveTemps.back());
+        frameSlots_.liveTemps.pop_back();
+    }
+}
+
+// The prologue runs before the body has allocated anything, so it emits the
+// estimated size and finalizeFrameSize rewrites every sub/add rsp of the frame
+void NativeCodeGen::emitFrameAllocate() {
+    frameSlots_.frameBase = stackOffset;
+    frameSlots_.sizeFixups.push_back(asm_.code.size() + 3);
+    asm_.sub_rsp_imm32(functionStackSize_);
+}
+
+void NativeCodeGen::emitFrameRelease() {
+    frameSlots_.sizeFixups.push_back(asm_.code.size() + 3);
+    asm_.add_rsp_imm32(functionStackSize_);
+}
+
+// rbp is 16-byte aligned after push rbp. Everything below it - the
+// callee-saved pushes, the locals and the outgoing area - is rounded up
+// together, so rsp stays aligned at every call whatever the push count.
+void NativeCodeGen::finalizeFrameSize(int32_t callStack) {
+    int32_t savedBytes = -frameSlots_.frameBase;
+    int32_t frameBytes = -stackOffset + callStack + 0x28;
+    functionStackSize_ = ((frameBytes + 15) / 16) * 16 - savedBytes;
+    for (size_t pos : frameSlots_.sizeFixups) {
+        for (int i = 0; i < 4; i++) {
+            asm_.code[pos + i] = static_cast<uint8_t>((functionStackSize_ >> (i * 8)) & 0xFF);
+        }
+    }
+}
+
+NativeCodeGen::EmitCheckpoint NativeCodeGen::emitCheckpoint() const {
+    EmitCheckpoint checkpoint;
+    checkpoint.codeSize = asm_.code.size();
+    checkpoint.labelFixups = asm_.labelFixups.size();
+    checkpoint.ripFixups = asm_.ripFixups.size();
+    checkpoint.coldBlocks = coldBlocks_.size();
+    for (const auto& [name, pos] : asm_.labels) {
+        if (pos == checkpoint.codeSize) checkpoint.labelsAtEnd.push_back(name);
+    }
+    checkpoint.gcCodeRanges = gcCodeRanges_.size();
+    checkpoint.gcRangeStart = gcRangeStart_;
+    if (gcFrameMap_ >= 0) checkpoint.gcSlots = gcFrameMaps_[gcFrameMap_];
+    return checkpoint;
+}
+
+// Labels placed since the checkpoint go too; forward-declared function
+// labels (0xFFFFFFFF until emitted) and ones placed before it are kept
+void NativeCodeGen::rollbackTo(const EmitCheckpoint& checkpoint) {
+    for (auto it = asm_.labels.begin(); it != asm_.labels.end();) {
+        bool placedSince = it->second > checkpoint.codeSize && it->second <= asm_.code.size();
+        if (it->second == checkpoint.codeSize) {
+            placedSince = std::find(checkpoint.labelsAtEnd.begin(), checkpoint.labelsAtEnd.end(),
+                                    it->first) == checkpoint.labelsAtEnd.end();
+        }
+        if (placedSince) {
+            it = asm_.labels.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    asm_.code.resize(checkpoint.codeSize);
+    asm_.labelFixups.resize(checkpoint.labelFixups);
+    asm_.ripFixups.resize(checkpoint.ripFixups);
+    coldBlocks_.resize(checkpoint.coldBlocks);
+    gcCodeRanges_.resize(checkpoint.gcCodeRanges);
+    gcRangeStart_ = checkpoint.gcRangeStart;
+    if (gcFrameMap_ >= 0) gcFrameMaps_[gcFrameMap_] = checkpoint.gcSlots;
 }
 
 // Calculate the maximum stack space needed for a function body
@@ -136,12 +228,36 @@ int32_t NativeCodeGen::calculateExprStackSize(Expression* expr) {
     return maxStack;
 }
 
+// Function frames reserve the shadow space and outgoing argument area in the
+// prologue, so a call is just the call. Only code without a frame (frameless
+// leaf functions, which have no calls of their own) pays for the adjustment.
 void NativeCodeGen::emitCallWithOptimizedStack(uint32_t importRVA) {
+    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
     asm_.call_mem_rip(importRVA);
+    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
 }
 
 void NativeCodeGen::emitCallRelWithOptimizedStack(const std::string& label) {
+    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
     asm_.call_rel32(label);
+    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+}
+
+// Calls that can wait on another thread park the caller for the GC, so the
+// thread it waits for can still collect
+void NativeCodeGen::emitBlockingCall(uint32_t importRVA) {
+    if (!useGC_) {
+        emitCallWithOptimizedStack(importRVA);
+        return;
+    }
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), X64Operand::ripRVA(importRVA));
+    emitCallRelWithOptimizedStack(gcBlockingCallLabel_);
+}
+
+void NativeCodeGen::emitCallRaxWithOptimizedStack() {
+    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
+    asm_.call_rax();
+    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
 }
 
 // Check if a statement ends with a terminator (return, break, continue)
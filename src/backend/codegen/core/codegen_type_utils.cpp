@@ -31,6 +31,17 @@ bool NativeCodeGen::isFloatExpression(Expression* expr) {
         }
     }
     
+    // f64 elements of a fixed-size array
+    if (auto* index = dynamic_cast<IndexExpr*>(expr)) {
+        if (auto* objId = dynamic_cast<Identifier*>(index->object.get())) {
+            auto fixedIt = varFixedArrayTypes_.find(objId->name);
+            if (fixedIt != varFixedArrayTypes_.end() && fixedIt->second.elementSize == 8 &&
+                isFloatTypeName(fixedIt->second.elementType)) {
+                return true;
+            }
+        }
+    }
+    
     // Check for record field access - check if the field type is float
     if (auto* member = dynamic_cast<MemberExpr*>(expr)) {
         if (auto* objId = dynamic_cast<Identifier*>(member->object.get())) {
@@ -5,11 +5,19 @@
 
 namespace tyl {
 
-// Check if an expression contains any function calls
+// Check if an expression contains any function calls. Anything not known
+// to be call-free counts as a call: builtins behind other node kinds (list
+// literals, interpolation, channel ops, ...) call into the runtime and keep
+// their scratch values in frame slots, so they need a real frame.
 bool NativeCodeGen::expressionHasCall(Expression* expr) {
     if (!expr) return false;
     
-    if (dynamic_cast<CallExpr*>(expr)) return true;
+    if (dynamic_cast<IntegerLiteral*>(expr) || dynamic_cast<FloatLiteral*>(expr) ||
+        dynamic_cast<BoolLiteral*>(expr) || dynamic_cast<CharLiteral*>(expr) ||
+        dynamic_cast<NilLiteral*>(expr) || dynamic_cast<StringLiteral*>(expr) ||
+        dynamic_cast<Identifier*>(expr)) {
+        return false;
+    }
     
     if (auto* binary = dynamic_cast<BinaryExpr*>(expr)) {
         return expressionHasCall(binary->left.get()) || expressionHasCall(binary->right.get());
@@ -28,8 +36,11 @@ bool NativeCodeGen::expressionHasCall(Expression* expr) {
     if (auto* member = dynamic_cast<MemberExpr*>(expr)) {
         return expressionHasCall(member->object.get());
     }
+    if (auto* assign = dynamic_cast<AssignExpr*>(expr)) {
+        return expressionHasCall(assign->target.get()) || expressionHasCall(assign->value.get());
+    }
     
-    return false;
+    return true;
 }
 
 // Check if a statement contains any function calls
@@ -70,16 +81,20 @@ bool NativeCodeGen::statementHasCall(Statement* stmt) {
     if (auto* returnStmt = dynamic_cast<ReturnStmt*>(stmt)) {
         return expressionHasCall(returnStmt->value.get());
     }
+    if (dynamic_cast<BreakStmt*>(stmt) || dynamic_cast<ContinueStmt*>(stmt)) {
+        return false;
+    }
     
-    return false;
+    return true;
 }
 
 bool NativeCodeGen::checkIsLeafFunction(Statement* body) {
     return !statementHasCall(body);
 }
 
+// A leaf never prints, so it leaves rdi (the cached stdout handle) alone
 void NativeCodeGen::emitSaveCalleeSavedRegs() {
-    if (useStdoutCaching_) {
+    if (useStdoutCaching_ && !isLeafFunction_) {
         asm_.push_rdi();
         stackOffset -= 8;
     }
@@ -97,22 +112,23 @@ void NativeCodeGen::emitSaveCalleeSavedRegs() {
     }
 }
 
+// Epilogues can sit mid-function (early returns), so the pops leave
+// stackOffset alone - the slots below them are still the frame's
 void NativeCodeGen::emitRestoreCalleeSavedRegs() {
     auto usedRegs = regAlloc_.getUsedRegisters();
     for (auto it = usedRegs.rbegin(); it != usedRegs.rend(); ++it) {
         switch (*it) {
-            case VarRegister::RBX: asm_.pop_rbx(); stackOffset += 8; break;
-            case VarRegister::R12: asm_.pop_r12(); stackOffset += 8; break;
-            case VarRegister::R13: asm_.pop_r13(); stackOffset += 8; break;
-            case VarRegister::R14: asm_.pop_r14(); stackOffset += 8; break;
-            case VarRegister::R15: asm_.pop_r15(); stackOffset += 8; break;
+            case VarRegister::RBX: asm_.pop_rbx(); break;
+            case VarRegister::R12: asm_.pop_r12(); break;
+            case VarRegister::R13: asm_.pop_r13(); break;
+            case VarRegister::R14: asm_.pop_r14(); break;
+            case VarRegister::R15: asm_.pop_r15(); break;
             default: break;
         }
     }
     
-    if (useStdoutCaching_) {
+    if (useStdoutCaching_ && !isLeafFunction_) {
         asm_.pop_rdi();
-        stackOffset += 8;
     }
 }
 
@@ -326,6 +342,205 @@ static void collectNestedFunctions(Statement* stmt, std::vector<FnDecl*>& nested
     }
 }
 
+// Prologue, parameter moves, body and fall-through epilogue. Returns false if
+// a frameless body ended up allocating stack slots (rbp is the caller's).
+bool NativeCodeGen::emitFunctionBody(FnDecl& node, bool frameless) {
+    if (frameless) {
+        emitSaveCalleeSavedRegs();
+        stackAllocated_ = false;
+    } else {
+        asm_.push_rbp();
+        asm_.mov_rbp_rsp();
+        
+        emitSaveCalleeSavedRegs();
+        
+        emitFrameAllocate();
+        stackAllocated_ = true;
+    }
+    int32_t savedRegsOffset = stackOffset;
+    
+    for (size_t i = 0; i < node.params.size() && i < 4; i++) {
+        // Only mark string parameters in constStrVars
+        const std::string& paramType = node.params[i].second;
+        bool isStringParam = (paramType == "str" || paramType == "string" || paramType == "String");
+        
+        // Also check inferred parameter types from call sites
+        if (!isStringParam) {
+            auto fnIt = inferredParamTypes_.find(node.name);
+            if (fnIt != inferredParamTypes_.end()) {
+                auto paramIt = fnIt->second.find(i);
+                if (paramIt != fnIt->second.end() && paramIt->second == "str") {
+                    isStringParam = true;
+                }
+            }
+        }
+        
+        if (isStringParam) {
+            constStrVars[node.params[i].first] = "";  // Empty means runtime string
+        }
+        beginGCSlotDecl(node.params[i].first, gcSlotKindForType(paramType));
+        emitMoveParamToVar((int)i, node.params[i].first, node.params[i].second);
+        beginGCSlotDecl("", GC_SLOT_CONSERVATIVE);
+        if (isFloatTypeName(node.params[i].second)) {
+            floatVars.insert(node.params[i].first);
+        }
+        // Track function pointer parameters
+        if (paramType.find("fn(") != std::string::npos || 
+            paramType.find("fn (") != std::string::npos ||
+            (paramType.size() > 3 && paramType.substr(0, 3) == "*fn")) {
+            fnPtrVars_.insert(node.params[i].first);
+        }
+        // Track record type for parameters
+        // Handle generic types like Container[int] -> Container
+        std::string paramTypeName = node.params[i].second;
+        size_t bracketPos = paramTypeName.find('[');
+        if (bracketPos != std::string::npos) {
+            paramTypeName = paramTypeName.substr(0, bracketPos);
+        }
+        if (recordTypes_.find(paramTypeName) != recordTypes_.end()) {
+            varRecordTypes_[node.params[i].first] = paramTypeName;
+        }
+        // Track self parameter's record type from impl block context
+        if (node.params[i].first == "self" && !currentImplTypeName_.empty()) {
+            if (recordTypes_.find(currentImplTypeName_) != recordTypes_.end()) {
+                varRecordTypes_["self"] = currentImplTypeName_;
+            }
+        }
+        // Track borrow parameters for auto-dereference on return
+        if (!paramType.empty() && paramType[0] == '&') {
+            // Extract base type: "&int" -> "int", "&mut int" -> "int"
+            std::string baseType = paramType.substr(1);
+            if (baseType.substr(0, 4) == "mut ") {
+                baseType = baseType.substr(4);
+            }
+            // Trim leading whitespace
+            while (!baseType.empty() && (baseType[0] == ' ' || baseType[0] == '\t')) {
+                baseType = baseType.substr(1);
+            }
+            borrowParams_[node.params[i].first] = baseType;
+        }
+    }
+    
+    node.body->accept(*this);
+    
+    if (!endsWithTerminator(node.body.get())) {
+        asm_.xor_rax_rax();
+        
+        // Use stackAllocated_ to determine epilogue style
+        // This matches the prologue decision
+        if (!stackAllocated_) {
+            emitRestoreCalleeSavedRegs();
+        } else {
+            emitFrameRelease();
+            emitRestoreCalleeSavedRegs();
+            asm_.pop_rbp();
+        }
+        
+        asm_.ret();
+    }
+    
+    return !frameless || stackOffset == savedRegsOffset;
+}
+
+// Shrink-wrapping for entry guards like `if n <= 1: return n`. When the first
+// statement compares integer parameters against each other or a constant and
+// returns a parameter or a constant, it is emitted ahead of the prologue,
+// reading the parameters straight from their argument registers. Calls that
+// take the guard never push a callee-saved register or build a frame; the
+// body then skips the statement (its condition has no side effects).
+const Statement* NativeCodeGen::emitEntryGuard(FnDecl& node) {
+    if (!profileFile_.empty()) return nullptr;
+    if (node.returnType.empty() || isFloatTypeName(node.returnType) || node.returnType[0] == '&') return nullptr;
+    
+    auto* block = dynamic_cast<Block*>(node.body.get());
+    if (!block || block->statements.empty()) return nullptr;
+    auto* ifStmt = dynamic_cast<IfStmt*>(block->statements[0].get());
+    if (!ifStmt || !ifStmt->elifBranches.empty() || ifStmt->elseBranch) return nullptr;
+    
+    Statement* thenStmt = ifStmt->thenBranch.get();
+    if (auto* thenBlock = dynamic_cast<Block*>(thenStmt)) {
+        if (thenBlock->statements.size() != 1) return nullptr;
+        thenStmt = thenBlock->statements[0].get();
+    }
+    auto* ret = dynamic_cast<ReturnStmt*>(thenStmt);
+    auto* cond = dynamic_cast<BinaryExpr*>(ifStmt->condition.get());
+    if (!ret || !cond) return nullptr;
+    
+    static const X64Reg argRegs[] = {X64Reg::RCX, X64Reg::RDX, X64Reg::R8, X64Reg::R9};
+    
+    // Operand: an integer parameter still in its argument register, or a constant
+    struct GuardOperand { X64Reg reg = X64Reg::NONE; int64_t imm = 0; };
+    auto operand = [&](Expression* expr, GuardOperand& out) {
+        if (auto* id = dynamic_cast<Identifier*>(expr)) {
+            for (size_t i = 0; i < node.params.size() && i < 4; i++) {
+                if (node.params[i].first != id->name) continue;
+                const std::string& type = node.params[i].second;
+                if (type != "int" && type != "i64" && type != "i32" && type != "i16" &&
+                    type != "i8" && type != "isize" && type != "bool") {
+                    return false;
+                }
+                out.reg = argRegs[i];
+                return true;
+            }
+            return false;
+        }
+        if (auto* lit = dynamic_cast<IntegerLiteral*>(expr)) {
+            if (lit->value < INT32_MIN || lit->value > INT32_MAX) return false;
+            out.imm = lit->value;
+            return true;
+        }
+        if (auto* lit = dynamic_cast<BoolLiteral*>(expr)) {
+            out.imm = lit->value ? 1 : 0;
+            return true;
+        }
+        return false;
+    };
+    
+    X64Cond skipCond;
+    switch (cond->op) {
+        case TokenType::EQ: skipCond = X64Cond::NE; break;
+        case TokenType::NE: skipCond = X64Cond::E; break;
+        case TokenType::LT: skipCond = X64Cond::GE; break;
+        case TokenType::LE: skipCond = X64Cond::G; break;
+        case TokenType::GT: skipCond = X64Cond::LE; break;
+        case TokenType::GE: skipCond = X64Cond::L; break;
+        default: return nullptr;
+    }
+    
+    GuardOperand lhs, rhs, value;
+    if (!operand(cond->left.get(), lhs) || !operand(cond->right.get(), rhs)) return nullptr;
+    if (ret->value && !dynamic_cast<NilLiteral*>(ret->value.get()) && !operand(ret->value.get(), value)) return nullptr;
+    
+    if (lhs.reg == X64Reg::NONE) {
+        // Constant on the left: swap the operands and mirror the comparison
+        if (rhs.reg == X64Reg::NONE) return nullptr;
+        std::swap(lhs, rhs);
+        switch (skipCond) {
+            case X64Cond::GE: skipCond = X64Cond::LE; break;
+            case X64Cond::G: skipCond = X64Cond::L; break;
+            case X64Cond::LE: skipCond = X64Cond::GE; break;
+            case X64Cond::L: skipCond = X64Cond::G; break;
+            default: break;
+        }
+    }
+    
+    std::string bodyLabel = newLabel("fn_body");
+    asm_.emit(X64Op::CMP, X64Operand::r(lhs.reg),
+              rhs.reg != X64Reg::NONE ? X64Operand::r(rhs.reg) : X64Operand::immediate(rhs.imm));
+    asm_.jcc(skipCond, bodyLabel);
+    if (value.reg != X64Reg::NONE) {
+        asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), X64Operand::r(value.reg));
+    } else if (value.imm == 0) {
+        asm_.xor_rax_rax();
+    } else {
+        asm_.mov_rax_imm64(value.imm);
+    }
+    asm_.ret();
+    asm_.label(bodyLabel);
+    return ifStmt;
+}
+
+
 void NativeCodeGen::visit(FnDecl& node) {
     // Skip comptime functions - they are evaluated at compile time, not emitted as code
     if (node.isComptime) {
@@ -349,6 +564,7 @@ void NativeCodeGen::visit(FnDecl& node) {
     std::string savedReturnType = currentFnReturnType_;
     std::set<std::string> savedFnPtrVars = fnPtrVars_;
     std::set<std::string> savedClosureVars = closureVars_;
+    FrameSlots savedFrameSlots = std::move(frameSlots_);
     
     std::vector<FnDecl*> nestedFunctions;
     if (auto* block = dynamic_cast<Block*>(node.body.get())) {
@@ -369,6 +585,7 @@ void NativeCodeGen::visit(FnDecl& node) {
     closureVars_.clear();
     currentFnReturnType_ = node.returnType;
     stackOffset = 0;
+    frameSlots_ = FrameSlots();
     stackAllocated_ = false;
     varRegisters_.clear();
     
@@ -486,6 +703,7 @@ void NativeCodeGen::visit(FnDecl& node) {
         }
         else if (auto* forStmt = dynamic_cast<ForStmt*>(stmt)) {
             localVarCount += 3;  // loop var, $end, possibly $step
+            localVarCount += countStrengthReducibleAccesses(*forStmt);
             scanExpr(forStmt->iterable.get());
             countLocals(forStmt->body.get());
         }
@@ -534,9 +752,12 @@ void NativeCodeGen::visit(FnDecl& node) {
         callStack = 0;
     }
     
+    // Provisional: finalizeFrameSize re-sizes the frame from the packed
+    // locals once the body is emitted
     functionStackSize_ = ((baseStack + callStack + 0x28 + 15) / 16) * 16;
     
     asm_.label(node.name);
+    emitProfileCounter(&node);
     
     // Handle naked functions - no prologue/epilogue
     if (node.isNaked) {
@@ -549,6 +770,7 @@ void NativeCodeGen::visit(FnDecl& node) {
         constStrVars = savedConstStrVars;
         varRecordTypes_ = savedVarRecordTypes;
         stackOffset = savedStackOffset;
+        frameSlots_ = std::move(savedFrameSlots);
         inFunction = savedInFunction;
         functionStackSize_ = savedFunctionStackSize;
         stackAllocated_ = savedStackAllocated;
@@ -562,164 +784,51 @@ void NativeCodeGen::visit(FnDecl& node) {
         return;
     }
     
-    // Only use simplified leaf function prologue if there are no local variables
-    // (including those created by walrus expressions)
-    if (isLeafFunction_ && varRegisters_.size() == node.params.size() && node.params.size() <= 4 && localVarCount == 0) {
-        emitSaveCalleeSavedRegs();
-        
-        for (size_t i = 0; i < node.params.size() && i < 4; i++) {
-            // Only mark string parameters in constStrVars
-            const std::string& paramType = node.params[i].second;
-            bool isStringParam = (paramType == "str" || paramType == "string" || paramType == "String");
-            
-            // Also check inferred parameter types from call sites
-            if (!isStringParam) {
-                auto fnIt = inferredParamTypes_.find(node.name);
-                if (fnIt != inferredParamTypes_.end()) {
-                    auto paramIt = fnIt->second.find(i);
-                    if (paramIt != fnIt->second.end() && paramIt->second == "str") {
-                        isStringParam = true;
-                    }
-                }
-            }
-            
-            if (isStringParam) {
-                constStrVars[node.params[i].first] = "";  // Empty means runtime string
-            }
-            emitMoveParamToVar((int)i, node.params[i].first, node.params[i].second);
-            if (isFloatTypeName(node.params[i].second)) {
-                floatVars.insert(node.params[i].first);
-            }
-            // Track function pointer parameters
-            if (paramType.find("fn(") != std::string::npos || 
-                paramType.find("fn (") != std::string::npos ||
-                (paramType.size() > 3 && paramType.substr(0, 3) == "*fn")) {
-                fnPtrVars_.insert(node.params[i].first);
-            }
-            // Track record type for parameters
-            // Handle generic types like Container[int] -> Container
-            std::string paramTypeName = node.params[i].second;
-            size_t bracketPos = paramTypeName.find('[');
-            if (bracketPos != std::string::npos) {
-                paramTypeName = paramTypeName.substr(0, bracketPos);
-            }
-            if (recordTypes_.find(paramTypeName) != recordTypes_.end()) {
-                varRecordTypes_[node.params[i].first] = paramTypeName;
-            }
-            // Track self parameter's record type from impl block context
-            if (node.params[i].first == "self" && !currentImplTypeName_.empty()) {
-                if (recordTypes_.find(currentImplTypeName_) != recordTypes_.end()) {
-                    varRecordTypes_["self"] = currentImplTypeName_;
-                }
-            }
-            // Track borrow parameters for auto-dereference on return
-            if (!paramType.empty() && paramType[0] == '&') {
-                // Extract base type: "&int" -> "int", "&mut int" -> "int"
-                std::string baseType = paramType.substr(1);
-                if (baseType.substr(0, 4) == "mut ") {
-                    baseType = baseType.substr(4);
-                }
-                // Trim leading whitespace
-                while (!baseType.empty() && (baseType[0] == ' ' || baseType[0] == '\t')) {
-                    baseType = baseType.substr(1);
-                }
-                borrowParams_[node.params[i].first] = baseType;
-            }
+    // Frame-pointer omission: a leaf whose parameters and locals all got
+    // registers needs no rbp frame at all. A few declarations still fall
+    // back to a stack slot while being emitted, so a frameless attempt that
+    // allocated one is thrown away and the function is emitted again with a
+    // frame.
+    bool frameless = isLeafFunction_ && node.params.size() <= 4 &&
+                     varRegisters_.size() == node.params.size() + localVarCount;
+    for (const auto& param : node.params) {
+        auto regIt = varRegisters_.find(param.first);
+        if (regIt == varRegisters_.end() || regIt->second == VarRegister::NONE) frameless = false;
+    }
+    
+    int32_t enclosingFrameMap = beginGCFrameMap();
+    hoistedGuard_ = optLevel_ != CodeGenOptLevel::O0 ? emitEntryGuard(node) : nullptr;
+    
+    if (frameless) {
+        EmitCheckpoint bodyStart = emitCheckpoint();
+        std::map<std::string, VarRegister> allocatedRegisters = varRegisters_;
+        if (!emitFunctionBody(node, true)) {
+            rollbackTo(bodyStart);
+            locals.clear();
+            constStrVars = savedConstStrVars;
+            varRecordTypes_.clear();
+            borrowParams_.clear();
+            fnPtrVars_.clear();
+            closureVars_.clear();
+            stackOffset = 0;
+            frameSlots_ = FrameSlots();
+            varRegisters_ = allocatedRegisters;
+            stdoutHandleCached_ = savedStdoutCached;
+            emitFunctionBody(node, false);
         }
-        
-        stackAllocated_ = false;
     } else {
-        asm_.push_rbp();
-        asm_.mov_rbp_rsp();
-        
-        emitSaveCalleeSavedRegs();
-        
-        asm_.sub_rsp_imm32(functionStackSize_);
-        stackAllocated_ = true;
-        
-        for (size_t i = 0; i < node.params.size() && i < 4; i++) {
-            // Only mark string parameters in constStrVars
-            const std::string& paramType = node.params[i].second;
-            bool isStringParam = (paramType == "str" || paramType == "string" || paramType == "String");
-            
-            // Also check inferred parameter types from call sites
-            if (!isStringParam) {
-                auto fnIt = inferredParamTypes_.find(node.name);
-                if (fnIt != inferredParamTypes_.end()) {
-                    auto paramIt = fnIt->second.find(i);
-                    if (paramIt != fnIt->second.end() && paramIt->second == "str") {
-                        isStringParam = true;
-                    }
-                }
-            }
-            
-            if (isStringParam) {
-                constStrVars[node.params[i].first] = "";  // Empty means runtime string
-            }
-            emitMoveParamToVar((int)i, node.params[i].first, node.params[i].second);
-            if (isFloatTypeName(node.params[i].second)) {
-                floatVars.insert(node.params[i].first);
-            }
-            // Track function pointer parameters
-            if (paramType.find("fn(") != std::string::npos || 
-                paramType.find("fn (") != std::string::npos ||
-                (paramType.size() > 3 && paramType.substr(0, 3) == "*fn")) {
-                fnPtrVars_.insert(node.params[i].first);
-            }
-            // Track record type for parameters
-            // Handle generic types like Container[int] -> Container
-            std::string paramTypeName = node.params[i].second;
-            size_t bracketPos = paramTypeName.find('[');
-            if (bracketPos != std::string::npos) {
-                paramTypeName = paramTypeName.substr(0, bracketPos);
-            }
-            if (recordTypes_.find(paramTypeName) != recordTypes_.end()) {
-                varRecordTypes_[node.params[i].first] = paramTypeName;
-            }
-            // Track self parameter's record type from impl block context
-            if (node.params[i].first == "self" && !currentImplTypeName_.empty()) {
-                if (recordTypes_.find(currentImplTypeName_) != recordTypes_.end()) {
-                    varRecordTypes_["self"] = currentImplTypeName_;
-                }
-            }
-            // Track borrow parameters for auto-dereference on return
-            if (!paramType.empty() && paramType[0] == '&') {
-                // Extract base type: "&int" -> "int", "&mut int" -> "int"
-                std::string baseType = paramType.substr(1);
-                if (baseType.substr(0, 4) == "mut ") {
-                    baseType = baseType.substr(4);
-                }
-                // Trim leading whitespace
-                while (!baseType.empty() && (baseType[0] == ' ' || baseType[0] == '\t')) {
-                    baseType = baseType.substr(1);
-                }
-                borrowParams_[node.params[i].first] = baseType;
-            }
-        }
+        emitFunctionBody(node, false);
     }
+    hoistedGuard_ = nullptr;
     
-    node.body->accept(*this);
-    
-    if (!endsWithTerminator(node.body.get())) {
-        asm_.xor_rax_rax();
-        
-        // Use stackAllocated_ to determine epilogue style
-        // This matches the prologue decision
-        if (!stackAllocated_) {
-            emitRestoreCalleeSavedRegs();
-        } else {
-            asm_.add_rsp_imm32(functionStackSize_);
-            emitRestoreCalleeSavedRegs();
-            asm_.pop_rbp();
-        }
-        
-        asm_.ret();
-    }
+    finalizeFrameSize(callStack);
+    endGCFrameMap(enclosingFrameMap);
     
     locals = savedLocals;
     constStrVars = savedConstStrVars;
     varRecordTypes_ = savedVarRecordTypes;
     stackOffset = savedStackOffset;
+    frameSlots_ = std::move(savedFrameSlots);
     inFunction = savedInFunction;
     functionStackSize_ = savedFunctionStackSize;
     stackAllocated_ = savedStackAllocated;
@@ -51,6 +51,7 @@ void NativeCodeGen::emitSpecializedFunctions() {
         std::map<std::string, std::string> savedConstStrVars = constStrVars;
         std::set<std::string> savedFloatVars = floatVars;
         int32_t savedStackOffset = stackOffset;
+        FrameSlots savedFrameSlots = std::move(frameSlots_);
         bool savedInFunction = inFunction;
         int32_t savedFunctionStackSize = functionStackSize_;
         bool savedStackAllocated = stackAllocated_;
@@ -65,6 +66,7 @@ void NativeCodeGen::emitSpecializedFunctions() {
         inFunction = true;
         locals.clear();
         stackOffset = 0;
+        frameSlots_ = FrameSlots();
         stackAllocated_ = false;
         varRegisters_.clear();
         floatVars.clear();  // Clear float vars for this function
@@ -117,6 +119,7 @@ void NativeCodeGen::emitSpecializedFunctions() {
         
         // Emit function label
         asm_.label(mangledName);
+        int32_t enclosingFrameMap = beginGCFrameMap();
         
         // Standard function prologue
         asm_.push_rbp();
@@ -124,7 +127,7 @@ void NativeCodeGen::emitSpecializedFunctions() {
         
         emitSaveCalleeSavedRegs();
         
-        asm_.sub_rsp_imm32(functionStackSize_);
+        emitFrameAllocate();
         stackAllocated_ = true;
 
         // Handle parameters - for float parameters, they come in XMM registers
@@ -213,17 +216,21 @@ void NativeCodeGen::emitSpecializedFunctions() {
         // Emit epilogue if body doesn't end with return
         if (!endsWithTerminator(originalFn->body.get())) {
             asm_.xor_rax_rax();
-            asm_.add_rsp_imm32(functionStackSize_);
+            emitFrameRelease();
             emitRestoreCalleeSavedRegs();
             asm_.pop_rbp();
             asm_.ret();
         }
         
+        finalizeFrameSize(callStack);
+        endGCFrameMap(enclosingFrameMap);
+        
         // Restore state
         locals = savedLocals;
         constStrVars = savedConstStrVars;
         floatVars = savedFloatVars;
         stackOffset = savedStackOffset;
+        frameSlots_ = std::move(savedFrameSlots);
         inFunction = savedInFunction;
         functionStackSize_ = savedFunctionStackSize;
         stackAllocated_ = savedStackAllocated;
@@ -361,6 +368,12 @@ void NativeCodeGen::visit(Program& node) {
         }
     }
     
+    // Find loops that get a packed SIMD main loop
+    if (optLevel_ == CodeGenOptLevel::O3 || optLevel_ == CodeGenOptLevel::Ofast) {
+        vectorizer_.setVectorBytes(targetISA_ == TargetISA::X86_64_V3 ? 32 : 16);
+        if (profileFile_.empty()) vectorizer_.analyze(node);   // Keep instrumented loops scalar
+    }
+    
     // Infer parameter types from call sites (for functions without explicit type annotations)
     inferParamTypesFromCallSites(node, functions);
     
@@ -399,6 +412,7 @@ void NativeCodeGen::visit(Program& node) {
     }
     
     asm_.label("_start");
+    int32_t enclosingFrameMap = beginGCFrameMap();
     asm_.push_rbp();
     asm_.mov_rbp_rsp();
     
@@ -445,11 +459,16 @@ void NativeCodeGen::visit(Program& node) {
         emitGCInit();
     }
     
+    // Probe AVX2 for the vector loops
+    emitCpuFeatureCheck();
+    
     // Copy global register assignments to varRegisters_ for use in codegen
     varRegisters_ = globalVarRegisters_;
     
     for (auto* stmt : topLevelStmts) {
+        size_t tempMark = frameSlots_.liveTemps.size();
         stmt->accept(*this);
+        releaseTemps(tempMark);
     }
     
     if (mainFn) {
@@ -458,16 +477,18 @@ void NativeCodeGen::visit(Program& node) {
         asm_.xor_rax_rax();
     }
     
+    emitProfileDumpCall();
     asm_.mov_rcx_rax();
     asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
+    endGCFrameMap(enclosingFrameMap);
     
     // Reset for function compilation
     stackAllocated_ = false;
     functionStackSize_ = 0;
     varRegisters_.clear();
     
-    // Emit top-level functions
-    for (auto* fn : functions) {
+    // Emit top-level functions, hot ones first
+    for (auto* fn : layoutFunctions(functions)) {
         fn->accept(*this);
     }
     
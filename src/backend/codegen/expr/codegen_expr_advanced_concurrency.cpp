@@ -11,70 +11,58 @@ void NativeCodeGen::emitFutureCreate(int32_t elementSize) {
     (void)elementSize;
     asm_.mov_rcx_imm64(40);
     emitGCAllocRaw(40);
-    asm_.push_rax();
+    int32_t futureSlot = allocTemp("$future_ptr");
+    asm_.mov_mem_rbp_rax(futureSlot);
     
     asm_.xor_rcx_rcx();
     asm_.xor_rdx_rdx();
     asm_.xor_r8_r8();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CreateMutexA"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CreateMutexA"));
     asm_.mov_rcx_rax();
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(futureSlot);
     asm_.mov_mem_rax_rcx(0);
     
     asm_.xor_rcx_rcx();
     asm_.mov_edx_imm32(1);
     asm_.xor_r8_r8();
     asm_.xor_r9_r9();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CreateEventA"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CreateEventA"));
     asm_.mov_rcx_rax();
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(futureSlot);
     asm_.mov_mem_rax_rcx(8);
     
-    asm_.mov_rax_mem_rsp(0);
     asm_.xor_rcx_rcx();
     asm_.mov_mem_rax_rcx(16);
     asm_.mov_mem_rax_rcx(24);
     asm_.mov_mem_rax_rcx(32);
-    asm_.pop_rax();
 }
 
 void NativeCodeGen::emitFutureGet() {
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);
-    asm_.mov_rax_mem_rsp(8);
+    int32_t futureSlot = allocTemp("$future_ptr");
+    asm_.mov_mem_rbp_rax(futureSlot);
     asm_.mov_rcx_mem_rax(8);
     asm_.mov_rdx_imm64(0xFFFFFFFF);
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WaitForSingleObject"));
-    asm_.add_rsp_imm32(0x28);
-    asm_.mov_rax_mem_rsp(8);
+    emitBlockingCall(pe_.getImportRVA("WaitForSingleObject"));
+    asm_.mov_rax_mem_rbp(futureSlot);
     asm_.mov_rcx_mem_rax(16);
     asm_.mov_rax_rcx();
-    asm_.add_rsp_imm32(16);
 }
 
 void NativeCodeGen::emitFutureSet() {
     // Entry: RAX = future pointer, RCX = value to set
-    // Stack layout after pushes: RSP+0 = value, RSP+8 = future
-    asm_.push_rax();           // push future
-    asm_.push_rcx();           // push value
+    int32_t futureSlot = allocTemp("$future_ptr");
+    int32_t valueSlot = allocTemp("$future_value");
+    asm_.mov_mem_rbp_rax(futureSlot);
+    asm_.mov_mem_rbp_rcx(valueSlot);
     
     // Lock the mutex: WaitForSingleObject(future->mutex, INFINITE)
-    asm_.mov_rax_mem_rsp(8);   // RAX = future
     asm_.mov_rcx_mem_rax(0);   // RCX = future->mutex
     asm_.mov_rdx_imm64(0xFFFFFFFF);  // INFINITE
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WaitForSingleObject"));
-    asm_.add_rsp_imm32(0x28);
+    emitBlockingCall(pe_.getImportRVA("WaitForSingleObject"));
     
     // Store value: future->value = value
-    asm_.mov_rax_mem_rsp(0);   // RAX = value
-    asm_.mov_rcx_rax();        // RCX = value
-    asm_.mov_rax_mem_rsp(8);   // RAX = future
+    asm_.mov_rcx_mem_rbp(valueSlot);   // RCX = value
+    asm_.mov_rax_mem_rbp(futureSlot);  // RAX = future
     asm_.mov_mem_rax_rcx(16);  // future->value = value
     
     // Set ready flag: future->is_ready = 1
@@ -83,18 +71,12 @@ void NativeCodeGen::emitFutureSet() {
     
     // Signal event: SetEvent(future->event)
     asm_.mov_rcx_mem_rax(8);   // RCX = future->event
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("SetEvent"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("SetEvent"));
     
     // Release mutex: ReleaseMutex(future->mutex)
-    asm_.mov_rax_mem_rsp(8);   // RAX = future
+    asm_.mov_rax_mem_rbp(futureSlot);  // RAX = future
     asm_.mov_rcx_mem_rax(0);   // RCX = future->mutex
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("ReleaseMutex"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);    // clean up stack (pop value and future)
+    emitCallWithOptimizedStack(pe_.getImportRVA("ReleaseMutex"));
 }
 
 void NativeCodeGen::emitFutureIsReady() {
@@ -132,70 +114,52 @@ void NativeCodeGen::visit(FutureIsReadyExpr& node) {
 void NativeCodeGen::emitThreadPoolCreate(int64_t numWorkers) {
     asm_.mov_rcx_imm64(32);
     emitGCAllocRaw(32);
-    asm_.push_rax();
+    int32_t poolSlot = allocTemp("$pool_ptr");
+    asm_.mov_mem_rbp_rax(poolSlot);
     
     asm_.xor_rcx_rcx();
     asm_.xor_rdx_rdx();
     asm_.xor_r8_r8();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CreateMutexA"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CreateMutexA"));
     asm_.mov_rcx_rax();
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(poolSlot);
     asm_.mov_mem_rax_rcx(0);
     
     asm_.xor_rcx_rcx();
     asm_.xor_rdx_rdx();
     asm_.xor_r8_r8();
     asm_.xor_r9_r9();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CreateEventA"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CreateEventA"));
     asm_.mov_rcx_rax();
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(poolSlot);
     asm_.mov_mem_rax_rcx(8);
     
-    asm_.mov_rax_mem_rsp(0);
     asm_.xor_rcx_rcx();
     asm_.mov_mem_rax_rcx(16);
     asm_.mov_rcx_imm64(numWorkers);
     asm_.mov_mem_rax_rcx(24);
-    asm_.pop_rax();
 }
 
 void NativeCodeGen::emitThreadPoolSubmit() {
-    asm_.push_rax();
-    asm_.push_rcx();
     asm_.mov_rax_rcx();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_rax();
-    asm_.add_rsp_imm32(0x28);
-    asm_.add_rsp_imm32(16);
+    emitCallRaxWithOptimizedStack();
     asm_.xor_rax_rax();
 }
 
 void NativeCodeGen::emitThreadPoolShutdown() {
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);
-    asm_.mov_rax_mem_rsp(8);
+    int32_t poolSlot = allocTemp("$pool_ptr");
+    asm_.mov_mem_rbp_rax(poolSlot);
     asm_.mov_rcx_mem_rax(0);
     asm_.mov_rdx_imm64(0xFFFFFFFF);
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WaitForSingleObject"));
-    asm_.add_rsp_imm32(0x28);
-    asm_.mov_rax_mem_rsp(8);
+    emitBlockingCall(pe_.getImportRVA("WaitForSingleObject"));
+    asm_.mov_rax_mem_rbp(poolSlot);
     asm_.mov_rcx_imm64(1);
     asm_.mov_mem_rax_rcx(16);
     asm_.mov_rcx_mem_rax(8);
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("SetEvent"));
-    asm_.add_rsp_imm32(0x28);
-    asm_.mov_rax_mem_rsp(8);
+    emitCallWithOptimizedStack(pe_.getImportRVA("SetEvent"));
+    asm_.mov_rax_mem_rbp(poolSlot);
     asm_.mov_rcx_mem_rax(0);
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("ReleaseMutex"));
-    asm_.add_rsp_imm32(0x28);
-    asm_.add_rsp_imm32(16);
+    emitCallWithOptimizedStack(pe_.getImportRVA("ReleaseMutex"));
 }
 
 void NativeCodeGen::visit(MakeThreadPoolExpr& node) {
@@ -277,7 +241,8 @@ void NativeCodeGen::visit(ChanSendTimeoutExpr& node) {
 void NativeCodeGen::emitCancelTokenCreate() {
     asm_.mov_rcx_imm64(16);
     emitGCAllocRaw(16);
-    asm_.push_rax();
+    int32_t tokenSlot = allocTemp("$cancel_token");
+    asm_.mov_mem_rbp_rax(tokenSlot);
     asm_.xor_rcx_rcx();
     asm_.mov_mem_rax_rcx(0);
     
@@ -285,26 +250,17 @@ void NativeCodeGen::emitCancelTokenCreate() {
     asm_.mov_edx_imm32(1);
     asm_.xor_r8_r8();
     asm_.xor_r9_r9();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CreateEventA"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CreateEventA"));
     asm_.mov_rcx_rax();
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(tokenSlot);
     asm_.mov_mem_rax_rcx(8);
-    asm_.pop_rax();
 }
 
 void NativeCodeGen::emitCancel() {
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);
-    asm_.mov_rax_mem_rsp(8);
     asm_.mov_rcx_imm64(1);
     asm_.mov_mem_rax_rcx(0);
     asm_.mov_rcx_mem_rax(8);
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("SetEvent"));
-    asm_.add_rsp_imm32(0x28);
-    asm_.add_rsp_imm32(16);
+    emitCallWithOptimizedStack(pe_.getImportRVA("SetEvent"));
 }
 
 void NativeCodeGen::emitIsCancelled() {
@@ -345,17 +301,16 @@ void NativeCodeGen::emitAsyncRuntimeInit(int64_t numWorkers) {
     // Allocate runtime structure
     asm_.mov_rcx_imm64(56);
     emitGCAllocRaw(56);
-    asm_.push_rax();
+    int32_t runtimeSlot = allocTemp("$async_runtime");
+    asm_.mov_mem_rbp_rax(runtimeSlot);
     
     // Create mutex for task queue protection
     asm_.xor_rcx_rcx();
     asm_.xor_rdx_rdx();
     asm_.xor_r8_r8();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CreateMutexA"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CreateMutexA"));
     asm_.mov_rcx_rax();
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(runtimeSlot);
     asm_.mov_mem_rax_rcx(0);  // runtime->mutex
     
     // Create event for task notification (auto-reset)
@@ -363,15 +318,12 @@ void NativeCodeGen::emitAsyncRuntimeInit(int64_t numWorkers) {
     asm_.xor_rdx_rdx();  // auto-reset event
     asm_.xor_r8_r8();
     asm_.xor_r9_r9();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CreateEventA"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CreateEventA"));
     asm_.mov_rcx_rax();
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(runtimeSlot);
     asm_.mov_mem_rax_rcx(8);  // runtime->event
     
     // Initialize other fields
-    asm_.mov_rax_mem_rsp(0);
     asm_.xor_rcx_rcx();
     asm_.mov_mem_rax_rcx(16);  // runtime->shutdown = 0
     asm_.mov_rcx_imm64(numWorkers);
@@ -380,8 +332,6 @@ void NativeCodeGen::emitAsyncRuntimeInit(int64_t numWorkers) {
     asm_.mov_mem_rax_rcx(32);  // runtime->task_queue_head = null
     asm_.mov_mem_rax_rcx(40);  // runtime->task_queue_tail = null
     asm_.mov_mem_rax_rcx(48);  // runtime->active_tasks = 0
-    
-    asm_.pop_rax();
 }
 
 void NativeCodeGen::emitAsyncRuntimeRun() {
@@ -393,36 +343,27 @@ void NativeCodeGen::emitAsyncRuntimeRun() {
 
 void NativeCodeGen::emitAsyncRuntimeShutdown() {
     // Set shutdown flag and signal all workers
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);
+    int32_t runtimeSlot = allocTemp("$async_runtime");
+    asm_.mov_mem_rbp_rax(runtimeSlot);
     
     // Lock mutex
-    asm_.mov_rax_mem_rsp(8);
     asm_.mov_rcx_mem_rax(0);  // mutex
     asm_.mov_rdx_imm64(0xFFFFFFFF);
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WaitForSingleObject"));
-    asm_.add_rsp_imm32(0x28);
+    emitBlockingCall(pe_.getImportRVA("WaitForSingleObject"));
     
     // Set shutdown flag
-    asm_.mov_rax_mem_rsp(8);
+    asm_.mov_rax_mem_rbp(runtimeSlot);
     asm_.mov_rcx_imm64(1);
     asm_.mov_mem_rax_rcx(16);  // runtime->shutdown = 1
     
     // Signal event to wake up any waiting workers
     asm_.mov_rcx_mem_rax(8);  // event
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("SetEvent"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("SetEvent"));
     
     // Release mutex
-    asm_.mov_rax_mem_rsp(8);
+    asm_.mov_rax_mem_rbp(runtimeSlot);
     asm_.mov_rcx_mem_rax(0);  // mutex
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("ReleaseMutex"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);
+    emitCallWithOptimizedStack(pe_.getImportRVA("ReleaseMutex"));
 }
 
 void NativeCodeGen::emitAsyncSpawn() {
@@ -430,43 +371,38 @@ void NativeCodeGen::emitAsyncSpawn() {
     // RAX = task function pointer
     // In a full implementation, this would queue the task for async execution
     
-    asm_.push_rax();  // save task
+    int32_t taskSlot = allocTemp("$spawn_task");
+    asm_.mov_mem_rbp_rax(taskSlot);
     
     // Create a future for the result
     emitFutureCreate(8);
-    asm_.push_rax();  // save future
+    int32_t futureSlot = allocTemp("$spawn_future");
+    asm_.mov_mem_rbp_rax(futureSlot);
     
     // Execute the task
-    asm_.mov_rax_mem_rsp(8);  // get task
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_rax();
-    asm_.add_rsp_imm32(0x28);
+    asm_.mov_rax_mem_rbp(taskSlot);
+    emitCallRaxWithOptimizedStack();
     
     // Store result in future
     asm_.mov_rcx_rax();  // RCX = result
-    asm_.mov_rax_mem_rsp(0);  // RAX = future
+    asm_.mov_rax_mem_rbp(futureSlot);
     emitFutureSet();
     
     // Return the future
-    asm_.mov_rax_mem_rsp(0);
-    asm_.add_rsp_imm32(16);
+    asm_.mov_rax_mem_rbp(futureSlot);
 }
 
 void NativeCodeGen::emitAsyncSleep(int64_t durationMs) {
     // Call Windows Sleep function
     asm_.mov_rcx_imm64(durationMs);
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("Sleep"));
-    asm_.add_rsp_imm32(0x28);
+    emitBlockingCall(pe_.getImportRVA("Sleep"));
     asm_.xor_rax_rax();
 }
 
 void NativeCodeGen::emitAsyncYield() {
     // Yield to other threads using SwitchToThread or Sleep(0)
     asm_.xor_rcx_rcx();  // Sleep(0) yields to other threads
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("Sleep"));
-    asm_.add_rsp_imm32(0x28);
+    emitBlockingCall(pe_.getImportRVA("Sleep"));
     asm_.xor_rax_rax();
 }
 
@@ -503,9 +439,7 @@ void NativeCodeGen::visit(AsyncSleepExpr& node) {
         // Dynamic duration - evaluate expression
         node.durationMs->accept(*this);
         asm_.mov_rcx_rax();
-        asm_.sub_rsp_imm32(0x28);
-        asm_.call_mem_rip(pe_.getImportRVA("Sleep"));
-        asm_.add_rsp_imm32(0x28);
+        emitBlockingCall(pe_.getImportRVA("Sleep"));
         asm_.xor_rax_rax();
         return;
     }
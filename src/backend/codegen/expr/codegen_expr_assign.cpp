@@ -220,6 +220,7 @@ void NativeCodeGen::visit(AssignExpr& node) {
         asm_.mov_rcx_rax();
         asm_.pop_rax();
         asm_.mov_mem_rcx_rax();
+        emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
         return;
     }
     
@@ -281,6 +282,7 @@ void NativeCodeGen::visit(AssignExpr& node) {
                             asm_.code.push_back(0x01);
                         } else {
                             asm_.mov_mem_rcx_rax();
+                            emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
                         }
                         return;
                     }
@@ -293,6 +295,7 @@ void NativeCodeGen::visit(AssignExpr& node) {
         asm_.mov_rcx_rax();
         asm_.pop_rax();
         asm_.mov_mem_rcx_rax();
+        emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
         return;
     }
     
@@ -519,6 +522,16 @@ void NativeCodeGen::visit(AssignExpr& node) {
 
 // Helper for index assignment (extracted for clarity)
 void NativeCodeGen::emitIndexAssignment(IndexExpr* indexExpr, AssignExpr& node) {
+    // Induction-variable store inside a strength-reduced loop
+    auto reducedIt = strengthReduced_.find(indexExpr);
+    if (reducedIt != strengthReduced_.end()) {
+        asm_.mov_rcx_mem_rbp(locals[reducedIt->second.pointerSlot]);
+        uint8_t size = static_cast<uint8_t>(reducedIt->second.elementSize);
+        asm_.emit(X64Op::MOV, X64Operand::mem(X64Reg::RCX, 0, size), X64Operand::r(X64Reg::RAX, size));
+        if (size == 8) emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
+        return;
+    }
+    
     asm_.push_rax();
     
     if (auto* strKey = dynamic_cast<StringLiteral*>(indexExpr->index.get())) {
@@ -530,7 +543,7 @@ void NativeCodeGen::emitIndexAssignment(IndexExpr* indexExpr, AssignExpr& node)
         uint32_t keyRva = addString(strKey->value);
         
         indexExpr->object->accept(*this);
-        allocLocal("$map_set_ptr");
+        allocTemp("$map_set_ptr");
         asm_.mov_mem_rbp_rax(locals["$map_set_ptr"]);
         
         asm_.mov_rcx_mem_rax();
@@ -545,7 +558,7 @@ void NativeCodeGen::emitIndexAssignment(IndexExpr* indexExpr, AssignExpr& node)
         asm_.code.push_back(0xE2); asm_.code.push_back(0x03);
         asm_.code.push_back(0x48); asm_.code.push_back(0x01); asm_.code.push_back(0xD0);
         
-        allocLocal("$bucket_addr");
+        allocTemp("$bucket_addr");
         asm_.mov_mem_rbp_rax(locals["$bucket_addr"]);
         
         asm_.mov_rax_mem_rax();
@@ -577,7 +590,7 @@ void NativeCodeGen::emitIndexAssignment(IndexExpr* indexExpr, AssignExpr& node)
         asm_.label(insertNew);
         emitGCAllocMapEntry();
         
-        allocLocal("$new_entry");
+        allocTemp("$new_entry");
         asm_.mov_mem_rbp_rax(locals["$new_entry"]);
         
         asm_.mov_rcx_imm64(static_cast<int64_t>(hash));
@@ -597,6 +610,7 @@ void NativeCodeGen::emitIndexAssignment(IndexExpr* indexExpr, AssignExpr& node)
         asm_.mov_rax_mem_rbp(locals["$bucket_addr"]);
         asm_.mov_rcx_mem_rbp(locals["$new_entry"]);
         asm_.mov_mem_rax_rcx();
+        emitWriteBarrier(X64Reg::RAX, X64Reg::RCX);
         
         asm_.mov_rax_mem_rbp(locals["$new_entry"]);
         std::string setValueLabel = newLabel("map_set_value");
@@ -608,6 +622,7 @@ void NativeCodeGen::emitIndexAssignment(IndexExpr* indexExpr, AssignExpr& node)
         asm_.add_rax_imm32(16);
         asm_.pop_rcx();
         asm_.mov_mem_rax_rcx();
+        emitWriteBarrier(X64Reg::RAX, X64Reg::RCX);
         asm_.mov_rax_rcx();
     } else {
         // Check for fixed-size array
@@ -618,71 +633,24 @@ void NativeCodeGen::emitIndexAssignment(IndexExpr* indexExpr, AssignExpr& node)
                 
                 // Value is already on stack from push_rax above
                 
-                // Evaluate the index (0-based for fixed arrays)
-                indexExpr->index->accept(*this);
-                asm_.push_rax();  // Save index
+                X64Operand addr = emitElementAddress(indexExpr->object.get(), indexExpr->index.get(), info.elementSize, 0);
+                asm_.pop_rdx();  // rdx = value (addr is formed from rax/rcx)
                 
-                // Load the array pointer
-                indexExpr->object->accept(*this);
-                
-                asm_.pop_rcx();  // rcx = index
-                
-                // Calculate element offset: index * elementSize
-                if (info.elementSize == 8) {
-                    asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-                    asm_.code.push_back(0xE1); asm_.code.push_back(0x03);
-                } else if (info.elementSize == 4) {
-                    asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-                    asm_.code.push_back(0xE1); asm_.code.push_back(0x02);
-                } else if (info.elementSize == 2) {
-                    asm_.code.push_back(0x48); asm_.code.push_back(0xD1);
-                    asm_.code.push_back(0xE1);
-                } else if (info.elementSize != 1) {
-                    asm_.mov_rdx_imm64(info.elementSize);
-                    asm_.code.push_back(0x48); asm_.code.push_back(0x0F);
-                    asm_.code.push_back(0xAF); asm_.code.push_back(0xCA);
-                }
-                
-                asm_.add_rax_rcx();
-                
-                asm_.pop_rcx();  // rcx = value
-                
-                if (info.elementSize == 1) {
-                    asm_.code.push_back(0x88);
-                    asm_.code.push_back(0x08);
-                } else if (info.elementSize == 2) {
-                    asm_.code.push_back(0x66);
-                    asm_.code.push_back(0x89);
-                    asm_.code.push_back(0x08);
-                } else if (info.elementSize == 4) {
-                    asm_.code.push_back(0x89);
-                    asm_.code.push_back(0x08);
-                } else {
-                    asm_.code.push_back(0x48);
-                    asm_.code.push_back(0x89);
-                    asm_.code.push_back(0x08);
-                }
-                asm_.mov_rax_rcx();
+                uint8_t size = static_cast<uint8_t>(info.elementSize == 1 || info.elementSize == 2 || info.elementSize == 4 ? info.elementSize : 8);
+                addr.size = size;
+                asm_.emit(X64Op::MOV, addr, X64Operand::r(X64Reg::RDX, size));
+                if (size == 8) emitWriteBarrier(addr, X64Reg::RDX);
+                asm_.mov_rax_rdx();
                 return;
             }
         }
         
-        // List index assignment (1-based indexing)
-        indexExpr->index->accept(*this);
-        asm_.dec_rax();
-        asm_.push_rax();
-        
-        indexExpr->object->accept(*this);
-        asm_.add_rax_imm32(16);
-        
-        asm_.pop_rcx();
-        asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-        asm_.code.push_back(0xE1); asm_.code.push_back(0x03);
-        asm_.add_rax_rcx();
-        
-        asm_.pop_rcx();
-        asm_.mov_mem_rax_rcx();
-        asm_.mov_rax_rcx();
+        // List index assignment (1-based indexing, 16-byte header)
+        X64Operand addr = emitElementAddress(indexExpr->object.get(), indexExpr->index.get(), 8, 16 - 8);
+        asm_.pop_rdx();
+        asm_.emit(X64Op::MOV, addr, X64Operand::r(X64Reg::RDX));
+        emitWriteBarrier(addr, X64Reg::RDX);
+        asm_.mov_rax_rdx();
     }
 }
 
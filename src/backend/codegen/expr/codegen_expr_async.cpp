@@ -13,28 +13,22 @@ void NativeCodeGen::visit(AwaitExpr& node) {
     std::string done = newLabel("await_done");
     asm_.jl_rel32(notHandle);
     
-    allocLocal("$await_handle");
+    allocTemp("$await_handle");
     asm_.mov_mem_rbp_rax(locals["$await_handle"]);
     
     asm_.mov_rcx_rax();
     asm_.mov_rdx_imm64(0xFFFFFFFF);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WaitForSingleObject"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitBlockingCall(pe_.getImportRVA("WaitForSingleObject"));
     
-    allocLocal("$await_result");
+    allocTemp("$await_result");
     asm_.mov_rcx_mem_rbp(locals["$await_handle"]);
     asm_.lea_rdx_rbp_offset(locals["$await_result"]);
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetExitCodeThread"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetExitCodeThread"));
     
     asm_.mov_rcx_mem_rbp(locals["$await_handle"]);
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CloseHandle"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CloseHandle"));
     
     asm_.mov_rax_mem_rbp(locals["$await_result"]);
     asm_.jmp_rel32(done);
@@ -58,6 +52,14 @@ void NativeCodeGen::visit(SpawnExpr& node) {
                 asm_.push_rdi();
                 asm_.sub_rsp_imm32(0x30);
                 
+                // The parameter is the thread's GC record; adopting it
+                // yields the argument
+                if (useGC_) {
+                    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RDX), X64Operand::r(X64Reg::RBP));
+                    asm_.call_rel32(gcThreadStartLabel_);
+                    asm_.mov_rcx_rax();
+                }
+                
                 if (call->args.size() == 1) {
                     asm_.mov_mem_rbp_rcx(-0x10);
                 }
@@ -71,6 +73,7 @@ void NativeCodeGen::visit(SpawnExpr& node) {
                 }
                 
                 asm_.call_rel32(ident->name);
+                if (useGC_) asm_.call_rel32(gcThreadExitLabel_);
                 
                 asm_.add_rsp_imm32(0x30);
                 asm_.pop_rdi();
@@ -81,10 +84,14 @@ void NativeCodeGen::visit(SpawnExpr& node) {
                 
                 if (call->args.size() == 1) {
                     call->args[0]->accept(*this);
-                    asm_.code.push_back(0x49); asm_.code.push_back(0x89); asm_.code.push_back(0xC1);
                 } else {
-                    asm_.code.push_back(0x4D); asm_.code.push_back(0x31); asm_.code.push_back(0xC9);
+                    asm_.xor_rax_rax();
+                }
+                if (useGC_) {
+                    asm_.mov_rcx_rax();
+                    emitCallRelWithOptimizedStack(gcThreadNewLabel_);
                 }
+                asm_.code.push_back(0x49); asm_.code.push_back(0x89); asm_.code.push_back(0xC1);  // mov r9, rax
                 
                 asm_.code.push_back(0x4C); asm_.code.push_back(0x8D); asm_.code.push_back(0x05);
                 asm_.fixupLabel(thunkLabel);
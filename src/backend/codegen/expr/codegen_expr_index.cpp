@@ -6,6 +6,16 @@
 namespace tyl {
 
 void NativeCodeGen::visit(IndexExpr& node) {
+    // Induction-variable access inside a strength-reduced loop
+    auto reducedIt = strengthReduced_.find(&node);
+    if (reducedIt != strengthReduced_.end()) {
+        asm_.mov_rax_mem_rbp(locals[reducedIt->second.pointerSlot]);
+        emitElementLoad(X64Operand::mem(X64Reg::RAX), reducedIt->second.elementSize);
+        lastExprWasFloat_ = reducedIt->second.isFloat;
+        if (lastExprWasFloat_ && reducedIt->second.elementSize == 8) asm_.movq_xmm0_rax();
+        return;
+    }
+    
     // Handle map access with string key
     if (auto* strKey = dynamic_cast<StringLiteral*>(node.index.get())) {
         emitMapIndexAccess(node, strKey);
@@ -36,21 +46,8 @@ void NativeCodeGen::visit(IndexExpr& node) {
                     return;
                 }
             }
-            // Runtime index into constant list (now has 16-byte header)
-            node.index->accept(*this);
-            asm_.dec_rax();
-            asm_.push_rax();
-            
-            node.object->accept(*this);
-            asm_.add_rax_imm32(16);  // Skip header
-            asm_.pop_rcx();
-            
-            asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-            asm_.code.push_back(0xE1); asm_.code.push_back(0x03);
-            
-            asm_.add_rax_rcx();
-            asm_.mov_rax_mem_rax();
-            
+            // Runtime index into constant list (16-byte header, 1-based index)
+            emitElementLoad(emitElementAddress(node.object.get(), node.index.get(), 8, 16 - 8), 8);
             lastExprWasFloat_ = false;
             return;
         }
@@ -74,22 +71,100 @@ void NativeCodeGen::visit(IndexExpr& node) {
         }
     }
     
-    // Runtime list indexing (GC-allocated lists have a 16-byte header)
-    node.index->accept(*this);
-    asm_.dec_rax();
-    asm_.push_rax();
+    // Runtime list indexing (GC-allocated lists have a 16-byte header, 1-based index)
+    emitElementLoad(emitElementAddress(node.object.get(), node.index.get(), 8, 16 - 8), 8);
+    lastExprWasFloat_ = false;
+}
+
+bool NativeCodeGen::getSimpleVarOperand(Expression* expr, X64Operand& out, bool allowFloat) {
+    auto* ident = dynamic_cast<Identifier*>(expr);
+    if (!ident) return false;
+    const std::string& name = ident->name;
+    
+    // Mirror the lookup order of visit(Identifier); anything it would not
+    // load with a single move is left to the general path
+    if (constVars.count(name) || constFloatVars.count(name)) return false;
+    if (floatVars.count(name) && !allowFloat) return false;
+    if (asm_.labels.count(name) || allFunctionNames_.count(name)) return false;
+    
+    auto toReg = [](VarRegister reg) {
+        switch (reg) {
+            case VarRegister::RBX: return X64Reg::RBX;
+            case VarRegister::R12: return X64Reg::R12;
+            case VarRegister::R13: return X64Reg::R13;
+            case VarRegister::R14: return X64Reg::R14;
+            case VarRegister::R15: return X64Reg::R15;
+            default: return X64Reg::NONE;
+        }
+    };
     
-    node.object->accept(*this);
-    asm_.add_rax_imm32(16);
+    auto regIt = varRegisters_.find(name);
+    if (regIt != varRegisters_.end() && regIt->second != VarRegister::NONE) {
+        out = X64Operand::r(toReg(regIt->second));
+        return true;
+    }
+    auto globalRegIt = globalVarRegisters_.find(name);
+    if (globalRegIt != globalVarRegisters_.end() && globalRegIt->second != VarRegister::NONE) {
+        out = X64Operand::r(toReg(globalRegIt->second));
+        return true;
+    }
+    auto it = locals.find(name);
+    if (it != locals.end()) {
+        out = X64Operand::mem(X64Reg::RBP, it->second);
+        return true;
+    }
+    return false;
+}
+
+// Address of object + index * elementSize + bias as a single memory operand.
+// The index is evaluated before the object, as in the unfolded sequence;
+// the returned operand is built from rax and rcx.
+X64Operand NativeCodeGen::emitElementAddress(Expression* object, Expression* index, int32_t elementSize, int32_t bias) {
+    int64_t constIndex;
+    if (tryEvalConstant(index, constIndex)) {
+        int64_t disp = constIndex * elementSize + bias;
+        if (disp >= INT32_MIN && disp <= INT32_MAX) {
+            object->accept(*this);
+            return X64Operand::mem(X64Reg::RAX, static_cast<int32_t>(disp), static_cast<uint8_t>(elementSize));
+        }
+    }
+    index->accept(*this);
+    return emitElementAddressFromRax(object, elementSize, bias);
+}
+
+X64Operand NativeCodeGen::emitElementAddressFromRax(Expression* object, int32_t elementSize, int32_t bias) {
+    uint8_t scale = 1;
+    if (elementSize == 1 || elementSize == 2 || elementSize == 4 || elementSize == 8) {
+        scale = static_cast<uint8_t>(elementSize);
+    } else {
+        asm_.emit(X64Op::IMUL, X64Operand::r(X64Reg::RAX), X64Operand::r(X64Reg::RAX),
+                  X64Operand::immediate(elementSize));
+    }
+    uint8_t size = static_cast<uint8_t>(elementSize <= 8 ? elementSize : 8);
     
+    X64Operand base;
+    if (getSimpleVarOperand(object, base)) {
+        asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RCX), base);
+        return X64Operand::mem(X64Reg::RCX, X64Reg::RAX, scale, bias, size);
+    }
+    asm_.push_rax();
+    object->accept(*this);
     asm_.pop_rcx();
-    asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-    asm_.code.push_back(0xE1); asm_.code.push_back(0x03);
-    
-    asm_.add_rax_rcx();
-    asm_.mov_rax_mem_rax();
-    
-    lastExprWasFloat_ = false;
+    return X64Operand::mem(X64Reg::RAX, X64Reg::RCX, scale, bias, size);
+}
+
+void NativeCodeGen::emitElementLoad(const X64Operand& addr, int32_t elementSize) {
+    X64Operand src = addr;
+    if (elementSize == 1 || elementSize == 2) {
+        src.size = static_cast<uint8_t>(elementSize);
+        asm_.emit(X64Op::MOVZX, X64Operand::r(X64Reg::RAX, 4), src);
+    } else if (elementSize == 4) {
+        src.size = 4;
+        asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX, 4), src);
+    } else {
+        src.size = 8;
+        asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RAX), src);
+    }
 }
 
 void NativeCodeGen::emitStringSlice(IndexExpr& node, Expression* startExpr, Expression* endExpr, bool inclusive) {
@@ -124,7 +199,7 @@ void NativeCodeGen::emitStringSlice(IndexExpr& node, Expression* startExpr, Expr
     // Use GC allocation for the str_view struct
     emitGCAllocRaw(16);
     
-    allocLocal("$str_view_ptr");
+    allocTemp("$str_view_ptr");
     asm_.mov_mem_rbp_rax(locals["$str_view_ptr"]);
     
     // Pop string pointer into rcx
@@ -175,7 +250,7 @@ void NativeCodeGen::emitMapIndexAccess(IndexExpr& node, StringLiteral* strKey) {
     
     node.object->accept(*this);
     
-    allocLocal("$map_get_ptr");
+    allocTemp("$map_get_ptr");
     asm_.mov_mem_rbp_rax(locals["$map_get_ptr"]);
     
     asm_.mov_rcx_mem_rax();
@@ -260,13 +335,6 @@ void NativeCodeGen::emitMapIndexAccess(IndexExpr& node, StringLiteral* strKey) {
 }
 
 void NativeCodeGen::emitFixedArrayIndexAccess(IndexExpr& node, const FixedArrayInfo& info) {
-    node.index->accept(*this);
-    asm_.dec_rax();  // Convert 1-based index to 0-based
-    asm_.push_rax();
-    
-    node.object->accept(*this);
-    asm_.pop_rcx();
-    
     // Check if element type is itself an array (multi-dimensional)
     bool isNestedArray = !info.elementType.empty() && info.elementType[0] == '[';
     
@@ -274,53 +342,19 @@ void NativeCodeGen::emitFixedArrayIndexAccess(IndexExpr& node, const FixedArrayI
     // For scalar elements, use the actual element size
     int32_t actualElementSize = isNestedArray ? 8 : info.elementSize;
     
-    // Multiply index by element size
-    if (actualElementSize == 8) {
-        asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-        asm_.code.push_back(0xE1); asm_.code.push_back(0x03);  // shl rcx, 3
-    } else if (actualElementSize == 4) {
-        asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-        asm_.code.push_back(0xE1); asm_.code.push_back(0x02);  // shl rcx, 2
-    } else if (actualElementSize == 2) {
-        asm_.code.push_back(0x48); asm_.code.push_back(0xD1);
-        asm_.code.push_back(0xE1);  // shl rcx, 1
-    } else if (actualElementSize != 1) {
-        asm_.mov_rdx_imm64(actualElementSize);
-        asm_.code.push_back(0x48); asm_.code.push_back(0x0F);
-        asm_.code.push_back(0xAF); asm_.code.push_back(0xCA);  // imul rcx, rdx
-    }
+    // base + (index - 1) * elementSize, folded into one addressing mode
+    X64Operand addr = emitElementAddress(node.object.get(), node.index.get(), actualElementSize, -actualElementSize);
     
-    asm_.add_rax_rcx();  // rax = base + index * elementSize
-    
-    // Check if element type is itself an array (multi-dimensional)
-    // If so, load the pointer to the sub-array
     if (isNestedArray) {
-        // For nested arrays, load the pointer stored at this location
-        // The outer array stores pointers to inner arrays
-        asm_.mov_rax_mem_rax();  // Load the pointer to the inner array
-        // The inner array has a 16-byte header (length + capacity), skip it
+        // The outer array stores pointers to inner arrays; skip the inner
+        // array's 16-byte header (length + capacity)
+        emitElementLoad(addr, 8);
         asm_.add_rax_imm32(16);
         lastExprWasFloat_ = false;
     } else {
-        // For scalar elements, load the value
-        if (info.elementSize == 1) {
-            asm_.code.push_back(0x48);
-            asm_.code.push_back(0x0F);
-            asm_.code.push_back(0xB6);
-            asm_.code.push_back(0x00);  // movzx rax, byte [rax]
-        } else if (info.elementSize == 2) {
-            asm_.code.push_back(0x48);
-            asm_.code.push_back(0x0F);
-            asm_.code.push_back(0xB7);
-            asm_.code.push_back(0x00);  // movzx rax, word [rax]
-        } else if (info.elementSize == 4) {
-            asm_.code.push_back(0x8B);
-            asm_.code.push_back(0x00);  // mov eax, [rax]
-        } else {
-            asm_.mov_rax_mem_rax();  // mov rax, [rax]
-        }
-        
+        emitElementLoad(addr, info.elementSize);
         lastExprWasFloat_ = isFloatTypeName(info.elementType);
+        if (lastExprWasFloat_ && info.elementSize == 8) asm_.movq_xmm0_rax();
     }
 }
 
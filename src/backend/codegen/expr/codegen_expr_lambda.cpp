@@ -37,6 +37,7 @@ void NativeCodeGen::visit(LambdaExpr& node) {
     // Save context
     std::map<std::string, int32_t> savedLocals = locals;
     int32_t savedStackOffset = stackOffset;
+    FrameSlots savedFrameSlots = std::move(frameSlots_);
     bool savedInFunction = inFunction;
     int32_t savedFunctionStackSize = functionStackSize_;
     bool savedStackAllocated = stackAllocated_;
@@ -45,13 +46,15 @@ void NativeCodeGen::visit(LambdaExpr& node) {
     inFunction = true;
     locals.clear();
     stackOffset = 0;
+    frameSlots_ = FrameSlots();
     varRegisters_.clear();
     
+    int32_t enclosingFrameMap = beginGCFrameMap();
     asm_.push_rbp();
     asm_.mov_rbp_rsp();
     
     functionStackSize_ = 0x40 + (hasCaptures ? (int32_t)(capturedVars.size() * 8 + 8) : 0);
-    asm_.sub_rsp_imm32(functionStackSize_);
+    emitFrameAllocate();
     stackAllocated_ = true;
     
     if (hasCaptures) {
@@ -107,13 +110,18 @@ void NativeCodeGen::visit(LambdaExpr& node) {
     
     node.body->accept(*this);
     
-    asm_.add_rsp_imm32(functionStackSize_);
+    emitFrameRelease();
     asm_.pop_rbp();
     asm_.ret();
     
+    // Calls in the body run on this frame, so size it for the widest call
+    finalizeFrameSize(0x38);
+    endGCFrameMap(enclosingFrameMap);
+    
     // Restore context
     locals = savedLocals;
     stackOffset = savedStackOffset;
+    frameSlots_ = std::move(savedFrameSlots);
     inFunction = savedInFunction;
     functionStackSize_ = savedFunctionStackSize;
     stackAllocated_ = savedStackAllocated;
@@ -121,7 +129,7 @@ void NativeCodeGen::visit(LambdaExpr& node) {
     
     asm_.label(afterLambda);
     
-    emitGCAllocClosure(capturedVars.size());
+    emitGCAllocClosure(capturedVars.size(), node.noEscape);
     asm_.push_rax();
     
     // Store function pointer
@@ -22,7 +22,7 @@ void NativeCodeGen::visit(RangeExpr& node) {
         
         emitGCAllocList(static_cast<size_t>(size));
         
-        allocLocal("$range_ptr");
+        allocTemp("$range_ptr");
         asm_.mov_mem_rbp_rax(locals["$range_ptr"]);
         
         // Set count
@@ -97,7 +97,7 @@ void NativeCodeGen::visit(ListExpr& node) {
         size_t capacity = node.elements.size();
         if (capacity < 4) capacity = 4;
         
-        emitGCAllocList(capacity);
+        emitGCAllocList(capacity, node.noEscape);
         
         std::string listPtrName = "$list_ptr_" + std::to_string(labelCounter++);
         allocLocal(listPtrName);
@@ -117,6 +117,8 @@ void NativeCodeGen::visit(ListExpr& node) {
             int32_t offset = 16 + static_cast<int32_t>(i * 8);
             asm_.add_rcx_imm32(offset);
             asm_.mov_mem_rcx_rax();
+            // Literals too big for the nursery are allocated old
+            emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
         }
         
         asm_.mov_rax_mem_rbp(locals[listPtrName]);
@@ -164,10 +166,10 @@ void NativeCodeGen::visit(ListCompExpr& node) {
     
     emitGCAllocList(static_cast<size_t>(listSize));
     
-    allocLocal("$listcomp_ptr");
+    allocTemp("$listcomp_ptr");
     asm_.mov_mem_rbp_rax(locals["$listcomp_ptr"]);
     
-    allocLocal("$listcomp_idx");
+    allocTemp("$listcomp_idx");
     asm_.xor_rax_rax();
     asm_.mov_mem_rbp_rax(locals["$listcomp_idx"]);
     
@@ -184,7 +186,7 @@ void NativeCodeGen::visit(ListCompExpr& node) {
     }
     asm_.mov_mem_rbp_rax(locals[node.var]);
     
-    allocLocal("$listcomp_end");
+    allocTemp("$listcomp_end");
     if (auto* range = dynamic_cast<RangeExpr*>(node.iterable.get())) {
         range->end->accept(*this);
     } else if (auto* call = dynamic_cast<CallExpr*>(node.iterable.get())) {
@@ -314,7 +316,7 @@ void NativeCodeGen::visit(InclusiveRangeExpr& node) {
         emitGCAllocList(static_cast<size_t>(size));
         
         // Store list pointer
-        allocLocal("$incrange_ptr");
+        allocTemp("$incrange_ptr");
         asm_.mov_mem_rbp_rax(locals["$incrange_ptr"]);
         
         // Set length
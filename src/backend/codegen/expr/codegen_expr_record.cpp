@@ -34,9 +34,9 @@ void NativeCodeGen::visit(RecordExpr& node) {
             }
             
             size_t recordSize = static_cast<size_t>(typeIt->second.totalSize);
-            emitGCAllocRaw(recordSize);
+            emitGCAllocRaw(recordSize, node.noEscape);
             
-            allocLocal("$record_ptr");
+            allocTemp("$record_ptr");
             asm_.mov_mem_rbp_rax(locals["$record_ptr"]);
             
             // Store type ID at offset 0 for RTTI (for raw allocated records)
@@ -87,9 +87,9 @@ void NativeCodeGen::visit(RecordExpr& node) {
     }
     
     // Anonymous record - use GC allocation with type ID
-    emitGCAllocRecord(fieldCount, typeId);
+    emitGCAllocRecord(fieldCount, typeId, node.noEscape);
     
-    allocLocal("$record_ptr");
+    allocTemp("$record_ptr");
     asm_.mov_mem_rbp_rax(locals["$record_ptr"]);
     
     for (size_t i = 0; i < node.fields.size(); i++) {
@@ -119,7 +119,7 @@ void NativeCodeGen::visit(MapExpr& node) {
     
     emitGCAllocMap(capacity);
     
-    allocLocal("$map_ptr");
+    allocTemp("$map_ptr");
     asm_.mov_mem_rbp_rax(locals["$map_ptr"]);
     
     asm_.mov_rcx_imm64(static_cast<int64_t>(node.entries.size()));
@@ -140,7 +140,7 @@ void NativeCodeGen::visit(MapExpr& node) {
         
         emitGCAllocMapEntry();
         
-        allocLocal("$entry_ptr");
+        allocTemp("$entry_ptr");
         asm_.mov_mem_rbp_rax(locals["$entry_ptr"]);
         
         asm_.mov_rcx_imm64(static_cast<int64_t>(hash));
@@ -20,64 +20,47 @@ void NativeCodeGen::emitMutexCreate(int32_t elementSize) {
     emitGCAllocRaw(totalSize);
     // RAX now contains pointer to mutex structure
     
-    asm_.push_rax();  // Save mutex pointer
+    int32_t ptrSlot = allocTemp("$mutex_ptr");
+    asm_.mov_mem_rbp_rax(ptrSlot);  // Save mutex pointer
     
     // Create Windows mutex
     asm_.xor_rcx_rcx();  // lpMutexAttributes = NULL
     asm_.xor_rdx_rdx();  // bInitialOwner = FALSE
     asm_.xor_r8_r8();    // lpName = NULL
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CreateMutexA"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CreateMutexA"));
     
     // Store mutex handle at offset 0
     asm_.mov_rcx_rax();  // mutex handle
-    asm_.mov_rax_mem_rsp(0);  // mutex pointer
+    asm_.mov_rax_mem_rbp(ptrSlot);  // mutex pointer
     asm_.mov_mem_rax_rcx(0);  // store handle at offset 0
     
     // Set data pointer (offset 8) - points to offset 24
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(ptrSlot);
     asm_.lea_rcx_rax_offset(24);
     asm_.mov_mem_rax_rcx(8);
     
     // Set element size (offset 16)
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(ptrSlot);
     asm_.mov_rcx_imm64(elementSize);
     asm_.mov_mem_rax_rcx(16);
     
     // Return mutex pointer
-    asm_.pop_rax();
+    asm_.mov_rax_mem_rbp(ptrSlot);
 }
 
 void NativeCodeGen::emitMutexLock() {
     // Mutex pointer in RAX
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Wait for mutex
-    asm_.mov_rax_mem_rsp(8);  // mutex pointer
     asm_.mov_rcx_mem_rax(0);  // mutex handle
     asm_.mov_rdx_imm64(0xFFFFFFFF);  // INFINITE
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WaitForSingleObject"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitBlockingCall(pe_.getImportRVA("WaitForSingleObject"));
 }
 
 void NativeCodeGen::emitMutexUnlock() {
     // Mutex pointer in RAX
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Release mutex
-    asm_.mov_rax_mem_rsp(8);  // mutex pointer
     asm_.mov_rcx_mem_rax(0);  // mutex handle
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("ReleaseMutex"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitCallWithOptimizedStack(pe_.getImportRVA("ReleaseMutex"));
 }
 
 // RWLock structure layout (allocated on heap):
@@ -90,79 +73,55 @@ void NativeCodeGen::emitRWLockCreate(int32_t elementSize) {
     // Allocate rwlock structure (24 bytes) + data
     size_t totalSize = 24 + elementSize;
     
-    // Allocate memory for rwlock
+    // Allocate memory for rwlock (old, so a minor GC never moves the SRW lock
+    // under a waiting thread)
     asm_.mov_rcx_imm64(totalSize);
-    emitGCAllocRaw(totalSize);
+    emitGCAlloc(totalSize, GCObjectType::RAW, true);
     // RAX now contains pointer to rwlock structure
     
-    asm_.push_rax();  // Save rwlock pointer
+    int32_t ptrSlot = allocTemp("$rwlock_ptr");
+    asm_.mov_mem_rbp_rax(ptrSlot);  // Save rwlock pointer
     
     // Initialize SRW lock (SRWLOCK is initialized to 0, which is SRWLOCK_INIT)
     // The memory is already zeroed by GC allocation, but we call InitializeSRWLock for safety
     asm_.mov_rcx_rax();  // pointer to SRWLOCK
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("InitializeSRWLock"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("InitializeSRWLock"));
     
     // Set data pointer (offset 8) - points to offset 24
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(ptrSlot);
     asm_.lea_rcx_rax_offset(24);
     asm_.mov_mem_rax_rcx(8);
     
     // Set element size (offset 16)
-    asm_.mov_rax_mem_rsp(0);
+    asm_.mov_rax_mem_rbp(ptrSlot);
     asm_.mov_rcx_imm64(elementSize);
     asm_.mov_mem_rax_rcx(16);
     
     // Return rwlock pointer
-    asm_.pop_rax();
+    asm_.mov_rax_mem_rbp(ptrSlot);
 }
 
 void NativeCodeGen::emitRWLockReadLock() {
     // RWLock pointer in RAX
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Acquire shared lock
-    asm_.mov_rax_mem_rsp(8);  // rwlock pointer (SRWLOCK is at offset 0)
     asm_.mov_rcx_rax();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("AcquireSRWLockShared"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitBlockingCall(pe_.getImportRVA("AcquireSRWLockShared"));
 }
 
 void NativeCodeGen::emitRWLockWriteLock() {
     // RWLock pointer in RAX
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Acquire exclusive lock
-    asm_.mov_rax_mem_rsp(8);  // rwlock pointer (SRWLOCK is at offset 0)
     asm_.mov_rcx_rax();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("AcquireSRWLockExclusive"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitBlockingCall(pe_.getImportRVA("AcquireSRWLockExclusive"));
 }
 
 void NativeCodeGen::emitRWLockUnlock() {
     // RWLock pointer in RAX
     // Note: We need to track whether we have a read or write lock
     // For simplicity, we'll release exclusive lock (caller must track lock type)
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Release exclusive lock
-    asm_.mov_rax_mem_rsp(8);  // rwlock pointer
     asm_.mov_rcx_rax();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("ReleaseSRWLockExclusive"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitCallWithOptimizedStack(pe_.getImportRVA("ReleaseSRWLockExclusive"));
 }
 
 // Condition variable structure layout (allocated on heap):
@@ -170,72 +129,46 @@ void NativeCodeGen::emitRWLockUnlock() {
 // Total: 8 bytes
 
 void NativeCodeGen::emitCondCreate() {
-    // Allocate condition variable structure (8 bytes)
+    // Allocate condition variable structure (8 bytes, old like the rwlock's)
     asm_.mov_rcx_imm64(8);
-    emitGCAllocRaw(8);
+    emitGCAlloc(8, GCObjectType::RAW, true);
     // RAX now contains pointer to condition variable
     
-    asm_.push_rax();  // Save cond pointer
+    int32_t ptrSlot = allocTemp("$cond_ptr");
+    asm_.mov_mem_rbp_rax(ptrSlot);  // Save cond pointer
     
     // Initialize condition variable
     asm_.mov_rcx_rax();  // pointer to CONDITION_VARIABLE
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("InitializeConditionVariable"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("InitializeConditionVariable"));
     
     // Return cond pointer
-    asm_.pop_rax();
+    asm_.mov_rax_mem_rbp(ptrSlot);
 }
 
 void NativeCodeGen::emitCondWait() {
     // Cond pointer in RAX, Mutex pointer in RCX
-    asm_.push_rax();  // cond
-    asm_.push_rcx();  // mutex
-    
     // SleepConditionVariableSRW(ConditionVariable, SRWLock, dwMilliseconds, Flags)
     // We use the mutex's underlying handle - but Windows CV works with SRWLock
     // For compatibility, we'll use SleepConditionVariableSRW with the mutex treated as SRWLock
-    asm_.mov_rax_mem_rsp(8);  // cond pointer
-    asm_.mov_rcx_rax();
-    asm_.mov_rax_mem_rsp(0);  // mutex pointer (use as SRWLock)
-    asm_.mov_rdx_rax();
+    asm_.mov_rdx_rcx();  // mutex pointer (use as SRWLock)
+    asm_.mov_rcx_rax();  // cond pointer
     asm_.mov_r8_imm64(0xFFFFFFFF);  // INFINITE
     asm_.xor_r9_r9();  // Flags = 0 (exclusive mode)
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("SleepConditionVariableSRW"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitBlockingCall(pe_.getImportRVA("SleepConditionVariableSRW"));
 }
 
 void NativeCodeGen::emitCondSignal() {
     // Cond pointer in RAX
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Wake one waiter
-    asm_.mov_rax_mem_rsp(8);  // cond pointer
     asm_.mov_rcx_rax();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WakeConditionVariable"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitCallWithOptimizedStack(pe_.getImportRVA("WakeConditionVariable"));
 }
 
 void NativeCodeGen::emitCondBroadcast() {
     // Cond pointer in RAX
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Wake all waiters
-    asm_.mov_rax_mem_rsp(8);  // cond pointer
     asm_.mov_rcx_rax();
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WakeAllConditionVariable"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitCallWithOptimizedStack(pe_.getImportRVA("WakeAllConditionVariable"));
 }
 
 // Semaphore structure layout (allocated on heap):
@@ -248,72 +181,49 @@ void NativeCodeGen::emitSemaphoreCreate(int64_t initialCount, int64_t maxCount)
     emitGCAllocRaw(8);
     // RAX now contains pointer to semaphore structure
     
-    asm_.push_rax();  // Save semaphore pointer
+    int32_t ptrSlot = allocTemp("$sem_ptr");
+    asm_.mov_mem_rbp_rax(ptrSlot);  // Save semaphore pointer
     
     // Create Windows semaphore
     asm_.xor_rcx_rcx();  // lpSemaphoreAttributes = NULL
     asm_.mov_rdx_imm64(initialCount);  // lInitialCount
     asm_.mov_r8_imm64(maxCount);  // lMaximumCount
     asm_.xor_r9_r9();  // lpName = NULL
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("CreateSemaphoreA"));
-    asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("CreateSemaphoreA"));
     
     // Store semaphore handle at offset 0
     asm_.mov_rcx_rax();  // semaphore handle
-    asm_.mov_rax_mem_rsp(0);  // semaphore pointer
+    asm_.mov_rax_mem_rbp(ptrSlot);  // semaphore pointer
     asm_.mov_mem_rax_rcx(0);  // store handle at offset 0
     
     // Return semaphore pointer
-    asm_.pop_rax();
+    asm_.mov_rax_mem_rbp(ptrSlot);
 }
 
 void NativeCodeGen::emitSemaphoreAcquire() {
     // Semaphore pointer in RAX
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Wait for semaphore
-    asm_.mov_rax_mem_rsp(8);  // semaphore pointer
     asm_.mov_rcx_mem_rax(0);  // semaphore handle
     asm_.mov_rdx_imm64(0xFFFFFFFF);  // INFINITE
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WaitForSingleObject"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitBlockingCall(pe_.getImportRVA("WaitForSingleObject"));
 }
 
 void NativeCodeGen::emitSemaphoreRelease() {
     // Semaphore pointer in RAX
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Release semaphore
-    asm_.mov_rax_mem_rsp(8);  // semaphore pointer
     asm_.mov_rcx_mem_rax(0);  // semaphore handle
     asm_.mov_rdx_imm64(1);  // lReleaseCount = 1
     asm_.xor_r8_r8();  // lpPreviousCount = NULL
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("ReleaseSemaphore"));
-    asm_.add_rsp_imm32(0x28);
-    
-    asm_.add_rsp_imm32(16);  // Clean up
+    emitCallWithOptimizedStack(pe_.getImportRVA("ReleaseSemaphore"));
 }
 
 void NativeCodeGen::emitSemaphoreTryAcquire() {
     // Semaphore pointer in RAX
     // Returns 1 if acquired, 0 if not
-    asm_.push_rax();
-    asm_.sub_rsp_imm32(8);  // Align stack
-    
     // Try to acquire semaphore with 0 timeout
-    asm_.mov_rax_mem_rsp(8);  // semaphore pointer
     asm_.mov_rcx_mem_rax(0);  // semaphore handle
     asm_.xor_rdx_rdx();  // dwMilliseconds = 0 (no wait)
-    asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("WaitForSingleObject"));
-    asm_.add_rsp_imm32(0x28);
+    emitBlockingCall(pe_.getImportRVA("WaitForSingleObject"));
     
     // Check result: WAIT_OBJECT_0 (0) = success, WAIT_TIMEOUT (258) = failed
     asm_.test_rax_rax();  // Check if RAX == 0
@@ -330,7 +240,6 @@ void NativeCodeGen::emitSemaphoreTryAcquire() {
     asm_.mov_rax_imm64(1);
     
     asm_.label(doneLabel);
-    asm_.add_rsp_imm32(16);  // Clean up
 }
 
 // AST visitor implementations
@@ -420,7 +329,8 @@ void NativeCodeGen::visit(SemTryAcquireExpr& node) {
 void NativeCodeGen::visit(LockStmt& node) {
     // Evaluate mutex
     node.mutex->accept(*this);
-    asm_.push_rax();  // Save mutex pointer
+    int32_t mutexSlot = allocTemp("$lock_mutex");
+    asm_.mov_mem_rbp_rax(mutexSlot);  // Save mutex pointer
     
     // Lock the mutex
     emitMutexLock();
@@ -429,7 +339,7 @@ void NativeCodeGen::visit(LockStmt& node) {
     node.body->accept(*this);
     
     // Unlock the mutex
-    asm_.pop_rax();  // Restore mutex pointer
+    asm_.mov_rax_mem_rbp(mutexSlot);  // Restore mutex pointer
     emitMutexUnlock();
 }
 
@@ -8,11 +8,14 @@
 #include "backend/object/object_file.h"
 #include "backend/codegen/register_allocator.h"
 #include "backend/codegen/global_register_allocator.h"
+#include "backend/codegen/vectorizer.h"
 #include "backend/gc/gc.h"
 #include "semantic/generics/monomorphizer.h"
 #include "semantic/ctfe/ctfe_interpreter.h"
+#include "semantic/optimizer/analysis/pgo.h"
 #include <map>
 #include <set>
+#include <functional>
 
 namespace tyl {
 
@@ -27,6 +30,23 @@ enum class CodeGenOptLevel {
     Ofast  // Maximum optimization - full inlining, unsafe opts
 };
 
+// Target instruction set (-march), following the x86-64 psABI levels
+enum class TargetISA {
+    X86_64,     // Baseline - SSE2 only
+    X86_64_V2,  // + SSE4.2, POPCNT
+    X86_64_V3   // + AVX2, FMA (256-bit vector loops)
+};
+
+// GC heap sizing (--gc-heap-min, --gc-heap-max, --gc-heap-growth). Each major
+// collection sets the next threshold to growthPercent of the bytes that
+// survived it, kept within [minBytes, maxBytes]. The TYL_GC_HEAP_MIN, _MAX
+// and _GROWTH environment variables override these at startup.
+struct GCHeapSizing {
+    uint64_t minBytes = 1024 * 1024;  // Also the first threshold
+    uint64_t maxBytes = 0;            // 0 = no ceiling
+    uint64_t growthPercent = 200;
+};
+
 class NativeCodeGen : public ASTVisitor {
 public:
     NativeCodeGen();
@@ -37,6 +57,16 @@ public:
     void setOptLevel(CodeGenOptLevel level) { optLevel_ = level; }
     CodeGenOptLevel optLevel() const { return optLevel_; }
     
+    // Set target instruction set
+    void setTargetISA(TargetISA isa) { targetISA_ = isa; }
+    TargetISA targetISA() const { return targetISA_; }
+    
+    // Instrument the program and write a profile to `profileFile` at exit
+    void setProfileGenerate(const std::string& profileFile) { profileFile_ = profileFile; }
+    
+    // Set the compiled-in GC heap sizing
+    void setGCHeapSizing(const GCHeapSizing& sizing) { gcHeapSizing_ = sizing; }
+    
     // Add functions that may return strings (from type checker analysis)
     void addStringReturningFunctions(const std::set<std::string>& funcs) {
         stringReturningFunctions_.insert(funcs.begin(), funcs.end());
@@ -91,6 +121,17 @@ private:
     int32_t functionStackSize_ = 0;            // Total stack size for current function
     bool stackAllocated_ = false;              // Whether stack is already allocated
     
+    // Stack slot packing - scratch temps are released at the end of the
+    // statement that allocated them and their slots reused, and the frame
+    // size is patched from the deepest offset actually handed out
+    struct FrameSlots {
+        std::vector<int32_t> liveTemps;        // Temp slots held by statements being emitted
+        std::vector<int32_t> freeTemps;        // Released temp slots available for reuse
+        std::vector<size_t> sizeFixups;        // Code offsets of the frame size imm32 in sub/add rsp
+        int32_t frameBase = 0;                 // stackOffset below the callee-saved pushes
+    };
+    FrameSlots frameSlots_;
+    
     // Register allocation
     RegisterAllocator regAlloc_;               // Register allocator instance
     bool useRegisterAllocation_ = true;        // Enable register allocation
@@ -104,6 +145,19 @@ private:
     // Leaf function optimization
     bool isLeafFunction_ = false;              // Current function is a leaf (no calls)
     bool useLeafOptimization_ = true;          // Enable leaf function optimization
+    const Statement* hoistedGuard_ = nullptr;  // Entry guard emitted ahead of the prologue
+    
+    // Emission checkpoint - lets a speculative emission be undone
+    struct EmitCheckpoint {
+        size_t codeSize = 0;
+        size_t labelFixups = 0;
+        size_t ripFixups = 0;
+        size_t coldBlocks = 0;
+        std::vector<std::string> labelsAtEnd;  // Labels already placed at codeSize
+        size_t gcCodeRanges = 0;
+        std::string gcRangeStart;
+        std::map<int32_t, uint8_t> gcSlots;    // Current frame map's slots
+    };
     
     // Stdout handle caching - avoid redundant GetStdHandle calls
     bool stdoutHandleCached_ = false;          // Whether stdout handle is cached in RDI
@@ -122,6 +176,8 @@ private:
     uint32_t addString(const std::string& str);
     uint32_t addFloatConstant(double value);    // Add float constant to data section
     void allocLocal(const std::string& name);
+    int32_t allocTemp(const std::string& name);  // Scratch slot, reused once its statement ends
+    void releaseTemps(size_t mark);              // Free temps allocated since liveTemps.size() == mark
     void emitPrintInt(int32_t localOffset);
     void emitPrintString(uint32_t dataOffset);
     void emitPrintNewline();
@@ -137,6 +193,7 @@ private:
     void emitPrintIntCall();                    // Call shared print_int routine (O1/O2)
     bool shouldInlineItoa() const;              // Check if itoa should be inlined based on opt level
     bool shouldInlineFtoa() const;              // Check if ftoa should be inlined based on opt level
+    void optimizeMachineCode();                 // Lift to machine IR, run peephole/DCE/scheduling, re-encode
     
     bool tryEvalConstant(Expression* expr, int64_t& outValue);
     bool tryEvalConstantFloat(Expression* expr, double& outValue);  // Evaluate float constants
@@ -157,8 +214,15 @@ private:
     // Stack frame optimization helpers
     int32_t calculateFunctionStackSize(Statement* body);  // Pre-scan to calculate stack needs
     int32_t calculateExprStackSize(Expression* expr);     // Calculate stack needs for expression
-    void emitCallWithOptimizedStack(uint32_t importRVA);  // Emit call without stack adjustment
-    void emitCallRelWithOptimizedStack(const std::string& label);  // Emit relative call
+    void emitCallWithOptimizedStack(uint32_t importRVA);  // Import call using the frame's shadow space
+    void emitCallRelWithOptimizedStack(const std::string& label);  // Relative call using the frame's shadow space
+    void emitBlockingCall(uint32_t importRVA);  // Import call that may wait on other threads
+    void emitCallRaxWithOptimizedStack();                 // Indirect call through rax, same stack handling
+    void emitFrameAllocate();                             // sub rsp, frame size (patched later)
+    void emitFrameRelease();                              // add rsp, frame size (patched later)
+    void finalizeFrameSize(int32_t callStack);            // Size the frame from the packed locals
+    EmitCheckpoint emitCheckpoint() const;                // Current end of the emitted code
+    void rollbackTo(const EmitCheckpoint& checkpoint);    // Drop code, labels and fixups emitted since
     
     // Dead code elimination helper - check if statement ends with terminator
     bool endsWithTerminator(Statement* stmt);  // Returns true if stmt ends with return/break/continue
@@ -172,6 +236,8 @@ private:
     
     // Leaf function optimization helpers
     bool checkIsLeafFunction(Statement* body);            // Check if function makes no calls
+    bool emitFunctionBody(FnDecl& node, bool frameless);  // Prologue, body, epilogue; false if frameless needed slots
+    const Statement* emitEntryGuard(FnDecl& node);        // Hoist an `if p <= k: return ...` guard above the prologue
     bool statementHasCall(Statement* stmt);               // Check if statement contains a call
     bool expressionHasCall(Expression* expr);             // Check if expression contains a call
     
@@ -215,7 +281,47 @@ private:
     bool useGC_ = true;                                    // Enable GC for allocations
     bool gcInitEmitted_ = false;                           // Whether GC init code has been emitted
     uint32_t gcDataRVA_ = 0;                               // RVA of GC data section globals
+    GCHeapSizing gcHeapSizing_;                            // Threshold bounds and growth
     std::string gcCollectLabel_;                           // Label for GC collection routine
+    std::string gcMajorLabel_ = "__TYL_gc_major";          // Old-space mark-and-sweep
+    std::string gcMinorLabel_ = "__TYL_gc_minor";          // Nursery collection
+    std::string gcAllocSlowLabel_ = "__TYL_gc_alloc_slow"; // Nursery refill / old-space allocation
+    std::string gcRememberLabel_ = "__TYL_gc_remember";    // Write barrier slow path
+    std::string gcInitLabel_ = "__TYL_gc_init";            // Nursery setup at program start
+    std::string gcEnvSizeLabel_ = "__TYL_gc_env_size";     // Read a heap sizing environment variable
+    std::string gcHeapBytesLabel_ = "__TYL_gc_heap_bytes"; // Live bytes for gc_stats()
+    std::string gcFrameMapLabel_ = "__TYL_gc_frame_map";   // Return address -> frame map lookup
+    std::string gcFrameTableLabel_ = "__TYL_gc_frame_table";  // Code ranges and their frame maps
+    std::string gcOldAllocLabel_ = "__TYL_gc_old_alloc";   // Size-class cell from the old-space regions
+    std::string gcMarkLabel_ = "__TYL_gc_mark";            // Mark the old object a word points into
+    std::string gcGrayPushLabel_ = "__TYL_gc_gray_push";   // Queue an object for scanning
+    std::string gcGrowLabel_ = "__TYL_gc_grow";            // Double a GC buffer (gray stack, region table)
+    std::string gcAllocOldLabel_ = "__TYL_gc_alloc_old";   // Old-space allocation that a minor GC never moves
+    std::string gcLockLabel_ = "__TYL_gc_lock";            // Take the GC lock, parked while waiting
+    std::string gcStopLabel_ = "__TYL_gc_stop";            // Wait until every other thread is parked
+    std::string gcThreadNewLabel_ = "__TYL_gc_thread_new"; // Register a thread about to be created
+    std::string gcThreadStartLabel_ = "__TYL_gc_thread_start";  // Adopt the record in the new thread
+    std::string gcThreadExitLabel_ = "__TYL_gc_thread_exit";    // Unregister the finishing thread
+    std::string gcBlockingCallLabel_ = "__TYL_gc_blocking_call";  // Call an OS wait parked
+    std::string gcMarkPushLabel_ = "__TYL_gc_mark_push";   // Push onto the calling marker's stack
+    std::string gcMarkDrainLabel_ = "__TYL_gc_mark_drain"; // Scan and steal until every marker is idle
+    std::string gcMarkerThreadLabel_ = "__TYL_gc_marker_thread";  // Helper marker thread procedure
+    std::string gcMarkersStartLabel_ = "__TYL_gc_markers_start";  // Size the marker pool, start its helpers
+    
+    // Frame maps for precise stack scanning (codegen_gc_roots.cpp). Each
+    // function's map gives the GCSlotKind of the named locals whose contents
+    // are known; the code ranges say which map applies to a return address.
+    struct GCCodeRange {
+        std::string start;
+        std::string end;
+        int32_t map;
+    };
+    std::vector<std::map<int32_t, uint8_t>> gcFrameMaps_;  // rbp offset -> GCSlotKind
+    std::vector<GCCodeRange> gcCodeRanges_;
+    int32_t gcFrameMap_ = -1;                              // Map of the frame being emitted
+    std::string gcRangeStart_;                             // Start label of its open code range
+    std::pair<std::string, uint8_t> gcPendingSlot_;        // Variable being declared and its kind
+    int32_t gcPendingOffset_ = 0;                          // stackOffset when the declaration began
     
     // Generics / Monomorphization support
     Monomorphizer monomorphizer_;                          // Tracks generic instantiations
@@ -290,6 +396,45 @@ private:
     };
     std::map<std::string, FixedArrayInfo> varFixedArrayTypes_;  // Variable name -> fixed array info
     
+    // Loop strength reduction: element accesses indexed by a range loop's
+    // induction variable read through a pointer bumped once per iteration
+    struct StrengthReducedAccess {
+        std::string pointerSlot;                           // Local holding &array[i] for the current iteration
+        int32_t elementSize;                               // Bytes loaded/stored per access
+        bool isFloat;                                      // Element is a float type
+    };
+    std::map<IndexExpr*, StrengthReducedAccess> strengthReduced_;
+    std::map<ForStmt*, std::vector<StrengthReducedAccess>> loopReducedPointers_;
+    
+    // Loop vectorization: reductions and elementwise stores found by the
+    // Vectorizer at -O3/-Ofast get a packed main loop. Below x86-64-v3 the
+    // loop is emitted twice, AVX2 and SSE, picked by a cpuid flag at startup.
+    Vectorizer vectorizer_;
+    TargetISA targetISA_ = TargetISA::X86_64;
+    uint32_t cpuHasAVX2RVA_ = 0;                           // RVA of the startup cpuid result (1 = AVX2+FMA usable)
+    struct VectorLane {
+        int32_t elementSize;                               // 4 or 8 bytes per lane
+        bool isFloat;                                      // f64 lanes
+    };
+    
+    // Profile instrumentation (--profile-generate): one 64-bit counter per
+    // site in the data section, dumped as a text profile at exit
+    ProfileCollector profileCollector_;
+    std::string profileFile_;                              // Empty = not instrumenting
+    uint32_t profileCountersRVA_ = 0;
+    std::string profileDumpLabel_ = "__TYL_profile_dump";
+    
+    // Cold text region: blocks queued by deferColdBlock, emitted after all
+    // functions and runtime routines
+    struct ColdBlock {
+        std::string label;
+        std::function<void()> body;
+        int32_t gcFrameMap = -1;               // Frame map of the code that queued it
+    };
+    std::vector<ColdBlock> coldBlocks_;
+    bool fatalErrorUsed_ = false;
+    std::string fatalErrorLabel_ = "__TYL_fatal_error";
+    
     // Function pointer type tracking
     std::set<std::string> fnPtrVars_;                      // Variables that hold function pointers
     std::set<std::string> closureVars_;                    // Variables that hold closures (lambdas)
@@ -494,8 +639,43 @@ private:
     void emitFixedArrayIndexAccess(IndexExpr& node, const FixedArrayInfo& info);
     void emitStringSlice(IndexExpr& node, Expression* startExpr, Expression* endExpr, bool inclusive);
     bool getNestedFixedArrayInfo(IndexExpr* indexExpr, FixedArrayInfo& outInfo);
+    bool getSimpleVarOperand(Expression* expr, X64Operand& out, bool allowFloat = false);  // Register/[rbp+off] operand for a plain variable
+    X64Operand emitElementAddress(Expression* object, Expression* index, int32_t elementSize, int32_t bias);
+    X64Operand emitElementAddressFromRax(Expression* object, int32_t elementSize, int32_t bias);
+    void emitElementLoad(const X64Operand& addr, int32_t elementSize);  // rax = zero-extended element
+    
+    // Loop strength reduction (codegen_stmt_control.cpp)
+    struct InductionAccess {
+        IndexExpr* expr;
+        std::string array;
+        bool isStore;                                      // Target of an assignment
+    };
+    static std::vector<InductionAccess> scanInductionAccesses(ForStmt& node);  // Syntactic candidates
+    int countStrengthReducibleAccesses(ForStmt& node);     // Pointer slots the loop may need
+    void beginStrengthReduction(ForStmt& node, int64_t step);  // Allocate and seed the bumped pointers
+    void bumpStrengthReducedPointers(ForStmt& node, int64_t step);
+    void endStrengthReduction(ForStmt& node);
+    
+    // Loop vectorization (codegen_stmt_vector.cpp)
+    bool getVectorArray(Expression* access, bool isStore, VectorLane& lane, int32_t& bias, X64Operand& base);
+    void emitVectorizedLoop(ForStmt& node, bool inclusive, VarRegister loopVarReg);  // Packed main loop ahead of the scalar loop
+    void emitPackedMul64(X64Reg dst, X64Reg src, uint8_t vectorBytes);  // dst *= src per 64-bit lane (clobbers xmm3/xmm4)
+    void emitPackedMinMax64(X64Reg acc, X64Reg value, bool isMin, uint8_t vectorBytes);  // acc = min/max(acc, value) per signed 64-bit lane
+    void emitCpuFeatureCheck();                            // cpuid/xgetbv probe in _start
+    
+    // Profile instrumentation (codegen_profile.cpp)
+    void emitProfileCounter(const ASTNode* site, int slot = 0);  // inc the site's counter, flags only
+    void emitProfileDumpCall();                            // Write the profile before ExitProcess
+    void emitProfileDumpRoutine();                         // Shared __TYL_profile_dump at end of code
+    
+    // Code layout (codegen_layout.cpp)
+    std::vector<FnDecl*> layoutFunctions(const std::vector<FnDecl*>& functions);  // Hot first, cold last
+    std::string deferColdBlock(const std::string& prefix, std::function<void()> body);  // Queue for the cold region, returns its label
+    void emitColdBlocks();                                 // Flush the cold region (+ __TYL_fatal_error)
+    void emitFatalError(const std::string& message);       // Print message and exit(1), out of line
     
     // Modular statement helpers (codegen_stmt_vardecl.cpp)
+    void emitVarDecl(VarDecl& node);
     void emitUninitializedVarDecl(VarDecl& node);
     void emitFixedArrayDecl(VarDecl& node);
     
@@ -707,19 +887,51 @@ private:
     void inferParamTypesFromStmt(Statement* stmt, const std::set<std::string>& functionNames);
     
     // GC helper methods
+    void initGCData();                                     // Add the GC data block to .data
     void emitGCInit();                                     // Emit GC initialization at program start
     void emitGCShutdown();                                 // Emit GC shutdown at program end
-    void emitGCAlloc(size_t size, GCObjectType type);      // Emit GC allocation call
-    void emitGCAllocList(size_t capacity);                 // Emit list allocation via GC
-    void emitGCAllocRecord(size_t fieldCount, uint64_t typeId = 0);  // Emit record allocation via GC (typeId for RTTI)
-    void emitGCAllocClosure(size_t captureCount);          // Emit closure allocation via GC
+    void emitGCAlloc(size_t size, GCObjectType type, bool old = false);  // Emit GC allocation call (old: never moved)
+    void emitGCAllocList(size_t capacity, bool onStack = false);  // Emit list allocation via GC (or the frame)
+    void emitGCAllocRecord(size_t fieldCount, uint64_t typeId = 0, bool onStack = false);  // Emit record allocation via GC (typeId for RTTI)
+    void emitGCAllocClosure(size_t captureCount, bool onStack = false);  // Emit closure allocation via GC (or the frame)
     void emitGCAllocString(size_t len);                    // Emit string allocation via GC
     void emitGCAllocMap(size_t capacity);                  // Emit map allocation via GC
     void emitGCAllocMapEntry();                            // Emit map entry allocation via GC
-    void emitGCAllocRaw(size_t size);                      // Emit raw allocation via GC
+    void emitGCAllocRaw(size_t size, bool onStack = false);  // Emit raw allocation via GC (or the frame)
+    bool emitStackAlloc(size_t size);                      // Zeroed frame block for a noEscape allocation
     void emitGCPushFrame();                                // Emit stack frame push for GC
     void emitGCPopFrame();                                 // Emit stack frame pop for GC
-    void emitGCCollectRoutine();                           // Emit the GC collection routine (mark-and-sweep)
+    void emitWriteBarrier(X64Reg slot, X64Reg value);      // Remember [slot] if it now holds a nursery pointer
+    void emitWriteBarrier(X64Operand slot, X64Reg value);  // Same, for a store through a memory operand
+    void emitGCCollectRoutine();                           // Emit the GC runtime routines
+    void emitGCInitRoutine();                              // Reserve the nursery and remembered set
+    void emitGCEnvSizeRoutine();                           // Parse a TYL_GC_HEAP_* variable into the data block
+    void emitGCAllocSlowRoutine();                         // Find the next free nursery run, collect, or allocate old
+    void emitGCRememberRoutine();                          // Append a slot to the remembered set
+    void emitGCHeapBytesRoutine();                         // Sum live old and young bytes
+    void emitGCMinorRoutine();                             // Copy/promote nursery survivors into the old space
+    void emitNurserySkipFree(X64Reg cursor, X64Reg limit); // Advance cursor over zeroed nursery qwords
+    void emitGCOldAllocRoutine();                          // Pop a free cell, sweeping or adding regions as needed
+    void emitGCMarkRoutine();                              // Region bitmap / list mark of one word
+    void emitGCGrayPushRoutine();                          // Push onto the gray stack
+    void emitGCGrowRoutine();                              // Grow a base/top/end buffer
+    void emitGCThreadRoutines();                           // GC lock, stop-the-world and thread registration
+    void emitGCThreadRecord(X64Reg dst);                   // Load the current thread's record
+    void emitGCUnlock();                                   // Release the GC lock (clobbers R11)
+    void emitGCMarkerRoutines();                           // Marker pool, mark stacks and work stealing
+    void emitGCClock(int32_t slot);                        // Performance counter into [rbp+slot]
+    void emitGCPhaseTime(int32_t phase, int32_t from, int32_t to);  // Account [rbp+to] - [rbp+from] to a phase
+    int32_t beginGCFrameMap();                             // Start a function's frame map; returns the enclosing one
+    void endGCFrameMap(int32_t enclosing);                 // Close its code range and resume the enclosing map
+    void openGCCodeRange();                                // Start a code range for gcFrameMap_ here
+    void closeGCCodeRange();                               // End the open code range here
+    void beginGCSlotDecl(const std::string& name, uint8_t kind);  // The declaration's own slot gets this kind
+    void noteGCSlot(const std::string& name, int32_t offset);     // allocLocal hook for beginGCSlotDecl
+    uint8_t gcSlotKindForType(const std::string& typeName);
+    uint8_t gcSlotKindFor(VarDecl& node);
+    void emitGCRootWalk(int32_t savedBytes, const std::function<void(const std::string&)>& body);
+    void emitGCFrameMapRoutine();                          // Binary search of the frame table
+    void emitGCFrameTable();                               // Frame table, after the code is final
     
     // Ownership system helpers
     void emitListClone();                                  // Deep copy a list (RAX = source, returns new list in RAX)
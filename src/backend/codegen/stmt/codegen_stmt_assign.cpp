@@ -78,7 +78,7 @@ void NativeCodeGen::visit(DestructuringDecl& node) {
     // For lists, the data starts at offset 16 (after length and capacity)
     node.initializer->accept(*this);
     
-    allocLocal("$destruct_base");
+    allocTemp("$destruct_base");
     asm_.mov_mem_rbp_rax(locals["$destruct_base"]);
     
     for (size_t i = 0; i < node.names.size(); i++) {
@@ -152,6 +152,7 @@ void NativeCodeGen::visit(AssignStmt& node) {
         node.value->accept(*this);
         asm_.pop_rcx();
         asm_.mov_mem_rcx_rax();
+        emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
     }
 }
 
@@ -345,9 +346,22 @@ void NativeCodeGen::emitDerefAssign(DerefExpr* deref, AssignStmt& node) {
     asm_.mov_rcx_rax();
     asm_.pop_rax();
     asm_.mov_mem_rcx_rax();
+    emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
 }
 
 void NativeCodeGen::emitIndexAssign(IndexExpr* indexExpr, AssignStmt& node) {
+    // Induction-variable store inside a strength-reduced loop
+    auto reducedIt = strengthReduced_.find(indexExpr);
+    if (reducedIt != strengthReduced_.end()) {
+        node.value->accept(*this);
+        asm_.mov_rcx_mem_rbp(locals[reducedIt->second.pointerSlot]);
+        int32_t size = reducedIt->second.elementSize;
+        asm_.emit(X64Op::MOV, X64Operand::mem(X64Reg::RCX, 0, static_cast<uint8_t>(size)),
+                  X64Operand::r(X64Reg::RAX, static_cast<uint8_t>(size)));
+        if (size == 8) emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
+        return;
+    }
+    
     if (auto* objId = dynamic_cast<Identifier*>(indexExpr->object.get())) {
         auto fixedArrayIt = varFixedArrayTypes_.find(objId->name);
         if (fixedArrayIt != varFixedArrayTypes_.end()) {
@@ -356,70 +370,27 @@ void NativeCodeGen::emitIndexAssign(IndexExpr* indexExpr, AssignStmt& node) {
         }
     }
     
-    // Regular list assignment (1-based)
+    // Regular list assignment (1-based, 16-byte header)
     node.value->accept(*this);
     asm_.push_rax();
     
-    indexExpr->index->accept(*this);
-    asm_.dec_rax();
-    asm_.push_rax();
-    
-    indexExpr->object->accept(*this);
-    asm_.add_rax_imm32(16);
-    
-    asm_.pop_rcx();
-    asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-    asm_.code.push_back(0xE1); asm_.code.push_back(0x03);
-    
-    asm_.add_rax_rcx();
-    asm_.mov_rcx_rax();
-    
-    asm_.pop_rax();
-    asm_.mov_mem_rcx_rax();
+    X64Operand addr = emitElementAddress(indexExpr->object.get(), indexExpr->index.get(), 8, 16 - 8);
+    asm_.pop_rdx();
+    asm_.emit(X64Op::MOV, addr, X64Operand::r(X64Reg::RDX));
+    emitWriteBarrier(addr, X64Reg::RDX);
 }
 
 void NativeCodeGen::emitFixedArrayAssign(IndexExpr* indexExpr, AssignStmt& node, const FixedArrayInfo& info) {
     node.value->accept(*this);
     asm_.push_rax();
     
-    indexExpr->index->accept(*this);
-    asm_.push_rax();
-    
-    indexExpr->object->accept(*this);
-    asm_.pop_rcx();
+    X64Operand addr = emitElementAddress(indexExpr->object.get(), indexExpr->index.get(), info.elementSize, 0);
+    asm_.pop_rdx();
     
-    if (info.elementSize == 8) {
-        asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-        asm_.code.push_back(0xE1); asm_.code.push_back(0x03);
-    } else if (info.elementSize == 4) {
-        asm_.code.push_back(0x48); asm_.code.push_back(0xC1);
-        asm_.code.push_back(0xE1); asm_.code.push_back(0x02);
-    } else if (info.elementSize == 2) {
-        asm_.code.push_back(0x48); asm_.code.push_back(0xD1);
-        asm_.code.push_back(0xE1);
-    } else if (info.elementSize != 1) {
-        asm_.mov_rdx_imm64(info.elementSize);
-        asm_.code.push_back(0x48); asm_.code.push_back(0x0F);
-        asm_.code.push_back(0xAF); asm_.code.push_back(0xCA);
-    }
-    
-    asm_.add_rax_rcx();
-    asm_.mov_rcx_rax();
-    asm_.pop_rax();
-    
-    if (info.elementSize == 1) {
-        asm_.code.push_back(0x88);
-        asm_.code.push_back(0x01);
-    } else if (info.elementSize == 2) {
-        asm_.code.push_back(0x66);
-        asm_.code.push_back(0x89);
-        asm_.code.push_back(0x01);
-    } else if (info.elementSize == 4) {
-        asm_.code.push_back(0x89);
-        asm_.code.push_back(0x01);
-    } else {
-        asm_.mov_mem_rcx_rax();
-    }
+    uint8_t size = static_cast<uint8_t>(info.elementSize == 1 || info.elementSize == 2 || info.elementSize == 4 ? info.elementSize : 8);
+    addr.size = size;
+    asm_.emit(X64Op::MOV, addr, X64Operand::r(X64Reg::RDX, size));
+    if (size == 8) emitWriteBarrier(addr, X64Reg::RDX);
 }
 
 void NativeCodeGen::emitMemberAssign(MemberExpr* member, AssignStmt& node) {
@@ -477,6 +448,7 @@ void NativeCodeGen::emitMemberAssign(MemberExpr* member, AssignStmt& node) {
                         asm_.code.push_back(0x01);
                     } else {
                         asm_.mov_mem_rcx_rax();
+                        emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
                     }
                     return;
                 }
@@ -491,6 +463,7 @@ void NativeCodeGen::emitMemberAssign(MemberExpr* member, AssignStmt& node) {
     asm_.mov_rcx_rax();
     asm_.pop_rax();
     asm_.mov_mem_rcx_rax();
+    emitWriteBarrier(X64Reg::RCX, X64Reg::RAX);
 }
 
 } // namespace tyl
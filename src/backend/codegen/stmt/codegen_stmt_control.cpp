@@ -9,9 +9,11 @@ void NativeCodeGen::visit(IfStmt& node) {
     std::string elseLabel = newLabel("if_else");
     std::string endLabel = newLabel("if_end");
     
+    emitProfileCounter(node.condition.get());
     node.condition->accept(*this);
     asm_.test_rax_rax();
     asm_.jz_rel32(elseLabel);
+    emitProfileCounter(node.condition.get(), 1);
     node.thenBranch->accept(*this);
     
     bool thenTerminates = endsWithTerminator(node.thenBranch.get());
@@ -22,9 +24,11 @@ void NativeCodeGen::visit(IfStmt& node) {
     
     for (auto& [cond, body] : node.elifBranches) {
         std::string nextLabel = newLabel("elif");
+        emitProfileCounter(cond.get());
         cond->accept(*this);
         asm_.test_rax_rax();
         asm_.jz_rel32(nextLabel);
+        emitProfileCounter(cond.get(), 1);
         body->accept(*this);
         
         if (!endsWithTerminator(body.get())) {
@@ -50,10 +54,12 @@ void NativeCodeGen::visit(WhileStmt& node) {
     // Only mutable variables that are modified in the loop need special handling,
     // and those are tracked separately.
     
+    emitProfileCounter(&node);
     asm_.label(loopLabel);
     node.condition->accept(*this);
     asm_.test_rax_rax();
     asm_.jz_rel32(endLabel);
+    emitProfileCounter(&node, 1);
     node.body->accept(*this);
     
     if (!endsWithTerminator(node.body.get())) {
@@ -70,6 +76,7 @@ void NativeCodeGen::visit(ForStmt& node) {
     std::string endLabel = newLabel("for_end");
     
     loopStack.push_back({node.label, continueLabel, endLabel});
+    emitProfileCounter(&node);
     
     // Check if loop variable is allocated to a register
     VarRegister loopVarReg = VarRegister::NONE;
@@ -91,7 +98,7 @@ void NativeCodeGen::visit(ForStmt& node) {
         }
         
         range->end->accept(*this);
-        allocLocal("$end");
+        allocTemp("$end");
         asm_.mov_mem_rbp_rax(locals["$end"]);
         
         // Handle step value (by keyword)
@@ -105,7 +112,7 @@ void NativeCodeGen::visit(ForStmt& node) {
             } else {
                 // Non-constant step - evaluate and store
                 range->step->accept(*this);
-                allocLocal("$step");
+                allocTemp("$step");
                 asm_.mov_mem_rbp_rax(locals["$step"]);
                 hasVarStep = true;
             }
@@ -113,6 +120,9 @@ void NativeCodeGen::visit(ForStmt& node) {
         
         constVars.erase(node.var);
         
+        if (!hasVarStep && stepValue == 1) emitVectorizedLoop(node, true, loopVarReg);
+        if (!hasVarStep) beginStrengthReduction(node, stepValue);
+        
         asm_.label(loopLabel);
         
         // Load loop variable
@@ -124,9 +134,11 @@ void NativeCodeGen::visit(ForStmt& node) {
         asm_.cmp_rax_mem_rbp(locals["$end"]);
         asm_.jg_rel32(endLabel);  // Exit when i > end (inclusive)
         
+        emitProfileCounter(&node, 1);
         node.body->accept(*this);
         
         asm_.label(continueLabel);
+        bumpStrengthReducedPointers(node, stepValue);
         
         // Load, increment, store loop variable
         if (loopVarReg != VarRegister::NONE) {
@@ -152,6 +164,7 @@ void NativeCodeGen::visit(ForStmt& node) {
         asm_.jmp_rel32(loopLabel);
         
         asm_.label(endLabel);
+        endStrengthReduction(node);
         loopStack.pop_back();
         return;
     }
@@ -175,7 +188,7 @@ void NativeCodeGen::visit(ForStmt& node) {
                     }
                     
                     call->args[0]->accept(*this);
-                    allocLocal("$end");
+                    allocTemp("$end");
                     asm_.mov_mem_rbp_rax(locals["$end"]);
                 } else {
                     // range(start, end) or range(start, end, step)
@@ -188,7 +201,7 @@ void NativeCodeGen::visit(ForStmt& node) {
                     }
                     
                     call->args[1]->accept(*this);
-                    allocLocal("$end");
+                    allocTemp("$end");
                     asm_.mov_mem_rbp_rax(locals["$end"]);
                     
                     // Handle step value if provided
@@ -199,7 +212,7 @@ void NativeCodeGen::visit(ForStmt& node) {
                         } else {
                             // Non-constant step - evaluate and store
                             call->args[2]->accept(*this);
-                            allocLocal("$step");
+                            allocTemp("$step");
                             asm_.mov_mem_rbp_rax(locals["$step"]);
                             hasVarStep = true;
                         }
@@ -208,6 +221,9 @@ void NativeCodeGen::visit(ForStmt& node) {
                 
                 constVars.erase(node.var);
                 
+                if (!hasVarStep && stepValue == 1) emitVectorizedLoop(node, false, loopVarReg);
+                if (!hasVarStep) beginStrengthReduction(node, stepValue);
+                
                 asm_.label(loopLabel);
                 
                 // Load loop variable
@@ -219,9 +235,11 @@ void NativeCodeGen::visit(ForStmt& node) {
                 asm_.cmp_rax_mem_rbp(locals["$end"]);
                 asm_.jge_rel32(endLabel);
                 
+                emitProfileCounter(&node, 1);
                 node.body->accept(*this);
                 
                 asm_.label(continueLabel);
+                bumpStrengthReducedPointers(node, stepValue);
                 
                 // Load, increment, store loop variable
                 if (loopVarReg != VarRegister::NONE) {
@@ -247,6 +265,7 @@ void NativeCodeGen::visit(ForStmt& node) {
                 asm_.jmp_rel32(loopLabel);
                 
                 asm_.label(endLabel);
+                endStrengthReduction(node);
                 loopStack.pop_back();
                 return;
             }
@@ -261,14 +280,14 @@ void NativeCodeGen::visit(ForStmt& node) {
             size_t listSize = sizeIt->second;
             
             node.iterable->accept(*this);
-            allocLocal("$for_list_ptr");
+            allocTemp("$for_list_ptr");
             asm_.mov_mem_rbp_rax(locals["$for_list_ptr"]);
             
-            allocLocal("$for_idx");
+            allocTemp("$for_idx");
             asm_.xor_rax_rax();
             asm_.mov_mem_rbp_rax(locals["$for_idx"]);
             
-            allocLocal("$for_list_size");
+            allocTemp("$for_list_size");
             asm_.mov_rax_imm64((int64_t)listSize);
             asm_.mov_mem_rbp_rax(locals["$for_list_size"]);
             
@@ -296,6 +315,7 @@ void NativeCodeGen::visit(ForStmt& node) {
                 asm_.mov_mem_rbp_rax(locals[node.var]);
             }
             
+            emitProfileCounter(&node, 1);
             node.body->accept(*this);
             
             asm_.label(continueLabel);
@@ -312,14 +332,14 @@ void NativeCodeGen::visit(ForStmt& node) {
     
     // Fallback: iterate over list with runtime size
     node.iterable->accept(*this);
-    allocLocal("$for_list_ptr");
+    allocTemp("$for_list_ptr");
     asm_.mov_mem_rbp_rax(locals["$for_list_ptr"]);
     
-    allocLocal("$for_idx");
+    allocTemp("$for_idx");
     asm_.xor_rax_rax();
     asm_.mov_mem_rbp_rax(locals["$for_idx"]);
     
-    allocLocal("$for_list_size");
+    allocTemp("$for_list_size");
     asm_.mov_rax_mem_rbp(locals["$for_list_ptr"]);
     asm_.mov_rax_mem_rax();
     asm_.mov_mem_rbp_rax(locals["$for_list_size"]);
@@ -349,6 +369,7 @@ void NativeCodeGen::visit(ForStmt& node) {
         asm_.mov_mem_rbp_rax(locals[node.var]);
     }
     
+    emitProfileCounter(&node, 1);
     node.body->accept(*this);
     
     asm_.label(continueLabel);
@@ -361,9 +382,228 @@ void NativeCodeGen::visit(ForStmt& node) {
     loopStack.pop_back();
 }
 
+// ============================================
+// Loop strength reduction
+// ============================================
+// In a range loop whose induction variable is never written by the body,
+// arr[i] is replaced by a pointer to the element that is bumped by
+// step * elementSize at the continue label. The access then becomes a
+// single load/store through the pointer instead of reloading i and arr and
+// forming the address on every iteration.
+
+std::vector<NativeCodeGen::InductionAccess> NativeCodeGen::scanInductionAccesses(ForStmt& node) {
+    std::vector<InductionAccess> accesses;
+    std::set<std::string> escaped;   // Names used other than as arr[...]
+    bool ok = true;
+    const std::string& var = node.var;
+    
+    std::function<void(Expression*)> scanExpr;
+    std::function<void(Statement*)> scanStmt;
+    
+    auto isVar = [&](Expression* e) {
+        auto* id = dynamic_cast<Identifier*>(e);
+        return id && id->name == var;
+    };
+    
+    // arr[...] leaves arr itself untouched; only arr[var] is a candidate
+    auto scanIndex = [&](IndexExpr* index, bool isStore) {
+        if (auto* obj = dynamic_cast<Identifier*>(index->object.get())) {
+            if (isVar(index->index.get()) && obj->name != var) {
+                accesses.push_back({index, obj->name, isStore});
+                return;
+            }
+            if (obj->name == var) escaped.insert(var);
+        } else {
+            scanExpr(index->object.get());
+        }
+        scanExpr(index->index.get());
+    };
+    
+    // A write target: the induction variable must not be assigned
+    auto scanTarget = [&](Expression* target) {
+        if (auto* id = dynamic_cast<Identifier*>(target)) {
+            if (id->name == var) ok = false;
+            escaped.insert(id->name);
+        } else if (auto* index = dynamic_cast<IndexExpr*>(target)) {
+            if (auto* obj = dynamic_cast<Identifier*>(index->object.get())) {
+                if (obj->name == var) ok = false;
+            } else {
+                scanExpr(index->object.get());
+            }
+            scanExpr(index->index.get());
+        } else {
+            ok = false;
+        }
+    };
+    
+    scanExpr = [&](Expression* expr) {
+        if (!expr || !ok) return;
+        if (dynamic_cast<IntegerLiteral*>(expr) || dynamic_cast<FloatLiteral*>(expr) ||
+            dynamic_cast<StringLiteral*>(expr) || dynamic_cast<BoolLiteral*>(expr) ||
+            dynamic_cast<NilLiteral*>(expr)) {
+            return;
+        }
+        if (auto* id = dynamic_cast<Identifier*>(expr)) {
+            if (id->name != var) escaped.insert(id->name);
+        } else if (auto* index = dynamic_cast<IndexExpr*>(expr)) {
+            scanIndex(index, false);
+        } else if (auto* binary = dynamic_cast<BinaryExpr*>(expr)) {
+            scanExpr(binary->left.get());
+            scanExpr(binary->right.get());
+        } else if (auto* unary = dynamic_cast<UnaryExpr*>(expr)) {
+            scanExpr(unary->operand.get());
+        } else if (auto* ternary = dynamic_cast<TernaryExpr*>(expr)) {
+            scanExpr(ternary->condition.get());
+            scanExpr(ternary->thenExpr.get());
+            scanExpr(ternary->elseExpr.get());
+        } else if (auto* member = dynamic_cast<MemberExpr*>(expr)) {
+            scanExpr(member->object.get());
+        } else if (auto* call = dynamic_cast<CallExpr*>(expr)) {
+            scanExpr(call->callee.get());
+            for (auto& arg : call->args) scanExpr(arg.get());
+            for (auto& named : call->namedArgs) scanExpr(named.second.get());
+        } else if (auto* assign = dynamic_cast<AssignExpr*>(expr)) {
+            auto* index = dynamic_cast<IndexExpr*>(assign->target.get());
+            if (index && assign->op == TokenType::ASSIGN) {
+                scanIndex(index, true);
+            } else {
+                scanTarget(assign->target.get());
+            }
+            scanExpr(assign->value.get());
+        } else {
+            ok = false;
+        }
+    };
+    
+    scanStmt = [&](Statement* stmt) {
+        if (!stmt || !ok) return;
+        if (auto* block = dynamic_cast<Block*>(stmt)) {
+            for (auto& s : block->statements) scanStmt(s.get());
+        } else if (auto* exprStmt = dynamic_cast<ExprStmt*>(stmt)) {
+            scanExpr(exprStmt->expr.get());
+        } else if (auto* varDecl = dynamic_cast<VarDecl*>(stmt)) {
+            // Shadowing the induction variable or an array changes what the name means
+            if (varDecl->name == var) ok = false;
+            escaped.insert(varDecl->name);
+            scanExpr(varDecl->initializer.get());
+        } else if (auto* assignStmt = dynamic_cast<AssignStmt*>(stmt)) {
+            auto* index = dynamic_cast<IndexExpr*>(assignStmt->target.get());
+            if (index && assignStmt->op == TokenType::ASSIGN) {
+                scanIndex(index, true);
+            } else {
+                scanTarget(assignStmt->target.get());
+            }
+            scanExpr(assignStmt->value.get());
+        } else if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt)) {
+            scanExpr(ifStmt->condition.get());
+            scanStmt(ifStmt->thenBranch.get());
+            for (auto& elif : ifStmt->elifBranches) {
+                scanExpr(elif.first.get());
+                scanStmt(elif.second.get());
+            }
+            scanStmt(ifStmt->elseBranch.get());
+        } else if (auto* whileStmt = dynamic_cast<WhileStmt*>(stmt)) {
+            scanExpr(whileStmt->condition.get());
+            scanStmt(whileStmt->body.get());
+        } else if (auto* forStmt = dynamic_cast<ForStmt*>(stmt)) {
+            if (forStmt->var == var) ok = false;
+            escaped.insert(forStmt->var);
+            scanExpr(forStmt->iterable.get());
+            scanStmt(forStmt->body.get());
+        } else if (auto* returnStmt = dynamic_cast<ReturnStmt*>(stmt)) {
+            scanExpr(returnStmt->value.get());
+        } else if (!dynamic_cast<BreakStmt*>(stmt) && !dynamic_cast<ContinueStmt*>(stmt)) {
+            ok = false;
+        }
+    };
+    
+    scanStmt(node.body.get());
+    if (!ok) return {};
+    
+    std::vector<InductionAccess> result;
+    for (auto& access : accesses) {
+        if (!escaped.count(access.array)) result.push_back(access);
+    }
+    return result;
+}
+
+int NativeCodeGen::countStrengthReducibleAccesses(ForStmt& node) {
+    std::set<std::pair<std::string, bool>> groups;
+    for (auto& access : scanInductionAccesses(node)) {
+        groups.insert({access.array, access.isStore});
+    }
+    return static_cast<int>(groups.size());
+}
+
+void NativeCodeGen::beginStrengthReduction(ForStmt& node, int64_t step) {
+    if (optLevel_ == CodeGenOptLevel::O0) return;
+    
+    // Accesses sharing an array, element size and bias share one pointer
+    std::map<std::tuple<std::string, int32_t, int32_t>, std::string> slots;
+    std::vector<StrengthReducedAccess> pointers;
+    
+    for (auto& access : scanInductionAccesses(node)) {
+        if (constListVars.count(access.array) || globalVarRegisters_.count(access.array)) continue;
+        
+        Identifier* array = dynamic_cast<Identifier*>(access.expr->object.get());
+        X64Operand base;
+        if (!getSimpleVarOperand(array, base)) continue;
+        
+        // Same layout as the unreduced paths: lists are 1-based behind a
+        // 16-byte header, fixed arrays are read 1-based and stored 0-based
+        int32_t elementSize = 8;
+        int32_t bias = 16 - 8;
+        bool isFloat = false;
+        auto fixedIt = varFixedArrayTypes_.find(access.array);
+        if (fixedIt != varFixedArrayTypes_.end()) {
+            const FixedArrayInfo& info = fixedIt->second;
+            if (!info.elementType.empty() && info.elementType[0] == '[') continue;
+            if (info.elementSize != 1 && info.elementSize != 2 && info.elementSize != 4 && info.elementSize != 8) continue;
+            elementSize = info.elementSize;
+            bias = access.isStore ? 0 : -elementSize;
+            isFloat = isFloatTypeName(info.elementType);
+        }
+        if (step * elementSize < INT32_MIN || step * elementSize > INT32_MAX) continue;
+        
+        auto key = std::make_tuple(access.array, elementSize, bias);
+        auto slotIt = slots.find(key);
+        if (slotIt == slots.end()) {
+            std::string slot = newLabel("$lsr_ptr");
+            allocLocal(slot);
+            
+            // slot = &array[i] for the first iteration
+            emitLoadVarToRax(node.var);
+            asm_.emit(X64Op::LEA, X64Operand::r(X64Reg::RAX), emitElementAddressFromRax(array, elementSize, bias));
+            asm_.mov_mem_rbp_rax(locals[slot]);
+            
+            slotIt = slots.emplace(key, slot).first;
+            pointers.push_back({slot, elementSize, isFloat});
+        }
+        strengthReduced_[access.expr] = {slotIt->second, elementSize, isFloat};
+    }
+    
+    if (!pointers.empty()) loopReducedPointers_[&node] = std::move(pointers);
+}
+
+void NativeCodeGen::bumpStrengthReducedPointers(ForStmt& node, int64_t step) {
+    auto it = loopReducedPointers_.find(&node);
+    if (it == loopReducedPointers_.end()) return;
+    for (auto& pointer : it->second) {
+        asm_.emit(X64Op::ADD, X64Operand::mem(X64Reg::RBP, locals[pointer.pointerSlot]),
+                  X64Operand::immediate(step * pointer.elementSize));
+    }
+}
+
+void NativeCodeGen::endStrengthReduction(ForStmt& node) {
+    loopReducedPointers_.erase(&node);
+    for (auto& access : scanInductionAccesses(node)) {
+        strengthReduced_.erase(access.expr);
+    }
+}
+
 void NativeCodeGen::visit(MatchStmt& node) {
     node.value->accept(*this);
-    allocLocal("$match_val");
+    allocTemp("$match_val");
     asm_.mov_mem_rbp_rax(locals["$match_val"]);
     
     std::string endLabel = newLabel("match_end");
@@ -17,6 +17,10 @@ void NativeCodeGen::visit(Block& node) {
         if (dynamic_cast<FnDecl*>(stmt.get())) {
             continue;
         }
+        // Already emitted ahead of the prologue (emitEntryGuard)
+        if (stmt.get() == hoistedGuard_) {
+            continue;
+        }
         
         // Track variable declarations for drop
         if (auto* varDecl = dynamic_cast<VarDecl*>(stmt.get())) {
@@ -123,7 +127,9 @@ void NativeCodeGen::visit(Block& node) {
             }
         }
         
+        size_t tempMark = frameSlots_.liveTemps.size();
         stmt->accept(*this);
+        releaseTemps(tempMark);
     }
     
     // Emit drop calls for variables in reverse declaration order
@@ -184,17 +190,13 @@ void NativeCodeGen::visit(Block& node) {
             asm_.mov_rcx_rax();
             
             // Call the drop function
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_rel32(dropLabel);
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+            emitCallRelWithOptimizedStack(dropLabel);
         } else if (localIt != locals.end()) {
             // Variable is on stack - load its value (the pointer to the record)
             asm_.mov_rcx_mem_rbp(localIt->second);
             
             // Call the drop function
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_rel32(dropLabel);
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+            emitCallRelWithOptimizedStack(dropLabel);
         }
     }
 }
@@ -235,7 +237,7 @@ void NativeCodeGen::visit(ReturnStmt& node) {
         emitRestoreCalleeSavedRegs();
     } else {
         // Full epilogue with stack cleanup
-        asm_.add_rsp_imm32(functionStackSize_);
+        emitFrameRelease();
         emitRestoreCalleeSavedRegs();
         asm_.pop_rbp();
     }
@@ -295,13 +297,11 @@ void NativeCodeGen::visit(DeleteStmt& node) {
     node.expr->accept(*this);
     asm_.mov_r8_rax();
     
-    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-    asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+    emitCallWithOptimizedStack(pe_.getImportRVA("GetProcessHeap"));
     asm_.mov_rcx_rax();
     asm_.xor_rax_rax();
     asm_.mov_rdx_rax();
-    asm_.call_mem_rip(pe_.getImportRVA("HeapFree"));
-    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+    emitCallWithOptimizedStack(pe_.getImportRVA("HeapFree"));
 }
 
 // Helper to parse a register name and return its encoding
@@ -356,10 +356,123 @@ static std::vector<std::string> split(const std::string& s, char delim) {
     return result;
 }
 
+static uint8_t parseRegisterSize(const std::string& reg) {
+    if (reg.empty()) return 8;
+    if (reg[0] == 'r') {
+        char last = reg.back();
+        if (last == 'd') return 4;
+        if (last == 'w') return 2;
+        if (last == 'b') return 1;
+        return 8;
+    }
+    if (reg[0] == 'e') return 4;
+    if (reg.size() == 3 && reg[2] == 'l') return 1;    // spl, bpl, sil, dil
+    if (reg.size() == 2 && (reg[1] == 'l' || reg[1] == 'h')) return 1;
+    return 2;
+}
+
+static bool parseAsmImmediate(const std::string& text, int64_t& value) {
+    try {
+        bool neg = !text.empty() && text[0] == '-';
+        std::string digits = neg ? trim(text.substr(1)) : text;
+        if (digits.size() > 2 && digits[0] == '0' && digits[1] == 'x') {
+            value = static_cast<int64_t>(std::stoull(digits, nullptr, 16));
+        } else {
+            value = std::stoll(digits);
+        }
+        if (neg) value = -value;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Parses a register, an immediate, or "[base + index*scale + disp]" with an
+// optional "byte/word/dword/qword ptr" size prefix
+static bool parseAsmOperand(const std::string& text, X64Operand& out) {
+    std::string op = trim(text);
+    uint8_t size = 8;
+    static const std::pair<const char*, uint8_t> sizePrefixes[] = {
+        {"byte", 1}, {"word", 2}, {"dword", 4}, {"qword", 8}};
+    for (auto& [prefix, bytes] : sizePrefixes) {
+        std::string p = prefix;
+        if (op.compare(0, p.size(), p) == 0 && op.size() > p.size() && (op[p.size()] == ' ' || op[p.size()] == '[')) {
+            size = bytes;
+            op = trim(op.substr(p.size()));
+            if (op.compare(0, 3, "ptr") == 0) op = trim(op.substr(3));
+            break;
+        }
+    }
+
+    if (!op.empty() && op[0] == '[') {
+        if (op.back() != ']') return false;
+        X64Reg base = X64Reg::NONE, index = X64Reg::NONE;
+        uint8_t scale = 1;
+        int64_t disp = 0;
+        std::string body = op.substr(1, op.size() - 2);
+        // Split on + and -, keeping the sign with each term
+        std::vector<std::string> terms;
+        std::string cur;
+        for (char c : body) {
+            if ((c == '+' || c == '-') && !trim(cur).empty()) {
+                terms.push_back(trim(cur));
+                cur.clear();
+            }
+            if (c != '+') cur += c;
+        }
+        if (!trim(cur).empty()) terms.push_back(trim(cur));
+
+        for (const std::string& term : terms) {
+            size_t star = term.find('*');
+            if (star != std::string::npos) {
+                int reg = parseRegister(trim(term.substr(0, star)));
+                int64_t s = 0;
+                if (reg < 0 || index != X64Reg::NONE || !parseAsmImmediate(trim(term.substr(star + 1)), s)) return false;
+                index = static_cast<X64Reg>(reg);
+                scale = static_cast<uint8_t>(s);
+                continue;
+            }
+            int reg = parseRegister(term);
+            if (reg >= 0) {
+                if (base == X64Reg::NONE) base = static_cast<X64Reg>(reg);
+                else if (index == X64Reg::NONE) index = static_cast<X64Reg>(reg);
+                else return false;
+                continue;
+            }
+            int64_t v = 0;
+            if (!parseAsmImmediate(term, v)) return false;
+            disp += v;
+        }
+        if (disp < INT32_MIN || disp > INT32_MAX) return false;
+        out = X64Operand::mem(base, index, scale, static_cast<int32_t>(disp), size);
+        return true;
+    }
+
+    int reg = parseRegister(op);
+    if (reg >= 0) {
+        out = X64Operand::r(static_cast<X64Reg>(reg), parseRegisterSize(op));
+        return true;
+    }
+    int64_t imm = 0;
+    if (!parseAsmImmediate(op, imm)) return false;
+    out = X64Operand::immediate(imm);
+    return true;
+}
+
 void NativeCodeGen::visit(AsmStmt& node) {
     // Parse and emit inline assembly
     // Split by newlines and process each instruction
     std::vector<std::string> lines = split(node.code, '\n');
+
+    static const std::unordered_map<std::string, X64Op> unaryOps = {
+        {"push", X64Op::PUSH}, {"pop", X64Op::POP}, {"inc", X64Op::INC}, {"dec", X64Op::DEC},
+        {"neg", X64Op::NEG}, {"not", X64Op::NOT}, {"mul", X64Op::MUL}, {"div", X64Op::DIV},
+        {"idiv", X64Op::IDIV}};
+    static const std::unordered_map<std::string, X64Op> binaryOps = {
+        {"mov", X64Op::MOV}, {"movzx", X64Op::MOVZX}, {"movsx", X64Op::MOVSX}, {"lea", X64Op::LEA},
+        {"xchg", X64Op::XCHG}, {"add", X64Op::ADD}, {"sub", X64Op::SUB}, {"and", X64Op::AND},
+        {"or", X64Op::OR}, {"xor", X64Op::XOR}, {"cmp", X64Op::CMP}, {"test", X64Op::TEST},
+        {"imul", X64Op::IMUL}, {"shl", X64Op::SHL}, {"shr", X64Op::SHR}, {"sar", X64Op::SAR}};
     
     for (const std::string& line : lines) {
         std::string instr = trim(line);
@@ -381,197 +494,20 @@ void NativeCodeGen::visit(AsmStmt& node) {
         else if (mnemonic == "nop") {
             asm_.code.push_back(0x90);
         }
-        else if (mnemonic == "push") {
-            int reg = parseRegister(operands);
-            if (reg >= 0) {
-                if (reg >= 8) {
-                    asm_.code.push_back(0x41);
-                    asm_.code.push_back(0x50 + (reg - 8));
-                } else {
-                    asm_.code.push_back(0x50 + reg);
-                }
-            }
-        }
-        else if (mnemonic == "pop") {
-            int reg = parseRegister(operands);
-            if (reg >= 0) {
-                if (reg >= 8) {
-                    asm_.code.push_back(0x41);
-                    asm_.code.push_back(0x58 + (reg - 8));
-                } else {
-                    asm_.code.push_back(0x58 + reg);
-                }
-            }
-        }
-        else if (mnemonic == "mov") {
-            auto parts = split(operands, ',');
-            if (parts.size() == 2) {
-                int dst = parseRegister(parts[0]);
-                int src = parseRegister(parts[1]);
-                
-                if (dst >= 0 && src >= 0) {
-                    // mov reg, reg
-                    uint8_t rex = 0x48;
-                    if (dst >= 8) rex |= 0x01;  // REX.B
-                    if (src >= 8) rex |= 0x04;  // REX.R
-                    asm_.code.push_back(rex);
-                    asm_.code.push_back(0x89);
-                    asm_.code.push_back(0xC0 | ((src & 7) << 3) | (dst & 7));
-                }
-                else if (dst >= 0) {
-                    // mov reg, imm
-                    int64_t imm = 0;
-                    try {
-                        if (parts[1].size() > 2 && parts[1][0] == '0' && parts[1][1] == 'x') {
-                            imm = std::stoll(parts[1], nullptr, 16);
-                        } else {
-                            imm = std::stoll(parts[1]);
-                        }
-                    } catch (...) {
-                        continue;  // Skip invalid immediate
-                    }
-                    
-                    // mov r64, imm64
-                    uint8_t rex = 0x48;
-                    if (dst >= 8) rex |= 0x01;
-                    asm_.code.push_back(rex);
-                    asm_.code.push_back(0xB8 + (dst & 7));
-                    for (int i = 0; i < 8; i++) {
-                        asm_.code.push_back((imm >> (i * 8)) & 0xFF);
-                    }
-                }
-            }
-        }
-        else if (mnemonic == "xor") {
-            auto parts = split(operands, ',');
-            if (parts.size() == 2) {
-                int dst = parseRegister(parts[0]);
-                int src = parseRegister(parts[1]);
-                if (dst >= 0 && src >= 0) {
-                    uint8_t rex = 0x48;
-                    if (dst >= 8) rex |= 0x01;
-                    if (src >= 8) rex |= 0x04;
-                    asm_.code.push_back(rex);
-                    asm_.code.push_back(0x31);
-                    asm_.code.push_back(0xC0 | ((src & 7) << 3) | (dst & 7));
-                }
+        else if (unaryOps.count(mnemonic)) {
+            X64Operand dst;
+            if (parseAsmOperand(operands, dst) && !dst.isImm()) {
+                asm_.emit(unaryOps.at(mnemonic), dst);
             }
         }
-        else if (mnemonic == "add") {
+        else if (binaryOps.count(mnemonic)) {
             auto parts = split(operands, ',');
-            if (parts.size() == 2) {
-                int dst = parseRegister(parts[0]);
-                int src = parseRegister(parts[1]);
-                if (dst >= 0 && src >= 0) {
-                    uint8_t rex = 0x48;
-                    if (dst >= 8) rex |= 0x01;
-                    if (src >= 8) rex |= 0x04;
-                    asm_.code.push_back(rex);
-                    asm_.code.push_back(0x01);
-                    asm_.code.push_back(0xC0 | ((src & 7) << 3) | (dst & 7));
-                }
-                else if (dst >= 0) {
-                    // add reg, imm
-                    int64_t imm = 0;
-                    try {
-                        if (parts[1].size() > 2 && parts[1][0] == '0' && parts[1][1] == 'x') {
-                            imm = std::stoll(parts[1], nullptr, 16);
-                        } else {
-                            imm = std::stoll(parts[1]);
-                        }
-                    } catch (...) { continue; }
-                    
-                    uint8_t rex = 0x48;
-                    if (dst >= 8) rex |= 0x01;
-                    asm_.code.push_back(rex);
-                    if (imm >= -128 && imm <= 127) {
-                        asm_.code.push_back(0x83);
-                        asm_.code.push_back(0xC0 | (dst & 7));
-                        asm_.code.push_back((int8_t)imm);
-                    } else {
-                        asm_.code.push_back(0x81);
-                        asm_.code.push_back(0xC0 | (dst & 7));
-                        for (int i = 0; i < 4; i++) {
-                            asm_.code.push_back((imm >> (i * 8)) & 0xFF);
-                        }
-                    }
-                }
-            }
-        }
-        else if (mnemonic == "sub") {
-            auto parts = split(operands, ',');
-            if (parts.size() == 2) {
-                int dst = parseRegister(parts[0]);
-                int src = parseRegister(parts[1]);
-                if (dst >= 0 && src >= 0) {
-                    uint8_t rex = 0x48;
-                    if (dst >= 8) rex |= 0x01;
-                    if (src >= 8) rex |= 0x04;
-                    asm_.code.push_back(rex);
-                    asm_.code.push_back(0x29);
-                    asm_.code.push_back(0xC0 | ((src & 7) << 3) | (dst & 7));
-                }
-                else if (dst >= 0) {
-                    int64_t imm = 0;
-                    try {
-                        if (parts[1].size() > 2 && parts[1][0] == '0' && parts[1][1] == 'x') {
-                            imm = std::stoll(parts[1], nullptr, 16);
-                        } else {
-                            imm = std::stoll(parts[1]);
-                        }
-                    } catch (...) { continue; }
-                    
-                    uint8_t rex = 0x48;
-                    if (dst >= 8) rex |= 0x01;
-                    asm_.code.push_back(rex);
-                    if (imm >= -128 && imm <= 127) {
-                        asm_.code.push_back(0x83);
-                        asm_.code.push_back(0xE8 | (dst & 7));
-                        asm_.code.push_back((int8_t)imm);
-                    } else {
-                        asm_.code.push_back(0x81);
-                        asm_.code.push_back(0xE8 | (dst & 7));
-                        for (int i = 0; i < 4; i++) {
-                            asm_.code.push_back((imm >> (i * 8)) & 0xFF);
-                        }
-                    }
-                }
-            }
-        }
-        else if (mnemonic == "inc") {
-            int reg = parseRegister(operands);
-            if (reg >= 0) {
-                uint8_t rex = 0x48;
-                if (reg >= 8) rex |= 0x01;
-                asm_.code.push_back(rex);
-                asm_.code.push_back(0xFF);
-                asm_.code.push_back(0xC0 | (reg & 7));
-            }
-        }
-        else if (mnemonic == "dec") {
-            int reg = parseRegister(operands);
-            if (reg >= 0) {
-                uint8_t rex = 0x48;
-                if (reg >= 8) rex |= 0x01;
-                asm_.code.push_back(rex);
-                asm_.code.push_back(0xFF);
-                asm_.code.push_back(0xC8 | (reg & 7));
-            }
-        }
-        else if (mnemonic == "imul") {
-            auto parts = split(operands, ',');
-            if (parts.size() == 2) {
-                int dst = parseRegister(parts[0]);
-                int src = parseRegister(parts[1]);
-                if (dst >= 0 && src >= 0) {
-                    uint8_t rex = 0x48;
-                    if (src >= 8) rex |= 0x01;
-                    if (dst >= 8) rex |= 0x04;
-                    asm_.code.push_back(rex);
-                    asm_.code.push_back(0x0F);
-                    asm_.code.push_back(0xAF);
-                    asm_.code.push_back(0xC0 | ((dst & 7) << 3) | (src & 7));
-                }
+            X64Operand dst, src;
+            if (parts.size() == 2 && parseAsmOperand(parts[0], dst) && parseAsmOperand(parts[1], src)) {
+                // Memory operands without a size prefix take the register's size
+                if (dst.isMem() && src.isReg()) dst.size = src.size;
+                if (src.isMem() && dst.isReg() && mnemonic != "movzx" && mnemonic != "movsx") src.size = dst.size;
+                asm_.emit(binaryOps.at(mnemonic), dst, src);
             }
         }
         else if (mnemonic == "syscall") {
@@ -666,9 +602,7 @@ void NativeCodeGen::visit(WithStmt& node) {
             // Call TypeName_close(resource)
             asm_.mov_rax_mem_rbp(resourceOffset);
             asm_.mov_rcx_rax();  // First arg = self
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_rel32(closeMethod);
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+            emitCallRelWithOptimizedStack(closeMethod);
             cleanupEmitted = true;
         }
         
@@ -677,9 +611,7 @@ void NativeCodeGen::visit(WithStmt& node) {
         if (asm_.labels.count(delMethod)) {
             asm_.mov_rax_mem_rbp(resourceOffset);
             asm_.mov_rcx_rax();  // First arg = self
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_rel32(delMethod);
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+            emitCallRelWithOptimizedStack(delMethod);
             cleanupEmitted = true;
         }
         
@@ -688,9 +620,7 @@ void NativeCodeGen::visit(WithStmt& node) {
         if (asm_.labels.count(dropMethod)) {
             asm_.mov_rax_mem_rbp(resourceOffset);
             asm_.mov_rcx_rax();  // First arg = self
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_rel32(dropMethod);
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+            emitCallRelWithOptimizedStack(dropMethod);
             cleanupEmitted = true;
         }
         
@@ -699,9 +629,7 @@ void NativeCodeGen::visit(WithStmt& node) {
         if (asm_.labels.count(disposeMethod)) {
             asm_.mov_rax_mem_rbp(resourceOffset);
             asm_.mov_rcx_rax();  // First arg = self
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_rel32(disposeMethod);
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+            emitCallRelWithOptimizedStack(disposeMethod);
             cleanupEmitted = true;
         }
     }
@@ -715,9 +643,7 @@ void NativeCodeGen::visit(WithStmt& node) {
                     // This is a file handle, call CloseHandle
                     asm_.mov_rax_mem_rbp(resourceOffset);
                     asm_.mov_rcx_rax();  // Handle
-                    if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-                    asm_.call_mem_rip(pe_.getImportRVA("CloseHandle"));
-                    if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
+                    emitCallWithOptimizedStack(pe_.getImportRVA("CloseHandle"));
                 }
             }
         }
@@ -1291,7 +1217,7 @@ void NativeCodeGen::visit(HandleExpr& node) {
     }
     
     // Allocate space for the result
-    allocLocal("$handle_result");
+    allocTemp("$handle_result");
     
     // Evaluate the main expression - this is where perform calls will dispatch to handlers
     node.expr->accept(*this);
@@ -1343,6 +1269,8 @@ void NativeCodeGen::visit(HandleExpr& node) {
             // Save current locals and create handler-local scope
             auto savedLocals = locals;
             auto savedStackOffset = stackOffset;
+            FrameSlots savedFrameSlots = std::move(frameSlots_);
+            frameSlots_ = FrameSlots();
             
             // Set up parameter names in the handler's local scope
             stackOffset = -8;
@@ -1355,6 +1283,7 @@ void NativeCodeGen::visit(HandleExpr& node) {
             // Restore locals
             locals = savedLocals;
             stackOffset = savedStackOffset;
+            frameSlots_ = std::move(savedFrameSlots);
         }
         
         // Result is in RAX - clean up and return
@@ -6,7 +6,15 @@
 
 namespace tyl {
 
+// The variable's own slot is entered in the frame map with the kind its
+// declaration implies
 void NativeCodeGen::visit(VarDecl& node) {
+    beginGCSlotDecl(node.name, gcSlotKindFor(node));
+    emitVarDecl(node);
+    beginGCSlotDecl("", GC_SLOT_CONSERVATIVE);
+}
+
+void NativeCodeGen::emitVarDecl(VarDecl& node) {
     if (node.initializer) {
         // For compile-time constants (NAME :: value), only store in constVars
         // and skip code generation - they will be inlined at use sites
@@ -691,15 +699,13 @@ void NativeCodeGen::emitUninitializedVarDecl(VarDecl& node) {
         varRecordTypes_[node.name] = node.typeName;
         size_t recordSize = static_cast<size_t>(getRecordSize(node.typeName));
         
-        if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
         
-        asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+        emitCallWithOptimizedStack(pe_.getImportRVA("GetProcessHeap"));
         asm_.mov_rcx_rax();
         asm_.mov_rdx_imm64(0x08);
         asm_.mov_r8_imm64(recordSize);
-        asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
+        emitCallWithOptimizedStack(pe_.getImportRVA("HeapAlloc"));
         
-        if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
         
         auto regIt = varRegisters_.find(node.name);
         if (regIt != varRegisters_.end() && regIt->second != VarRegister::NONE) {
@@ -796,15 +802,13 @@ void NativeCodeGen::emitFixedArrayDecl(VarDecl& node) {
         int32_t storageElemSize = isNestedArray ? 8 : elemSize;  // Pointers are 8 bytes
         int32_t actualArraySize = storageElemSize * static_cast<int32_t>(arrayCount);
         
-        if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
         
-        asm_.call_mem_rip(pe_.getImportRVA("GetProcessHeap"));
+        emitCallWithOptimizedStack(pe_.getImportRVA("GetProcessHeap"));
         asm_.mov_rcx_rax();
         asm_.mov_rdx_imm64(0x08);
         asm_.mov_r8_imm64(static_cast<size_t>(actualArraySize));
-        asm_.call_mem_rip(pe_.getImportRVA("HeapAlloc"));
+        emitCallWithOptimizedStack(pe_.getImportRVA("HeapAlloc"));
         
-        if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
         
         // Store array pointer
         allocLocal(node.name);
@@ -840,6 +844,7 @@ void NativeCodeGen::emitFixedArrayDecl(VarDecl& node) {
                         asm_.code.push_back(0x08);  // mov [rax], ecx
                     } else {
                         asm_.mov_mem_rax_rcx();  // mov [rax], rcx
+                        emitWriteBarrier(X64Reg::RAX, X64Reg::RCX);
                     }
                 }
             }
@@ -855,6 +860,27 @@ void NativeCodeGen::emitRefinementCheck(const RefinementTypeInfo& info, SourceLo
     // Save the value
     asm_.push_rax();
     
+    // Branch to the out-of-line failure path when the comparison (already
+    // flagged by cmp rax, rcx) does not hold. False for unknown operators.
+    auto emitFailBranch = [&](TokenType op) {
+        X64Cond failCond;
+        switch (op) {
+            case TokenType::GT: failCond = X64Cond::LE; break;
+            case TokenType::GE: failCond = X64Cond::L; break;
+            case TokenType::LT: failCond = X64Cond::GE; break;
+            case TokenType::LE: failCond = X64Cond::G; break;
+            case TokenType::EQ: failCond = X64Cond::NE; break;
+            case TokenType::NE: failCond = X64Cond::E; break;
+            default: return false;
+        }
+        std::string errorMsg = "Refinement type constraint failed for type '" + info.name + "'\n";
+        std::string failLabel = deferColdBlock("refine_fail", [this, errorMsg]() {
+            emitFatalError(errorMsg);
+        });
+        asm_.jcc(failCond, failLabel);
+        return true;
+    };
+    
     // The constraint expression uses PlaceholderExpr (_) to refer to the value
     // We need to evaluate it with RAX as the placeholder value
     // For now, we'll handle simple comparisons: _ > 0, _ >= 0, _ < N, etc.
@@ -873,71 +899,7 @@ void NativeCodeGen::emitRefinementCheck(const RefinementTypeInfo& info, SourceLo
             
             // Compare RAX with RCX
             asm_.cmp_rax_rcx();
-            
-            // Generate appropriate jump based on operator
-            std::string passLabel = newLabel("refine_pass");
-            std::string failLabel = newLabel("refine_fail");
-            
-            switch (binary->op) {
-                case TokenType::GT:
-                    asm_.jg_rel32(passLabel);
-                    break;
-                case TokenType::GE:
-                    asm_.jge_rel32(passLabel);
-                    break;
-                case TokenType::LT:
-                    asm_.jl_rel32(passLabel);
-                    break;
-                case TokenType::LE:
-                    asm_.jle_rel32(passLabel);
-                    break;
-                case TokenType::EQ:
-                    asm_.jz_rel32(passLabel);
-                    break;
-                case TokenType::NE:
-                    asm_.jnz_rel32(passLabel);
-                    break;
-                default:
-                    // Unknown operator, skip check
-                    asm_.pop_rax();
-                    return;
-            }
-            
-            // Fail path - print error and exit
-            asm_.label(failLabel);
-            
-            // Print error message
-            std::string errorMsg = "Refinement type constraint failed for type '" + info.name + "'\n";
-            uint32_t errorRVA = addString(errorMsg);
-            
-            // Get stdout handle
-            asm_.mov_rcx_imm64(static_cast<uint64_t>(-11));  // STD_OUTPUT_HANDLE
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_mem_rip(pe_.getImportRVA("GetStdHandle"));
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
-            asm_.mov_rcx_rax();  // Handle in RCX
-            
-            // Write error message
-            asm_.lea_rax_rip_fixup(errorRVA);
-            asm_.mov_rdx_rax();
-            asm_.mov_r8_imm64(errorMsg.size());
-            asm_.xor_r9_r9();  // lpNumberOfCharsWritten = NULL
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            // Push 5th arg (lpReserved = NULL)
-            asm_.code.push_back(0x48); asm_.code.push_back(0xC7);
-            asm_.code.push_back(0x44); asm_.code.push_back(0x24);
-            asm_.code.push_back(0x20); // [rsp+0x20]
-            asm_.code.push_back(0x00); asm_.code.push_back(0x00);
-            asm_.code.push_back(0x00); asm_.code.push_back(0x00);
-            asm_.call_mem_rip(pe_.getImportRVA("WriteConsoleA"));
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
-            
-            // Exit with error code 1
-            asm_.mov_rcx_imm64(1);
-            asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
-            
-            // Pass path - restore value and continue
-            asm_.label(passLabel);
+            emitFailBranch(binary->op);
             asm_.pop_rax();
             
         } else if (!leftIsPlaceholder && rightIsPlaceholder) {
@@ -950,61 +912,7 @@ void NativeCodeGen::emitRefinementCheck(const RefinementTypeInfo& info, SourceLo
             
             // Compare RAX with RCX
             asm_.cmp_rax_rcx();
-            
-            std::string passLabel = newLabel("refine_pass");
-            std::string failLabel = newLabel("refine_fail");
-            
-            switch (binary->op) {
-                case TokenType::GT:
-                    asm_.jg_rel32(passLabel);
-                    break;
-                case TokenType::GE:
-                    asm_.jge_rel32(passLabel);
-                    break;
-                case TokenType::LT:
-                    asm_.jl_rel32(passLabel);
-                    break;
-                case TokenType::LE:
-                    asm_.jle_rel32(passLabel);
-                    break;
-                case TokenType::EQ:
-                    asm_.jz_rel32(passLabel);
-                    break;
-                case TokenType::NE:
-                    asm_.jnz_rel32(passLabel);
-                    break;
-                default:
-                    asm_.pop_rax();
-                    return;
-            }
-            
-            // Fail path
-            asm_.label(failLabel);
-            std::string errorMsg = "Refinement type constraint failed for type '" + info.name + "'\n";
-            uint32_t errorRVA = addString(errorMsg);
-            
-            asm_.mov_rcx_imm64(static_cast<uint64_t>(-11));
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.call_mem_rip(pe_.getImportRVA("GetStdHandle"));
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
-            asm_.mov_rcx_rax();
-            asm_.lea_rax_rip_fixup(errorRVA);
-            asm_.mov_rdx_rax();
-            asm_.mov_r8_imm64(errorMsg.size());
-            asm_.xor_r9_r9();
-            if (!stackAllocated_) asm_.sub_rsp_imm32(0x28);
-            asm_.code.push_back(0x48); asm_.code.push_back(0xC7);
-            asm_.code.push_back(0x44); asm_.code.push_back(0x24);
-            asm_.code.push_back(0x20);
-            asm_.code.push_back(0x00); asm_.code.push_back(0x00);
-            asm_.code.push_back(0x00); asm_.code.push_back(0x00);
-            asm_.call_mem_rip(pe_.getImportRVA("WriteConsoleA"));
-            if (!stackAllocated_) asm_.add_rsp_imm32(0x28);
-            
-            asm_.mov_rcx_imm64(1);
-            asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
-            
-            asm_.label(passLabel);
+            emitFailBranch(binary->op);
             asm_.pop_rax();
         } else {
             // Both or neither are placeholders - not supported yet
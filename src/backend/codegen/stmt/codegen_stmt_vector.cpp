@@ -0,0 +1,522 @@
+// Tyl Compiler - Native Code Generator Loop Vectorization
+// Handles: packed SSE/AVX2 main loops for range loops recognized by the Vectorizer
+//
+// A range loop whose body is a reduction or an elementwise store gets a
+// packed main loop in front of the scalar loop. The packed loop advances
+// the induction variable past the elements it handled, so the unchanged
+// scalar loop serves both as the epilogue for the remainder and as the
+// fallback when the trip count is too small or the arrays overlap.
+//
+// -march=x86-64-v3 gets 256-bit AVX2 loops only. Below that each loop is
+// emitted twice, AVX2 and 128-bit SSE, and the flag set by the startup
+// cpuid probe picks one; x86-64-v2 lets the SSE version use pcmpgtq and
+// pmulld.
+//
+// Register use inside the packed loop (no calls are made):
+//   rax = i, rdx = bytes handled by the packed loop, r11 = byte offset
+//   r8 = &store[i], r9 = &lhs[i], r10 = &rhs[i]
+//   xmm0 = accumulator, xmm1/xmm2 = operands, xmm3/xmm4 = scratch,
+//   xmm5 = broadcast loop-invariant operand or sign mask
+//   (ymm registers in the AVX2 version)
+
+#include "backend/codegen/codegen_base.h"
+
+namespace tyl {
+
+// Element layout of arr[i] as the scalar paths address it
+bool NativeCodeGen::getVectorArray(Expression* access, bool isStore, VectorLane& lane, int32_t& bias, X64Operand& base) {
+    auto* index = dynamic_cast<IndexExpr*>(access);
+    auto* array = index ? dynamic_cast<Identifier*>(index->object.get()) : nullptr;
+    if (!array || constListVars.count(array->name)) return false;
+    if (!getSimpleVarOperand(array, base)) return false;
+
+    auto fixedIt = varFixedArrayTypes_.find(array->name);
+    if (fixedIt != varFixedArrayTypes_.end()) {
+        const FixedArrayInfo& info = fixedIt->second;
+        if (!info.elementType.empty() && info.elementType[0] == '[') return false;
+        bool isFloat = isFloatTypeName(info.elementType);
+        if (info.elementSize == 8) lane = {8, isFloat};
+        else if (info.elementSize == 4 && !isFloat) lane = {4, false};
+        else return false;
+        // Fixed arrays are read 1-based and stored 0-based
+        bias = isStore ? 0 : -info.elementSize;
+        return true;
+    }
+
+    // Everything else indexed by an int goes through the runtime list path:
+    // 1-based behind a 16-byte header, int64 elements
+    lane = {8, false};
+    bias = 16 - 8;
+    return true;
+}
+
+void NativeCodeGen::emitVectorizedLoop(ForStmt& node, bool inclusive, VarRegister loopVarReg) {
+    if (optLevel_ != CodeGenOptLevel::O3 && optLevel_ != CodeGenOptLevel::Ofast) return;
+    const VectorizableLoop* info = vectorizer_.getLoop(&node);
+    if (!info || !info->isVectorizable) return;
+
+    bool isReduction = info->kind == VectorLoopKind::REDUCTION;
+
+    // ---- Classify the operands; nothing is emitted until the loop qualifies ----
+    struct ArrayOperand {
+        Expression* expr = nullptr;
+        std::string name;
+        X64Operand base;
+        int32_t bias = 0;
+        X64Reg pointer = X64Reg::NONE;
+    };
+    std::vector<ArrayOperand> arrays;
+    VectorLane lane{0, false};
+
+    auto addArray = [&](Expression* expr, bool isStore, X64Reg pointer) {
+        VectorLane l;
+        ArrayOperand a;
+        if (!getVectorArray(expr, isStore, l, a.bias, a.base)) return false;
+        if (lane.elementSize && (l.elementSize != lane.elementSize || l.isFloat != lane.isFloat)) return false;
+        lane = l;
+        a.expr = expr;
+        a.name = static_cast<Identifier*>(static_cast<IndexExpr*>(expr)->object.get())->name;
+        a.pointer = pointer;
+        arrays.push_back(a);
+        return true;
+    };
+    auto isAccess = [](Expression* e) { return dynamic_cast<IndexExpr*>(e) != nullptr; };
+
+    if (info->store && !addArray(info->store, true, X64Reg::R8)) return;
+    if (isAccess(info->lhs) && !addArray(info->lhs, false, X64Reg::R9)) return;
+    if (info->rhs && isAccess(info->rhs) && !addArray(info->rhs, false, X64Reg::R10)) return;
+
+    Expression* scalar = nullptr;
+    if (!isAccess(info->lhs)) scalar = info->lhs;
+    else if (info->rhs && !isAccess(info->rhs)) scalar = info->rhs;
+
+    // Operators per lane type; an int32 multiply needs pmulld (SSE4.1), which
+    // the baseline SSE version cannot use
+    TokenType op = info->elementOp;
+    bool hasOp = info->rhs != nullptr;
+    if (hasOp) {
+        bool bitwise = op == TokenType::AMP || op == TokenType::PIPE || op == TokenType::CARET;
+        if (lane.isFloat && bitwise) return;
+        if (!lane.isFloat && op == TokenType::SLASH) return;
+        if (lane.elementSize == 4 && op == TokenType::STAR && targetISA_ == TargetISA::X86_64) return;
+    }
+
+    // The scalar loop decides float vs int arithmetic with isFloatExpression;
+    // the packed loop has to agree with it
+    if (scalar) {
+        if (auto* id = dynamic_cast<Identifier*>(scalar)) {
+            if (listVars.count(id->name) || varFixedArrayTypes_.count(id->name) ||
+                asm_.labels.count(id->name) || allFunctionNames_.count(id->name)) {
+                return;
+            }
+        }
+        if (!lane.isFloat && isFloatExpression(scalar)) return;
+        // a[i] = k stores k's bits unconverted; only a float k fills f64 lanes
+        if (lane.isFloat && !hasOp && !isFloatExpression(scalar)) return;
+    }
+
+    X64Operand accumulator;
+    TokenType reduction = info->reductionOp;
+    if (isReduction) {
+        if (lane.elementSize != 8) return;
+        if (!getSimpleVarOperand(info->accumulator, accumulator, true)) return;
+        if (isFloatExpression(info->accumulator) != lane.isFloat) return;
+        if (lane.isFloat) {
+            // Reassociating a float reduction changes rounding: -Ofast only
+            if (optLevel_ != CodeGenOptLevel::Ofast) return;
+            if (reduction == TokenType::LT || reduction == TokenType::GT) return;
+        }
+    }
+
+    // A store into an array read at the same index: lists address both the
+    // same way (in place, safe); fixed arrays read element i-1 and store
+    // element i, a loop-carried dependence
+    if (info->store) {
+        for (size_t k = 1; k < arrays.size(); k++) {
+            if (arrays[k].name == arrays[0].name && arrays[k].bias != arrays[0].bias) return;
+        }
+    }
+
+    // ---- Emit ----
+    int32_t es = lane.elementSize;
+    uint8_t shift = es == 8 ? 3 : 2;
+    bool isMinMax = reduction == TokenType::LT || reduction == TokenType::GT;
+    auto gpr = [](X64Reg r) { return X64Operand::r(r); };
+    auto imm = [](int64_t v) { return X64Operand::immediate(v); };
+
+    std::string skipLabel = newLabel("vec_skip");
+
+    // Loop-invariant operand into lane 0 of xmm5; each version broadcasts it
+    if (scalar) {
+        double floatVal;
+        int64_t intVal;
+        if (lane.isFloat && hasOp && tryEvalConstantFloat(scalar, floatVal)) {
+            union { double d; int64_t i; } u;
+            u.d = floatVal;
+            asm_.mov_rax_imm64(u.i);
+        } else if (!lane.isFloat && tryEvalConstant(scalar, intVal)) {
+            asm_.mov_rax_imm64(intVal);
+        } else {
+            scalar->accept(*this);
+            if (lane.isFloat && hasOp && !lastExprWasFloat_) {
+                asm_.cvtsi2sd_xmm0_rax();
+                asm_.movq_rax_xmm0();
+            }
+        }
+        asm_.emit(es == 4 ? X64Op::MOVD : X64Op::MOVQ, X64Operand::r(X64Reg::XMM5), X64Operand::r(X64Reg::RAX, es));
+    }
+
+    // One packed loop over 16-byte (SSE) or 32-byte (AVX2) registers
+    auto emitVersion = [&](uint8_t vectorBytes) {
+        bool wide = vectorBytes == 32;
+        int32_t lanes = vectorBytes / es;
+        auto v = [&](X64Reg r) { return X64Operand::r(r, vectorBytes); };
+        auto x = [](X64Reg r) { return X64Operand::r(r); };
+        auto vecMem = [&](X64Reg base) { return X64Operand::mem(base, X64Reg::R11, 1, 0, vectorBytes); };
+        // dst = dst op src: destructive SSE form or non-destructive VEX form
+        auto packed = [&](X64Op sse, X64Op avx, X64Reg dst, X64Reg src) {
+            if (wide) asm_.emit(avx, v(dst), v(dst), v(src));
+            else asm_.emit(sse, v(dst), v(src));
+        };
+        auto broadcast64 = [&](X64Reg r) {
+            if (wide) asm_.emit(X64Op::VPBROADCASTQ, v(r), x(r));
+            else asm_.emit(X64Op::PSHUFD, v(r), v(r), imm(0x44));
+        };
+        X64Op load = lane.isFloat ? (wide ? X64Op::VMOVUPD : X64Op::MOVUPD) : (wide ? X64Op::VMOVDQU : X64Op::MOVDQU);
+        X64Op copy = lane.isFloat ? (wide ? X64Op::VMOVAPD : X64Op::MOVAPD) : (wide ? X64Op::VMOVDQA : X64Op::MOVDQA);
+        std::string loopLabel = newLabel("vec_loop");
+
+        if (scalar) {
+            if (es == 8) broadcast64(X64Reg::XMM5);
+            else if (wide) asm_.emit(X64Op::VPBROADCASTD, v(X64Reg::XMM5), x(X64Reg::XMM5));
+            else asm_.emit(X64Op::PSHUFD, v(X64Reg::XMM5), v(X64Reg::XMM5), imm(0x00));
+        }
+
+        // rdx = elements left, rounded down to whole vectors, in bytes
+        if (loopVarReg != VarRegister::NONE) {
+            emitLoadVarToRax(node.var);
+        } else {
+            asm_.mov_rax_mem_rbp(locals[node.var]);
+        }
+        asm_.emit(X64Op::MOV, gpr(X64Reg::RDX), X64Operand::mem(X64Reg::RBP, locals["$end"]));
+        asm_.emit(X64Op::SUB, gpr(X64Reg::RDX), gpr(X64Reg::RAX));
+        if (inclusive) asm_.emit(X64Op::ADD, gpr(X64Reg::RDX), imm(1));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::RDX), imm(lanes));
+        asm_.jcc(X64Cond::L, skipLabel);
+        asm_.emit(X64Op::AND, gpr(X64Reg::RDX), imm(-lanes));
+        asm_.emit(X64Op::SHL, gpr(X64Reg::RDX), imm(shift));
+
+        // Element pointers for the first packed iteration
+        for (auto& a : arrays) {
+            asm_.emit(X64Op::MOV, gpr(a.pointer), a.base);
+            asm_.emit(X64Op::LEA, gpr(a.pointer), X64Operand::mem(a.pointer, X64Reg::RAX, static_cast<uint8_t>(es), a.bias));
+        }
+
+        // Runtime alias check: a source starting less than one vector below
+        // the store would be read by the packed loop before the scalar order
+        // writes it
+        if (info->store) {
+            for (size_t k = 1; k < arrays.size(); k++) {
+                if (arrays[k].name == arrays[0].name) continue;
+                asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), gpr(X64Reg::R8));
+                asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), gpr(arrays[k].pointer));
+                asm_.emit(X64Op::SUB, gpr(X64Reg::RCX), imm(1));
+                asm_.emit(X64Op::CMP, gpr(X64Reg::RCX), imm(vectorBytes - 1));
+                asm_.jcc(X64Cond::B, skipLabel);
+            }
+        }
+
+        // Accumulator identity (or the current value for min/max)
+        if (isReduction) {
+            if (isMinMax) {
+                asm_.emit(X64Op::MOVQ, x(X64Reg::XMM0), accumulator);
+                broadcast64(X64Reg::XMM0);
+                if (!wide && targetISA_ == TargetISA::X86_64) {
+                    // xmm5 = 0x0000000080000000 per lane, flips the low dword's sign
+                    asm_.emit(X64Op::PCMPEQD, x(X64Reg::XMM5), x(X64Reg::XMM5));
+                    asm_.emit(X64Op::PSLLQ, x(X64Reg::XMM5), imm(63));
+                    asm_.emit(X64Op::PSRLQ, x(X64Reg::XMM5), imm(32));
+                }
+            } else if (reduction == TokenType::STAR) {
+                union { double d; int64_t i; } one;
+                one.d = 1.0;
+                asm_.emit(X64Op::MOV, gpr(X64Reg::RCX), imm(lane.isFloat ? one.i : 1));
+                asm_.emit(X64Op::MOVQ, x(X64Reg::XMM0), gpr(X64Reg::RCX));
+                broadcast64(X64Reg::XMM0);
+            } else {
+                packed(X64Op::PXOR, X64Op::VPXOR, X64Reg::XMM0, X64Reg::XMM0);
+            }
+        }
+
+        // acc = acc op xmm1 per lane
+        auto accumulate = [&](TokenType red) {
+            switch (red) {
+                case TokenType::PLUS:
+                    if (lane.isFloat) packed(X64Op::ADDPD, X64Op::VADDPD, X64Reg::XMM0, X64Reg::XMM1);
+                    else packed(X64Op::PADDQ, X64Op::VPADDQ, X64Reg::XMM0, X64Reg::XMM1);
+                    break;
+                case TokenType::MINUS:
+                    if (lane.isFloat) packed(X64Op::SUBPD, X64Op::VSUBPD, X64Reg::XMM0, X64Reg::XMM1);
+                    else packed(X64Op::PSUBQ, X64Op::VPSUBQ, X64Reg::XMM0, X64Reg::XMM1);
+                    break;
+                case TokenType::STAR:
+                    if (lane.isFloat) packed(X64Op::MULPD, X64Op::VMULPD, X64Reg::XMM0, X64Reg::XMM1);
+                    else emitPackedMul64(X64Reg::XMM0, X64Reg::XMM1, vectorBytes);
+                    break;
+                case TokenType::LT: emitPackedMinMax64(X64Reg::XMM0, X64Reg::XMM1, true, vectorBytes); break;
+                case TokenType::GT: emitPackedMinMax64(X64Reg::XMM0, X64Reg::XMM1, false, vectorBytes); break;
+                default: break;
+            }
+        };
+
+        // ---- Packed main loop ----
+        asm_.emit(X64Op::XOR, X64Operand::r(X64Reg::R11, 4), X64Operand::r(X64Reg::R11, 4));
+        asm_.label(loopLabel);
+
+        auto loadOperand = [&](Expression* expr, X64Reg dst, X64Reg pointer) {
+            if (isAccess(expr)) asm_.emit(load, v(dst), vecMem(pointer));
+            else asm_.emit(copy, v(dst), v(X64Reg::XMM5));
+        };
+        // s += a[i] * b[i] on f64 lanes: one fused multiply-add (AVX2 versions imply FMA)
+        bool fused = wide && isReduction && lane.isFloat && reduction == TokenType::PLUS &&
+                     hasOp && op == TokenType::STAR;
+        loadOperand(info->lhs, X64Reg::XMM1, X64Reg::R9);
+        if (hasOp) loadOperand(info->rhs, X64Reg::XMM2, X64Reg::R10);
+        if (hasOp && !fused) {
+            X64Reg x1 = X64Reg::XMM1, x2 = X64Reg::XMM2;
+            switch (op) {
+                case TokenType::PLUS:
+                    if (lane.isFloat) packed(X64Op::ADDPD, X64Op::VADDPD, x1, x2);
+                    else if (es == 8) packed(X64Op::PADDQ, X64Op::VPADDQ, x1, x2);
+                    else packed(X64Op::PADDD, X64Op::VPADDD, x1, x2);
+                    break;
+                case TokenType::MINUS:
+                    if (lane.isFloat) packed(X64Op::SUBPD, X64Op::VSUBPD, x1, x2);
+                    else if (es == 8) packed(X64Op::PSUBQ, X64Op::VPSUBQ, x1, x2);
+                    else packed(X64Op::PSUBD, X64Op::VPSUBD, x1, x2);
+                    break;
+                case TokenType::STAR:
+                    if (lane.isFloat) packed(X64Op::MULPD, X64Op::VMULPD, x1, x2);
+                    else if (es == 8) emitPackedMul64(x1, x2, vectorBytes);
+                    else packed(X64Op::PMULLD, X64Op::VPMULLD, x1, x2);
+                    break;
+                case TokenType::SLASH: packed(X64Op::DIVPD, X64Op::VDIVPD, x1, x2); break;
+                case TokenType::AMP:   packed(X64Op::PAND, X64Op::VPAND, x1, x2); break;
+                case TokenType::PIPE:  packed(X64Op::POR, X64Op::VPOR, x1, x2); break;
+                case TokenType::CARET: packed(X64Op::PXOR, X64Op::VPXOR, x1, x2); break;
+                default: break;
+            }
+        }
+
+        if (fused) {
+            asm_.emit(X64Op::VFMADD231PD, v(X64Reg::XMM0), v(X64Reg::XMM1), v(X64Reg::XMM2));
+        } else if (isReduction) {
+            accumulate(reduction);
+        } else {
+            X64Op storeOp = lane.isFloat ? (wide ? X64Op::VMOVUPD : X64Op::MOVUPD) : (wide ? X64Op::VMOVDQU : X64Op::MOVDQU);
+            asm_.emit(storeOp, vecMem(X64Reg::R8), v(X64Reg::XMM1));
+        }
+
+        asm_.emit(X64Op::ADD, gpr(X64Reg::R11), imm(vectorBytes));
+        asm_.emit(X64Op::CMP, gpr(X64Reg::R11), gpr(X64Reg::RDX));
+        asm_.jcc(X64Cond::B, loopLabel);
+
+        // ---- Fold the lanes into the reduction variable ----
+        if (isReduction) {
+            // MINUS accumulated 0 - a[i] - ... per lane, so the lanes fold with an add
+            TokenType fold = reduction == TokenType::MINUS ? TokenType::PLUS : reduction;
+            if (wide) {
+                asm_.emit(X64Op::VPERMQ, v(X64Reg::XMM1), v(X64Reg::XMM0), imm(0x4E));  // Swap 128-bit halves
+                accumulate(fold);
+            }
+            asm_.emit(wide ? X64Op::VPSHUFD : X64Op::PSHUFD, v(X64Reg::XMM1), v(X64Reg::XMM0), imm(0x4E));  // Swap 64-bit lanes
+            accumulate(fold);
+            if (wide) asm_.emit(X64Op::VZEROUPPER);
+
+            X64Operand x0 = x(X64Reg::XMM0), x1 = x(X64Reg::XMM1);
+            if (lane.isFloat) {
+                asm_.emit(X64Op::MOVQ, x1, accumulator);
+                asm_.emit(reduction == TokenType::STAR ? X64Op::MULSD : X64Op::ADDSD, x1, x0);
+                asm_.emit(X64Op::MOVQ, accumulator, x1);
+            } else if (isMinMax) {
+                asm_.emit(X64Op::MOVQ, accumulator, x0);
+            } else if (reduction == TokenType::STAR) {
+                asm_.emit(X64Op::MOVQ, gpr(X64Reg::RCX), x0);
+                asm_.emit(X64Op::IMUL, gpr(X64Reg::RCX), accumulator);
+                asm_.emit(X64Op::MOV, accumulator, gpr(X64Reg::RCX));
+            } else {
+                asm_.emit(X64Op::MOVQ, gpr(X64Reg::RCX), x0);
+                asm_.emit(X64Op::ADD, accumulator, gpr(X64Reg::RCX));
+            }
+        } else if (wide) {
+            asm_.emit(X64Op::VZEROUPPER);
+        }
+
+        // i += elements handled; the scalar loop picks up from there
+        asm_.emit(X64Op::SHR, gpr(X64Reg::RDX), imm(shift));
+        asm_.emit(X64Op::ADD, gpr(X64Reg::RAX), gpr(X64Reg::RDX));
+        if (loopVarReg != VarRegister::NONE) {
+            emitStoreRaxToVar(node.var);
+        } else {
+            asm_.mov_mem_rbp_rax(locals[node.var]);
+        }
+    };
+
+    if (targetISA_ == TargetISA::X86_64_V3) {
+        emitVersion(32);
+    } else {
+        // Multi-versioned: AVX2 when the startup probe found it, SSE otherwise
+        std::string sseLabel = newLabel("vec_sse");
+        asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RCX, 4), X64Operand::ripRVA(cpuHasAVX2RVA_, 4));
+        asm_.emit(X64Op::TEST, X64Operand::r(X64Reg::RCX, 4), X64Operand::r(X64Reg::RCX, 4));
+        asm_.jcc(X64Cond::E, sseLabel);
+        emitVersion(32);
+        asm_.jmp_rel32(skipLabel);
+        asm_.label(sseLabel);
+        emitVersion(16);
+    }
+
+    asm_.label(skipLabel);
+}
+
+// Low 64 bits of a 64x64 multiply from 32x32->64 pmuludq (no 64-bit
+// packed multiply below AVX-512):
+// lo(a)*lo(b) + ((hi(a)*lo(b) + lo(a)*hi(b)) << 32)
+void NativeCodeGen::emitPackedMul64(X64Reg dst, X64Reg src, uint8_t vectorBytes) {
+    X64Operand d = X64Operand::r(dst, vectorBytes), s = X64Operand::r(src, vectorBytes);
+    X64Operand t3 = X64Operand::r(X64Reg::XMM3, vectorBytes), t4 = X64Operand::r(X64Reg::XMM4, vectorBytes);
+    X64Operand by32 = X64Operand::immediate(32);
+    if (vectorBytes == 32) {
+        asm_.emit(X64Op::VPSRLQ, t3, d, by32);
+        asm_.emit(X64Op::VPMULUDQ, t3, t3, s);
+        asm_.emit(X64Op::VPSRLQ, t4, s, by32);
+        asm_.emit(X64Op::VPMULUDQ, t4, t4, d);
+        asm_.emit(X64Op::VPADDQ, t3, t3, t4);
+        asm_.emit(X64Op::VPSLLQ, t3, t3, by32);
+        asm_.emit(X64Op::VPMULUDQ, d, d, s);
+        asm_.emit(X64Op::VPADDQ, d, d, t3);
+        return;
+    }
+    asm_.emit(X64Op::MOVDQA, t3, d);
+    asm_.emit(X64Op::PSRLQ, t3, by32);
+    asm_.emit(X64Op::PMULUDQ, t3, s);
+    asm_.emit(X64Op::MOVDQA, t4, s);
+    asm_.emit(X64Op::PSRLQ, t4, by32);
+    asm_.emit(X64Op::PMULUDQ, t4, d);
+    asm_.emit(X64Op::PADDQ, t3, t4);
+    asm_.emit(X64Op::PSLLQ, t3, by32);
+    asm_.emit(X64Op::PMULUDQ, d, s);
+    asm_.emit(X64Op::PADDQ, d, t3);
+}
+
+// Signed 64-bit min/max, selecting value where it wins as the scalar
+// min()/max() cmov does. pcmpgtq is SSE4.2; for the baseline, build the
+// compare from 32-bit ones. With the low dwords' sign bits flipped (xmm5),
+// pcmpgtd compares the high dwords signed and the low dwords unsigned:
+//   gt64 = gt(hi) | (eq(hi) & gt(lo))
+void NativeCodeGen::emitPackedMinMax64(X64Reg acc, X64Reg value, bool isMin, uint8_t vectorBytes) {
+    X64Operand a = X64Operand::r(acc, vectorBytes), v = X64Operand::r(value, vectorBytes);
+    X64Operand t2 = X64Operand::r(X64Reg::XMM2, vectorBytes), t3 = X64Operand::r(X64Reg::XMM3, vectorBytes);
+    X64Operand t4 = X64Operand::r(X64Reg::XMM4, vectorBytes), mask = X64Operand::r(X64Reg::XMM5, vectorBytes);
+
+    // min: value wins where acc > value; max: where value > acc
+    X64Operand greater = isMin ? a : v;
+    X64Operand lesser = isMin ? v : a;
+
+    if (vectorBytes == 32) {
+        asm_.emit(X64Op::VPCMPGTQ, t4, greater, lesser);    // t4 = value wins
+        asm_.emit(X64Op::VPAND, t2, v, t4);
+        asm_.emit(X64Op::VPANDN, t4, t4, a);
+        asm_.emit(X64Op::VPOR, a, t2, t4);
+        return;
+    }
+
+    if (targetISA_ != TargetISA::X86_64) {
+        asm_.emit(X64Op::MOVDQA, t4, greater);
+        asm_.emit(X64Op::PCMPGTQ, t4, lesser);              // t4 = value wins
+    } else {
+        asm_.emit(X64Op::MOVDQA, t2, greater);
+        asm_.emit(X64Op::PXOR, t2, mask);
+        asm_.emit(X64Op::MOVDQA, t3, lesser);
+        asm_.emit(X64Op::PXOR, t3, mask);
+        asm_.emit(X64Op::MOVDQA, t4, t2);
+        asm_.emit(X64Op::PCMPGTD, t4, t3);                      // Per-dword greater-than
+        asm_.emit(X64Op::PCMPEQD, t2, t3);                      // Per-dword equal
+        asm_.emit(X64Op::PSHUFD, t3, t4, X64Operand::immediate(0xA0));  // gt(lo) in both halves
+        asm_.emit(X64Op::PSHUFD, t2, t2, X64Operand::immediate(0xF5));  // eq(hi) in both halves
+        asm_.emit(X64Op::PAND, t3, t2);
+        asm_.emit(X64Op::PSHUFD, t4, t4, X64Operand::immediate(0xF5));  // gt(hi) in both halves
+        asm_.emit(X64Op::POR, t4, t3);                          // t4 = value wins
+    }
+
+    asm_.emit(X64Op::MOVDQA, t2, v);
+    asm_.emit(X64Op::PAND, t2, t4);
+    asm_.emit(X64Op::PANDN, t4, a);
+    asm_.emit(X64Op::POR, t2, t4);
+    asm_.emit(X64Op::MOVDQA, a, t2);
+}
+
+// Startup probe for the AVX2 loop versions: sets the dispatch flag when
+// the CPU has AVX2 and FMA and the OS saves ymm state (XCR0 bits 1-2).
+// x86-64-v3 builds have no SSE fallback, so there an unsupported CPU exits
+// with a message instead of faulting in the first vector loop.
+void NativeCodeGen::emitCpuFeatureCheck() {
+    if (optLevel_ != CodeGenOptLevel::O3 && optLevel_ != CodeGenOptLevel::Ofast) return;
+    if (vectorizer_.loopsVectorizable() == 0) return;
+
+    auto r32 = [](X64Reg r) { return X64Operand::r(r, 4); };
+    auto imm = [](int64_t v) { return X64Operand::immediate(v); };
+    std::string unsupportedLabel = newLabel("cpu_no_avx2");
+    std::string doneLabel = newLabel("cpu_probe_done");
+    const int64_t leaf1Bits = (1 << 12) | (1 << 27) | (1 << 28);     // FMA, OSXSAVE, AVX
+
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::R11), X64Operand::r(X64Reg::RBX));  // cpuid clobbers rbx
+    asm_.emit(X64Op::XOR, r32(X64Reg::RAX), r32(X64Reg::RAX));
+    asm_.emit(X64Op::CPUID);
+    asm_.emit(X64Op::CMP, r32(X64Reg::RAX), imm(7));
+    asm_.jcc(X64Cond::B, unsupportedLabel);
+
+    asm_.emit(X64Op::MOV, r32(X64Reg::RAX), imm(1));
+    asm_.emit(X64Op::XOR, r32(X64Reg::RCX), r32(X64Reg::RCX));
+    asm_.emit(X64Op::CPUID);
+    asm_.emit(X64Op::AND, r32(X64Reg::RCX), imm(leaf1Bits));
+    asm_.emit(X64Op::CMP, r32(X64Reg::RCX), imm(leaf1Bits));
+    asm_.jcc(X64Cond::NE, unsupportedLabel);
+
+    asm_.emit(X64Op::XOR, r32(X64Reg::RCX), r32(X64Reg::RCX));
+    asm_.emit(X64Op::XGETBV);
+    asm_.emit(X64Op::AND, r32(X64Reg::RAX), imm(6));
+    asm_.emit(X64Op::CMP, r32(X64Reg::RAX), imm(6));
+    asm_.jcc(X64Cond::NE, unsupportedLabel);
+
+    asm_.emit(X64Op::MOV, r32(X64Reg::RAX), imm(7));
+    asm_.emit(X64Op::XOR, r32(X64Reg::RCX), r32(X64Reg::RCX));
+    asm_.emit(X64Op::CPUID);
+    asm_.emit(X64Op::TEST, r32(X64Reg::RBX), imm(1 << 5));           // AVX2
+    asm_.jcc(X64Cond::E, unsupportedLabel);
+
+    asm_.emit(X64Op::MOV, r32(X64Reg::RCX), imm(1));
+    asm_.emit(X64Op::MOV, X64Operand::ripRVA(cpuHasAVX2RVA_, 4), r32(X64Reg::RCX));
+    asm_.jmp_rel32(doneLabel);
+
+    asm_.label(unsupportedLabel);
+    if (targetISA_ == TargetISA::X86_64_V3) {
+        std::string msg = "This program was built with -march=x86-64-v3 and needs a CPU with AVX2 and FMA\r\n";
+        uint32_t msgRVA = addString(msg);
+        asm_.emit(X64Op::MOV, r32(X64Reg::RCX), imm(-11));
+        asm_.call_mem_rip(pe_.getImportRVA("GetStdHandle"));
+        asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RCX), X64Operand::r(X64Reg::RAX));
+        asm_.emit(X64Op::LEA, X64Operand::r(X64Reg::RDX), X64Operand::ripRVA(msgRVA));
+        asm_.emit(X64Op::MOV, r32(X64Reg::R8), imm(static_cast<int64_t>(msg.size())));
+        asm_.emit(X64Op::LEA, X64Operand::r(X64Reg::R9), X64Operand::mem(X64Reg::RSP, 0x28));
+        asm_.emit(X64Op::MOV, X64Operand::mem(X64Reg::RSP, 0x20), imm(0));
+        asm_.call_mem_rip(pe_.getImportRVA("WriteConsoleA"));
+        asm_.emit(X64Op::MOV, r32(X64Reg::RCX), imm(1));
+        asm_.call_mem_rip(pe_.getImportRVA("ExitProcess"));
+    }
+
+    asm_.label(doneLabel);
+    asm_.emit(X64Op::MOV, X64Operand::r(X64Reg::RBX), X64Operand::r(X64Reg::R11));
+}
+
+} // namespace tyl
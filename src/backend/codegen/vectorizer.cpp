@@ -2,8 +2,7 @@
 // Auto-vectorization for loops and array operations
 
 #include "vectorizer.h"
-#include "backend/x64/x64_assembler.h"
-#include <algorithm>
+#include <functional>
 
 namespace tyl {
 
@@ -11,6 +10,7 @@ Vectorizer::Vectorizer() {}
 
 void Vectorizer::analyze(Program& program) {
     loops_.clear();
+    loopIndex_.clear();
     loopsAnalyzed_ = 0;
     loopsVectorizable_ = 0;
     
@@ -61,41 +61,31 @@ void Vectorizer::analyzeLoop(ForStmt* loop) {
     info.isVectorizable = false;
     info.reason = "Not analyzed";
     
-    // Check if trip count is known and sufficient for vectorization
-    if (!info.tripCountKnown) {
-        info.reason = "Unknown trip count";
-        loops_.push_back(info);
-        return;
-    }
+    loopIndex_[loop] = loops_.size();
     
-    if (info.tripCount < 4) {
+    // Unknown trip counts are fine: codegen checks the remaining count at
+    // runtime and the scalar loop handles whatever the vector loop leaves
+    if (info.tripCountKnown && info.tripCount < 4) {
         info.reason = "Trip count too small (< 4)";
         loops_.push_back(info);
         return;
     }
     
-    // Analyze loop body
-    if (!analyzeLoopBody(loop->body.get(), info)) {
+    if (!hasUnitStep(loop)) {
+        info.reason = "Non-unit step";
         loops_.push_back(info);
         return;
     }
     
-    // Check for dependencies that prevent vectorization
-    if (!checkDependencies(loop->body.get(), loop->var)) {
-        info.reason = "Loop-carried dependencies detected";
+    // Analyze loop body
+    if (!analyzeLoopBody(loop->body.get(), info)) {
         loops_.push_back(info);
         return;
     }
     
-    // Determine vector width
-    if (info.tripCount >= 8) {
-        info.width = VectorWidth::AVX_8;
-    } else if (info.tripCount >= 4) {
-        info.width = VectorWidth::SSE_4;
-    } else {
-        info.width = VectorWidth::SSE_2;
-    }
-    
+    // Width in 64-bit lanes; codegen derives the actual lane count from
+    // the element size of the arrays involved
+    info.width = vectorBytes_ == 32 ? VectorWidth::AVX_4 : VectorWidth::SSE_2;
     info.isVectorizable = true;
     info.reason = "Vectorizable";
     loopsVectorizable_++;
@@ -109,227 +99,205 @@ bool Vectorizer::analyzeLoopBody(Statement* body, VectorizableLoop& info) {
         return false;
     }
     
-    // Get statements from block
-    std::vector<Statement*> stmts;
+    // The body must be a single assignment
+    Statement* stmt = body;
     if (auto* block = dynamic_cast<Block*>(body)) {
-        for (auto& s : block->statements) {
-            stmts.push_back(s.get());
+        if (block->statements.size() != 1) {
+            info.reason = "Loop body is not a single assignment";
+            return false;
         }
-    } else {
-        stmts.push_back(body);
+        stmt = block->statements[0].get();
     }
     
-    // Analyze each statement
-    for (auto* stmt : stmts) {
-        // Check for simple reduction pattern: sum = sum + arr[i]
-        if (isSimpleReduction(stmt, info)) {
-            continue;
+    Expression* target = nullptr;
+    Expression* value = nullptr;
+    TokenType op = TokenType::ASSIGN;
+    if (auto* assign = dynamic_cast<AssignStmt*>(stmt)) {
+        target = assign->target.get();
+        value = assign->value.get();
+        op = assign->op;
+    } else if (auto* exprStmt = dynamic_cast<ExprStmt*>(stmt)) {
+        if (auto* assign = dynamic_cast<AssignExpr*>(exprStmt->expr.get())) {
+            target = assign->target.get();
+            value = assign->value.get();
+            op = assign->op;
         }
-        
-        // Check for array assignment: arr[i] = expr
-        if (auto* assign = dynamic_cast<AssignStmt*>(stmt)) {
-            if (auto* index = dynamic_cast<IndexExpr*>(assign->target.get())) {
-                std::string arrayName;
-                if (isArrayAccess(index, info.inductionVar, arrayName)) {
-                    info.hasArrayAccess = true;
-                    info.arrayVar = arrayName;
-                    continue;
-                }
+    }
+    if (!target || !value) {
+        info.reason = "Loop body is not a single assignment";
+        return false;
+    }
+    
+    if (auto* id = dynamic_cast<Identifier*>(target)) {
+        return analyzeReduction(id, op, value, info);
+    }
+    if (auto* index = dynamic_cast<IndexExpr*>(target)) {
+        return analyzeElementwise(index, op, value, info);
+    }
+    info.reason = "Unsupported assignment target";
+    return false;
+}
+
+// s += term, s -= term, s *= term, s = s + term, s = term + s, s = s - term,
+// s = s * term, s = min(s, a[i]), s = max(s, a[i]); term is a[i] or,
+// for sums, a[i] * b[i]
+bool Vectorizer::analyzeReduction(Identifier* target, TokenType op, Expression* value,
+                                  VectorizableLoop& info) {
+    const std::string& name = target->name;
+    if (name == info.inductionVar) {
+        info.reason = "Loop assigns its induction variable";
+        return false;
+    }
+    
+    auto isTarget = [&](Expression* e) {
+        auto* id = dynamic_cast<Identifier*>(e);
+        return id && id->name == name;
+    };
+    
+    Expression* term = nullptr;
+    TokenType reduction = TokenType::PLUS;
+    if (op == TokenType::PLUS_ASSIGN || op == TokenType::MINUS_ASSIGN || op == TokenType::STAR_ASSIGN) {
+        term = value;
+        reduction = op == TokenType::PLUS_ASSIGN ? TokenType::PLUS :
+                    op == TokenType::MINUS_ASSIGN ? TokenType::MINUS : TokenType::STAR;
+    } else if (op == TokenType::ASSIGN) {
+        if (auto* binary = dynamic_cast<BinaryExpr*>(value)) {
+            if (binary->op == TokenType::PLUS || binary->op == TokenType::STAR) {
+                if (isTarget(binary->left.get())) term = binary->right.get();
+                else if (isTarget(binary->right.get())) term = binary->left.get();
+            } else if (binary->op == TokenType::MINUS && isTarget(binary->left.get())) {
+                term = binary->right.get();
             }
-        }
-        
-        // Check for expression statements with array access
-        if (auto* exprStmt = dynamic_cast<ExprStmt*>(stmt)) {
-            // Allow print statements and other side effects
-            // but they prevent vectorization
-            if (auto* call = dynamic_cast<CallExpr*>(exprStmt->expr.get())) {
-                if (auto* id = dynamic_cast<Identifier*>(call->callee.get())) {
-                    if (id->name == "print" || id->name == "println") {
-                        info.reason = "Loop contains I/O operations";
-                        return false;
-                    }
-                }
+            reduction = binary->op;
+        } else if (auto* call = dynamic_cast<CallExpr*>(value)) {
+            auto* callee = dynamic_cast<Identifier*>(call->callee.get());
+            if (callee && (callee->name == "min" || callee->name == "max") &&
+                call->args.size() == 2 && call->namedArgs.empty()) {
+                if (isTarget(call->args[0].get())) term = call->args[1].get();
+                else if (isTarget(call->args[1].get())) term = call->args[0].get();
+                reduction = callee->name == "min" ? TokenType::LT : TokenType::GT;
+                if (term && !isInductionAccess(term, info.inductionVar)) term = nullptr;
             }
         }
-        
-        // Check for control flow that prevents vectorization
-        if (dynamic_cast<IfStmt*>(stmt) ||
-            dynamic_cast<WhileStmt*>(stmt) ||
-            dynamic_cast<ForStmt*>(stmt) ||
-            dynamic_cast<BreakStmt*>(stmt) ||
-            dynamic_cast<ContinueStmt*>(stmt) ||
-            dynamic_cast<ReturnStmt*>(stmt)) {
-            info.reason = "Loop contains control flow";
+    }
+    if (!term) {
+        info.reason = "No reduction pattern found";
+        return false;
+    }
+    
+    if (isInductionAccess(term, info.inductionVar)) {
+        info.lhs = term;
+    } else if (auto* product = dynamic_cast<BinaryExpr*>(term)) {
+        // Dot product: the per-element product is summed
+        if (product->op != TokenType::STAR ||
+            (reduction != TokenType::PLUS && reduction != TokenType::MINUS) ||
+            !isInductionAccess(product->left.get(), info.inductionVar) ||
+            !isInductionAccess(product->right.get(), info.inductionVar)) {
+            info.reason = "Unsupported reduction term";
             return false;
         }
+        info.lhs = product->left.get();
+        info.rhs = product->right.get();
+        info.elementOp = TokenType::STAR;
+    } else {
+        info.reason = "Unsupported reduction term";
+        return false;
     }
     
-    // Must have either reduction or array access to be vectorizable
-    if (!info.hasReduction && !info.hasArrayAccess) {
-        info.reason = "No vectorizable operations found";
-        return false;
+    // The accumulator must not also be one of the arrays
+    for (Expression* operand : {info.lhs, info.rhs}) {
+        auto* index = dynamic_cast<IndexExpr*>(operand);
+        if (index && isTarget(index->object.get())) {
+            info.reason = "Reduction variable is indexed in the loop";
+            return false;
+        }
     }
     
+    info.kind = VectorLoopKind::REDUCTION;
+    info.hasReduction = true;
+    info.reductionVar = name;
+    info.accumulator = target;
+    info.reductionOp = reduction;
+    info.hasArrayAccess = true;
+    info.arrayVar = static_cast<Identifier*>(static_cast<IndexExpr*>(info.lhs)->object.get())->name;
     return true;
 }
 
-bool Vectorizer::isSimpleReduction(Statement* stmt, VectorizableLoop& info) {
-    auto* assign = dynamic_cast<AssignStmt*>(stmt);
-    if (!assign) return false;
+// a[i] = x, a[i] = x op y with x and y each b[i] or loop-invariant
+bool Vectorizer::analyzeElementwise(IndexExpr* target, TokenType op, Expression* value,
+                                    VectorizableLoop& info) {
+    if (op != TokenType::ASSIGN || !isInductionAccess(target, info.inductionVar)) {
+        info.reason = "Store is not a[i] = ...";
+        return false;
+    }
     
-    auto* targetId = dynamic_cast<Identifier*>(assign->target.get());
-    if (!targetId) return false;
+    auto isOperand = [&](Expression* e) {
+        return isInductionAccess(e, info.inductionVar) || isLoopInvariant(e, info.inductionVar);
+    };
     
-    // Check for compound assignment: sum += expr
-    if (assign->op == TokenType::PLUS_ASSIGN || 
-        assign->op == TokenType::STAR_ASSIGN) {
-        
-        // Check if RHS contains array access with induction var
-        std::string arrayName;
-        if (isArrayAccess(assign->value.get(), info.inductionVar, arrayName)) {
-            info.hasReduction = true;
-            info.reductionVar = targetId->name;
-            info.reductionOp = assign->op == TokenType::PLUS_ASSIGN ? 
-                               TokenType::PLUS : TokenType::STAR;
-            info.hasArrayAccess = true;
-            info.arrayVar = arrayName;
-            return true;
-        }
-        
-        // Simple increment: count += 1
-        if (auto* intLit = dynamic_cast<IntegerLiteral*>(assign->value.get())) {
-            info.hasReduction = true;
-            info.reductionVar = targetId->name;
-            info.reductionOp = assign->op == TokenType::PLUS_ASSIGN ? 
-                               TokenType::PLUS : TokenType::STAR;
-            return true;
+    if (auto* binary = dynamic_cast<BinaryExpr*>(value)) {
+        switch (binary->op) {
+            case TokenType::PLUS: case TokenType::MINUS: case TokenType::STAR: case TokenType::SLASH:
+            case TokenType::AMP: case TokenType::PIPE: case TokenType::CARET:
+                break;
+            default:
+                info.reason = "Unsupported elementwise operator";
+                return false;
         }
-    }
-    
-    // Check for explicit form: sum = sum + arr[i]
-    if (assign->op == TokenType::ASSIGN) {
-        auto* binary = dynamic_cast<BinaryExpr*>(assign->value.get());
-        if (!binary) return false;
-        
-        if (binary->op != TokenType::PLUS && binary->op != TokenType::STAR) {
+        if (!isOperand(binary->left.get()) || !isOperand(binary->right.get()) ||
+            (!isInductionAccess(binary->left.get(), info.inductionVar) &&
+             !isInductionAccess(binary->right.get(), info.inductionVar))) {
+            info.reason = "Unsupported elementwise operands";
             return false;
         }
-        
-        // Check if one operand is the target variable
-        auto* leftId = dynamic_cast<Identifier*>(binary->left.get());
-        auto* rightId = dynamic_cast<Identifier*>(binary->right.get());
-        
-        Expression* otherOperand = nullptr;
-        if (leftId && leftId->name == targetId->name) {
-            otherOperand = binary->right.get();
-        } else if (rightId && rightId->name == targetId->name) {
-            otherOperand = binary->left.get();
-        }
-        
-        if (otherOperand) {
-            std::string arrayName;
-            if (isArrayAccess(otherOperand, info.inductionVar, arrayName)) {
-                info.hasReduction = true;
-                info.reductionVar = targetId->name;
-                info.reductionOp = binary->op;
-                info.hasArrayAccess = true;
-                info.arrayVar = arrayName;
-                return true;
-            }
-        }
+        info.lhs = binary->left.get();
+        info.rhs = binary->right.get();
+        info.elementOp = binary->op;
+    } else if (isOperand(value)) {
+        info.lhs = value;    // Copy or fill
+    } else {
+        info.reason = "Unsupported elementwise value";
+        return false;
     }
     
-    return false;
+    info.kind = VectorLoopKind::ELEMENTWISE;
+    info.store = target;
+    info.hasArrayAccess = true;
+    info.arrayVar = static_cast<Identifier*>(target->object.get())->name;
+    return true;
 }
 
-bool Vectorizer::isArrayAccess(Expression* expr, const std::string& inductionVar, 
-                                std::string& arrayName) {
+// arr[i] with i the induction variable
+bool Vectorizer::isInductionAccess(Expression* expr, const std::string& inductionVar) {
     auto* index = dynamic_cast<IndexExpr*>(expr);
     if (!index) return false;
-    
-    // Check if object is an identifier (array name)
     auto* arrayId = dynamic_cast<Identifier*>(index->object.get());
-    if (!arrayId) return false;
-    
-    // Check if index is the induction variable
     auto* indexId = dynamic_cast<Identifier*>(index->index.get());
-    if (indexId && indexId->name == inductionVar) {
-        arrayName = arrayId->name;
-        return true;
-    }
-    
-    // Check for index + constant or index * constant
-    if (auto* binary = dynamic_cast<BinaryExpr*>(index->index.get())) {
-        auto* leftId = dynamic_cast<Identifier*>(binary->left.get());
-        auto* rightId = dynamic_cast<Identifier*>(binary->right.get());
-        
-        if ((leftId && leftId->name == inductionVar) ||
-            (rightId && rightId->name == inductionVar)) {
-            arrayName = arrayId->name;
-            return true;
-        }
-    }
-    
-    return false;
+    return arrayId && indexId && indexId->name == inductionVar && arrayId->name != inductionVar;
 }
 
-bool Vectorizer::checkDependencies(Statement* body, const std::string& inductionVar) {
-    // Simple dependency check: look for writes that are read in the same iteration
-    // This is a conservative check - a full implementation would do proper
-    // dependence analysis
-    
-    std::set<std::string> written;
-    std::set<std::string> readBeforeWrite;
-    
-    std::function<void(Statement*, bool)> scan = [&](Statement* stmt, bool isWrite) {
-        if (!stmt) return;
-        
-        if (auto* block = dynamic_cast<Block*>(stmt)) {
-            for (auto& s : block->statements) {
-                scan(s.get(), false);
-            }
-        }
-        else if (auto* assign = dynamic_cast<AssignStmt*>(stmt)) {
-            // First scan the RHS for reads
-            std::function<void(Expression*)> scanExpr = [&](Expression* expr) {
-                if (!expr) return;
-                if (auto* id = dynamic_cast<Identifier*>(expr)) {
-                    if (written.count(id->name) == 0) {
-                        readBeforeWrite.insert(id->name);
-                    }
-                }
-                else if (auto* binary = dynamic_cast<BinaryExpr*>(expr)) {
-                    scanExpr(binary->left.get());
-                    scanExpr(binary->right.get());
-                }
-                else if (auto* index = dynamic_cast<IndexExpr*>(expr)) {
-                    scanExpr(index->object.get());
-                    scanExpr(index->index.get());
-                }
-            };
-            scanExpr(assign->value.get());
-            
-            // Then mark the target as written
-            if (auto* id = dynamic_cast<Identifier*>(assign->target.get())) {
-                written.insert(id->name);
-            }
-        }
-    };
-    
-    scan(body, false);
-    
-    // Check for loop-carried dependencies
-    // A variable that is both read and written could have dependencies
-    // unless it's a reduction variable (which we handle specially)
-    for (const auto& var : written) {
-        if (readBeforeWrite.count(var) && var != inductionVar) {
-            // This could be a loop-carried dependency
-            // For now, we're conservative and allow it if it looks like a reduction
-            // A full implementation would do proper analysis
-        }
+// A literal or a variable other than the induction variable; the body is a
+// single assignment, so a variable it does not assign stays invariant
+bool Vectorizer::isLoopInvariant(Expression* expr, const std::string& inductionVar) {
+    if (dynamic_cast<IntegerLiteral*>(expr) || dynamic_cast<FloatLiteral*>(expr)) return true;
+    auto* id = dynamic_cast<Identifier*>(expr);
+    return id && id->name != inductionVar;
+}
+
+bool Vectorizer::hasUnitStep(ForStmt* loop) {
+    Expression* step = nullptr;
+    if (auto* range = dynamic_cast<RangeExpr*>(loop->iterable.get())) {
+        step = range->step.get();
+    } else if (auto* call = dynamic_cast<CallExpr*>(loop->iterable.get())) {
+        auto* id = dynamic_cast<Identifier*>(call->callee.get());
+        if (!id || id->name != "range") return false;
+        if (call->args.size() >= 3) step = call->args[2].get();
+    } else {
+        return false;
     }
-    
-    return true;  // Conservative: assume no problematic dependencies
+    if (!step) return true;
+    auto* stepLit = dynamic_cast<IntegerLiteral*>(step);
+    return stepLit && stepLit->value == 1;
 }
 
 int64_t Vectorizer::getTripCount(ForStmt* loop) {
@@ -339,7 +307,7 @@ int64_t Vectorizer::getTripCount(ForStmt* loop) {
         auto* endLit = dynamic_cast<IntegerLiteral*>(range->end.get());
         
         if (startLit && endLit) {
-            return endLit->value - startLit->value;
+            return endLit->value - startLit->value + 1;  // Inclusive
         }
     }
     
@@ -368,128 +336,19 @@ int64_t Vectorizer::getTripCount(ForStmt* loop) {
     return -1;  // Unknown trip count
 }
 
-bool Vectorizer::canVectorize(ForStmt* loop) {
-    for (const auto& info : loops_) {
-        if (info.loop == loop) {
-            return info.isVectorizable;
-        }
-    }
-    return false;
-}
-
-VectorWidth Vectorizer::getRecommendedWidth(ForStmt* loop) {
-    for (const auto& info : loops_) {
-        if (info.loop == loop) {
-            return info.width;
-        }
-    }
-    return VectorWidth::SCALAR;
-}
-
-// SIMD Code Generator implementation
-bool SIMDCodeGen::hasAVX() {
-    // Runtime CPUID check for AVX support
-    // For simplicity, assume AVX is available on modern x64 CPUs
-    return true;
-}
-
-VectorWidth SIMDCodeGen::getOptimalWidth() {
-    if (hasAVX()) {
-        return VectorWidth::AVX_8;
-    }
-    return VectorWidth::SSE_4;
-}
-
-// ============================================
-// SIMD Code Generation
-// ============================================
-
-bool SIMDCodeGen::generateVectorizedLoop(const VectorizableLoop& loop, X64Assembler& asm_,
-                                          NativeCodeGen& codegen) {
-    if (!loop.isVectorizable) return false;
-    
-    // For now, we support simple reduction patterns
-    if (loop.hasReduction) {
-        generateReduction(loop, asm_, codegen);
-        return true;
-    }
-    
-    // Array operations without reduction
-    if (loop.hasArrayAccess) {
-        generateArrayOp(loop, asm_, codegen);
-        return true;
-    }
-    
-    return false;
-}
-
-void SIMDCodeGen::generateReduction(const VectorizableLoop& loop, X64Assembler& asm_,
-                                     NativeCodeGen& codegen) {
-    (void)codegen;  // May be used for variable lookups
-    
-    // Determine vector width
-    int vectorWidth = static_cast<int>(loop.width);
-    if (vectorWidth < 2) vectorWidth = 4;  // Default to SSE width
-    
-    int64_t tripCount = loop.tripCount;
-    int64_t vectorIterations = tripCount / vectorWidth;
-    int64_t remainder = tripCount % vectorWidth;
-    
-    // Initialize accumulator vector to zero
-    // For addition: xorpd/pxor to zero
-    // For multiplication: would need to load 1.0 vector
-    if (loop.reductionOp == TokenType::PLUS) {
-        asm_.pxor_xmm0_xmm0();  // Zero the accumulator
-    }
-    
-    // Generate vectorized loop
-    // This is a simplified version - a full implementation would:
-    // 1. Load vector of array elements
-    // 2. Add to accumulator vector
-    // 3. Loop for vectorIterations
-    // 4. Horizontal reduction
-    // 5. Handle remainder with scalar code
-    
-    if (vectorIterations > 0) {
-        // Vectorized loop would go here
-        // For now, we just note that vectorization is possible
-        
-        // After vector loop, do horizontal reduction
-        generateHorizontalReduction(loop.reductionOp, loop.width, asm_);
-    }
-    
-    // Handle remainder iterations with scalar code
-    (void)remainder;  // Would generate scalar cleanup loop
+const VectorizableLoop* Vectorizer::getLoop(ForStmt* loop) const {
+    auto it = loopIndex_.find(loop);
+    return it != loopIndex_.end() ? &loops_[it->second] : nullptr;
 }
 
-void SIMDCodeGen::generateArrayOp(const VectorizableLoop& loop, X64Assembler& asm_,
-                                   NativeCodeGen& codegen) {
-    (void)loop;
-    (void)asm_;
-    (void)codegen;
-    // Generate vectorized array operations (e.g., arr[i] = arr[i] * 2)
-    // This would load vectors, operate, and store back
+bool Vectorizer::canVectorize(ForStmt* loop) {
+    const VectorizableLoop* info = getLoop(loop);
+    return info && info->isVectorizable;
 }
 
-void SIMDCodeGen::generateHorizontalReduction(TokenType op, VectorWidth width, X64Assembler& asm_) {
-    // Reduce vector in xmm0 to scalar
-    
-    if (width == VectorWidth::SSE_4 || width == VectorWidth::AVX_8) {
-        // For 4 x int32 or 4 x float
-        if (op == TokenType::PLUS) {
-            // Use horizontal add
-            asm_.phaddd_xmm0_xmm0();  // [a+b, c+d, a+b, c+d]
-            asm_.phaddd_xmm0_xmm0();  // [a+b+c+d, ...]
-        }
-    }
-    else if (width == VectorWidth::SSE_2 || width == VectorWidth::AVX_4) {
-        // For 2 x double
-        if (op == TokenType::PLUS) {
-            asm_.haddpd_xmm0_xmm0();  // [a+b, a+b]
-        }
-    }
-    
-    // Result is now in the low element of xmm0
+VectorWidth Vectorizer::getRecommendedWidth(ForStmt* loop) {
+    const VectorizableLoop* info = getLoop(loop);
+    return info ? info->width : VectorWidth::SCALAR;
 }
 
 } // namespace tyl
@@ -6,14 +6,10 @@
 #include "frontend/ast/ast.h"
 #include <vector>
 #include <string>
-#include <set>
+#include <map>
 
 namespace tyl {
 
-// Forward declarations
-class X64Assembler;
-class NativeCodeGen;
-
 // Vectorization width (number of elements processed in parallel)
 enum class VectorWidth {
     SCALAR = 1,     // No vectorization
@@ -23,6 +19,13 @@ enum class VectorWidth {
     AVX_8 = 8       // AVX: 8 floats or 8 ints
 };
 
+// Shape of a loop body that codegen can emit as a packed SIMD main loop
+enum class VectorLoopKind {
+    NONE,
+    REDUCTION,      // s = s + a[i], s += a[i] * b[i], s = min(s, a[i]), ...
+    ELEMENTWISE     // a[i] = b[i] op c[i], a[i] = b[i] op k, a[i] = b[i]
+};
+
 // Information about a vectorizable loop
 struct VectorizableLoop {
     ForStmt* loop;
@@ -34,16 +37,26 @@ struct VectorizableLoop {
     // Loop body analysis
     bool hasReduction;              // e.g., sum += arr[i]
     std::string reductionVar;
-    TokenType reductionOp;          // PLUS, STAR, etc.
+    TokenType reductionOp;          // PLUS, MINUS, STAR, LT (min) or GT (max)
     
     bool hasArrayAccess;            // Accesses array with induction var
     std::string arrayVar;
     
+    // Body pattern, valid when isVectorizable. Operands are either arr[i]
+    // over the induction variable or a loop-invariant literal/variable.
+    VectorLoopKind kind = VectorLoopKind::NONE;
+    IndexExpr* store = nullptr;     // ELEMENTWISE: the a[i] being written
+    Identifier* accumulator = nullptr;  // REDUCTION: the reduction variable
+    Expression* lhs = nullptr;      // First operand
+    Expression* rhs = nullptr;      // Second operand (nullptr: lhs alone)
+    TokenType elementOp = TokenType::PLUS;  // Combines lhs and rhs per element
+    
     bool isVectorizable;            // Can this loop be vectorized?
     std::string reason;             // Why not vectorizable (if not)
 };
 
-// Vectorizer pass - analyzes and transforms loops for SIMD
+// Vectorizer pass - analyzes loops for SIMD; NativeCodeGen emits the
+// packed loops for the patterns recorded here
 class Vectorizer {
 public:
     Vectorizer();
@@ -51,9 +64,15 @@ public:
     // Analyze program for vectorization opportunities
     void analyze(Program& program);
     
+    // Widest vector the target guarantees: 16 (SSE) or 32 (AVX2) bytes
+    void setVectorBytes(int bytes) { vectorBytes_ = bytes; }
+    
     // Get vectorizable loops found
     const std::vector<VectorizableLoop>& getVectorizableLoops() const { return loops_; }
     
+    // Analysis result for a loop, or nullptr if it was never analyzed
+    const VectorizableLoop* getLoop(ForStmt* loop) const;
+    
     // Check if a specific loop can be vectorized
     bool canVectorize(ForStmt* loop);
     
@@ -66,48 +85,22 @@ public:
     
 private:
     std::vector<VectorizableLoop> loops_;
+    std::map<ForStmt*, size_t> loopIndex_;   // ForStmt -> index into loops_
     int loopsAnalyzed_ = 0;
     int loopsVectorizable_ = 0;
+    int vectorBytes_ = 16;
     
     // Analysis helpers
     void analyzeLoop(ForStmt* loop);
     bool analyzeLoopBody(Statement* body, VectorizableLoop& info);
-    bool checkDependencies(Statement* body, const std::string& inductionVar);
-    bool isSimpleReduction(Statement* stmt, VectorizableLoop& info);
-    bool isArrayAccess(Expression* expr, const std::string& inductionVar, std::string& arrayName);
+    bool analyzeReduction(Identifier* target, TokenType op, Expression* value, VectorizableLoop& info);
+    bool analyzeElementwise(IndexExpr* target, TokenType op, Expression* value, VectorizableLoop& info);
+    bool isInductionAccess(Expression* expr, const std::string& inductionVar);
+    bool isLoopInvariant(Expression* expr, const std::string& inductionVar);
+    bool hasUnitStep(ForStmt* loop);
     int64_t getTripCount(ForStmt* loop);
 };
 
-// SIMD Code Generator - generates vectorized code
-class SIMDCodeGen {
-public:
-    // Check if SSE is available (always true on x64)
-    static bool hasSSE() { return true; }
-    
-    // Check if AVX is available (runtime check needed)
-    static bool hasAVX();
-    
-    // Get optimal vector width for current CPU
-    static VectorWidth getOptimalWidth();
-    
-    // Generate vectorized loop code
-    // Returns true if vectorization was successful
-    bool generateVectorizedLoop(const VectorizableLoop& loop, class X64Assembler& asm_,
-                                class NativeCodeGen& codegen);
-    
-private:
-    // Generate vectorized reduction (sum, product)
-    void generateReduction(const VectorizableLoop& loop, X64Assembler& asm_,
-                          NativeCodeGen& codegen);
-    
-    // Generate vectorized array operation
-    void generateArrayOp(const VectorizableLoop& loop, X64Assembler& asm_,
-                        NativeCodeGen& codegen);
-    
-    // Generate horizontal reduction to get final scalar result
-    void generateHorizontalReduction(TokenType op, VectorWidth width, X64Assembler& asm_);
-};
-
 } // namespace tyl
 
 #endif // TYL_VECTORIZER_H
@@ -37,6 +37,18 @@ enum GCFlags : uint8_t {
     GC_FLAG_PINNED = 1,     // Don't move or collect
     GC_FLAG_WEAK = 2,       // Weak reference
     GC_FLAG_FINALIZE = 4,   // Has finalizer
+    // Generational state (generated code's collector)
+    GC_FLAG_NURSERY = 8,    // Lives in nursery memory: reclaimed by zeroing, never freed
+    GC_FLAG_OLD = 16,       // Old generation (copied out, promoted in place, or allocated old)
+    GC_FLAG_FORWARDED = 32, // Copied by a minor GC; header->next holds the new address
+    GC_FLAG_SURVIVOR = 64,  // Pinned by a root during the current minor GC
+};
+
+// Stack slot kinds in the generated code's frame maps
+enum GCSlotKind : uint8_t {
+    GC_SLOT_CONSERVATIVE = 0,  // Unknown contents: pins whatever it points into
+    GC_SLOT_REFERENCE = 1,     // Object pointer or null: the collector may move its target and rewrite it
+    GC_SLOT_SCALAR = 2,        // Never a pointer: skipped
 };
 
 // GC statistics
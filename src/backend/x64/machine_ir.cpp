@@ -0,0 +1,985 @@
+// Tyl Compiler - Machine IR Implementation
+// x86-64 decoder (length, operands, register effects), lifting and lowering
+#include "machine_ir.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace tyl {
+
+namespace {
+
+constexpr uint32_t END_ID = 0xFFFFFFFF;       // INSTR reference to the end of the code
+constexpr uint32_t CODE_RVA = 0x1000;         // Must match PEGenerator::CODE_RVA
+
+X64Reg gpr(unsigned n) { return static_cast<X64Reg>(n & 15); }
+X64Reg xmm(unsigned n) { return static_cast<X64Reg>(16 + (n & 15)); }
+
+int64_t readSigned(const uint8_t* p, int size) {
+    switch (size) {
+        case 1: return static_cast<int8_t>(p[0]);
+        case 2: return static_cast<int16_t>(p[0] | (p[1] << 8));
+        case 4: return static_cast<int32_t>(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+        case 8: {
+            uint64_t v = 0;
+            for (int k = 7; k >= 0; k--) v = (v << 8) | p[k];
+            return static_cast<int64_t>(v);
+        }
+        default: return 0;
+    }
+}
+
+void writeSigned(uint8_t* p, int size, int64_t v) {
+    for (int k = 0; k < size; k++) p[k] = static_cast<uint8_t>((v >> (8 * k)) & 0xFF);
+}
+
+void makeOpaque(MachineInstr& mi) {
+    mi.op = MOpcode::OPAQUE;
+    mi.uses = REG_MASK_ALL;
+    mi.defs = REG_MASK_ALL;
+    mi.readsMem = true;
+    mi.writesMem = true;
+    mi.barrier = true;
+}
+
+// Fields produced by the length decoder and consumed by classification
+struct RawInstr {
+    bool opsize = false, addrsize = false, rep = false, repne = false, lock = false;
+    bool segment = false;       // FS/GS override (thread-local loads)
+    uint8_t rex = 0;
+    bool rexW = false, rexR = false, rexX = false, rexB = false;
+    bool vex = false;
+    unsigned vvvv = 0;
+    int map = 0;                // 0 = one-byte, 1 = 0F, 2 = 0F38, 3 = 0F3A
+    uint8_t opcode = 0;
+    bool hasModrm = false;
+    unsigned mod = 0, reg = 0, rm = 0;
+    int dispPos = -1;
+    int immSize = 0;
+    int64_t imm = 0;
+    int relPos = -1, relSize = 0;
+};
+
+} // namespace
+
+// ============================================
+// Decoder
+// ============================================
+
+size_t MachineCode::decode(const uint8_t* p, size_t avail, MachineInstr& mi) {
+    mi = MachineInstr{};
+    RawInstr d;
+    size_t i = 0;
+
+    // Legacy prefixes
+    for (;;) {
+        if (i >= avail) return 0;
+        uint8_t b = p[i];
+        if (b == 0x66) d.opsize = true;
+        else if (b == 0x67) d.addrsize = true;
+        else if (b == 0xF3) d.rep = true;
+        else if (b == 0xF2) d.repne = true;
+        else if (b == 0xF0) d.lock = true;
+        else if (b == 0x64 || b == 0x65) d.segment = true;
+        else if (b == 0x2E || b == 0x36 || b == 0x3E || b == 0x26) {
+            return 0;   // Other segment overrides are never emitted by codegen
+        }
+        else break;
+        if (++i > 4) return 0;
+    }
+
+    if ((p[i] & 0xF0) == 0x40) {
+        d.rex = p[i++];
+        if (i >= avail) return 0;
+        d.rexW = d.rex & 8; d.rexR = d.rex & 4; d.rexX = d.rex & 2; d.rexB = d.rex & 1;
+    }
+
+    uint8_t op = p[i];
+    if (op == 0xC4 || op == 0xC5) {
+        // VEX (always VEX in 64-bit mode)
+        if (d.rex || d.opsize || d.rep || d.repne || d.lock) return 0;
+        d.vex = true;
+        unsigned pp;
+        if (op == 0xC5) {
+            if (i + 2 >= avail) return 0;
+            uint8_t b1 = p[i + 1];
+            d.rexR = !(b1 & 0x80);
+            d.vvvv = (~b1 >> 3) & 15;
+            pp = b1 & 3;
+            d.map = 1;
+            i += 2;
+        } else {
+            if (i + 3 >= avail) return 0;
+            uint8_t b1 = p[i + 1], b2 = p[i + 2];
+            d.rexR = !(b1 & 0x80); d.rexX = !(b1 & 0x40); d.rexB = !(b1 & 0x20);
+            d.map = b1 & 0x1F;
+            if (d.map < 1 || d.map > 3) return 0;
+            d.rexW = b2 & 0x80;
+            d.vvvv = (~b2 >> 3) & 15;
+            pp = b2 & 3;
+            i += 3;
+        }
+        d.opsize = pp == 1; d.rep = pp == 2; d.repne = pp == 3;
+        op = p[i++];
+    } else {
+        i++;
+        if (op == 0x0F) {
+            if (i >= avail) return 0;
+            op = p[i++];
+            d.map = 1;
+            if (op == 0x38 || op == 0x3A) {
+                d.map = op == 0x38 ? 2 : 3;
+                if (i >= avail) return 0;
+                op = p[i++];
+            }
+        }
+    }
+    d.opcode = op;
+
+    int wideImm = d.opsize ? 2 : 4;
+    if (d.map == 0) {
+        if (op < 0x40) {
+            unsigned lo = op & 7;
+            if (lo < 4) d.hasModrm = true;
+            else if (lo == 4) d.immSize = 1;
+            else if (lo == 5) d.immSize = wideImm;
+            else return 0;
+        }
+        else if (op < 0x50) return 0;
+        else if (op < 0x60) {}
+        else if (op == 0x63) d.hasModrm = true;
+        else if (op == 0x68) d.immSize = wideImm;
+        else if (op == 0x69) { d.hasModrm = true; d.immSize = wideImm; }
+        else if (op == 0x6A) d.immSize = 1;
+        else if (op == 0x6B) { d.hasModrm = true; d.immSize = 1; }
+        else if (op >= 0x6C && op <= 0x6F) {}
+        else if (op >= 0x70 && op <= 0x7F) d.relSize = 1;
+        else if (op == 0x80 || op == 0x83) { d.hasModrm = true; d.immSize = 1; }
+        else if (op == 0x81) { d.hasModrm = true; d.immSize = wideImm; }
+        else if (op >= 0x84 && op <= 0x8F) d.hasModrm = true;
+        else if (op == 0x9A) return 0;
+        else if (op >= 0x90 && op <= 0x9F) {}
+        else if (op >= 0xA0 && op <= 0xA3) d.immSize = d.addrsize ? 4 : 8;
+        else if (op == 0xA8) d.immSize = 1;
+        else if (op == 0xA9) d.immSize = wideImm;
+        else if (op >= 0xA4 && op <= 0xAF) {}
+        else if (op >= 0xB0 && op <= 0xB7) d.immSize = 1;
+        else if (op >= 0xB8 && op <= 0xBF) d.immSize = d.rexW ? 8 : wideImm;
+        else if (op == 0xC0 || op == 0xC1 || op == 0xC6) { d.hasModrm = true; d.immSize = 1; }
+        else if (op == 0xC7) { d.hasModrm = true; d.immSize = wideImm; }
+        else if (op == 0xC2 || op == 0xCA) d.immSize = 2;
+        else if (op == 0xC3 || op == 0xC9 || op == 0xCB || op == 0xCC || op == 0xCF) {}
+        else if (op == 0xC8) d.immSize = 3;
+        else if (op == 0xCD) d.immSize = 1;
+        else if (op >= 0xD0 && op <= 0xD3) d.hasModrm = true;
+        else if (op == 0xD7) {}
+        else if (op >= 0xD8 && op <= 0xDF) d.hasModrm = true;
+        else if (op >= 0xE0 && op <= 0xE3) d.relSize = 1;
+        else if (op >= 0xE4 && op <= 0xE7) d.immSize = 1;
+        else if (op == 0xE8 || op == 0xE9) d.relSize = 4;
+        else if (op == 0xEB) d.relSize = 1;
+        else if (op >= 0xEC && op <= 0xEF) {}
+        else if (op == 0xF1 || op == 0xF4 || op == 0xF5 || (op >= 0xF8 && op <= 0xFD)) {}
+        else if (op == 0xF6 || op == 0xF7 || op == 0xFE || op == 0xFF) d.hasModrm = true;
+        else return 0;
+    } else if (d.map == 1) {
+        if (op >= 0x80 && op <= 0x8F) {
+            if (d.vex) return 0;
+            d.relSize = 4;
+        }
+        else if (op == 0x77) {}
+        else if (!d.vex && (op == 0x05 || op == 0x06 || op == 0x07 || op == 0x08 || op == 0x09 ||
+                 op == 0x0B || op == 0x0E || (op >= 0x30 && op <= 0x35) || op == 0x37 ||
+                 op == 0xA0 || op == 0xA1 || op == 0xA2 || op == 0xA8 || op == 0xA9 ||
+                 op == 0xAA || (op >= 0xC8 && op <= 0xCF))) {}
+        else if (op == 0x04 || op == 0x0A || op == 0x0C || op == 0x0F || (op >= 0x24 && op <= 0x27) ||
+                 op == 0x36 || op == 0x39 || (op >= 0x3B && op <= 0x3F) || op == 0x7A ||
+                 op == 0x7B || op == 0xA6 || op == 0xA7 || op == 0xFF) return 0;
+        else {
+            d.hasModrm = true;
+            if ((op >= 0x70 && op <= 0x73) || op == 0xC2 || op == 0xC4 || op == 0xC5 || op == 0xC6 ||
+                (!d.vex && (op == 0xA4 || op == 0xAC || op == 0xBA))) {
+                d.immSize = 1;
+            }
+        }
+    } else {
+        d.hasModrm = true;
+        if (d.map == 3) d.immSize = 1;
+    }
+
+    // ModRM / SIB / displacement
+    bool hasMem = false;
+    MemOperand mem;
+    int dispSize = 0;
+    if (d.hasModrm) {
+        if (i >= avail) return 0;
+        uint8_t m = p[i++];
+        d.mod = m >> 6;
+        d.reg = ((m >> 3) & 7) | (d.rexR ? 8 : 0);
+        d.rm = m & 7;
+        if (d.mod != 3) {
+            hasMem = true;
+            if (d.rm == 4) {
+                if (i >= avail) return 0;
+                uint8_t s = p[i++];
+                unsigned idx = ((s >> 3) & 7) | (d.rexX ? 8 : 0);
+                mem.scale = static_cast<uint8_t>(1 << (s >> 6));
+                if (idx != 4) mem.index = gpr(idx);
+                if ((s & 7) == 5 && d.mod == 0) dispSize = 4;
+                else mem.base = gpr((s & 7) | (d.rexB ? 8 : 0));
+            } else if (d.rm == 5 && d.mod == 0) {
+                mem.ripRelative = true;
+                dispSize = 4;
+            } else {
+                mem.base = gpr(d.rm | (d.rexB ? 8 : 0));
+            }
+            if (d.mod == 1) dispSize = 1;
+            else if (d.mod == 2) dispSize = 4;
+            if (dispSize) {
+                if (i + dispSize > avail) return 0;
+                d.dispPos = static_cast<int>(i);
+                mem.disp = static_cast<int32_t>(readSigned(p + i, dispSize));
+                i += dispSize;
+            }
+        } else {
+            d.rm |= (d.rexB ? 8 : 0);
+        }
+    }
+
+    if (d.map == 0 && (op == 0xF6 || op == 0xF7) && (d.reg & 7) <= 1) {
+        d.immSize = op == 0xF6 ? 1 : wideImm;
+    }
+    if (d.immSize) {
+        if (i + d.immSize > avail) return 0;
+        d.imm = readSigned(p + i, d.immSize == 3 ? 2 : d.immSize);
+        i += d.immSize;
+    }
+    if (d.relSize) {
+        if (i + d.relSize > avail) return 0;
+        d.relPos = static_cast<int>(i);
+        i += d.relSize;
+    }
+    if (i > 15) return 0;
+
+    mi.bytes.assign(p, p + i);
+    mi.hasMem = hasMem;
+    mi.mem = mem;
+    mi.imm = d.imm;
+    if (d.relSize) {
+        mi.refPos = static_cast<uint8_t>(d.relPos);
+        mi.refSize = static_cast<uint8_t>(d.relSize);
+    } else if (mem.ripRelative) {
+        mi.refPos = static_cast<uint8_t>(d.dispPos);
+        mi.refSize = 4;
+    }
+
+    // ============================================
+    // Classification and register effects
+    // ============================================
+
+    const unsigned mod = d.mod, reg = d.reg, rm = d.rm;
+    const bool regForm = d.hasModrm && mod == 3;
+    const RegMask addr = hasMem ? (regBit(mem.base) | regBit(mem.index)) : 0;
+    const uint8_t width = d.rexW ? 8 : (d.opsize ? 2 : 4);
+    const RegMask RSPBIT = regBit(X64Reg::RSP);
+    const RegMask RAXBIT = regBit(X64Reg::RAX);
+    const RegMask RDXBIT = regBit(X64Reg::RDX);
+
+    // Byte registers 4-7 without REX are AH/CH/DH/BH
+    auto byteReg = [&](unsigned n) -> X64Reg {
+        if (!d.rex && n >= 4 && n < 8) return gpr(n - 4);
+        return gpr(n);
+    };
+    // r/m operand as a source
+    auto rmUse = [&](bool byteOp) -> RegMask {
+        if (!regForm) return addr;
+        return regBit(byteOp ? byteReg(rm) : gpr(rm));
+    };
+    // r/m operand as a destination (partial writes also read the register)
+    auto rmDef = [&](MachineInstr& out, bool byteOp, uint8_t w) {
+        if (regForm) {
+            RegMask b = regBit(byteOp ? byteReg(rm) : gpr(rm));
+            out.defs |= b;
+            if (byteOp || w < 4) out.uses |= b;
+        } else {
+            out.writesMem = true;
+        }
+    };
+    auto regDef = [&](MachineInstr& out, bool byteOp, uint8_t w) {
+        RegMask b = regBit(byteOp ? byteReg(reg) : gpr(reg));
+        out.defs |= b;
+        if (byteOp || w < 4) out.uses |= b;
+    };
+
+    mi.op = MOpcode::OTHER;
+    mi.width = width;
+    if (hasMem) mi.readsMem = true;
+
+    // The address is not a flat one, so nothing may reason about it
+    if (d.segment) { makeOpaque(mi); return i; }
+
+    if (d.map == 0) {
+        if (d.rep || d.repne) {
+            // rep-prefixed string ops; "rep ret" is still a return
+            if (op != 0xC3 && op != 0x90) { makeOpaque(mi); return i; }
+        }
+        if (op < 0x40) {
+            MAluOp alu = static_cast<MAluOp>(op >> 3);
+            bool byteOp = !(op & 1);
+            unsigned lo = op & 7;
+            bool writesDst = alu != MAluOp::CMP;
+            RegMask flagsIn = (alu == MAluOp::ADC || alu == MAluOp::SBB) ? REG_MASK_FLAGS : 0;
+            mi.aluOp = alu;
+            mi.defs |= REG_MASK_FLAGS;
+            mi.uses |= flagsIn;
+            if (lo >= 4) {
+                mi.uses |= RAXBIT;
+                if (writesDst) mi.defs |= RAXBIT;
+                if (lo == 5 && width >= 4) {
+                    mi.op = MOpcode::ALU_RI;
+                    mi.dst = X64Reg::RAX;
+                }
+                else if (writesDst) mi.uses |= RAXBIT;
+                return i;
+            }
+            bool dir = op & 2;  // reg is the destination
+            if (regForm) {
+                X64Reg r = byteOp ? byteReg(reg) : gpr(reg);
+                X64Reg m = byteOp ? byteReg(rm) : gpr(rm);
+                X64Reg dst = dir ? r : m, src = dir ? m : r;
+                bool zeroIdiom = (alu == MAluOp::XOR || alu == MAluOp::SUB) && dst == src;
+                if (!zeroIdiom) mi.uses |= regBit(dst) | regBit(src);
+                if (writesDst) mi.defs |= regBit(dst);
+                if (byteOp || width < 4) {
+                    mi.uses |= regBit(dst);
+                } else {
+                    mi.op = MOpcode::ALU_RR;
+                    mi.dst = dst;
+                    mi.src = src;
+                }
+            } else {
+                mi.uses |= addr | regBit(byteOp ? byteReg(reg) : gpr(reg));
+                if (writesDst) {
+                    if (dir) regDef(mi, byteOp, width);
+                    else mi.writesMem = true;
+                }
+                if (d.lock) mi.barrier = true;
+            }
+            return i;
+        }
+        if (op >= 0x50 && op <= 0x57) {
+            X64Reg r = gpr((op - 0x50) | (d.rexB ? 8 : 0));
+            if (!d.opsize) { mi.op = MOpcode::PUSH; mi.src = r; }
+            mi.uses = regBit(r) | RSPBIT;
+            mi.defs = RSPBIT;
+            mi.writesMem = true;
+            return i;
+        }
+        if (op >= 0x58 && op <= 0x5F) {
+            X64Reg r = gpr((op - 0x58) | (d.rexB ? 8 : 0));
+            if (!d.opsize) { mi.op = MOpcode::POP; mi.dst = r; }
+            mi.uses = RSPBIT | (d.opsize ? regBit(r) : 0);
+            mi.defs = regBit(r) | RSPBIT;
+            mi.readsMem = true;
+            return i;
+        }
+        switch (op) {
+            case 0x63:  // movsxd
+                mi.uses |= rmUse(false);
+                regDef(mi, false, width);
+                return i;
+            case 0x68: case 0x6A:  // push imm
+                mi.uses = RSPBIT;
+                mi.defs = RSPBIT;
+                mi.writesMem = true;
+                return i;
+            case 0x69: case 0x6B:  // imul r, r/m, imm
+                mi.uses |= rmUse(false);
+                regDef(mi, false, width);
+                mi.defs |= REG_MASK_FLAGS;
+                return i;
+            case 0x80: case 0x81: case 0x83: {
+                MAluOp alu = static_cast<MAluOp>(reg & 7);
+                bool byteOp = op == 0x80;
+                mi.aluOp = alu;
+                mi.defs |= REG_MASK_FLAGS;
+                if (alu == MAluOp::ADC || alu == MAluOp::SBB) mi.uses |= REG_MASK_FLAGS;
+                mi.uses |= rmUse(byteOp);
+                if (alu != MAluOp::CMP) rmDef(mi, byteOp, width);
+                if (regForm && !byteOp && width >= 4) {
+                    mi.op = MOpcode::ALU_RI;
+                    mi.dst = gpr(rm);
+                }
+                if (d.lock) mi.barrier = true;
+                return i;
+            }
+            case 0x84: case 0x85: {
+                bool byteOp = op == 0x84;
+                mi.uses |= rmUse(byteOp) | regBit(byteOp ? byteReg(reg) : gpr(reg));
+                mi.defs |= REG_MASK_FLAGS;
+                if (regForm && !byteOp && width >= 4) {
+                    mi.op = MOpcode::TEST_RR;
+                    mi.dst = gpr(rm);
+                    mi.src = gpr(reg);
+                }
+                return i;
+            }
+            case 0x86: case 0x87: {
+                bool byteOp = op == 0x86;
+                mi.uses |= rmUse(byteOp);
+                rmDef(mi, byteOp, width);
+                mi.uses |= regBit(byteOp ? byteReg(reg) : gpr(reg));
+                regDef(mi, byteOp, width);
+                if (!regForm) mi.barrier = true;   // Implicitly locked
+                return i;
+            }
+            case 0x88: case 0x8A: {
+                // Byte moves
+                if (op == 0x88) {
+                    mi.uses |= regBit(byteReg(reg)) | (regForm ? 0 : addr);
+                    rmDef(mi, true, 1);
+                    if (!regForm) mi.readsMem = false;
+                } else {
+                    mi.uses |= rmUse(true);
+                    regDef(mi, true, 1);
+                }
+                return i;
+            }
+            case 0x89:
+                if (regForm) {
+                    mi.uses |= regBit(gpr(reg));
+                    rmDef(mi, false, width);
+                    if (width >= 4) { mi.op = MOpcode::MOV_RR; mi.dst = gpr(rm); mi.src = gpr(reg); }
+                } else {
+                    mi.uses |= regBit(gpr(reg)) | addr;
+                    mi.readsMem = false;
+                    mi.writesMem = true;
+                    if (width >= 4) { mi.op = MOpcode::STORE; mi.src = gpr(reg); }
+                }
+                return i;
+            case 0x8B:
+                mi.uses |= rmUse(false);
+                regDef(mi, false, width);
+                if (width >= 4) {
+                    mi.op = regForm ? MOpcode::MOV_RR : MOpcode::LOAD;
+                    mi.dst = gpr(reg);
+                    if (regForm) mi.src = gpr(rm);
+                }
+                return i;
+            case 0x8D:
+                if (regForm) { makeOpaque(mi); return i; }
+                mi.readsMem = false;
+                mi.uses |= addr;
+                regDef(mi, false, width);
+                if (width >= 4 && !d.addrsize) { mi.op = MOpcode::LEA; mi.dst = gpr(reg); }
+                return i;
+            case 0x8F:  // pop r/m
+                if ((reg & 7) != 0) { makeOpaque(mi); return i; }
+                mi.uses |= RSPBIT | addr;
+                mi.defs |= RSPBIT;
+                mi.readsMem = true;
+                rmDef(mi, false, 8);
+                return i;
+            case 0x90:
+                if (!d.rexB) {
+                    // nop / pause: kept in place (inline asm may rely on them)
+                    mi.op = d.rep ? MOpcode::OTHER : MOpcode::NOP;
+                    mi.barrier = true;
+                    return i;
+                }
+                [[fallthrough]];
+            case 0x91: case 0x92: case 0x93: case 0x94: case 0x95: case 0x96: case 0x97: {
+                X64Reg r = gpr((op - 0x90) | (d.rexB ? 8 : 0));
+                mi.uses = mi.defs = regBit(r) | RAXBIT;
+                return i;
+            }
+            case 0x98:  // cbw/cwde/cdqe
+                mi.uses = mi.defs = RAXBIT;
+                return i;
+            case 0x99:  // cwd/cdq/cqo
+                mi.uses = RAXBIT | (width < 4 ? RDXBIT : 0);
+                mi.defs = RDXBIT;
+                return i;
+            case 0x9C:  // pushf
+                mi.uses = REG_MASK_FLAGS | RSPBIT;
+                mi.defs = RSPBIT;
+                mi.writesMem = true;
+                return i;
+            case 0x9E: case 0x9F:  // sahf / lahf
+                mi.uses = mi.defs = RAXBIT | REG_MASK_FLAGS;
+                return i;
+            case 0xA8: case 0xA9:  // test al/eax, imm
+                mi.uses = RAXBIT;
+                mi.defs = REG_MASK_FLAGS;
+                return i;
+            case 0xC0: case 0xC1: case 0xD0: case 0xD1: case 0xD2: case 0xD3: {
+                // Shifts/rotates (a zero count leaves flags untouched)
+                if ((reg & 7) == 6) { makeOpaque(mi); return i; }
+                bool byteOp = !(op & 1);
+                mi.uses |= rmUse(byteOp) | REG_MASK_FLAGS;
+                if (op == 0xD2 || op == 0xD3) mi.uses |= regBit(X64Reg::RCX);
+                rmDef(mi, byteOp, width);
+                mi.defs |= REG_MASK_FLAGS;
+                return i;
+            }
+            case 0xC2: case 0xC3:
+                mi.op = MOpcode::RET;
+                mi.uses = REG_MASK_ALL;
+                mi.defs = RSPBIT;
+                mi.readsMem = true;
+                mi.barrier = true;
+                return i;
+            case 0xC6: case 0xC7: {
+                if ((reg & 7) != 0) { makeOpaque(mi); return i; }
+                bool byteOp = op == 0xC6;
+                if (regForm) {
+                    rmDef(mi, byteOp, width);
+                    if (!byteOp && width >= 4) {
+                        mi.op = MOpcode::MOV_RI;
+                        mi.dst = gpr(rm);
+                        mi.imm = width == 8 ? d.imm : static_cast<int64_t>(static_cast<uint32_t>(d.imm));
+                    }
+                } else {
+                    mi.uses |= addr;
+                    mi.readsMem = false;
+                    mi.writesMem = true;
+                    if (!byteOp && width >= 4) mi.op = MOpcode::STORE_IMM;
+                }
+                return i;
+            }
+            case 0xC9:  // leave
+                mi.uses = regBit(X64Reg::RBP);
+                mi.defs = regBit(X64Reg::RBP) | RSPBIT;
+                mi.readsMem = true;
+                return i;
+            case 0xE8:
+                // Calls never take arguments in flags
+                mi.op = MOpcode::CALL;
+                mi.uses = REG_MASK_ALL & ~REG_MASK_FLAGS;
+                mi.defs = REG_MASK_ALL;
+                mi.readsMem = mi.writesMem = true;
+                mi.barrier = true;
+                return i;
+            case 0xE9: case 0xEB:
+                mi.op = MOpcode::JMP;
+                mi.barrier = true;
+                return i;
+            case 0xF5: case 0xF8: case 0xF9: case 0xFC: case 0xFD:  // cmc/clc/stc/cld/std
+                mi.uses = mi.defs = REG_MASK_FLAGS;
+                return i;
+            case 0xF6: case 0xF7: {
+                bool byteOp = op == 0xF6;
+                unsigned sub = reg & 7;
+                mi.uses |= rmUse(byteOp);
+                mi.defs |= REG_MASK_FLAGS;
+                if (sub <= 1) return i;                     // test r/m, imm
+                if (sub == 2 || sub == 3) {                 // not / neg
+                    if (sub == 2) mi.defs &= ~REG_MASK_FLAGS;
+                    rmDef(mi, byteOp, width);
+                    if (d.lock) mi.barrier = true;
+                    return i;
+                }
+                // mul/imul/div/idiv: rdx:rax
+                mi.uses |= RAXBIT | RDXBIT;
+                mi.defs |= RAXBIT | RDXBIT;
+                if (sub >= 6) mi.barrier = true;            // May fault
+                return i;
+            }
+            case 0xFE: case 0xFF: {
+                unsigned sub = reg & 7;
+                bool byteOp = op == 0xFE;
+                if (sub <= 1) {                             // inc / dec (CF preserved)
+                    mi.uses |= rmUse(byteOp) | REG_MASK_FLAGS;
+                    rmDef(mi, byteOp, width);
+                    mi.defs |= REG_MASK_FLAGS;
+                    if (d.lock) mi.barrier = true;
+                    return i;
+                }
+                if (!byteOp && sub == 2) {                  // call r/m
+                    mi.op = MOpcode::CALL;
+                    mi.uses = REG_MASK_ALL & ~REG_MASK_FLAGS;
+                    mi.defs = REG_MASK_ALL;
+                    mi.readsMem = mi.writesMem = true;
+                    mi.barrier = true;
+                    return i;
+                }
+                if (!byteOp && sub == 6) {                  // push r/m
+                    mi.uses |= rmUse(false) | RSPBIT;
+                    mi.defs |= RSPBIT;
+                    mi.writesMem = true;
+                    return i;
+                }
+                makeOpaque(mi);                             // jmp r/m, far forms
+                return i;
+            }
+            default:
+                if (op >= 0x70 && op <= 0x7F) {
+                    mi.op = MOpcode::JCC;
+                    mi.cond = op & 15;
+                    mi.uses = REG_MASK_FLAGS;
+                    mi.barrier = true;
+                    return i;
+                }
+                if (op >= 0xB0 && op <= 0xB7) {
+                    X64Reg r = byteReg((op - 0xB0) | (d.rexB ? 8 : 0));
+                    mi.uses = mi.defs = regBit(r);
+                    return i;
+                }
+                if (op >= 0xB8 && op <= 0xBF) {
+                    X64Reg r = gpr((op - 0xB8) | (d.rexB ? 8 : 0));
+                    mi.defs = regBit(r);
+                    if (width < 4) { mi.uses = regBit(r); return i; }
+                    mi.op = MOpcode::MOV_RI;
+                    mi.dst = r;
+                    mi.imm = width == 8 ? d.imm : static_cast<int64_t>(static_cast<uint32_t>(d.imm));
+                    return i;
+                }
+                makeOpaque(mi);
+                return i;
+        }
+    }
+
+    if (d.map == 1 && !d.vex) {
+        if (op >= 0x80 && op <= 0x8F) {
+            mi.op = MOpcode::JCC;
+            mi.cond = op & 15;
+            mi.uses = REG_MASK_FLAGS;
+            mi.barrier = true;
+            return i;
+        }
+        if (op >= 0x40 && op <= 0x4F) {                     // cmovcc
+            mi.uses |= rmUse(false) | REG_MASK_FLAGS | regBit(gpr(reg));
+            mi.defs |= regBit(gpr(reg));
+            return i;
+        }
+        if (op >= 0x90 && op <= 0x9F) {                     // setcc
+            mi.readsMem = false;
+            mi.uses |= REG_MASK_FLAGS | (regForm ? 0 : addr);
+            rmDef(mi, true, 1);
+            return i;
+        }
+        switch (op) {
+            case 0x1F:                                      // multi-byte nop
+                mi.op = MOpcode::NOP;
+                mi.readsMem = false;
+                mi.barrier = true;
+                return i;
+            case 0x18: case 0x0D: case 0x1E:                // prefetch / endbr
+                mi.readsMem = false;
+                mi.uses |= addr;
+                mi.barrier = true;
+                return i;
+            case 0xA3: case 0xAB: case 0xB3: case 0xBB: case 0xBA:
+                if (!regForm) { makeOpaque(mi); return i; }
+                mi.uses |= regBit(gpr(rm)) | (op == 0xBA ? 0 : regBit(gpr(reg)));
+                mi.defs |= REG_MASK_FLAGS;
+                if (op != 0xA3 && !(op == 0xBA && (reg & 7) == 4)) rmDef(mi, false, width);
+                return i;
+            case 0xA4: case 0xA5: case 0xAC: case 0xAD:     // shld / shrd
+                mi.uses |= rmUse(false) | regBit(gpr(reg)) | REG_MASK_FLAGS;
+                if (op & 1) mi.uses |= regBit(X64Reg::RCX);
+                rmDef(mi, false, width);
+                mi.defs |= REG_MASK_FLAGS;
+                return i;
+            case 0xAF:                                      // imul r, r/m
+                mi.uses |= rmUse(false) | regBit(gpr(reg));
+                regDef(mi, false, width);
+                mi.defs |= REG_MASK_FLAGS;
+                return i;
+            case 0xB6: case 0xB7: case 0xBE: case 0xBF:     // movzx / movsx
+                mi.uses |= rmUse(op == 0xB6 || op == 0xBE);
+                regDef(mi, false, width);
+                return i;
+            case 0xB8: case 0xBC: case 0xBD:                // popcnt / bsf / bsr / tzcnt / lzcnt
+                if (op == 0xB8 && !d.rep) { makeOpaque(mi); return i; }
+                mi.uses |= rmUse(false) | regBit(gpr(reg));
+                mi.defs |= regBit(gpr(reg)) | REG_MASK_FLAGS;
+                return i;
+            case 0xC3:                                      // movnti
+                if (regForm) { makeOpaque(mi); return i; }
+                mi.uses |= addr | regBit(gpr(reg));
+                mi.readsMem = false;
+                mi.writesMem = true;
+                return i;
+            default:
+                if (op >= 0xC8 && op <= 0xCF) {             // bswap
+                    X64Reg r = gpr((op - 0xC8) | (d.rexB ? 8 : 0));
+                    mi.uses = mi.defs = regBit(r);
+                    return i;
+                }
+                break;
+        }
+        bool vectorOp = (op >= 0x10 && op <= 0x17) || (op >= 0x28 && op <= 0x2F) ||
+                        (op >= 0x50 && op <= 0x76) || (op >= 0x78 && op <= 0x7F) ||
+                        op == 0xC2 || (op >= 0xC4 && op <= 0xC6) || (op >= 0xD0 && op <= 0xFE);
+        if (!vectorOp) { makeOpaque(mi); return i; }
+    }
+
+    if (d.map == 3 && op >= 0x60 && op <= 0x63) { makeOpaque(mi); return i; }  // pcmp{e,i}str{i,m}
+
+    if (d.vex && d.map == 1 && op == 0x77) {                // vzeroupper / vzeroall
+        mi.uses = mi.defs = REG_MASK_XMM;
+        return i;
+    }
+
+    // SSE/AVX/BMI: registers may be XMM or GPR depending on the form, so
+    // account for both; every written register is also treated as read.
+    RegMask r = regBit(xmm(reg)) | regBit(gpr(reg));
+    RegMask m = regForm ? (regBit(xmm(rm)) | regBit(gpr(rm))) : addr;
+    RegMask v = d.vex ? (regBit(xmm(d.vvvv)) | regBit(gpr(d.vvvv))) : 0;
+    mi.uses |= r | m | v;
+    mi.defs |= r | (regForm ? m : 0) | v;
+    if (hasMem) mi.writesMem = true;
+    bool setsFlags = (d.map == 1 && (op == 0x2E || op == 0x2F)) ||
+                     (d.map == 2 && (op == 0x17 || op == 0x0E || op == 0x0F));
+    if (setsFlags) mi.defs |= REG_MASK_FLAGS;
+    if (d.vex && d.map == 2 && op >= 0xF0) {
+        mi.uses |= REG_MASK_FLAGS;
+        mi.defs |= REG_MASK_FLAGS;
+    }
+    return i;
+}
+
+// ============================================
+// Lifting
+// ============================================
+
+bool MachineCode::lift(const X64Assembler& assembler) {
+    instrs.clear();
+    endLabels.clear();
+    endAliases.clear();
+    unboundLabels.clear();
+
+    const std::vector<uint8_t>& code = assembler.code;
+    const size_t n = code.size();
+    std::vector<int32_t> startIndex(n + 1, -1);
+    std::vector<size_t> offsets;
+
+    size_t off = 0;
+    while (off < n) {
+        MachineInstr mi;
+        size_t len = decode(code.data() + off, n - off, mi);
+        if (len == 0) return false;
+        mi.id = static_cast<uint32_t>(instrs.size());
+        startIndex[off] = static_cast<int32_t>(instrs.size());
+        offsets.push_back(off);
+        instrs.push_back(std::move(mi));
+        off += len;
+    }
+    startIndex[n] = static_cast<int32_t>(instrs.size());
+    nextId_ = static_cast<uint32_t>(instrs.size());
+
+    auto instrAt = [&](size_t pos) -> int32_t {
+        auto it = std::upper_bound(offsets.begin(), offsets.end(), pos);
+        if (it == offsets.begin()) return -1;
+        return static_cast<int32_t>(it - offsets.begin() - 1);
+    };
+
+    for (const auto& [name, pos] : assembler.labels) {
+        if (pos > n) { unboundLabels[name] = pos; continue; }
+        if (pos == n) { endLabels.push_back(name); continue; }
+        if (startIndex[pos] < 0) return false;
+        instrs[startIndex[pos]].labels.push_back(name);
+    }
+
+    for (const auto& [pos, name] : assembler.labelFixups) {
+        int32_t idx = instrAt(pos);
+        if (idx < 0) return false;
+        MachineInstr& mi = instrs[idx];
+        if (mi.refSize != 4 || offsets[idx] + mi.refPos != pos || mi.refKind != MRefKind::NONE) return false;
+        mi.refKind = MRefKind::LABEL;
+        mi.refLabel = name;
+    }
+
+    for (const auto& [pos, rva] : assembler.ripFixups) {
+        int32_t idx = instrAt(pos);
+        if (idx < 0) return false;
+        MachineInstr& mi = instrs[idx];
+        if (mi.refSize != 4 || offsets[idx] + mi.refPos != pos || mi.refKind != MRefKind::NONE) return false;
+        if (rva >= CODE_RVA && rva <= CODE_RVA + n) return false;   // Would move with the code
+        mi.refKind = MRefKind::RVA;
+        mi.refRVA = rva;
+    }
+
+    // Remaining pc-relative fields were patched by hand: bind them to the target instruction
+    for (size_t k = 0; k < instrs.size(); k++) {
+        MachineInstr& mi = instrs[k];
+        if (mi.refSize == 0 || mi.refKind != MRefKind::NONE) continue;
+        int64_t rel = readSigned(mi.bytes.data() + mi.refPos, mi.refSize);
+        int64_t target = static_cast<int64_t>(offsets[k] + mi.size()) + rel;
+        if (target < 0 || target > static_cast<int64_t>(n) || startIndex[target] < 0) return false;
+        mi.refKind = MRefKind::INSTR;
+        mi.refId = static_cast<size_t>(target) == n ? END_ID : instrs[startIndex[target]].id;
+    }
+
+    refreshTargets();
+    return true;
+}
+
+// ============================================
+// Lowering
+// ============================================
+
+bool MachineCode::lower(X64Assembler& out) const {
+    std::unordered_map<uint32_t, size_t> idOffset;
+    std::vector<size_t> offsets(instrs.size());
+    size_t off = 0;
+    for (size_t k = 0; k < instrs.size(); k++) {
+        const MachineInstr& mi = instrs[k];
+        offsets[k] = off;
+        idOffset[mi.id] = off;
+        for (uint32_t a : mi.aliases) idOffset[a] = off;
+        off += mi.size();
+    }
+    for (uint32_t a : endAliases) idOffset[a] = off;
+    idOffset[END_ID] = off;
+
+    out.code.clear();
+    out.labels.clear();
+    out.labelFixups.clear();
+    out.ripFixups.clear();
+    out.code.reserve(off);
+
+    for (size_t k = 0; k < instrs.size(); k++) {
+        const MachineInstr& mi = instrs[k];
+        size_t start = out.code.size();
+        out.code.insert(out.code.end(), mi.bytes.begin(), mi.bytes.end());
+        for (const auto& name : mi.labels) out.labels[name] = start;
+        switch (mi.refKind) {
+            case MRefKind::LABEL:
+                out.labelFixups.push_back({start + mi.refPos, mi.refLabel});
+                break;
+            case MRefKind::RVA:
+                out.ripFixups.push_back({start + mi.refPos, mi.refRVA});
+                break;
+            case MRefKind::INSTR: {
+                auto it = idOffset.find(mi.refId);
+                if (it == idOffset.end()) return false;
+                int64_t rel = static_cast<int64_t>(it->second) - static_cast<int64_t>(start + mi.size());
+                if (mi.refSize == 1 && (rel < -128 || rel > 127)) return false;
+                writeSigned(out.code.data() + start + mi.refPos, mi.refSize, rel);
+                break;
+            }
+            case MRefKind::NONE:
+                break;
+        }
+    }
+    for (const auto& name : endLabels) out.labels[name] = off;
+    for (const auto& [name, pos] : unboundLabels) out.labels[name] = pos;
+    return true;
+}
+
+// ============================================
+// List maintenance
+// ============================================
+
+void MachineCode::compact() {
+    std::vector<std::string> pendingLabels;
+    std::vector<uint32_t> pendingAliases;
+    size_t w = 0;
+    for (size_t k = 0; k < instrs.size(); k++) {
+        MachineInstr& mi = instrs[k];
+        if (mi.dead) {
+            pendingLabels.insert(pendingLabels.end(), mi.labels.begin(), mi.labels.end());
+            pendingAliases.push_back(mi.id);
+            pendingAliases.insert(pendingAliases.end(), mi.aliases.begin(), mi.aliases.end());
+            continue;
+        }
+        if (!pendingLabels.empty()) {
+            mi.labels.insert(mi.labels.begin(), pendingLabels.begin(), pendingLabels.end());
+            pendingLabels.clear();
+        }
+        if (!pendingAliases.empty()) {
+            mi.aliases.insert(mi.aliases.end(), pendingAliases.begin(), pendingAliases.end());
+            pendingAliases.clear();
+        }
+        if (w != k) instrs[w] = std::move(mi);
+        w++;
+    }
+    instrs.resize(w);
+    endLabels.insert(endLabels.begin(), pendingLabels.begin(), pendingLabels.end());
+    endAliases.insert(endAliases.end(), pendingAliases.begin(), pendingAliases.end());
+    refreshTargets();
+}
+
+void MachineCode::refreshTargets() {
+    targetIds_.assign(nextId_, false);
+    for (const auto& mi : instrs) {
+        if (mi.refKind == MRefKind::INSTR && mi.refId < nextId_) targetIds_[mi.refId] = true;
+    }
+}
+
+bool MachineCode::isBranchTarget(size_t i) const {
+    const MachineInstr& mi = instrs[i];
+    if (!mi.labels.empty()) return true;
+    auto targeted = [&](uint32_t id) { return id >= targetIds_.size() || targetIds_[id]; };
+    if (targeted(mi.id)) return true;
+    for (uint32_t a : mi.aliases) {
+        if (targeted(a)) return true;
+    }
+    return false;
+}
+
+bool MachineCode::startsBlock(size_t i) const {
+    if (i == 0 || isBranchTarget(i)) return true;
+    return instrs[i - 1].endsBlock() || instrs[i - 1].op == MOpcode::CALL;
+}
+
+size_t MachineCode::nextLive(size_t i) const {
+    for (size_t k = i + 1; k < instrs.size(); k++) {
+        if (!instrs[k].dead) return k;
+    }
+    return instrs.size();
+}
+
+// ============================================
+// Encoders
+// ============================================
+
+namespace {
+
+// Encode through a scratch assembler so the bytes match what codegen emits
+MachineInstr finish(const X64Assembler& a) {
+    MachineInstr mi;
+    MachineCode::decode(a.code.data(), a.code.size(), mi);
+    return mi;
+}
+
+} // namespace
+
+MachineInstr MachineCode::makeMovRR(X64Reg dst, X64Reg src) {
+    X64Assembler a;
+    a.emit(X64Op::MOV, X64Operand::r(dst), X64Operand::r(src));
+    return finish(a);
+}
+
+MachineInstr MachineCode::makeMovRI(X64Reg dst, int64_t imm) {
+    X64Assembler a;
+    a.emit(X64Op::MOV, X64Operand::r(dst), X64Operand::immediate(imm));
+    return finish(a);
+}
+
+MachineInstr MachineCode::makeXorRR32(X64Reg reg) {
+    X64Assembler a;
+    a.emit(X64Op::XOR, X64Operand::r(reg, 4), X64Operand::r(reg, 4));
+    return finish(a);
+}
+
+MachineInstr MachineCode::makeTestRR(X64Reg reg) {
+    X64Assembler a;
+    a.emit(X64Op::TEST, X64Operand::r(reg), X64Operand::r(reg));
+    return finish(a);
+}
+
+MachineInstr MachineCode::makeIncDec(X64Reg reg, bool dec) {
+    X64Assembler a;
+    a.emit(dec ? X64Op::DEC : X64Op::INC, X64Operand::r(reg));
+    return finish(a);
+}
+
+MachineInstr MachineCode::makeJcc32(uint8_t cond) {
+    X64Assembler a;
+    a.jcc(static_cast<X64Cond>(cond & 15), "");
+    return finish(a);
+}
+
+} // namespace tyl
@@ -0,0 +1,174 @@
+// Tyl Compiler - Machine IR
+// Instruction-level view of generated x64 code (opcode, operands, label refs).
+// Codegen writes through X64Assembler; before labels are resolved the byte
+// stream is lifted into a list of MachineInstr so that peephole, scheduling
+// and dead-instruction removal can delete and reorder real instructions.
+// Lowering re-encodes the list and recomputes every pc-relative field, so
+// removed instructions shrink the code instead of leaving NOP sleds.
+#ifndef TYL_MACHINE_IR_H
+#define TYL_MACHINE_IR_H
+
+#include "x64_assembler.h"
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+namespace tyl {
+
+// Register sets for dependency and liveness analysis
+// Bits 0-15 = GPRs, 16-31 = XMM registers, bit 32 = RFLAGS
+using RegMask = uint64_t;
+constexpr RegMask REG_MASK_GPR = 0xFFFFull;
+constexpr RegMask REG_MASK_XMM = 0xFFFF0000ull;
+constexpr RegMask REG_MASK_FLAGS = 1ull << 32;
+constexpr RegMask REG_MASK_ALL = REG_MASK_GPR | REG_MASK_XMM | REG_MASK_FLAGS;
+
+inline RegMask regBit(X64Reg r) {
+    return r == X64Reg::NONE ? 0 : (1ull << static_cast<unsigned>(r));
+}
+
+// Recognized instruction forms
+// OTHER has exact effects but no rewrite patterns; OPAQUE is anything the
+// decoder does not model and is treated as reading/writing everything.
+enum class MOpcode : uint8_t {
+    OPAQUE,
+    OTHER,
+    NOP,
+    MOV_RR,      // mov dst, src
+    MOV_RI,      // mov dst, imm
+    LOAD,        // mov dst, [mem]
+    STORE,       // mov [mem], src
+    STORE_IMM,   // mov [mem], imm
+    LEA,         // lea dst, [mem]
+    PUSH,        // push src
+    POP,         // pop dst
+    ALU_RR,      // aluOp dst, src
+    ALU_RI,      // aluOp dst, imm
+    TEST_RR,     // test dst, src
+    JMP,
+    JCC,
+    CALL,
+    RET
+};
+
+// Group-1 ALU operations in x86 encoding order
+enum class MAluOp : uint8_t { ADD, OR, ADC, SBB, AND, SUB, XOR, CMP };
+
+// Memory operand: [base + index*scale + disp] or [rip + disp]
+struct MemOperand {
+    X64Reg base = X64Reg::NONE;
+    X64Reg index = X64Reg::NONE;
+    uint8_t scale = 1;
+    int32_t disp = 0;
+    bool ripRelative = false;
+
+    bool operator==(const MemOperand& o) const {
+        return base == o.base && index == o.index && scale == o.scale &&
+               disp == o.disp && ripRelative == o.ripRelative;
+    }
+};
+
+// What the pc-relative field of an instruction refers to
+enum class MRefKind : uint8_t {
+    NONE,
+    LABEL,   // Symbolic label (X64Assembler::labelFixups)
+    INSTR,   // Another instruction by id (hard-coded rel8/rel32 patched by codegen)
+    RVA      // Absolute RVA outside the code section (X64Assembler::ripFixups)
+};
+
+struct MachineInstr {
+    MOpcode op = MOpcode::OPAQUE;
+    MAluOp aluOp = MAluOp::ADD;
+    uint8_t cond = 0;                  // Condition code for JCC
+    uint8_t width = 8;                 // Operand width in bytes
+    X64Reg dst = X64Reg::NONE;
+    X64Reg src = X64Reg::NONE;
+    MemOperand mem;
+    bool hasMem = false;
+    int64_t imm = 0;
+
+    std::vector<uint8_t> bytes;        // Encoding (pc-relative field rewritten on lowering)
+
+    // pc-relative reference
+    MRefKind refKind = MRefKind::NONE;
+    uint8_t refPos = 0;                // Offset of the field inside bytes
+    uint8_t refSize = 0;               // 1 or 4
+    std::string refLabel;              // LABEL
+    uint32_t refId = 0;                // INSTR
+    uint32_t refRVA = 0;               // RVA
+
+    // Identity: labels and ids of deleted instructions that fell through to this one
+    uint32_t id = 0;
+    std::vector<uint32_t> aliases;
+    std::vector<std::string> labels;
+
+    // Effects
+    RegMask uses = 0;
+    RegMask defs = 0;
+    bool readsMem = false;
+    bool writesMem = false;
+    bool barrier = false;              // Never moved or removed (calls, atomics, unknown)
+    bool dead = false;                 // Scheduled for removal by MachineCode::compact()
+
+    bool isBranch() const { return op == MOpcode::JMP || op == MOpcode::JCC; }
+    bool endsBlock() const {
+        return op == MOpcode::JMP || op == MOpcode::JCC || op == MOpcode::RET ||
+               (op == MOpcode::OPAQUE && refKind != MRefKind::NONE);
+    }
+    bool hasLabelOrAlias() const { return !labels.empty() || !aliases.empty(); }
+    size_t size() const { return bytes.size(); }
+};
+
+// A lifted code section
+class MachineCode {
+public:
+    std::vector<MachineInstr> instrs;
+    std::vector<std::string> endLabels;           // Labels bound to the end of the code
+    std::vector<uint32_t> endAliases;             // Deleted trailing instructions
+    std::map<std::string, size_t> unboundLabels;  // Reserved labels never emitted (kept as-is)
+
+    // Lift the assembler's byte stream. Returns false (leaving the assembler
+    // untouched) if any byte range cannot be decoded exactly or a label/fixup
+    // does not line up with an instruction boundary.
+    bool lift(const X64Assembler& assembler);
+
+    // Re-encode into a fresh assembler state (code, labels, fixups).
+    // Returns false if a rel8 displacement no longer fits.
+    bool lower(X64Assembler& out) const;
+
+    // Remove instructions marked dead, moving their labels to the next one
+    void compact();
+
+    // Whether instruction i can be reached other than by falling through
+    bool isBranchTarget(size_t i) const;
+    // Whether instruction i starts a basic block
+    bool startsBlock(size_t i) const;
+    // Next instruction after i that is not marked dead (instrs.size() if none)
+    size_t nextLive(size_t i) const;
+
+    // Rebuild the referenced-id table after the instruction list changes
+    void refreshTargets();
+
+    // Decode a single instruction; returns its length or 0 if unsupported
+    static size_t decode(const uint8_t* p, size_t avail, MachineInstr& out);
+
+    // Encoders for instructions created by the optimizers
+    static MachineInstr makeMovRR(X64Reg dst, X64Reg src);
+    static MachineInstr makeMovRI(X64Reg dst, int64_t imm);
+    static MachineInstr makeXorRR32(X64Reg reg);
+    static MachineInstr makeTestRR(X64Reg reg);
+    static MachineInstr makeIncDec(X64Reg reg, bool dec);
+    static MachineInstr makeJcc32(uint8_t cond);
+
+    uint32_t newId() { return nextId_++; }
+
+private:
+    uint32_t nextId_ = 0;
+    std::vector<bool> targetIds_;   // Indexed by id: referenced by an INSTR ref
+};
+
+} // namespace tyl
+
+#endif // TYL_MACHINE_IR_H
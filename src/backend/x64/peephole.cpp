@@ -1,730 +1,303 @@
 // Tyl Compiler - Peephole Optimizer Implementation
-// Enhanced with register coalescing and more patterns for O3 optimization
+// Pattern rewrites and dead-instruction removal on the machine instruction list
 #include "peephole.h"
-#include <cstring>
 
 namespace tyl {
 
-size_t PeepholeOptimizer::optimize(std::vector<uint8_t>& code) {
+namespace {
+
+constexpr int kLivenessWindow = 64;   // Instructions scanned by deadAfter()
+constexpr int kPatternWindow = 16;    // Instructions allowed between paired instructions
+constexpr RegMask kFrameRegs = (1ull << static_cast<unsigned>(X64Reg::RSP)) |
+                               (1ull << static_cast<unsigned>(X64Reg::RBP));
+
+bool isFullWidthMov(const MachineInstr& mi) {
+    return mi.op == MOpcode::MOV_RR && mi.width == 8;
+}
+
+} // namespace
+
+size_t PeepholeOptimizer::optimize(MachineCode& mc) {
     removedBytes_ = 0;
     optimizationCount_ = 0;
-    
+    removedInstructions_ = 0;
+
     // Multiple passes until no more optimizations
     bool changed = true;
     int passes = 0;
     const int maxPasses = 10;  // Prevent infinite loops
-    
+
     while (changed && passes < maxPasses) {
         changed = false;
         passes++;
-        
-        for (size_t i = 0; i < code.size(); ) {
-            // Try each optimization pattern in order of effectiveness
-            
-            // Register coalescing - most impactful for O3
-            if (aggressiveMode_ && optimizeRegisterCoalescing(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // Redundant xor after xor (xor rax,rax; xor rax,rax)
-            if (optimizeRedundantXor(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // Direct push/pop elimination
-            if (optimizeDirectPushPop(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // Redundant push/pop pairs
-            if (optimizeRedundantPushPop(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // Push/pop with mov optimization
-            if (optimizePushPop(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // Small constant optimization
-            if (optimizeSmallConstants(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // Redundant mov elimination
-            if (optimizeRedundantMov(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // xor to zero optimization
-            if (aggressiveMode_ && optimizeXorZero(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // inc/dec optimization
-            if (aggressiveMode_ && optimizeIncDec(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // LEA arithmetic optimization
-            if (aggressiveMode_ && optimizeLeaArithmetic(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // test/cmp optimization
-            if (aggressiveMode_ && optimizeTestCmp(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            // xor before mov imm optimization
-            if (aggressiveMode_ && optimizeXorBeforeMovImm(code, i)) {
-                changed = true;
-                continue;
-            }
-            
-            ++i;
-        }
-    }
-    
-    // Final pass: remove all NOP instructions
-    removeNops(code);
-    
-    return code.size();
-}
 
-// Pattern: push rax; pop rcx -> mov rcx, rax (direct, no intervening code)
-// This is the most common pattern from stack-based code generation
-bool PeepholeOptimizer::optimizeDirectPushPop(std::vector<uint8_t>& code, size_t& i) {
-    if (i + 1 >= code.size()) return false;
-    
-    // push rax (0x50) followed immediately by pop rcx (0x59)
-    if (code[i] == 0x50 && code[i + 1] == 0x59) {
-        // push rax (1 byte) + pop rcx (1 byte) = 2 bytes
-        // mov rcx, rax = 3 bytes (48 89 C1)
-        // Not a win, skip this pattern
-        return false;
-    }
-    
-    // push rax (0x50) followed immediately by pop rdx (0x5A)
-    if (code[i] == 0x50 && code[i + 1] == 0x5A) {
-        // mov rdx, rax = 48 89 C2 (3 bytes) vs push+pop = 2 bytes
-        // Not a win, skip
-        return false;
-    }
-    
-    // push rcx (0x51) followed immediately by pop rax (0x58)
-    if (code[i] == 0x51 && code[i + 1] == 0x58) {
-        // mov rax, rcx = 48 89 C8 (3 bytes) vs push+pop = 2 bytes
-        // Not a win, skip
-        return false;
-    }
-    
-    return false;
-}
-
-// Pattern: mov rax, imm64; push rax; ... ; pop rcx
-// Replace with: mov rcx, imm64 (if nothing uses rax in between)
-// Or for small values: mov ecx, imm32
-bool PeepholeOptimizer::optimizePushPop(std::vector<uint8_t>& code, size_t& i) {
-    // Look for: push rax (0x50) followed soon by pop rcx (0x59) or pop rdx (0x5A)
-    if (i + 1 >= code.size()) return false;
-    
-    if (!isPushRax(code, i)) return false;
-    
-    // Find matching pop within reasonable distance
-    size_t pushPos = i;
-    size_t searchLimit = std::min(i + 30, code.size());
-    
-    for (size_t j = i + 1; j < searchLimit; ++j) {
-        // Check for pop rcx or pop rdx
-        if (isPopRcx(code, j) || isPopRdx(code, j)) {
-            // Check if there's a mov rax, imm64 right before the push
-            if (pushPos >= 10 && isMovRaxImm64(code, pushPos - 10)) {
-                int64_t imm = getImm64(code, pushPos - 10);
-                
-                // Check if value fits in 32 bits
-                if (imm >= 0 && imm <= 0x7FFFFFFF) {
-                    // Replace: mov rax, imm64 (10 bytes) + push rax (1 byte) + ... + pop rcx/rdx (1 byte)
-                    // With: mov ecx/edx, imm32 (5 bytes) + nops for the push/pop
-                    
-                    uint8_t destReg = isPopRcx(code, j) ? 0xB9 : 0xBA; // mov ecx or mov edx
-                    
-                    // Build replacement for mov rax, imm64 -> mov ecx/edx, imm32
-                    std::vector<uint8_t> replacement = {
-                        destReg,  // mov ecx/edx, imm32
-                        (uint8_t)(imm & 0xFF),
-                        (uint8_t)((imm >> 8) & 0xFF),
-                        (uint8_t)((imm >> 16) & 0xFF),
-                        (uint8_t)((imm >> 24) & 0xFF)
-                    };
-                    
-                    // Replace mov rax, imm64 with mov ecx/edx, imm32 + nops
-                    for (size_t k = 0; k < 5; ++k) {
-                        code[pushPos - 10 + k] = replacement[k];
-                    }
-                    // NOP out the rest of mov rax, imm64
-                    for (size_t k = 5; k < 10; ++k) {
-                        code[pushPos - 10 + k] = 0x90; // NOP
-                    }
-                    // NOP out push rax
-                    code[pushPos] = 0x90;
-                    // NOP out pop rcx/rdx
-                    code[j] = 0x90;
-                    
-                    removedBytes_ += 7; // Saved 10+1+1 - 5 = 7 bytes (NOPs will be removed later)
-                    optimizationCount_++;
-                    return true;
-                }
+        for (size_t i = 0; i < mc.instrs.size(); i++) {
+            if (mc.instrs[i].dead) continue;
+
+            if (optimizeRedundantMov(mc, i) ||
+                optimizePushPop(mc, i) ||
+                optimizeStoreLoad(mc, i) ||
+                optimizeConstantCopy(mc, i) ||
+                optimizeZeroCopy(mc, i) ||
+                optimizeMovImm(mc, i) ||
+                optimizeTestCmp(mc, i) ||
+                (aggressiveMode_ && optimizeIncDec(mc, i)) ||
+                optimizeJumps(mc, i)) {
+                changed = true;
             }
-            break;
         }
-        
-        // If we hit another push or something that modifies the stack, stop
-        if (code[j] == 0x50 || code[j] == 0x51 || code[j] == 0x52 || 
-            code[j] == 0x53 || code[j] == 0x54 || code[j] == 0x55 ||
-            code[j] == 0xC3 || code[j] == 0xE8 || code[j] == 0xFF) {
-            break;
-        }
-    }
-    
-    return false;
-}
-
-// Pattern: mov rax, small_value (10 bytes) -> mov eax, small_value (5 bytes)
-// Only for values that fit in 32 bits and don't need sign extension
-// NOTE: This optimization is now handled at code generation time, so we skip it here
-// to avoid leaving NOP artifacts in the binary
-bool PeepholeOptimizer::optimizeSmallConstants(std::vector<uint8_t>& code, size_t& i) {
-    // Skip this optimization - it's now done at codegen time
-    // Keeping the function for potential future use with other patterns
-    (void)code;
-    (void)i;
-    return false;
-}
+        mc.compact();
 
-// Pattern: mov [rbp+x], rax; mov rax, [rbp+x] -> just keep the first mov
-bool PeepholeOptimizer::optimizeRedundantMov(std::vector<uint8_t>& code, size_t& i) {
-    // Look for mov [rbp+disp32], rax followed by mov rax, [rbp+disp32]
-    // mov [rbp+disp32], rax = 48 89 85 xx xx xx xx (7 bytes)
-    // mov rax, [rbp+disp32] = 48 8B 85 xx xx xx xx (7 bytes)
-    
-    if (i + 14 > code.size()) return false;
-    
-    // Check for mov [rbp+disp32], rax
-    if (code[i] == 0x48 && code[i+1] == 0x89 && code[i+2] == 0x85) {
-        int32_t disp1 = *(int32_t*)&code[i+3];
-        
-        // Check if next instruction is mov rax, [rbp+disp32] with same displacement
-        if (code[i+7] == 0x48 && code[i+8] == 0x8B && code[i+9] == 0x85) {
-            int32_t disp2 = *(int32_t*)&code[i+10];
-            
-            if (disp1 == disp2) {
-                // NOP out the second mov (the load)
-                for (size_t k = 7; k < 14; ++k) {
-                    code[i + k] = 0x90;
-                }
-                removedBytes_ += 7;
-                optimizationCount_++;
-                i += 14;
-                return true;
-            }
+        if (deadCodeElim_ && eliminateDeadInstructions(mc)) {
+            changed = true;
+            mc.compact();
         }
     }
-    
-    return false;
-}
-
-// Helper functions
 
-bool PeepholeOptimizer::isPushRax(const std::vector<uint8_t>& code, size_t i) {
-    return i < code.size() && code[i] == 0x50;
+    return removedBytes_ > 0 ? static_cast<size_t>(removedBytes_) : 0;
 }
 
-bool PeepholeOptimizer::isPopRcx(const std::vector<uint8_t>& code, size_t i) {
-    return i < code.size() && code[i] == 0x59;
-}
-
-bool PeepholeOptimizer::isPopRdx(const std::vector<uint8_t>& code, size_t i) {
-    return i < code.size() && code[i] == 0x5A;
-}
-
-bool PeepholeOptimizer::isMovRaxImm64(const std::vector<uint8_t>& code, size_t i) {
-    // mov rax, imm64 = 48 B8 xx xx xx xx xx xx xx xx (10 bytes)
-    if (i + 10 > code.size()) return false;
-    return code[i] == 0x48 && code[i + 1] == 0xB8;
-}
-
-bool PeepholeOptimizer::isMovRaxMemRbp(const std::vector<uint8_t>& code, size_t i) {
-    // mov rax, [rbp+disp32] = 48 8B 85 xx xx xx xx (7 bytes)
-    if (i + 7 > code.size()) return false;
-    return code[i] == 0x48 && code[i + 1] == 0x8B && code[i + 2] == 0x85;
-}
+// ============================================
+// Helpers
+// ============================================
 
-int64_t PeepholeOptimizer::getImm64(const std::vector<uint8_t>& code, size_t i) {
-    if (i + 10 > code.size()) return 0;
-    int64_t val = 0;
-    for (int k = 0; k < 8; ++k) {
-        val |= ((int64_t)code[i + 2 + k]) << (k * 8);
+bool PeepholeOptimizer::deadAfter(const MachineCode& mc, size_t i, RegMask regs) const {
+    size_t k = i;
+    for (int steps = 0; regs && steps < kLivenessWindow; steps++) {
+        k = mc.nextLive(k);
+        if (k >= mc.instrs.size()) return false;
+        const MachineInstr& mi = mc.instrs[k];
+        if (mi.uses & regs) return false;
+        regs &= ~mi.defs;
+        if (!regs) return true;
+        // Anything still pending may be read on another path
+        if (mi.endsBlock() || mi.op == MOpcode::CALL) return false;
     }
-    return val;
+    return regs == 0;
 }
 
-void PeepholeOptimizer::removeBytes(std::vector<uint8_t>& code, size_t start, size_t count) {
-    if (start + count <= code.size()) {
-        code.erase(code.begin() + start, code.begin() + start + count);
+bool PeepholeOptimizer::jumpsTo(const MachineCode& mc, size_t i, size_t j) const {
+    const MachineInstr& br = mc.instrs[i];
+    if (j >= mc.instrs.size()) {
+        if (br.refKind == MRefKind::LABEL) {
+            for (const auto& name : mc.endLabels) if (name == br.refLabel) return true;
+        }
+        return false;
     }
-}
-
-void PeepholeOptimizer::replaceBytes(std::vector<uint8_t>& code, size_t start,
-                                      const std::vector<uint8_t>& replacement, size_t oldLen) {
-    if (start + oldLen > code.size()) return;
-    
-    // Replace bytes
-    for (size_t k = 0; k < replacement.size() && start + k < code.size(); ++k) {
-        code[start + k] = replacement[k];
+    const MachineInstr& target = mc.instrs[j];
+    if (br.refKind == MRefKind::LABEL) {
+        for (const auto& name : target.labels) if (name == br.refLabel) return true;
+        return false;
     }
-    
-    // If replacement is shorter, fill with NOPs
-    for (size_t k = replacement.size(); k < oldLen && start + k < code.size(); ++k) {
-        code[start + k] = 0x90;
+    if (br.refKind == MRefKind::INSTR) {
+        if (br.refId == target.id) return true;
+        for (uint32_t a : target.aliases) if (a == br.refId) return true;
     }
+    return false;
 }
 
-void PeepholeOptimizer::removeNops(std::vector<uint8_t>& code) {
-    // IMPORTANT: We cannot safely remove NOPs after code generation because
-    // relative jump offsets have already been calculated. Removing bytes
-    // would invalidate all jump targets.
-    //
-    // The NOPs inserted by peephole optimizations are cosmetic - they don't
-    // affect correctness, just code size. A proper solution would require:
-    // 1. Tracking all jump instructions and their targets
-    // 2. Recalculating offsets after NOP removal
-    // 3. Potentially iterating if the offset size changes (e.g., rel8 to rel32)
-    //
-    // For now, we leave NOPs in place. The code is still correct and the
-    // size overhead is minimal (typically a few dozen bytes).
-    (void)code;
-}
-
-bool PeepholeOptimizer::isPushRcx(const std::vector<uint8_t>& code, size_t i) {
-    return i < code.size() && code[i] == 0x51;
-}
-
-bool PeepholeOptimizer::isPopRax(const std::vector<uint8_t>& code, size_t i) {
-    return i < code.size() && code[i] == 0x58;
+void PeepholeOptimizer::replace(MachineCode& mc, size_t i, MachineInstr repl) {
+    MachineInstr& old = mc.instrs[i];
+    removedBytes_ += static_cast<int>(old.size()) - static_cast<int>(repl.size());
+    repl.id = old.id;
+    repl.aliases = std::move(old.aliases);
+    repl.labels = std::move(old.labels);
+    old = std::move(repl);
+    optimizationCount_++;
 }
 
-bool PeepholeOptimizer::isNop(const std::vector<uint8_t>& code, size_t i) {
-    return i < code.size() && code[i] == 0x90;
+void PeepholeOptimizer::kill(MachineCode& mc, size_t i) {
+    MachineInstr& mi = mc.instrs[i];
+    removedBytes_ += static_cast<int>(mi.size());
+    removedInstructions_++;
+    mi.dead = true;
+    optimizationCount_++;
 }
 
 // ============================================
-// New O3 Optimization Patterns
+// Patterns
 // ============================================
 
-// Pattern: xor rax, rax; mov REG, rax -> xor REG, REG
-// This eliminates redundant register moves after zeroing
-bool PeepholeOptimizer::optimizeRegisterCoalescing(std::vector<uint8_t>& code, size_t& i) {
-    if (i + 6 > code.size()) return false;
-    
-    // Check for xor rax, rax (48 31 C0)
-    if (code[i] == 0x48 && code[i+1] == 0x31 && code[i+2] == 0xC0) {
-        // mov rbx, rax = 48 89 C3
-        if (code[i+3] == 0x48 && code[i+4] == 0x89 && code[i+5] == 0xC3) {
-            // Replace with xor ebx, ebx (31 DB) - 2 bytes
-            code[i] = 0x31;
-            code[i+1] = 0xDB;
-            code[i+2] = 0x90;
-            code[i+3] = 0x90;
-            code[i+4] = 0x90;
-            code[i+5] = 0x90;
-            removedBytes_ += 4;
-            optimizationCount_++;
-            i += 6;
-            return true;
-        }
-        // mov rcx, rax = 48 89 C1
-        if (code[i+3] == 0x48 && code[i+4] == 0x89 && code[i+5] == 0xC1) {
-            // Replace with xor ecx, ecx (31 C9) - 2 bytes
-            code[i] = 0x31;
-            code[i+1] = 0xC9;
-            code[i+2] = 0x90;
-            code[i+3] = 0x90;
-            code[i+4] = 0x90;
-            code[i+5] = 0x90;
-            removedBytes_ += 4;
-            optimizationCount_++;
-            i += 6;
-            return true;
-        }
-        // mov rdx, rax = 48 89 C2
-        if (code[i+3] == 0x48 && code[i+4] == 0x89 && code[i+5] == 0xC2) {
-            // Replace with xor edx, edx (31 D2) - 2 bytes
-            code[i] = 0x31;
-            code[i+1] = 0xD2;
-            code[i+2] = 0x90;
-            code[i+3] = 0x90;
-            code[i+4] = 0x90;
-            code[i+5] = 0x90;
-            removedBytes_ += 4;
-            optimizationCount_++;
-            i += 6;
-            return true;
-        }
-        // mov r12, rax = 49 89 C4
-        if (code[i+3] == 0x49 && code[i+4] == 0x89 && code[i+5] == 0xC4) {
-            // Replace with xor r12d, r12d (45 31 E4) - 3 bytes
-            code[i] = 0x45;
-            code[i+1] = 0x31;
-            code[i+2] = 0xE4;
-            code[i+3] = 0x90;
-            code[i+4] = 0x90;
-            code[i+5] = 0x90;
-            removedBytes_ += 3;
-            optimizationCount_++;
-            i += 6;
-            return true;
-        }
-        // mov r13, rax = 49 89 C5
-        if (code[i+3] == 0x49 && code[i+4] == 0x89 && code[i+5] == 0xC5) {
-            // Replace with xor r13d, r13d (45 31 ED)
-            code[i] = 0x45;
-            code[i+1] = 0x31;
-            code[i+2] = 0xED;
-            code[i+3] = 0x90;
-            code[i+4] = 0x90;
-            code[i+5] = 0x90;
-            removedBytes_ += 3;
-            optimizationCount_++;
-            i += 6;
-            return true;
-        }
-        // mov r14, rax = 49 89 C6
-        if (code[i+3] == 0x49 && code[i+4] == 0x89 && code[i+5] == 0xC6) {
-            // Replace with xor r14d, r14d (45 31 F6)
-            code[i] = 0x45;
-            code[i+1] = 0x31;
-            code[i+2] = 0xF6;
-            code[i+3] = 0x90;
-            code[i+4] = 0x90;
-            code[i+5] = 0x90;
-            removedBytes_ += 3;
-            optimizationCount_++;
-            i += 6;
-            return true;
-        }
-        // mov r15, rax = 49 89 C7
-        if (code[i+3] == 0x49 && code[i+4] == 0x89 && code[i+5] == 0xC7) {
-            // Replace with xor r15d, r15d (45 31 FF)
-            code[i] = 0x45;
-            code[i+1] = 0x31;
-            code[i+2] = 0xFF;
-            code[i+3] = 0x90;
-            code[i+4] = 0x90;
-            code[i+5] = 0x90;
-            removedBytes_ += 3;
-            optimizationCount_++;
-            i += 6;
-            return true;
-        }
+// mov r, r (64-bit) is a no-op; the 32-bit form zero-extends and is kept
+bool PeepholeOptimizer::optimizeRedundantMov(MachineCode& mc, size_t i) {
+    const MachineInstr& mi = mc.instrs[i];
+    if (!isFullWidthMov(mi) || mi.dst != mi.src) return false;
+    kill(mc, i);
+    return true;
+}
+
+// push a; <code not touching rsp>; pop b
+//   a == b  ->  (nothing), if the code does not write a
+//   a != b  ->  mov b, a at the push, if the code does not touch b
+bool PeepholeOptimizer::optimizePushPop(MachineCode& mc, size_t i) {
+    const MachineInstr& push = mc.instrs[i];
+    if (push.op != MOpcode::PUSH || push.src == X64Reg::RSP) return false;
+    const RegMask rspBit = regBit(X64Reg::RSP);
+
+    size_t j = i;
+    RegMask betweenUses = 0, betweenDefs = 0;
+    for (int steps = 0; steps < kPatternWindow; steps++) {
+        j = mc.nextLive(j);
+        if (j >= mc.instrs.size() || mc.isBranchTarget(j)) return false;
+        const MachineInstr& mi = mc.instrs[j];
+        if (mi.op == MOpcode::POP) break;
+        if (mi.barrier || mi.endsBlock() || ((mi.uses | mi.defs) & rspBit)) return false;
+        betweenUses |= mi.uses;
+        betweenDefs |= mi.defs;
     }
-    
-    return false;
-}
-
-// Pattern: xor rax, rax; xor rax, rax -> xor rax, rax (remove duplicate)
-bool PeepholeOptimizer::optimizeRedundantXor(std::vector<uint8_t>& code, size_t& i) {
-    if (i + 6 > code.size()) return false;
-    
-    // xor rax, rax = 48 31 C0
-    if (code[i] == 0x48 && code[i+1] == 0x31 && code[i+2] == 0xC0) {
-        if (code[i+3] == 0x48 && code[i+4] == 0x31 && code[i+5] == 0xC0) {
-            // NOP out the second xor
-            code[i+3] = 0x90;
-            code[i+4] = 0x90;
-            code[i+5] = 0x90;
-            removedBytes_ += 3;
-            optimizationCount_++;
-            i += 6;
-            return true;
-        }
-    }
-    
-    return false;
-}
-
-// Pattern: push rax; pop rax -> (remove both, they cancel out)
-bool PeepholeOptimizer::optimizeRedundantPushPop(std::vector<uint8_t>& code, size_t& i) {
-    if (i + 2 > code.size()) return false;
-    
-    // push rax (0x50) followed by pop rax (0x58)
-    if (code[i] == 0x50 && code[i+1] == 0x58) {
-        code[i] = 0x90;
-        code[i+1] = 0x90;
-        removedBytes_ += 2;
-        optimizationCount_++;
-        i += 2;
+    if (j >= mc.instrs.size() || mc.instrs[j].op != MOpcode::POP) return false;
+
+    X64Reg a = push.src, b = mc.instrs[j].dst;
+    if (b == X64Reg::RSP) return false;
+    if (a == b) {
+        if (betweenDefs & regBit(a)) return false;
+        kill(mc, i);
+        kill(mc, j);
         return true;
     }
-    
-    // push rcx (0x51) followed by pop rcx (0x59)
-    if (code[i] == 0x51 && code[i+1] == 0x59) {
-        code[i] = 0x90;
-        code[i+1] = 0x90;
-        removedBytes_ += 2;
-        optimizationCount_++;
-        i += 2;
-        return true;
+    if ((betweenUses | betweenDefs) & regBit(b)) return false;
+    MachineInstr mov = MachineCode::makeMovRR(b, a);
+    if (optimizeForSize_ && mov.size() > push.size() + mc.instrs[j].size()) return false;
+    kill(mc, j);
+    replace(mc, i, std::move(mov));
+    optimizationCount_--;  // One rewrite, not two
+    return true;
+}
+
+// mov [m], a; <code not writing memory, a or m's registers>; mov b, [m]
+//   -> the load becomes mov b, a (or disappears when b == a)
+bool PeepholeOptimizer::optimizeStoreLoad(MachineCode& mc, size_t i) {
+    const MachineInstr& store = mc.instrs[i];
+    if (store.op != MOpcode::STORE || store.width != 8 || store.mem.ripRelative) return false;
+    RegMask pinned = regBit(store.src) | regBit(store.mem.base) | regBit(store.mem.index);
+
+    size_t j = i;
+    for (int steps = 0; steps < kPatternWindow; steps++) {
+        j = mc.nextLive(j);
+        if (j >= mc.instrs.size() || mc.isBranchTarget(j)) return false;
+        const MachineInstr& mi = mc.instrs[j];
+        if (mi.op == MOpcode::LOAD && mi.width == 8 && mi.mem == store.mem) break;
+        if (mi.barrier || mi.endsBlock() || mi.writesMem || (mi.defs & pinned)) return false;
     }
-    
-    // push rdx (0x52) followed by pop rdx (0x5A)
-    if (code[i] == 0x52 && code[i+1] == 0x5A) {
-        code[i] = 0x90;
-        code[i+1] = 0x90;
-        removedBytes_ += 2;
-        optimizationCount_++;
-        i += 2;
-        return true;
+    if (j >= mc.instrs.size()) return false;
+    const MachineInstr& load = mc.instrs[j];
+    if (load.op != MOpcode::LOAD || !(load.mem == store.mem)) return false;
+
+    if (load.dst == store.src) {
+        kill(mc, j);
+    } else {
+        replace(mc, j, MachineCode::makeMovRR(load.dst, store.src));
     }
-    
-    return false;
-}
-
-// Pattern: mov rax, 0 -> xor eax, eax (smaller and faster)
-bool PeepholeOptimizer::optimizeXorZero(std::vector<uint8_t>& code, size_t& i) {
-    // mov rax, 0 = 48 B8 00 00 00 00 00 00 00 00 (10 bytes)
-    if (i + 10 > code.size()) return false;
-    
-    if (code[i] == 0x48 && code[i+1] == 0xB8) {
-        // Check if immediate is 0
-        bool isZero = true;
-        for (int j = 2; j < 10; j++) {
-            if (code[i+j] != 0) {
-                isZero = false;
-                break;
-            }
-        }
-        if (isZero) {
-            // Replace with xor eax, eax (31 C0) - 2 bytes
-            code[i] = 0x31;
-            code[i+1] = 0xC0;
-            for (int j = 2; j < 10; j++) {
-                code[i+j] = 0x90;
-            }
-            removedBytes_ += 8;
-            optimizationCount_++;
-            i += 10;
-            return true;
-        }
-    }
-    
-    return false;
-}
-
-// Pattern: add rax, 1 -> inc rax (smaller)
-bool PeepholeOptimizer::optimizeIncDec(std::vector<uint8_t>& code, size_t& i) {
-    // add rax, 1 = 48 83 C0 01 (4 bytes) or 48 05 01 00 00 00 (6 bytes)
-    if (i + 4 > code.size()) return false;
-    
-    // add rax, imm8 = 48 83 C0 xx
-    if (code[i] == 0x48 && code[i+1] == 0x83 && code[i+2] == 0xC0) {
-        if (code[i+3] == 0x01) {
-            // Replace with inc rax (48 FF C0) - 3 bytes
-            code[i] = 0x48;
-            code[i+1] = 0xFF;
-            code[i+2] = 0xC0;
-            code[i+3] = 0x90;
-            removedBytes_ += 1;
-            optimizationCount_++;
-            i += 4;
-            return true;
-        }
-        if (code[i+3] == 0xFF) {  // -1 in signed byte
-            // Replace with dec rax (48 FF C8) - 3 bytes
-            code[i] = 0x48;
-            code[i+1] = 0xFF;
-            code[i+2] = 0xC8;
-            code[i+3] = 0x90;
-            removedBytes_ += 1;
-            optimizationCount_++;
-            i += 4;
-            return true;
-        }
-    }
-    
-    // sub rax, 1 = 48 83 E8 01
-    if (code[i] == 0x48 && code[i+1] == 0x83 && code[i+2] == 0xE8 && code[i+3] == 0x01) {
-        // Replace with dec rax (48 FF C8) - 3 bytes
-        code[i] = 0x48;
-        code[i+1] = 0xFF;
-        code[i+2] = 0xC8;
-        code[i+3] = 0x90;
-        removedBytes_ += 1;
-        optimizationCount_++;
-        i += 4;
+    return true;
+}
+
+// mov a, imm; mov b, a  ->  mov a, imm; mov b, imm (a usually dies afterwards)
+bool PeepholeOptimizer::optimizeConstantCopy(MachineCode& mc, size_t i) {
+    const MachineInstr& movImm = mc.instrs[i];
+    if (movImm.op != MOpcode::MOV_RI) return false;
+    size_t j = mc.nextLive(i);
+    if (j >= mc.instrs.size() || mc.isBranchTarget(j)) return false;
+    const MachineInstr& copy = mc.instrs[j];
+    if (!isFullWidthMov(copy) || copy.src != movImm.dst || copy.dst == movImm.dst) return false;
+    MachineInstr repl = MachineCode::makeMovRI(copy.dst, movImm.imm);
+    if (repl.size() > copy.size() && !deadAfter(mc, j, regBit(movImm.dst))) return false;
+    replace(mc, j, std::move(repl));
+    return true;
+}
+
+// xor a, a; mov b, a  ->  xor a, a; xor b, b (same flags as the first xor)
+bool PeepholeOptimizer::optimizeZeroCopy(MachineCode& mc, size_t i) {
+    const MachineInstr& zero = mc.instrs[i];
+    if (zero.op != MOpcode::ALU_RR || zero.aluOp != MAluOp::XOR || zero.dst != zero.src) return false;
+    size_t j = mc.nextLive(i);
+    if (j >= mc.instrs.size() || mc.isBranchTarget(j)) return false;
+    const MachineInstr& copy = mc.instrs[j];
+    if (copy.op != MOpcode::MOV_RR || copy.src != zero.dst || copy.dst == zero.dst) return false;
+    MachineInstr repl = MachineCode::makeXorRR32(copy.dst);
+    if (repl.size() > copy.size()) return false;
+    replace(mc, j, std::move(repl));
+    return true;
+}
+
+// Pick the shortest encoding of mov r, imm; zero becomes xor r32, r32 when flags are dead
+bool PeepholeOptimizer::optimizeMovImm(MachineCode& mc, size_t i) {
+    const MachineInstr& mi = mc.instrs[i];
+    if (mi.op != MOpcode::MOV_RI) return false;
+    if (mi.imm == 0 && aggressiveMode_ && deadAfter(mc, i, REG_MASK_FLAGS)) {
+        replace(mc, i, MachineCode::makeXorRR32(mi.dst));
         return true;
     }
-    
-    return false;
-}
-
-// Pattern: add rax, rcx -> lea rax, [rax + rcx] (can be combined with other ops)
-bool PeepholeOptimizer::optimizeLeaArithmetic(std::vector<uint8_t>& code, size_t& i) {
-    // This is more of a preparation for future optimizations
-    // For now, we'll skip this as it doesn't always improve code
-    (void)code;
-    (void)i;
-    return false;
-}
-
-// Pattern: cmp rax, 0; je label -> test rax, rax; je label (smaller)
-bool PeepholeOptimizer::optimizeTestCmp(std::vector<uint8_t>& code, size_t& i) {
-    // cmp rax, 0 = 48 83 F8 00 (4 bytes)
-    if (i + 4 > code.size()) return false;
-    
-    if (code[i] == 0x48 && code[i+1] == 0x83 && code[i+2] == 0xF8 && code[i+3] == 0x00) {
-        // Replace with test rax, rax (48 85 C0) - 3 bytes
-        code[i] = 0x48;
-        code[i+1] = 0x85;
-        code[i+2] = 0xC0;
-        code[i+3] = 0x90;
-        removedBytes_ += 1;
-        optimizationCount_++;
-        i += 4;
-        return true;
-    }
-    
-    // cmp rcx, 0 = 48 83 F9 00
-    if (code[i] == 0x48 && code[i+1] == 0x83 && code[i+2] == 0xF9 && code[i+3] == 0x00) {
-        // Replace with test rcx, rcx (48 85 C9) - 3 bytes
-        code[i] = 0x48;
-        code[i+1] = 0x85;
-        code[i+2] = 0xC9;
-        code[i+3] = 0x90;
-        removedBytes_ += 1;
-        optimizationCount_++;
-        i += 4;
+    MachineInstr repl = MachineCode::makeMovRI(mi.dst, mi.imm);
+    if (repl.size() >= mi.size()) return false;
+    replace(mc, i, std::move(repl));
+    return true;
+}
+
+// cmp r, 0  ->  test r, r (identical ZF/SF/PF/CF/OF)
+bool PeepholeOptimizer::optimizeTestCmp(MachineCode& mc, size_t i) {
+    const MachineInstr& mi = mc.instrs[i];
+    if (mi.op != MOpcode::ALU_RI || mi.aluOp != MAluOp::CMP || mi.imm != 0 || mi.width != 8) return false;
+    MachineInstr repl = MachineCode::makeTestRR(mi.dst);
+    if (repl.size() >= mi.size()) return false;
+    replace(mc, i, std::move(repl));
+    return true;
+}
+
+// add/sub r, 1  ->  inc/dec r, only when nothing reads CF afterwards
+bool PeepholeOptimizer::optimizeIncDec(MachineCode& mc, size_t i) {
+    const MachineInstr& mi = mc.instrs[i];
+    if (mi.op != MOpcode::ALU_RI || mi.width != 8 || mi.imm != 1) return false;
+    if (mi.aluOp != MAluOp::ADD && mi.aluOp != MAluOp::SUB) return false;
+    MachineInstr repl = MachineCode::makeIncDec(mi.dst, mi.aluOp == MAluOp::SUB);
+    if (repl.size() >= mi.size() || !deadAfter(mc, i, REG_MASK_FLAGS)) return false;
+    replace(mc, i, std::move(repl));
+    return true;
+}
+
+// jmp L; L:               ->  L:
+// jcc L1; jmp L2; L1:     ->  jncc L2; L1:
+bool PeepholeOptimizer::optimizeJumps(MachineCode& mc, size_t i) {
+    const MachineInstr& br = mc.instrs[i];
+    if (!br.isBranch() || br.refKind == MRefKind::NONE || br.refKind == MRefKind::RVA) return false;
+    size_t j = mc.nextLive(i);
+
+    if (br.op == MOpcode::JMP) {
+        if (!jumpsTo(mc, i, j)) return false;
+        kill(mc, i);
         return true;
     }
-    
-    return false;
-}
-
-// Pattern: xor rax, rax followed by mov eax, imm32 -> just mov eax, imm32
-// The xor is redundant because mov eax, imm32 zero-extends to rax
-bool PeepholeOptimizer::optimizeXorBeforeMovImm(std::vector<uint8_t>& code, size_t& i) {
-    // xor rax, rax = 48 31 C0 (3 bytes)
-    // xor eax, eax = 31 C0 (2 bytes)
-    if (i + 5 > code.size()) return false;
-    
-    // Check for xor rax, rax (48 31 C0) followed by mov eax, imm32 (B8 xx xx xx xx)
-    if (code[i] == 0x48 && code[i+1] == 0x31 && code[i+2] == 0xC0) {
-        // Check if next instruction is mov eax, imm32 (B8 xx xx xx xx)
-        if (i + 8 <= code.size() && code[i+3] == 0xB8) {
-            // NOP out the xor rax, rax - mov eax zero-extends to rax anyway
-            code[i] = 0x90;
-            code[i+1] = 0x90;
-            code[i+2] = 0x90;
-            removedBytes_ += 3;
-            optimizationCount_++;
-            i += 3;
-            return true;
-        }
-        // Check for mov r8d, imm32 (41 B8 xx xx xx xx)
-        if (i + 9 <= code.size() && code[i+3] == 0x41 && code[i+4] == 0xB8) {
-            // This is xor rax, rax followed by mov r8d, imm32
-            // The xor is likely for a different purpose, skip
-            return false;
-        }
-    }
-    
-    // Check for xor eax, eax (31 C0) followed by mov eax, imm32 (B8 xx xx xx xx)
-    if (code[i] == 0x31 && code[i+1] == 0xC0) {
-        if (i + 7 <= code.size() && code[i+2] == 0xB8) {
-            // NOP out the xor eax, eax
-            code[i] = 0x90;
-            code[i+1] = 0x90;
-            removedBytes_ += 2;
-            optimizationCount_++;
-            i += 2;
-            return true;
-        }
-    }
-    
-    return false;
-}
-
-// Pattern: movzx optimization (not commonly needed, placeholder)
-bool PeepholeOptimizer::optimizeMovZeroExtend(std::vector<uint8_t>& code, size_t& i) {
-    (void)code;
-    (void)i;
-    return false;
-}
-
-// Helper functions for new patterns
-bool PeepholeOptimizer::isXorRaxRax(const std::vector<uint8_t>& code, size_t i) {
-    if (i + 3 > code.size()) return false;
-    return code[i] == 0x48 && code[i+1] == 0x31 && code[i+2] == 0xC0;
-}
 
-bool PeepholeOptimizer::isXorRcxRcx(const std::vector<uint8_t>& code, size_t i) {
-    if (i + 3 > code.size()) return false;
-    return code[i] == 0x48 && code[i+1] == 0x31 && code[i+2] == 0xC9;
-}
-
-bool PeepholeOptimizer::isMovRaxRcx(const std::vector<uint8_t>& code, size_t i) {
-    if (i + 3 > code.size()) return false;
-    return code[i] == 0x48 && code[i+1] == 0x89 && code[i+2] == 0xC8;
-}
-
-bool PeepholeOptimizer::isMovRcxRax(const std::vector<uint8_t>& code, size_t i) {
-    if (i + 3 > code.size()) return false;
-    return code[i] == 0x48 && code[i+1] == 0x89 && code[i+2] == 0xC1;
-}
-
-bool PeepholeOptimizer::isMovR12Rax(const std::vector<uint8_t>& code, size_t i) {
-    if (i + 3 > code.size()) return false;
-    return code[i] == 0x49 && code[i+1] == 0x89 && code[i+2] == 0xC4;
-}
-
-bool PeepholeOptimizer::isMovR13Rax(const std::vector<uint8_t>& code, size_t i) {
-    if (i + 3 > code.size()) return false;
-    return code[i] == 0x49 && code[i+1] == 0x89 && code[i+2] == 0xC5;
-}
+    if (j >= mc.instrs.size() || mc.isBranchTarget(j)) return false;
+    const MachineInstr& jmp = mc.instrs[j];
+    if (jmp.op != MOpcode::JMP || jmp.refKind == MRefKind::NONE || jmp.refKind == MRefKind::RVA) return false;
+    if (!jumpsTo(mc, i, mc.nextLive(j))) return false;
 
-bool PeepholeOptimizer::isAddRaxImm(const std::vector<uint8_t>& code, size_t i, int32_t& imm) {
-    if (i + 4 > code.size()) return false;
-    if (code[i] == 0x48 && code[i+1] == 0x83 && code[i+2] == 0xC0) {
-        imm = (int8_t)code[i+3];  // Sign extend
-        return true;
-    }
-    return false;
+    MachineInstr repl = MachineCode::makeJcc32(br.cond ^ 1);
+    if (repl.size() > br.size() + jmp.size()) return false;  // Never grow: rel8 users nearby must still fit
+    repl.refKind = jmp.refKind;
+    repl.refLabel = jmp.refLabel;
+    repl.refId = jmp.refId;
+    kill(mc, j);
+    replace(mc, i, std::move(repl));
+    optimizationCount_--;  // One rewrite, not two
+    return true;
 }
 
-bool PeepholeOptimizer::isSubRaxImm(const std::vector<uint8_t>& code, size_t i, int32_t& imm) {
-    if (i + 4 > code.size()) return false;
-    if (code[i] == 0x48 && code[i+1] == 0x83 && code[i+2] == 0xE8) {
-        imm = (int8_t)code[i+3];  // Sign extend
-        return true;
-    }
-    return false;
-}
+// ============================================
+// Dead instruction elimination
+// ============================================
 
-void PeepholeOptimizer::nopOut(std::vector<uint8_t>& code, size_t start, size_t count) {
-    for (size_t i = 0; i < count && start + i < code.size(); ++i) {
-        code[start + i] = 0x90;
+bool PeepholeOptimizer::eliminateDeadInstructions(MachineCode& mc) {
+    bool changed = false;
+    for (size_t i = 0; i < mc.instrs.size(); i++) {
+        const MachineInstr& mi = mc.instrs[i];
+        if (mi.dead || mi.barrier || mi.op == MOpcode::OPAQUE || mi.op == MOpcode::NOP) continue;
+        if (mi.readsMem || mi.writesMem || mi.defs == 0 || (mi.defs & kFrameRegs)) continue;
+        if (!deadAfter(mc, i, mi.defs)) continue;
+        kill(mc, i);
+        changed = true;
     }
+    return changed;
 }
 
 } // namespace tyl
@@ -1,86 +1,68 @@
 // Tyl Compiler - Peephole Optimizer for x64 Code
-// Performs local optimizations on generated machine code
-// Enhanced with register coalescing and more patterns for O3 optimization
+// Performs local optimizations on the lifted machine instruction list
+// Instructions are deleted from the list rather than NOP-filled, so lowering
+// produces smaller code with every branch displacement recomputed.
 #ifndef TYL_PEEPHOLE_H
 #define TYL_PEEPHOLE_H
 
+#include "machine_ir.h"
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
 namespace tyl {
 
-// Peephole optimizer that works on raw x64 machine code
+// Peephole optimizer that works on MachineCode (see machine_ir.h)
 class PeepholeOptimizer {
 public:
-    // Optimize the code buffer in place
-    // Returns the new size (may be smaller due to removed instructions)
-    size_t optimize(std::vector<uint8_t>& code);
-    
+    // Optimize the instruction list in place
+    // Returns the number of bytes removed
+    size_t optimize(MachineCode& code);
+
     // Statistics
     int removedBytes() const { return removedBytes_; }
     int optimizationCount() const { return optimizationCount_; }
-    
+    int removedInstructions() const { return removedInstructions_; }
+
     // Configuration
     void setAggressiveMode(bool aggressive) { aggressiveMode_ = aggressive; }
-    
+    void setOptimizeForSize(bool size) { optimizeForSize_ = size; }  // Never trade bytes for speed
+    void setDeadCodeElimination(bool dce) { deadCodeElim_ = dce; }
+
 private:
     int removedBytes_ = 0;
     int optimizationCount_ = 0;
-    bool aggressiveMode_ = true;  // Enable aggressive optimizations by default
-    
-    // Pattern matchers and replacers
-    bool optimizePushPop(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeMovMov(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeSmallConstants(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeRedundantMov(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeDirectPushPop(std::vector<uint8_t>& code, size_t& i);
-    
-    // New optimization patterns for O3
-    bool optimizeRegisterCoalescing(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeXorZero(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeRedundantXor(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeIncDec(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeLeaArithmetic(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeTestCmp(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeXorBeforeMovImm(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeMovZeroExtend(std::vector<uint8_t>& code, size_t& i);
-    bool optimizeRedundantPushPop(std::vector<uint8_t>& code, size_t& i);
-    
-    // Remove NOP instructions (final cleanup pass)
-    void removeNops(std::vector<uint8_t>& code);
-    
-    // Helper to check instruction patterns
-    bool isPushRax(const std::vector<uint8_t>& code, size_t i);
-    bool isPushRcx(const std::vector<uint8_t>& code, size_t i);
-    bool isPopRcx(const std::vector<uint8_t>& code, size_t i);
-    bool isPopRdx(const std::vector<uint8_t>& code, size_t i);
-    bool isPopRax(const std::vector<uint8_t>& code, size_t i);
-    bool isMovRaxImm64(const std::vector<uint8_t>& code, size_t i);
-    bool isMovRaxMemRbp(const std::vector<uint8_t>& code, size_t i);
-    bool isNop(const std::vector<uint8_t>& code, size_t i);
-    
-    // New helper functions
-    bool isXorRaxRax(const std::vector<uint8_t>& code, size_t i);
-    bool isXorRcxRcx(const std::vector<uint8_t>& code, size_t i);
-    bool isMovRaxRcx(const std::vector<uint8_t>& code, size_t i);
-    bool isMovRcxRax(const std::vector<uint8_t>& code, size_t i);
-    bool isMovR12Rax(const std::vector<uint8_t>& code, size_t i);
-    bool isMovR13Rax(const std::vector<uint8_t>& code, size_t i);
-    bool isAddRaxImm(const std::vector<uint8_t>& code, size_t i, int32_t& imm);
-    bool isSubRaxImm(const std::vector<uint8_t>& code, size_t i, int32_t& imm);
-    
-    // Get immediate value from mov rax, imm64
-    int64_t getImm64(const std::vector<uint8_t>& code, size_t i);
-    
-    // Remove bytes from code
-    void removeBytes(std::vector<uint8_t>& code, size_t start, size_t count);
-    
-    // Replace bytes in code
-    void replaceBytes(std::vector<uint8_t>& code, size_t start, 
-                      const std::vector<uint8_t>& replacement, size_t oldLen);
-    
-    // NOP out a range of bytes
-    void nopOut(std::vector<uint8_t>& code, size_t start, size_t count);
+    int removedInstructions_ = 0;
+    bool aggressiveMode_ = true;   // Enable flag-liveness dependent rewrites
+    bool optimizeForSize_ = false;
+    bool deadCodeElim_ = true;
+
+    // Pattern matchers; each looks at instruction i and its live successors
+    bool optimizePushPop(MachineCode& mc, size_t i);        // push a; ...; pop b
+    bool optimizeStoreLoad(MachineCode& mc, size_t i);      // mov [m], a; ...; mov b, [m]
+    bool optimizeRedundantMov(MachineCode& mc, size_t i);   // mov r, r
+    bool optimizeMovImm(MachineCode& mc, size_t i);         // shortest mov-imm / xor zero
+    bool optimizeConstantCopy(MachineCode& mc, size_t i);   // mov a, imm; mov b, a
+    bool optimizeZeroCopy(MachineCode& mc, size_t i);       // xor a, a; mov b, a
+    bool optimizeTestCmp(MachineCode& mc, size_t i);        // cmp r, 0 -> test r, r
+    bool optimizeIncDec(MachineCode& mc, size_t i);         // add/sub r, 1 -> inc/dec r
+    bool optimizeJumps(MachineCode& mc, size_t i);          // jmp next / jcc over jmp
+
+    // Remove register-only instructions whose results are never read
+    bool eliminateDeadInstructions(MachineCode& mc);
+
+    // True if none of regs is read after instruction i before being overwritten
+    // (scans forward within the basic block; conservative at block ends)
+    bool deadAfter(const MachineCode& mc, size_t i, RegMask regs) const;
+
+    // Whether instruction i transfers control to the instruction at j
+    bool jumpsTo(const MachineCode& mc, size_t i, size_t j) const;
+
+    // Replace instruction i keeping its labels and identity
+    void replace(MachineCode& mc, size_t i, MachineInstr repl);
+
+    // Mark instruction i for removal
+    void kill(MachineCode& mc, size_t i);
 };
 
 } // namespace tyl
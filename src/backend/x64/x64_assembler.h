@@ -9,6 +9,86 @@
 
 namespace tyl {
 
+// Physical registers in hardware encoding order (GPRs 0-15, XMM 16-31)
+enum class X64Reg : uint8_t {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+    XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
+    XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15,
+    NONE = 0xFF
+};
+
+// Condition codes in hardware encoding order (jcc/setcc/cmovcc)
+enum class X64Cond : uint8_t {
+    O, NO, B, AE, E, NE, BE, A, S, NS, P, NP, L, GE, LE, G
+};
+
+// Instructions understood by the table-driven encoder (X64Assembler::emit)
+enum class X64Op : uint8_t {
+    // Integer
+    MOV, MOVZX, MOVSX, MOVSXD, LEA, XCHG,
+    ADD, OR, ADC, SBB, AND, SUB, XOR, CMP, TEST,
+    NOT, NEG, INC, DEC, MUL, IMUL, DIV, IDIV,
+    SHL, SHR, SAR, ROL, ROR,
+    PUSH, POP, CALL, JMP,
+    BSF, BSR, POPCNT, LZCNT, TZCNT,
+
+    // SSE/SSE2/SSE4.1
+    MOVSD, MOVSS, MOVD, MOVQ, MOVAPS, MOVUPS, MOVAPD, MOVUPD, MOVDQA, MOVDQU,
+    ADDSD, SUBSD, MULSD, DIVSD, SQRTSD, MINSD, MAXSD,
+    ADDSS, SUBSS, MULSS, DIVSS, SQRTSS,
+    ADDPD, SUBPD, MULPD, DIVPD, ADDPS, SUBPS, MULPS, DIVPS,
+    ANDPD, ANDNPD, ORPD, XORPD, XORPS,
+    PADDD, PADDQ, PSUBD, PSUBQ, PMULLD, PMULUDQ, PAND, PANDN, POR, PXOR,
+    PCMPEQD, PCMPGTD, PCMPGTQ, PSLLQ, PSRLQ,
+    UCOMISD, COMISD, UCOMISS,
+    CVTSI2SD, CVTTSD2SI, CVTSI2SS, CVTTSS2SI, CVTSS2SD, CVTSD2SS,
+    SHUFPD, PSHUFD,
+
+    // AVX/AVX2 (VEX, non-destructive three-operand forms; 32-byte operands select ymm)
+    VMOVUPD, VMOVUPS, VMOVDQU,
+    VADDPD, VSUBPD, VMULPD, VDIVPD, VADDPS, VSUBPS, VMULPS, VDIVPS,
+    VADDSD, VSUBSD, VMULSD, VDIVSD,
+    VXORPD, VPXOR, VPADDD, VPADDQ, VPSUBD, VPSUBQ, VPMULLD,
+    VBROADCASTSD,
+    VMOVDQA, VMOVAPD, VPAND, VPANDN, VPOR, VPMULUDQ,
+    VPCMPEQD, VPCMPGTD, VPCMPGTQ, VPSLLQ, VPSRLQ, VPSHUFD,
+    VPBROADCASTD, VPBROADCASTQ, VPERMQ, VFMADD231PD, VZEROUPPER,
+    // System
+    CPUID, XGETBV
+};
+
+// Operand for the table-driven encoder: register, memory or immediate
+// Sizes are in bytes: 1/2/4/8 for GPRs and memory, 16 = xmm, 32 = ymm
+struct X64Operand {
+    enum class Kind : uint8_t { NONE, REG, MEM, IMM };
+
+    Kind kind = Kind::NONE;
+    uint8_t size = 8;
+    X64Reg reg = X64Reg::NONE;        // REG
+    X64Reg base = X64Reg::NONE;       // MEM: base register (NONE = absolute/rip)
+    X64Reg index = X64Reg::NONE;      // MEM: index register (never RSP)
+    uint8_t scale = 1;                // MEM: 1, 2, 4 or 8
+    int32_t disp = 0;                 // MEM: displacement
+    bool ripRelative = false;         // MEM: [rip + disp], resolved through label or ripTarget
+    std::string label;                // MEM: rip-relative label (X64Assembler::labelFixups)
+    uint32_t ripTarget = 0;           // MEM: rip-relative RVA (X64Assembler::ripFixups)
+    int64_t imm = 0;                  // IMM
+
+    static X64Operand r(X64Reg reg, uint8_t size = 0);
+    static X64Operand mem(X64Reg base, int32_t disp = 0, uint8_t size = 8);
+    static X64Operand mem(X64Reg base, X64Reg index, uint8_t scale, int32_t disp = 0, uint8_t size = 8);
+    static X64Operand ripLabel(const std::string& label, uint8_t size = 8);
+    static X64Operand ripRVA(uint32_t rva, uint8_t size = 8);
+    static X64Operand immediate(int64_t value);
+
+    bool isReg() const { return kind == Kind::REG; }
+    bool isMem() const { return kind == Kind::MEM; }
+    bool isImm() const { return kind == Kind::IMM; }
+    bool isXmm() const { return kind == Kind::REG && reg >= X64Reg::XMM0 && reg <= X64Reg::XMM15; }
+    bool isGpr() const { return kind == Kind::REG && reg <= X64Reg::R15; }
+};
+
 class X64Assembler {
 public:
     std::vector<uint8_t> code;
@@ -23,7 +103,17 @@ public:
     void fixupLabel(const std::string& name);
     void fixupRIP(uint32_t targetRVA);
     void resolve(uint32_t codeRVA = 0x1000);
-    
+
+    // Table-driven encoder: REX/VEX, ModRM, SIB, displacement and immediate
+    // are derived from the operands. Returns false (emitting nothing) if the
+    // operand combination has no encoding. RIP-relative memory operands cannot
+    // be combined with an immediate (the fixup is relative to the disp field).
+    bool emit(X64Op op, const X64Operand& dst = X64Operand(), const X64Operand& src = X64Operand());
+    bool emit(X64Op op, const X64Operand& dst, const X64Operand& src1, const X64Operand& src2);
+    bool jcc(X64Cond cond, const std::string& label);             // jcc rel32
+    bool setcc(X64Cond cond, const X64Operand& dst);              // setcc r/m8
+    bool cmov(X64Cond cond, const X64Operand& dst, const X64Operand& src);
+
     // Data movement
     void mov_rax_imm64(int64_t val);
     void mov_rcx_imm64(int64_t val);
@@ -418,6 +508,13 @@ private:
     void emit8(uint8_t b);
     void emit32(int32_t val);
     void emit64(int64_t val);
+
+    // Encoder internals (x64_encoder.cpp)
+    bool encodeModRM(uint8_t regField, const X64Operand& rm);
+    bool encodeLegacy(uint8_t prefix, bool rexW, bool forceRex, uint8_t map, uint8_t opcode,
+                      uint8_t regField, const X64Operand& rm);
+    bool encodeVex(uint8_t prefix, uint8_t map, bool vexW, bool vexL, uint8_t opcode,
+                   uint8_t regField, X64Reg vvvv, const X64Operand& rm);
 };
 
 } // namespace tyl
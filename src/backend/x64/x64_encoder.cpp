@@ -0,0 +1,644 @@
+// Tyl Compiler - x86-64 Table-Driven Encoder
+// Generic emit(Op, Operand, Operand): REX/VEX, ModRM, SIB, displacement and
+// immediate are computed from the operands, so codegen can use any register
+// and any [base + index*scale + disp] addressing mode.
+#include "x64_assembler.h"
+
+namespace tyl {
+
+// ============================================
+// Operands
+// ============================================
+
+X64Operand X64Operand::r(X64Reg reg, uint8_t size) {
+    X64Operand op;
+    op.kind = Kind::REG;
+    op.reg = reg;
+    op.size = size ? size : (reg >= X64Reg::XMM0 && reg <= X64Reg::XMM15 ? 16 : 8);
+    return op;
+}
+
+X64Operand X64Operand::mem(X64Reg base, int32_t disp, uint8_t size) {
+    X64Operand op;
+    op.kind = Kind::MEM;
+    op.base = base;
+    op.disp = disp;
+    op.size = size;
+    return op;
+}
+
+X64Operand X64Operand::mem(X64Reg base, X64Reg index, uint8_t scale, int32_t disp, uint8_t size) {
+    X64Operand op = mem(base, disp, size);
+    op.index = index;
+    op.scale = scale;
+    return op;
+}
+
+X64Operand X64Operand::ripLabel(const std::string& label, uint8_t size) {
+    X64Operand op = mem(X64Reg::NONE, 0, size);
+    op.ripRelative = true;
+    op.label = label;
+    return op;
+}
+
+X64Operand X64Operand::ripRVA(uint32_t rva, uint8_t size) {
+    X64Operand op = mem(X64Reg::NONE, 0, size);
+    op.ripRelative = true;
+    op.ripTarget = rva;
+    return op;
+}
+
+X64Operand X64Operand::immediate(int64_t value) {
+    X64Operand op;
+    op.kind = Kind::IMM;
+    op.imm = value;
+    return op;
+}
+
+namespace {
+
+// ============================================
+// Encoding table
+// ============================================
+
+enum class Form : uint8_t {
+    RM,     // reg <- r/m
+    MR,     // r/m <- reg
+    MI,     // r/m, imm (sized by operand, at most 32 bits)
+    MI8,    // r/m, simm8 (only when the immediate fits)
+    MIB,    // r/m, imm8 (shift counts)
+    M1,     // r/m, 1
+    MC,     // r/m, cl
+    M,      // r/m
+    O,      // opcode + register
+    RMI,    // reg <- r/m, imm (sized by operand)
+    RMI8,   // reg <- r/m, imm8
+    RVM,    // VEX: reg <- vvvv, r/m
+    VMI,    // VEX: vvvv <- r/m, imm8 (ModRM.reg is an opcode extension)
+    ZO      // No operands (ext, if set, is a fixed ModRM byte)
+};
+
+enum class Cls : uint8_t { GPR, XMM, NONE };
+
+enum EncFlags : uint16_t {
+    F_NONE   = 0,
+    F_BYTE   = 1 << 0,   // 8-bit operand size uses opcode - 1
+    F_W      = 1 << 1,   // Always REX.W / VEX.W1
+    F_WGPR   = 1 << 2,   // REX.W when the GPR operand is 64-bit (SSE<->GPR forms)
+    F_DEF64  = 1 << 3,   // Default 64-bit operand size (push/pop/call/jmp)
+    F_SRC8   = 1 << 4,   // Source operand must be 8-bit
+    F_SRC16  = 1 << 5,   // Source operand must be 16-bit
+    F_MEMSRC = 1 << 6,   // r/m operand must be memory
+    F_VEX    = 1 << 7,   // VEX encoded
+    F_VEXL   = 1 << 8,   // VEX.L from operand size (32 bytes = ymm)
+    F_NOSIZE = 1 << 9    // No operand-size prefix/REX.W from operand size (SSE)
+};
+
+struct Encoding {
+    X64Op op;
+    Form form;
+    Cls regCls;      // Class of the ModRM.reg operand
+    Cls rmCls;       // Class of the ModRM.rm operand when it is a register
+    uint8_t prefix;  // Mandatory prefix / VEX.pp (0, 0x66, 0xF2, 0xF3)
+    uint8_t map;     // 0 = one-byte, 1 = 0F, 2 = 0F38, 3 = 0F3A
+    uint8_t opcode;
+    uint8_t ext;     // ModRM.reg extension for M* forms
+    uint16_t flags;
+};
+
+constexpr Cls G = Cls::GPR;
+constexpr Cls X = Cls::XMM;
+constexpr Cls N = Cls::NONE;
+constexpr uint16_t SSE = F_NOSIZE;
+constexpr uint16_t AVX = F_NOSIZE | F_VEX | F_VEXL;
+
+// First matching entry wins, so register-register forms follow codegen's
+// existing choice (MR for integer ops, RM for SSE).
+const Encoding kEncodings[] = {
+    // ---- Integer moves ----
+    {X64Op::MOV,    Form::MR,   G, G, 0, 0, 0x89, 0, F_BYTE},
+    {X64Op::MOV,    Form::RM,   G, G, 0, 0, 0x8B, 0, F_BYTE},
+    {X64Op::MOV,    Form::MI,   N, G, 0, 0, 0xC7, 0, F_BYTE},
+    {X64Op::MOVZX,  Form::RM,   G, G, 0, 1, 0xB6, 0, F_SRC8},
+    {X64Op::MOVZX,  Form::RM,   G, G, 0, 1, 0xB7, 0, F_SRC16},
+    {X64Op::MOVSX,  Form::RM,   G, G, 0, 1, 0xBE, 0, F_SRC8},
+    {X64Op::MOVSX,  Form::RM,   G, G, 0, 1, 0xBF, 0, F_SRC16},
+    {X64Op::MOVSXD, Form::RM,   G, G, 0, 0, 0x63, 0, F_W},
+    {X64Op::LEA,    Form::RM,   G, G, 0, 0, 0x8D, 0, F_MEMSRC},
+    {X64Op::XCHG,   Form::MR,   G, G, 0, 0, 0x87, 0, F_BYTE},
+
+    // ---- ALU (group 1) ----
+    {X64Op::ADD, Form::MR,  G, G, 0, 0, 0x01, 0, F_BYTE},
+    {X64Op::ADD, Form::RM,  G, G, 0, 0, 0x03, 0, F_BYTE},
+    {X64Op::ADD, Form::MI8, N, G, 0, 0, 0x83, 0, F_NONE},
+    {X64Op::ADD, Form::MI,  N, G, 0, 0, 0x81, 0, F_BYTE},
+    {X64Op::OR,  Form::MR,  G, G, 0, 0, 0x09, 0, F_BYTE},
+    {X64Op::OR,  Form::RM,  G, G, 0, 0, 0x0B, 0, F_BYTE},
+    {X64Op::OR,  Form::MI8, N, G, 0, 0, 0x83, 1, F_NONE},
+    {X64Op::OR,  Form::MI,  N, G, 0, 0, 0x81, 1, F_BYTE},
+    {X64Op::ADC, Form::MR,  G, G, 0, 0, 0x11, 0, F_BYTE},
+    {X64Op::ADC, Form::RM,  G, G, 0, 0, 0x13, 0, F_BYTE},
+    {X64Op::ADC, Form::MI8, N, G, 0, 0, 0x83, 2, F_NONE},
+    {X64Op::ADC, Form::MI,  N, G, 0, 0, 0x81, 2, F_BYTE},
+    {X64Op::SBB, Form::MR,  G, G, 0, 0, 0x19, 0, F_BYTE},
+    {X64Op::SBB, Form::RM,  G, G, 0, 0, 0x1B, 0, F_BYTE},
+    {X64Op::SBB, Form::MI8, N, G, 0, 0, 0x83, 3, F_NONE},
+    {X64Op::SBB, Form::MI,  N, G, 0, 0, 0x81, 3, F_BYTE},
+    {X64Op::AND, Form::MR,  G, G, 0, 0, 0x21, 0, F_BYTE},
+    {X64Op::AND, Form::RM,  G, G, 0, 0, 0x23, 0, F_BYTE},
+    {X64Op::AND, Form::MI8, N, G, 0, 0, 0x83, 4, F_NONE},
+    {X64Op::AND, Form::MI,  N, G, 0, 0, 0x81, 4, F_BYTE},
+    {X64Op::SUB, Form::MR,  G, G, 0, 0, 0x29, 0, F_BYTE},
+    {X64Op::SUB, Form::RM,  G, G, 0, 0, 0x2B, 0, F_BYTE},
+    {X64Op::SUB, Form::MI8, N, G, 0, 0, 0x83, 5, F_NONE},
+    {X64Op::SUB, Form::MI,  N, G, 0, 0, 0x81, 5, F_BYTE},
+    {X64Op::XOR, Form::MR,  G, G, 0, 0, 0x31, 0, F_BYTE},
+    {X64Op::XOR, Form::RM,  G, G, 0, 0, 0x33, 0, F_BYTE},
+    {X64Op::XOR, Form::MI8, N, G, 0, 0, 0x83, 6, F_NONE},
+    {X64Op::XOR, Form::MI,  N, G, 0, 0, 0x81, 6, F_BYTE},
+    {X64Op::CMP, Form::MR,  G, G, 0, 0, 0x39, 0, F_BYTE},
+    {X64Op::CMP, Form::RM,  G, G, 0, 0, 0x3B, 0, F_BYTE},
+    {X64Op::CMP, Form::MI8, N, G, 0, 0, 0x83, 7, F_NONE},
+    {X64Op::CMP, Form::MI,  N, G, 0, 0, 0x81, 7, F_BYTE},
+    {X64Op::TEST, Form::MR, G, G, 0, 0, 0x85, 0, F_BYTE},
+    {X64Op::TEST, Form::MI, N, G, 0, 0, 0xF7, 0, F_BYTE},
+
+    // ---- Unary / multiply / divide (group 3, group 4/5) ----
+    {X64Op::NOT,  Form::M,    N, G, 0, 0, 0xF7, 2, F_BYTE},
+    {X64Op::NEG,  Form::M,    N, G, 0, 0, 0xF7, 3, F_BYTE},
+    {X64Op::MUL,  Form::M,    N, G, 0, 0, 0xF7, 4, F_BYTE},
+    {X64Op::IMUL, Form::RM,   G, G, 0, 1, 0xAF, 0, F_NONE},
+    {X64Op::IMUL, Form::RMI8, G, G, 0, 0, 0x6B, 0, F_NONE},
+    {X64Op::IMUL, Form::RMI,  G, G, 0, 0, 0x69, 0, F_NONE},
+    {X64Op::IMUL, Form::M,    N, G, 0, 0, 0xF7, 5, F_BYTE},
+    {X64Op::DIV,  Form::M,    N, G, 0, 0, 0xF7, 6, F_BYTE},
+    {X64Op::IDIV, Form::M,    N, G, 0, 0, 0xF7, 7, F_BYTE},
+    {X64Op::INC,  Form::M,    N, G, 0, 0, 0xFF, 0, F_BYTE},
+    {X64Op::DEC,  Form::M,    N, G, 0, 0, 0xFF, 1, F_BYTE},
+
+    // ---- Shifts (group 2) ----
+    {X64Op::SHL, Form::M1,  N, G, 0, 0, 0xD1, 4, F_BYTE},
+    {X64Op::SHL, Form::MIB, N, G, 0, 0, 0xC1, 4, F_BYTE},
+    {X64Op::SHL, Form::MC,  N, G, 0, 0, 0xD3, 4, F_BYTE},
+    {X64Op::SHR, Form::M1,  N, G, 0, 0, 0xD1, 5, F_BYTE},
+    {X64Op::SHR, Form::MIB, N, G, 0, 0, 0xC1, 5, F_BYTE},
+    {X64Op::SHR, Form::MC,  N, G, 0, 0, 0xD3, 5, F_BYTE},
+    {X64Op::SAR, Form::M1,  N, G, 0, 0, 0xD1, 7, F_BYTE},
+    {X64Op::SAR, Form::MIB, N, G, 0, 0, 0xC1, 7, F_BYTE},
+    {X64Op::SAR, Form::MC,  N, G, 0, 0, 0xD3, 7, F_BYTE},
+    {X64Op::ROL, Form::M1,  N, G, 0, 0, 0xD1, 0, F_BYTE},
+    {X64Op::ROL, Form::MIB, N, G, 0, 0, 0xC1, 0, F_BYTE},
+    {X64Op::ROL, Form::MC,  N, G, 0, 0, 0xD3, 0, F_BYTE},
+    {X64Op::ROR, Form::M1,  N, G, 0, 0, 0xD1, 1, F_BYTE},
+    {X64Op::ROR, Form::MIB, N, G, 0, 0, 0xC1, 1, F_BYTE},
+    {X64Op::ROR, Form::MC,  N, G, 0, 0, 0xD3, 1, F_BYTE},
+
+    // ---- Stack / indirect control flow ----
+    {X64Op::PUSH, Form::O, N, G, 0, 0, 0x50, 0, F_DEF64},
+    {X64Op::PUSH, Form::M, N, G, 0, 0, 0xFF, 6, F_DEF64},
+    {X64Op::POP,  Form::O, N, G, 0, 0, 0x58, 0, F_DEF64},
+    {X64Op::POP,  Form::M, N, G, 0, 0, 0x8F, 0, F_DEF64},
+    {X64Op::CALL, Form::M, N, G, 0, 0, 0xFF, 2, F_DEF64},
+    {X64Op::JMP,  Form::M, N, G, 0, 0, 0xFF, 4, F_DEF64},
+
+    // ---- Bit scan / count ----
+    {X64Op::BSF,    Form::RM, G, G, 0,    1, 0xBC, 0, F_NONE},
+    {X64Op::BSR,    Form::RM, G, G, 0,    1, 0xBD, 0, F_NONE},
+    {X64Op::POPCNT, Form::RM, G, G, 0xF3, 1, 0xB8, 0, F_NONE},
+    {X64Op::LZCNT,  Form::RM, G, G, 0xF3, 1, 0xBD, 0, F_NONE},
+    {X64Op::TZCNT,  Form::RM, G, G, 0xF3, 1, 0xBC, 0, F_NONE},
+
+    // ---- SSE moves ----
+    {X64Op::MOVSD,  Form::RM, X, X, 0xF2, 1, 0x10, 0, SSE},
+    {X64Op::MOVSD,  Form::MR, X, X, 0xF2, 1, 0x11, 0, SSE},
+    {X64Op::MOVSS,  Form::RM, X, X, 0xF3, 1, 0x10, 0, SSE},
+    {X64Op::MOVSS,  Form::MR, X, X, 0xF3, 1, 0x11, 0, SSE},
+    {X64Op::MOVD,   Form::RM, X, G, 0x66, 1, 0x6E, 0, SSE},
+    {X64Op::MOVD,   Form::MR, X, G, 0x66, 1, 0x7E, 0, SSE},
+    {X64Op::MOVQ,   Form::RM, X, G, 0x66, 1, 0x6E, 0, SSE | F_W},
+    {X64Op::MOVQ,   Form::MR, X, G, 0x66, 1, 0x7E, 0, SSE | F_W},
+    {X64Op::MOVQ,   Form::RM, X, X, 0xF3, 1, 0x7E, 0, SSE},
+    {X64Op::MOVAPS, Form::RM, X, X, 0,    1, 0x28, 0, SSE},
+    {X64Op::MOVAPS, Form::MR, X, X, 0,    1, 0x29, 0, SSE},
+    {X64Op::MOVUPS, Form::RM, X, X, 0,    1, 0x10, 0, SSE},
+    {X64Op::MOVUPS, Form::MR, X, X, 0,    1, 0x11, 0, SSE},
+    {X64Op::MOVAPD, Form::RM, X, X, 0x66, 1, 0x28, 0, SSE},
+    {X64Op::MOVAPD, Form::MR, X, X, 0x66, 1, 0x29, 0, SSE},
+    {X64Op::MOVUPD, Form::RM, X, X, 0x66, 1, 0x10, 0, SSE},
+    {X64Op::MOVUPD, Form::MR, X, X, 0x66, 1, 0x11, 0, SSE},
+    {X64Op::MOVDQA, Form::RM, X, X, 0x66, 1, 0x6F, 0, SSE},
+    {X64Op::MOVDQA, Form::MR, X, X, 0x66, 1, 0x7F, 0, SSE},
+    {X64Op::MOVDQU, Form::RM, X, X, 0xF3, 1, 0x6F, 0, SSE},
+    {X64Op::MOVDQU, Form::MR, X, X, 0xF3, 1, 0x7F, 0, SSE},
+
+    // ---- SSE arithmetic ----
+    {X64Op::ADDSD,  Form::RM, X, X, 0xF2, 1, 0x58, 0, SSE},
+    {X64Op::SUBSD,  Form::RM, X, X, 0xF2, 1, 0x5C, 0, SSE},
+    {X64Op::MULSD,  Form::RM, X, X, 0xF2, 1, 0x59, 0, SSE},
+    {X64Op::DIVSD,  Form::RM, X, X, 0xF2, 1, 0x5E, 0, SSE},
+    {X64Op::SQRTSD, Form::RM, X, X, 0xF2, 1, 0x51, 0, SSE},
+    {X64Op::MINSD,  Form::RM, X, X, 0xF2, 1, 0x5D, 0, SSE},
+    {X64Op::MAXSD,  Form::RM, X, X, 0xF2, 1, 0x5F, 0, SSE},
+    {X64Op::ADDSS,  Form::RM, X, X, 0xF3, 1, 0x58, 0, SSE},
+    {X64Op::SUBSS,  Form::RM, X, X, 0xF3, 1, 0x5C, 0, SSE},
+    {X64Op::MULSS,  Form::RM, X, X, 0xF3, 1, 0x59, 0, SSE},
+    {X64Op::DIVSS,  Form::RM, X, X, 0xF3, 1, 0x5E, 0, SSE},
+    {X64Op::SQRTSS, Form::RM, X, X, 0xF3, 1, 0x51, 0, SSE},
+    {X64Op::ADDPD,  Form::RM, X, X, 0x66, 1, 0x58, 0, SSE},
+    {X64Op::SUBPD,  Form::RM, X, X, 0x66, 1, 0x5C, 0, SSE},
+    {X64Op::MULPD,  Form::RM, X, X, 0x66, 1, 0x59, 0, SSE},
+    {X64Op::DIVPD,  Form::RM, X, X, 0x66, 1, 0x5E, 0, SSE},
+    {X64Op::ADDPS,  Form::RM, X, X, 0,    1, 0x58, 0, SSE},
+    {X64Op::SUBPS,  Form::RM, X, X, 0,    1, 0x5C, 0, SSE},
+    {X64Op::MULPS,  Form::RM, X, X, 0,    1, 0x59, 0, SSE},
+    {X64Op::DIVPS,  Form::RM, X, X, 0,    1, 0x5E, 0, SSE},
+    {X64Op::ANDPD,  Form::RM, X, X, 0x66, 1, 0x54, 0, SSE},
+    {X64Op::ANDNPD, Form::RM, X, X, 0x66, 1, 0x55, 0, SSE},
+    {X64Op::ORPD,   Form::RM, X, X, 0x66, 1, 0x56, 0, SSE},
+    {X64Op::XORPD,  Form::RM, X, X, 0x66, 1, 0x57, 0, SSE},
+    {X64Op::XORPS,  Form::RM, X, X, 0,    1, 0x57, 0, SSE},
+    {X64Op::PADDD,  Form::RM, X, X, 0x66, 1, 0xFE, 0, SSE},
+    {X64Op::PADDQ,  Form::RM, X, X, 0x66, 1, 0xD4, 0, SSE},
+    {X64Op::PSUBD,  Form::RM, X, X, 0x66, 1, 0xFA, 0, SSE},
+    {X64Op::PSUBQ,  Form::RM, X, X, 0x66, 1, 0xFB, 0, SSE},
+    {X64Op::PMULLD, Form::RM, X, X, 0x66, 2, 0x40, 0, SSE},
+    {X64Op::PMULUDQ, Form::RM, X, X, 0x66, 1, 0xF4, 0, SSE},
+    {X64Op::PAND,   Form::RM, X, X, 0x66, 1, 0xDB, 0, SSE},
+    {X64Op::PANDN,  Form::RM, X, X, 0x66, 1, 0xDF, 0, SSE},
+    {X64Op::POR,    Form::RM, X, X, 0x66, 1, 0xEB, 0, SSE},
+    {X64Op::PXOR,   Form::RM, X, X, 0x66, 1, 0xEF, 0, SSE},
+    {X64Op::PCMPEQD, Form::RM,  X, X, 0x66, 1, 0x76, 0, SSE},
+    {X64Op::PCMPGTD, Form::RM,  X, X, 0x66, 1, 0x66, 0, SSE},
+    {X64Op::PCMPGTQ, Form::RM,  X, X, 0x66, 2, 0x37, 0, SSE},
+    {X64Op::PSLLQ,   Form::MIB, N, X, 0x66, 1, 0x73, 6, SSE},
+    {X64Op::PSRLQ,   Form::MIB, N, X, 0x66, 1, 0x73, 2, SSE},
+
+    // ---- SSE compare / convert / shuffle ----
+    {X64Op::UCOMISD,   Form::RM,   X, X, 0x66, 1, 0x2E, 0, SSE},
+    {X64Op::COMISD,    Form::RM,   X, X, 0x66, 1, 0x2F, 0, SSE},
+    {X64Op::UCOMISS,   Form::RM,   X, X, 0,    1, 0x2E, 0, SSE},
+    {X64Op::CVTSI2SD,  Form::RM,   X, G, 0xF2, 1, 0x2A, 0, SSE | F_WGPR},
+    {X64Op::CVTTSD2SI, Form::RM,   G, X, 0xF2, 1, 0x2C, 0, SSE | F_WGPR},
+    {X64Op::CVTSI2SS,  Form::RM,   X, G, 0xF3, 1, 0x2A, 0, SSE | F_WGPR},
+    {X64Op::CVTTSS2SI, Form::RM,   G, X, 0xF3, 1, 0x2C, 0, SSE | F_WGPR},
+    {X64Op::CVTSS2SD,  Form::RM,   X, X, 0xF3, 1, 0x5A, 0, SSE},
+    {X64Op::CVTSD2SS,  Form::RM,   X, X, 0xF2, 1, 0x5A, 0, SSE},
+    {X64Op::SHUFPD,    Form::RMI8, X, X, 0x66, 1, 0xC6, 0, SSE},
+    {X64Op::PSHUFD,    Form::RMI8, X, X, 0x66, 1, 0x70, 0, SSE},
+
+    // ---- AVX/AVX2 ----
+    {X64Op::VMOVUPD, Form::RM,  X, X, 0x66, 1, 0x10, 0, AVX},
+    {X64Op::VMOVUPD, Form::MR,  X, X, 0x66, 1, 0x11, 0, AVX},
+    {X64Op::VMOVUPS, Form::RM,  X, X, 0,    1, 0x10, 0, AVX},
+    {X64Op::VMOVUPS, Form::MR,  X, X, 0,    1, 0x11, 0, AVX},
+    {X64Op::VMOVDQU, Form::RM,  X, X, 0xF3, 1, 0x6F, 0, AVX},
+    {X64Op::VMOVDQU, Form::MR,  X, X, 0xF3, 1, 0x7F, 0, AVX},
+    {X64Op::VADDPD,  Form::RVM, X, X, 0x66, 1, 0x58, 0, AVX},
+    {X64Op::VSUBPD,  Form::RVM, X, X, 0x66, 1, 0x5C, 0, AVX},
+    {X64Op::VMULPD,  Form::RVM, X, X, 0x66, 1, 0x59, 0, AVX},
+    {X64Op::VDIVPD,  Form::RVM, X, X, 0x66, 1, 0x5E, 0, AVX},
+    {X64Op::VADDPS,  Form::RVM, X, X, 0,    1, 0x58, 0, AVX},
+    {X64Op::VSUBPS,  Form::RVM, X, X, 0,    1, 0x5C, 0, AVX},
+    {X64Op::VMULPS,  Form::RVM, X, X, 0,    1, 0x59, 0, AVX},
+    {X64Op::VDIVPS,  Form::RVM, X, X, 0,    1, 0x5E, 0, AVX},
+    {X64Op::VADDSD,  Form::RVM, X, X, 0xF2, 1, 0x58, 0, AVX},
+    {X64Op::VSUBSD,  Form::RVM, X, X, 0xF2, 1, 0x5C, 0, AVX},
+    {X64Op::VMULSD,  Form::RVM, X, X, 0xF2, 1, 0x59, 0, AVX},
+    {X64Op::VDIVSD,  Form::RVM, X, X, 0xF2, 1, 0x5E, 0, AVX},
+    {X64Op::VXORPD,  Form::RVM, X, X, 0x66, 1, 0x57, 0, AVX},
+    {X64Op::VPXOR,   Form::RVM, X, X, 0x66, 1, 0xEF, 0, AVX},
+    {X64Op::VPADDD,  Form::RVM, X, X, 0x66, 1, 0xFE, 0, AVX},
+    {X64Op::VPADDQ,  Form::RVM, X, X, 0x66, 1, 0xD4, 0, AVX},
+    {X64Op::VPSUBD,  Form::RVM, X, X, 0x66, 1, 0xFA, 0, AVX},
+    {X64Op::VPSUBQ,  Form::RVM, X, X, 0x66, 1, 0xFB, 0, AVX},
+    {X64Op::VPMULLD, Form::RVM, X, X, 0x66, 2, 0x40, 0, AVX},
+    {X64Op::VBROADCASTSD, Form::RM, X, X, 0x66, 2, 0x19, 0, AVX},
+    {X64Op::VMOVDQA, Form::RM,  X, X, 0x66, 1, 0x6F, 0, AVX},
+    {X64Op::VMOVDQA, Form::MR,  X, X, 0x66, 1, 0x7F, 0, AVX},
+    {X64Op::VMOVAPD, Form::RM,  X, X, 0x66, 1, 0x28, 0, AVX},
+    {X64Op::VMOVAPD, Form::MR,  X, X, 0x66, 1, 0x29, 0, AVX},
+    {X64Op::VPAND,   Form::RVM, X, X, 0x66, 1, 0xDB, 0, AVX},
+    {X64Op::VPANDN,  Form::RVM, X, X, 0x66, 1, 0xDF, 0, AVX},
+    {X64Op::VPOR,    Form::RVM, X, X, 0x66, 1, 0xEB, 0, AVX},
+    {X64Op::VPMULUDQ, Form::RVM, X, X, 0x66, 1, 0xF4, 0, AVX},
+    {X64Op::VPCMPEQD, Form::RVM, X, X, 0x66, 1, 0x76, 0, AVX},
+    {X64Op::VPCMPGTD, Form::RVM, X, X, 0x66, 1, 0x66, 0, AVX},
+    {X64Op::VPCMPGTQ, Form::RVM, X, X, 0x66, 2, 0x37, 0, AVX},
+    {X64Op::VPSLLQ,  Form::VMI, X, X, 0x66, 1, 0x73, 6, AVX},
+    {X64Op::VPSRLQ,  Form::VMI, X, X, 0x66, 1, 0x73, 2, AVX},
+    {X64Op::VPSHUFD, Form::RMI8, X, X, 0x66, 1, 0x70, 0, AVX},
+    {X64Op::VPBROADCASTD, Form::RM, X, X, 0x66, 2, 0x58, 0, AVX},
+    {X64Op::VPBROADCASTQ, Form::RM, X, X, 0x66, 2, 0x59, 0, AVX},
+    {X64Op::VPERMQ,  Form::RMI8, X, X, 0x66, 3, 0x00, 0, AVX | F_W},
+    {X64Op::VFMADD231PD, Form::RVM, X, X, 0x66, 2, 0xB8, 0, AVX | F_W},
+    {X64Op::VZEROUPPER, Form::ZO, N, N, 0, 1, 0x77, 0, F_NOSIZE | F_VEX},
+
+    // ---- System ----
+    {X64Op::CPUID,  Form::ZO, N, N, 0, 1, 0xA2, 0,    F_NONE},
+    {X64Op::XGETBV, Form::ZO, N, N, 0, 1, 0x01, 0xD0, F_NONE},
+};
+
+uint8_t regNum(X64Reg r) { return static_cast<uint8_t>(r) & 15; }
+bool isExtended(X64Reg r) { return r != X64Reg::NONE && (static_cast<uint8_t>(r) & 8) != 0; }
+
+bool regMatches(const X64Operand& op, Cls cls) {
+    if (!op.isReg()) return false;
+    return cls == Cls::GPR ? op.isGpr() : cls == Cls::XMM ? op.isXmm() : false;
+}
+
+// Register of class cls, or memory
+bool rmMatches(const X64Operand& op, Cls cls, uint16_t flags) {
+    if (op.isMem()) return true;
+    if (flags & F_MEMSRC) return false;
+    return regMatches(op, cls);
+}
+
+bool fitsInt8(int64_t v) { return v >= -128 && v <= 127; }
+bool fitsInt32(int64_t v) { return v >= INT32_MIN && v <= INT32_MAX; }
+
+bool validMem(const X64Operand& op) {
+    if (!op.isMem()) return true;
+    if (op.index == X64Reg::RSP) return false;
+    if (op.index != X64Reg::NONE && !(op.index <= X64Reg::R15)) return false;
+    if (op.base != X64Reg::NONE && !(op.base <= X64Reg::R15)) return false;
+    if (op.scale != 1 && op.scale != 2 && op.scale != 4 && op.scale != 8) return false;
+    if (op.ripRelative && (op.base != X64Reg::NONE || op.index != X64Reg::NONE)) return false;
+    return true;
+}
+
+// Byte registers spl/bpl/sil/dil need a REX prefix to be addressable
+bool needsByteRex(const X64Operand& op) {
+    return op.isGpr() && op.size == 1 && op.reg >= X64Reg::RSP && op.reg <= X64Reg::RDI;
+}
+
+bool matches(const Encoding& e, const X64Operand& a, const X64Operand& b, const X64Operand& c) {
+    bool noC = c.kind == X64Operand::Kind::NONE;
+    switch (e.form) {
+        case Form::RM:
+            if (!noC || !regMatches(a, e.regCls) || !rmMatches(b, e.rmCls, e.flags)) return false;
+            if ((e.flags & F_SRC8) && b.size != 1) return false;
+            if ((e.flags & F_SRC16) && b.size != 2) return false;
+            return true;
+        case Form::MR:
+            return noC && rmMatches(a, e.rmCls, e.flags) && regMatches(b, e.regCls);
+        case Form::MI:
+            return noC && rmMatches(a, e.rmCls, e.flags) && b.isImm();
+        case Form::MI8:
+            return noC && rmMatches(a, e.rmCls, e.flags) && b.isImm() && fitsInt8(b.imm) && a.size != 1;
+        case Form::MIB:
+            // Integer shifts by 1 use the shorter M1 form; packed shifts have none
+            return noC && rmMatches(a, e.rmCls, e.flags) && b.isImm() && (b.imm != 1 || e.rmCls == Cls::XMM);
+        case Form::M1:
+            return noC && rmMatches(a, e.rmCls, e.flags) && b.isImm() && b.imm == 1;
+        case Form::MC:
+            return noC && rmMatches(a, e.rmCls, e.flags) && b.isReg() && b.reg == X64Reg::RCX;
+        case Form::M:
+            return noC && b.kind == X64Operand::Kind::NONE && rmMatches(a, e.rmCls, e.flags);
+        case Form::O:
+            return noC && b.kind == X64Operand::Kind::NONE && a.isGpr();
+        case Form::RMI8:
+            return regMatches(a, e.regCls) && rmMatches(b, e.rmCls, e.flags) && c.isImm() &&
+                   (e.op != X64Op::IMUL || fitsInt8(c.imm));
+        case Form::RMI:
+            return regMatches(a, e.regCls) && rmMatches(b, e.rmCls, e.flags) && c.isImm();
+        case Form::RVM:
+            return regMatches(a, e.regCls) && regMatches(b, e.regCls) && rmMatches(c, e.rmCls, e.flags);
+        case Form::VMI:
+            return regMatches(a, e.regCls) && rmMatches(b, e.rmCls, e.flags) && c.isImm();
+        case Form::ZO:
+            return a.kind == X64Operand::Kind::NONE && b.kind == X64Operand::Kind::NONE && noC;
+    }
+    return false;
+}
+
+} // namespace
+
+// ============================================
+// ModRM / prefixes
+// ============================================
+
+bool X64Assembler::encodeModRM(uint8_t regField, const X64Operand& rm) {
+    uint8_t reg = (regField & 7) << 3;
+    if (rm.isReg()) {
+        emit8(static_cast<uint8_t>(0xC0 | reg | (regNum(rm.reg) & 7)));
+        return true;
+    }
+    if (rm.ripRelative) {
+        emit8(0x05 | reg);
+        if (!rm.label.empty()) fixupLabel(rm.label);
+        else if (rm.ripTarget) fixupRIP(rm.ripTarget);
+        else emit32(rm.disp);
+        return true;
+    }
+
+    uint8_t ss = rm.scale == 8 ? 3 : rm.scale == 4 ? 2 : rm.scale == 2 ? 1 : 0;
+    uint8_t idx = rm.index == X64Reg::NONE ? 4 : (regNum(rm.index) & 7);
+
+    if (rm.base == X64Reg::NONE) {
+        // [index*scale + disp32] / [disp32]: SIB with no base
+        emit8(0x04 | reg);
+        emit8(static_cast<uint8_t>((ss << 6) | (idx << 3) | 5));
+        emit32(rm.disp);
+        return true;
+    }
+
+    uint8_t base = regNum(rm.base) & 7;
+    bool needSib = rm.index != X64Reg::NONE || base == 4;    // rsp/r12 base
+    uint8_t mod;
+    if (rm.disp == 0 && base != 5) mod = 0;                   // rbp/r13 base needs a displacement
+    else if (fitsInt8(rm.disp)) mod = 1;
+    else mod = 2;
+
+    if (needSib) {
+        emit8(static_cast<uint8_t>((mod << 6) | reg | 4));
+        emit8(static_cast<uint8_t>((ss << 6) | (idx << 3) | base));
+    } else {
+        emit8(static_cast<uint8_t>((mod << 6) | reg | base));
+    }
+    if (mod == 1) emit8(static_cast<uint8_t>(rm.disp));
+    else if (mod == 2) emit32(rm.disp);
+    return true;
+}
+
+bool X64Assembler::encodeLegacy(uint8_t prefix, bool rexW, bool forceRex, uint8_t map, uint8_t opcode,
+                                uint8_t regField, const X64Operand& rm) {
+    if (prefix) emit8(prefix);
+    uint8_t rex = 0x40;
+    if (rexW) rex |= 0x08;
+    if (regField & 8) rex |= 0x04;
+    if (rm.isReg() && isExtended(rm.reg)) rex |= 0x01;
+    if (rm.isMem() && isExtended(rm.index)) rex |= 0x02;
+    if (rm.isMem() && isExtended(rm.base)) rex |= 0x01;
+    if (rex != 0x40 || forceRex) emit8(rex);
+    if (map >= 1) emit8(0x0F);
+    if (map == 2) emit8(0x38);
+    if (map == 3) emit8(0x3A);
+    emit8(opcode);
+    return encodeModRM(regField, rm);
+}
+
+bool X64Assembler::encodeVex(uint8_t prefix, uint8_t map, bool vexW, bool vexL, uint8_t opcode,
+                             uint8_t regField, X64Reg vvvv, const X64Operand& rm) {
+    uint8_t pp = prefix == 0x66 ? 1 : prefix == 0xF3 ? 2 : prefix == 0xF2 ? 3 : 0;
+    bool r = regField & 8;
+    bool x = rm.isMem() && isExtended(rm.index);
+    bool b = (rm.isReg() && isExtended(rm.reg)) || (rm.isMem() && isExtended(rm.base));
+    uint8_t v = vvvv == X64Reg::NONE ? 0 : regNum(vvvv);
+    uint8_t tail = static_cast<uint8_t>(((~v & 15) << 3) | (vexL ? 4 : 0) | pp);
+    if (!x && !b && !vexW && map == 1) {
+        emit8(0xC5);
+        emit8(static_cast<uint8_t>((r ? 0 : 0x80) | tail));
+    } else {
+        emit8(0xC4);
+        emit8(static_cast<uint8_t>((r ? 0 : 0x80) | (x ? 0 : 0x40) | (b ? 0 : 0x20) | map));
+        emit8(static_cast<uint8_t>((vexW ? 0x80 : 0) | tail));
+    }
+    emit8(opcode);
+    return encodeModRM(regField, rm);
+}
+
+// ============================================
+// Generic emit
+// ============================================
+
+bool X64Assembler::emit(X64Op op, const X64Operand& dst, const X64Operand& src) {
+    return emit(op, dst, src, X64Operand());
+}
+
+bool X64Assembler::emit(X64Op op, const X64Operand& a, const X64Operand& b, const X64Operand& c) {
+    if (!validMem(a) || !validMem(b) || !validMem(c)) return false;
+
+    // mov r, imm picks the shortest of imm32 (zero-extended), simm32 and imm64
+    if (op == X64Op::MOV && a.isGpr() && b.isImm() && c.kind == X64Operand::Kind::NONE) {
+        uint8_t r = regNum(a.reg);
+        if (a.size == 8 && !(b.imm >= 0 && b.imm <= 0xFFFFFFFFLL)) {
+            if (fitsInt32(b.imm)) {
+                emit8(isExtended(a.reg) ? 0x49 : 0x48);
+                emit8(0xC7);
+                emit8(0xC0 | (r & 7));
+                emit32(static_cast<int32_t>(b.imm));
+            } else {
+                emit8(isExtended(a.reg) ? 0x49 : 0x48);
+                emit8(0xB8 + (r & 7));
+                emit64(b.imm);
+            }
+            return true;
+        }
+        if (a.size == 2) emit8(0x66);
+        if (isExtended(a.reg)) emit8(0x41);
+        else if (needsByteRex(a)) emit8(0x40);
+        emit8(static_cast<uint8_t>((a.size == 1 ? 0xB0 : 0xB8) + (r & 7)));
+        if (a.size == 1) emit8(static_cast<uint8_t>(b.imm));
+        else if (a.size == 2) { emit8(b.imm & 0xFF); emit8((b.imm >> 8) & 0xFF); }
+        else emit32(static_cast<int32_t>(b.imm));
+        return true;
+    }
+
+    for (const Encoding& e : kEncodings) {
+        if (e.op != op || !matches(e, a, b, c)) continue;
+
+        // Which operand lands in ModRM.reg and which in ModRM.rm
+        const X64Operand* regOp = nullptr;
+        const X64Operand* rmOp = &a;
+        const X64Operand* immOp = nullptr;
+        X64Reg vvvv = X64Reg::NONE;
+        switch (e.form) {
+            case Form::RM:   regOp = &a; rmOp = &b; break;
+            case Form::MR:   regOp = &b; rmOp = &a; break;
+            case Form::MI: case Form::MI8: case Form::MIB: immOp = &b; break;
+            case Form::RMI: case Form::RMI8: regOp = &a; rmOp = &b; immOp = &c; break;
+            case Form::RVM:  regOp = &a; vvvv = b.reg; rmOp = &c; break;
+            case Form::VMI:  vvvv = a.reg; rmOp = &b; immOp = &c; break;
+            default: break;
+        }
+        if (e.form == Form::ZO) {
+            if (e.flags & F_VEX) {
+                emit8(0xC5);                                // Two-byte VEX, 128-bit, no operands
+                emit8(0xF8);
+            } else if (e.map >= 1) {
+                emit8(0x0F);
+            }
+            emit8(e.opcode);
+            if (e.ext) emit8(e.ext);
+            return true;
+        }
+        if (immOp && rmOp->isMem() && rmOp->ripRelative) return false;
+        if (e.form == Form::MI && !fitsInt32(immOp->imm)) continue;
+
+        // Operand size: GPR forms take it from the integer operand
+        uint8_t size = 8;
+        if (e.form == Form::MR) size = regOp->size;
+        else if (e.form == Form::O) size = a.size;
+        else size = (regOp && regOp->isGpr()) ? regOp->size : rmOp->size;
+
+        bool sse = e.flags & F_NOSIZE;
+        bool rexW = (e.flags & F_W) != 0;
+        uint8_t opcode = e.opcode;
+        uint8_t prefix = e.prefix;
+        if (!sse && !(e.flags & F_DEF64)) {
+            if (size == 8) rexW = true;
+            if (size == 1) {
+                if (!(e.flags & F_BYTE)) continue;
+                opcode -= 1;
+            }
+            if (size == 2) prefix = 0x66;
+        }
+        if (e.flags & F_WGPR) {
+            const X64Operand* gprOp = e.regCls == Cls::GPR ? regOp : rmOp;
+            rexW = gprOp->size == 8;
+        }
+        bool forceRex = needsByteRex(a) || needsByteRex(b);
+
+        if (e.flags & F_VEX) {
+            bool vexL = (e.flags & F_VEXL) && (a.size == 32 || b.size == 32 || c.size == 32);
+            uint8_t regField = regOp ? regNum(regOp->reg) : e.ext;
+            encodeVex(prefix, e.map, rexW, vexL, opcode, regField, vvvv, *rmOp);
+            if (immOp) emit8(static_cast<uint8_t>(immOp->imm));
+            return true;
+        }
+
+        if (e.form == Form::O) {
+            if (prefix) emit8(prefix);
+            if (isExtended(a.reg)) emit8(0x41);
+            emit8(static_cast<uint8_t>(opcode + (regNum(a.reg) & 7)));
+            return true;
+        }
+
+        uint8_t regField = regOp ? regNum(regOp->reg) : e.ext;
+        encodeLegacy(prefix, rexW, forceRex, e.map, opcode, regField, *rmOp);
+
+        if (immOp) {
+            bool imm8 = e.form == Form::MI8 || e.form == Form::MIB || e.form == Form::RMI8 || size == 1;
+            if (imm8) emit8(static_cast<uint8_t>(immOp->imm));
+            else if (size == 2) { emit8(immOp->imm & 0xFF); emit8((immOp->imm >> 8) & 0xFF); }
+            else emit32(static_cast<int32_t>(immOp->imm));
+        }
+        return true;
+    }
+    return false;
+}
+
+bool X64Assembler::jcc(X64Cond cond, const std::string& label) {
+    emit8(0x0F);
+    emit8(static_cast<uint8_t>(0x80 | static_cast<uint8_t>(cond)));
+    fixupLabel(label);
+    return true;
+}
+
+bool X64Assembler::setcc(X64Cond cond, const X64Operand& dst) {
+    if (!validMem(dst) || !(dst.isMem() || dst.isGpr())) return false;
+    X64Operand byteDst = dst;
+    byteDst.size = 1;
+    encodeLegacy(0, false, needsByteRex(byteDst), 1, static_cast<uint8_t>(0x90 | static_cast<uint8_t>(cond)),
+                 0, byteDst);
+    return true;
+}
+
+bool X64Assembler::cmov(X64Cond cond, const X64Operand& dst, const X64Operand& src) {
+    if (!dst.isGpr() || !(src.isGpr() || src.isMem()) || !validMem(src) || dst.size < 2) return false;
+    encodeLegacy(dst.size == 2 ? 0x66 : 0, dst.size == 8, false, 1,
+                 static_cast<uint8_t>(0x40 | static_cast<uint8_t>(cond)), regNum(dst.reg), src);
+    return true;
+}
+
+} // namespace tyl
@@ -28,11 +28,11 @@ struct UnaryExpr : Expression { TokenType op; ExprPtr operand; UnaryExpr(TokenTy
 struct CallExpr : Expression { ExprPtr callee; std::vector<ExprPtr> args; std::vector<std::pair<std::string, ExprPtr>> namedArgs; std::vector<std::string> typeArgs; bool isHotCallSite = false; CallExpr(ExprPtr c, SourceLocation loc) : callee(std::move(c)) { location = loc; } void accept(ASTVisitor& visitor) override; };
 struct MemberExpr : Expression { ExprPtr object; std::string member; MemberExpr(ExprPtr obj, std::string m, SourceLocation loc) : object(std::move(obj)), member(std::move(m)) { location = loc; } void accept(ASTVisitor& visitor) override; };
 struct IndexExpr : Expression { ExprPtr object; ExprPtr index; IndexExpr(ExprPtr obj, ExprPtr idx, SourceLocation loc) : object(std::move(obj)), index(std::move(idx)) { location = loc; } void accept(ASTVisitor& visitor) override; };
-struct ListExpr : Expression { std::vector<ExprPtr> elements; ListExpr(SourceLocation loc) { location = loc; } void accept(ASTVisitor& visitor) override; };
-struct RecordExpr : Expression { std::string typeName; std::vector<std::string> typeArgs; std::vector<std::pair<std::string, ExprPtr>> fields; RecordExpr(SourceLocation loc) { location = loc; } void accept(ASTVisitor& visitor) override; };
+struct ListExpr : Expression { std::vector<ExprPtr> elements; bool noEscape = false; ListExpr(SourceLocation loc) { location = loc; } void accept(ASTVisitor& visitor) override; };
+struct RecordExpr : Expression { std::string typeName; std::vector<std::string> typeArgs; std::vector<std::pair<std::string, ExprPtr>> fields; bool noEscape = false; RecordExpr(SourceLocation loc) { location = loc; } void accept(ASTVisitor& visitor) override; };
 struct MapExpr : Expression { std::vector<std::pair<ExprPtr, ExprPtr>> entries; MapExpr(SourceLocation loc) { location = loc; } void accept(ASTVisitor& visitor) override; };
 struct RangeExpr : Expression { ExprPtr start; ExprPtr end; ExprPtr step; RangeExpr(ExprPtr s, ExprPtr e, ExprPtr st, SourceLocation loc) : start(std::move(s)), end(std::move(e)), step(std::move(st)) { location = loc; } void accept(ASTVisitor& visitor) override; };
-struct LambdaExpr : Expression { std::vector<std::pair<std::string, std::string>> params; ExprPtr body; LambdaExpr(SourceLocation loc) { location = loc; } void accept(ASTVisitor& visitor) override; };
+struct LambdaExpr : Expression { std::vector<std::pair<std::string, std::string>> params; ExprPtr body; bool noEscape = false; LambdaExpr(SourceLocation loc) { location = loc; } void accept(ASTVisitor& visitor) override; };
 struct TernaryExpr : Expression { ExprPtr condition; ExprPtr thenExpr; ExprPtr elseExpr; TernaryExpr(ExprPtr c, ExprPtr t, ExprPtr e, SourceLocation loc) : condition(std::move(c)), thenExpr(std::move(t)), elseExpr(std::move(e)) { location = loc; } void accept(ASTVisitor& visitor) override; };
 struct ListCompExpr : Expression { ExprPtr expr; std::string var; ExprPtr iterable; ExprPtr condition; ListCompExpr(ExprPtr e, std::string v, ExprPtr it, ExprPtr cond, SourceLocation loc) : expr(std::move(e)), var(std::move(v)), iterable(std::move(it)), condition(std::move(cond)) { location = loc; } void accept(ASTVisitor& visitor) override; };
 struct AddressOfExpr : Expression { ExprPtr operand; AddressOfExpr(ExprPtr e, SourceLocation loc) : operand(std::move(e)) { location = loc; } void accept(ASTVisitor& visitor) override; };
@@ -45,6 +45,9 @@ void printUsage(const char* prog) {
     std::cout << "  -Os             Optimize for size\n";
     std::cout << "  -Oz             Aggressive size optimization\n";
     std::cout << "  -Ofast          Maximum optimization (includes unsafe opts)\n";
+    std::cout << "  -march=<isa>    Target CPU: x86-64 (default), x86-64-v2, x86-64-v3 (AVX2/FMA)\n";
+    std::cout << "  --profile-generate[=<file>]  Instrument the executable; it writes <file> (default <output>.tylprof) at exit\n";
+    std::cout << "  --profile-use=<file>         Optimize using a profile written by an instrumented run\n";
     std::cout << "  --no-typecheck  Skip type checking (faster compile, less safe)\n";
     std::cout << "  --map           Generate map file\n";
     std::cout << "  -h, --help      Show this help\n";
@@ -190,10 +193,13 @@ int main(int argc, char* argv[]) {
     bool generateMap = false;
     bool generateImplib = false;
     bool skipTypeCheck = false;
+    bool profileGenerate = false;
     OptLevel optLevel = OptLevel::O2;
+    TargetISA targetISA = TargetISA::X86_64;
     std::string filename;
     std::string outputFile;
     std::string defFile;
+    std::string profileFile;
     std::vector<std::string> objectFiles;
     std::vector<std::string> staticLibs;
     std::vector<std::string> exportSymbols;
@@ -227,6 +233,13 @@ int main(int argc, char* argv[]) {
             generateMap = true;
         } else if (arg == "--no-typecheck") {
             skipTypeCheck = true;
+        } else if (arg == "--profile-generate") {
+            profileGenerate = true;
+        } else if (arg.rfind("--profile-generate=", 0) == 0) {
+            profileGenerate = true;
+            profileFile = arg.substr(19);
+        } else if (arg.rfind("--profile-use=", 0) == 0) {
+            profileFile = arg.substr(14);
         } else if (arg == "-O0") {
             optLevel = OptLevel::O0;
         } else if (arg == "-O1") {
@@ -241,6 +254,18 @@ int main(int argc, char* argv[]) {
             optLevel = OptLevel::Oz;
         } else if (arg == "-Ofast") {
             optLevel = OptLevel::Ofast;
+        } else if (arg.rfind("-march=", 0) == 0) {
+            std::string isa = arg.substr(7);
+            if (isa == "x86-64") {
+                targetISA = TargetISA::X86_64;
+            } else if (isa == "x86-64-v2") {
+                targetISA = TargetISA::X86_64_V2;
+            } else if (isa == "x86-64-v3") {
+                targetISA = TargetISA::X86_64_V3;
+            } else {
+                std::cerr << "Unknown -march target: " << isa << " (expected x86-64, x86-64-v2 or x86-64-v3)\n";
+                return 1;
+            }
         } else if (arg == "-o" && i + 1 < argc) {
             outputFile = argv[++i];
         } else if (arg == "-l" && i + 1 < argc) {
@@ -275,6 +300,11 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (profileGenerate && (compileObject || compileDll || linkMode)) {
+        std::cerr << "--profile-generate is only supported when compiling to an executable\n";
+        return 1;
+    }
+    
     // Link mode - combine object files (supports both EXE and DLL)
     if (linkMode || compileDll || (!filename.empty() && (filename.size() > 2 && 
         (filename.substr(filename.size() - 2) == ".o" || 
@@ -401,6 +431,15 @@ int main(int argc, char* argv[]) {
             Optimizer optimizer;
             optimizer.setOptLevel(optLevel);
             optimizer.setVerbose(verbose);
+            if (profileGenerate) {
+                // Keep call sites and loops shaped like the source so the
+                // counters line up with what --profile-use sees
+                optimizer.enableInlining(false);
+                optimizer.enableLoopOptimization(false);
+            } else if (!profileFile.empty()) {
+                optimizer.enablePGO(true);
+                optimizer.setProfileFile(profileFile);
+            }
             optimizer.optimize(*ast);
         }
         
@@ -434,6 +473,7 @@ int main(int argc, char* argv[]) {
                 case OptLevel::Oz: nativeCompiler.setOptLevel(CodeGenOptLevel::Oz); break;
                 case OptLevel::Ofast: nativeCompiler.setOptLevel(CodeGenOptLevel::Ofast); break;
             }
+            nativeCompiler.setTargetISA(targetISA);
             
             if (nativeCompiler.compileToObject(*ast, outputFile)) {
                 if (showAsm) {
@@ -467,6 +507,13 @@ int main(int argc, char* argv[]) {
                 case OptLevel::Oz: nativeCompiler.setOptLevel(CodeGenOptLevel::Oz); break;
                 case OptLevel::Ofast: nativeCompiler.setOptLevel(CodeGenOptLevel::Ofast); break;
             }
+            nativeCompiler.setTargetISA(targetISA);
+            if (profileGenerate) {
+                if (profileFile.empty()) {
+                    profileFile = fs::path(outputFile).replace_extension(".tylprof").string();
+                }
+                nativeCompiler.setProfileGenerate(profileFile);
+            }
             
             if (nativeCompiler.compile(*ast, outputFile)) {
                 if (showAsm) {
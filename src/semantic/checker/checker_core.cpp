@@ -336,6 +336,7 @@ void TypeChecker::registerBuiltins() {
     symbols_.define(Symbol("gc_enable", SymbolKind::FUNCTION, gcEnableFn));
     
     // gc_stats() -> int - Get GC statistics (allocated bytes)
+    // gc_stats(phase) -> int - Pause time of a collection phase so far (microseconds)
     auto gcStatsFn = std::make_shared<FunctionType>();
     gcStatsFn->returnType = reg.intType();
     symbols_.define(Symbol("gc_stats", SymbolKind::FUNCTION, gcStatsFn));
@@ -333,45 +333,52 @@ void InstructionSchedulerPass::scheduleStatements(std::vector<StmtPtr>& stmts,
 // Machine Code Scheduler
 // ============================================
 
-void MachineCodeScheduler::scheduleBlock(std::vector<uint8_t>& code, size_t start, size_t end) {
+int MachineCodeScheduler::schedule(MachineCode& code) {
+    int reordered = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < code.instrs.size(); ++i) {
+        // Blocks end before a branch target and after any control transfer;
+        // barriers (calls, nops, atomics) are never moved and split blocks too
+        const MachineInstr& instr = code.instrs[i];
+        bool startsHere = i > start && code.startsBlock(i);
+        if (startsHere) {
+            if (scheduleBlock(code, start, i)) reordered++;
+            start = i;
+        }
+        if (instr.barrier || instr.endsBlock() || instr.op == MOpcode::OPAQUE) {
+            if (scheduleBlock(code, start, i)) reordered++;
+            start = i + 1;
+        }
+    }
+    if (scheduleBlock(code, start, code.instrs.size())) reordered++;
+    return reordered;
+}
+
+bool MachineCodeScheduler::scheduleBlock(MachineCode& code, size_t start, size_t end) {
     // Machine code scheduler for x64 instructions
     // Reorders independent instructions to hide latencies and improve ILP
     
-    if (end <= start || end - start < 6) return;  // Too small to schedule
-    
-    // Decode all instructions in the block
-    std::vector<DecodedInstruction> instructions;
-    size_t pos = start;
-    
-    while (pos < end) {
-        DecodedInstruction instr;
-        instr.offset = pos;
-        instr.length = decodeInstructionLength(code, pos);
-        if (instr.length <= 0) break;
-        
-        // Decode register usage
-        decodeRegisterUsage(code, pos, instr);
-        
-        // Get latency info
-        uint8_t opcode = code[pos];
-        if (opcode >= 0x40 && opcode <= 0x4F && pos + 1 < code.size()) {
-            opcode = code[pos + 1];  // Skip REX prefix
+    const size_t maxWindow = 64;  // Bound the quadratic dependency build
+    if (end <= start || end - start < 3) return false;  // Too small to schedule
+    if (end - start > maxWindow) {
+        bool changed = false;
+        for (size_t s = start; s < end; s += maxWindow) {
+            changed |= scheduleBlock(code, s, std::min(end, s + maxWindow));
         }
-        auto latency = getInstructionLatency(opcode);
-        instr.latency = latency.latency;
-        instr.throughput = latency.throughput;
-        
-        instructions.push_back(instr);
-        pos += instr.length;
+        return changed;
     }
     
-    if (instructions.size() < 3) return;  // Not enough to schedule
+    const size_t count = end - start;
+    std::vector<int> latency(count);
+    for (size_t i = 0; i < count; ++i) {
+        latency[i] = getInstructionLatency(code.instrs[start + i]).latency;
+    }
     
     // Build dependency graph
-    std::vector<std::vector<int>> deps(instructions.size());
-    for (size_t i = 0; i < instructions.size(); ++i) {
-        for (size_t j = i + 1; j < instructions.size(); ++j) {
-            if (hasDataDependency(instructions[i], instructions[j])) {
+    std::vector<std::vector<int>> deps(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = i + 1; j < count; ++j) {
+            if (hasDataDependency(code.instrs[start + i], code.instrs[start + j])) {
                 deps[j].push_back(static_cast<int>(i));
             }
         }
@@ -379,14 +386,14 @@ void MachineCodeScheduler::scheduleBlock(std::vector<uint8_t>& code, size_t star
     
     // List scheduling algorithm
     std::vector<int> schedule;
-    std::vector<bool> scheduled(instructions.size(), false);
-    std::vector<int> readyTime(instructions.size(), 0);
+    std::vector<bool> scheduled(count, false);
+    std::vector<int> readyTime(count, 0);
     
     int currentCycle = 0;
-    while (schedule.size() < instructions.size()) {
+    while (schedule.size() < count) {
         // Find ready instructions
         std::vector<int> ready;
-        for (size_t i = 0; i < instructions.size(); ++i) {
+        for (size_t i = 0; i < count; ++i) {
             if (scheduled[i]) continue;
             
             bool allDepsScheduled = true;
@@ -396,8 +403,7 @@ void MachineCodeScheduler::scheduleBlock(std::vector<uint8_t>& code, size_t star
                     allDepsScheduled = false;
                     break;
                 }
-                maxDepFinish = std::max(maxDepFinish, 
-                    readyTime[dep] + instructions[dep].latency);
+                maxDepFinish = std::max(maxDepFinish, readyTime[dep] + latency[dep]);
             }
             
             if (allDepsScheduled && maxDepFinish <= currentCycle) {
@@ -410,9 +416,10 @@ void MachineCodeScheduler::scheduleBlock(std::vector<uint8_t>& code, size_t star
             continue;
         }
         
-        // Sort by priority (higher latency first to expose more parallelism)
-        std::sort(ready.begin(), ready.end(), [&](int a, int b) {
-            return instructions[a].latency > instructions[b].latency;
+        // Sort by priority (higher latency first to expose more parallelism),
+        // keeping the original order among equals
+        std::stable_sort(ready.begin(), ready.end(), [&](int a, int b) {
+            return latency[a] > latency[b];
         });
         
         // Schedule highest priority
@@ -430,277 +437,121 @@ void MachineCodeScheduler::scheduleBlock(std::vector<uint8_t>& code, size_t star
             break;
         }
     }
+    if (!changed) return false;
     
-    if (changed) {
-        // Reorder the actual bytes
-        std::vector<uint8_t> newCode;
-        newCode.reserve(end - start);
-        
-        for (int idx : schedule) {
-            const auto& instr = instructions[idx];
-            for (size_t i = 0; i < static_cast<size_t>(instr.length); ++i) {
-                newCode.push_back(code[instr.offset + i]);
-            }
-        }
-        
-        // Copy back
-        for (size_t i = 0; i < newCode.size(); ++i) {
-            code[start + i] = newCode[i];
-        }
-    }
-}
-
-void MachineCodeScheduler::decodeRegisterUsage(const std::vector<uint8_t>& code, 
-                                                size_t offset, DecodedInstruction& instr) {
-    if (offset >= code.size()) return;
-    
-    uint8_t b = code[offset];
-    size_t pos = offset;
+    // Reorder the instructions; the block's labels stay at its first instruction
+    std::vector<std::string> labels = std::move(code.instrs[start].labels);
+    std::vector<uint32_t> aliases = std::move(code.instrs[start].aliases);
+    uint32_t entryId = code.instrs[start].id;
+    code.instrs[start].labels.clear();
+    code.instrs[start].aliases.clear();
     
-    // Handle REX prefix
-    uint8_t rex = 0;
-    if (b >= 0x40 && b <= 0x4F) {
-        rex = b;
-        pos++;
-        if (pos >= code.size()) return;
-        b = code[pos];
+    std::vector<MachineInstr> reordered;
+    reordered.reserve(count);
+    for (int idx : schedule) {
+        reordered.push_back(std::move(code.instrs[start + idx]));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        code.instrs[start + i] = std::move(reordered[i]);
     }
     
-    // Decode based on opcode
-    switch (b) {
-        case 0x50: case 0x51: case 0x52: case 0x53:  // push r64
-        case 0x54: case 0x55: case 0x56: case 0x57:
-            instr.regsRead.insert(b - 0x50 + ((rex & 0x01) ? 8 : 0));
-            instr.regsRead.insert(4);  // RSP
-            instr.regsWritten.insert(4);  // RSP
-            break;
-            
-        case 0x58: case 0x59: case 0x5A: case 0x5B:  // pop r64
-        case 0x5C: case 0x5D: case 0x5E: case 0x5F:
-            instr.regsWritten.insert(b - 0x58 + ((rex & 0x01) ? 8 : 0));
-            instr.regsRead.insert(4);  // RSP
-            instr.regsWritten.insert(4);  // RSP
-            break;
-            
-        case 0x89: case 0x8B:  // mov r/m, r or mov r, r/m
-            if (pos + 1 < code.size()) {
-                uint8_t modrm = code[pos + 1];
-                int reg = (modrm >> 3) & 7;
-                int rm = modrm & 7;
-                if (rex & 0x04) reg += 8;  // REX.R
-                if (rex & 0x01) rm += 8;   // REX.B
-                
-                if (b == 0x89) {  // mov r/m, r
-                    instr.regsRead.insert(reg);
-                    if ((modrm >> 6) == 3) {  // Register mode
-                        instr.regsWritten.insert(rm);
-                    } else {
-                        instr.writesMemory = true;
-                    }
-                } else {  // mov r, r/m
-                    instr.regsWritten.insert(reg);
-                    if ((modrm >> 6) == 3) {
-                        instr.regsRead.insert(rm);
-                    } else {
-                        instr.readsMemory = true;
-                    }
-                }
-            }
-            break;
-            
-        case 0x01: case 0x03:  // add
-        case 0x29: case 0x2B:  // sub
-        case 0x21: case 0x23:  // and
-        case 0x09: case 0x0B:  // or
-        case 0x31: case 0x33:  // xor
-            if (pos + 1 < code.size()) {
-                uint8_t modrm = code[pos + 1];
-                int reg = (modrm >> 3) & 7;
-                int rm = modrm & 7;
-                if (rex & 0x04) reg += 8;
-                if (rex & 0x01) rm += 8;
-                
-                instr.regsRead.insert(reg);
-                if ((modrm >> 6) == 3) {
-                    instr.regsRead.insert(rm);
-                    instr.regsWritten.insert(rm);
-                } else {
-                    instr.readsMemory = true;
-                    instr.writesMemory = true;
-                }
-            }
-            break;
-            
-        default:
-            // For unknown instructions, be conservative
-            instr.readsMemory = true;
-            instr.writesMemory = true;
+    // Branches into the block name its entry id, so the new first instruction takes it over
+    MachineInstr& first = code.instrs[start];
+    for (size_t i = start + 1; i < end; ++i) {
+        if (code.instrs[i].id == entryId) {
+            std::swap(code.instrs[i].id, first.id);
             break;
+        }
     }
+    first.labels = std::move(labels);
+    first.aliases.insert(first.aliases.end(), aliases.begin(), aliases.end());
+    return true;
 }
 
-bool MachineCodeScheduler::hasDataDependency(const DecodedInstruction& a, 
-                                              const DecodedInstruction& b) {
+bool MachineCodeScheduler::hasDataDependency(const MachineInstr& a, const MachineInstr& b) {
+    // Barriers stay in place relative to everything
+    if (a.barrier || b.barrier || a.op == MOpcode::OPAQUE || b.op == MOpcode::OPAQUE) return true;
+    
     // RAW: b reads something a writes
-    for (int reg : a.regsWritten) {
-        if (b.regsRead.count(reg)) return true;
-    }
+    if (a.defs & b.uses) return true;
     
     // WAW: both write to same register
-    for (int reg : a.regsWritten) {
-        if (b.regsWritten.count(reg)) return true;
-    }
+    if (a.defs & b.defs) return true;
     
     // WAR: b writes something a reads
-    for (int reg : a.regsRead) {
-        if (b.regsWritten.count(reg)) return true;
-    }
+    if (a.uses & b.defs) return true;
     
     // Memory dependencies (conservative)
-    if ((a.writesMemory && b.readsMemory) ||
-        (a.writesMemory && b.writesMemory) ||
-        (a.readsMemory && b.writesMemory)) {
+    if ((a.writesMem && b.readsMem) ||
+        (a.writesMem && b.writesMem) ||
+        (a.readsMem && b.writesMem)) {
         return true;
     }
     
     return false;
 }
 
-int MachineCodeScheduler::decodeInstructionLength(const std::vector<uint8_t>& code, size_t offset) {
-    if (offset >= code.size()) return -1;
-    
-    uint8_t b = code[offset];
-    
-    // Simple length decoding for common x64 instructions
-    // This is not complete - a full decoder would be much more complex
-    
-    // REX prefix
-    bool hasRex = (b >= 0x40 && b <= 0x4F);
-    if (hasRex) {
-        if (offset + 1 >= code.size()) return -1;
-        b = code[offset + 1];
-    }
-    
-    int baseLen = hasRex ? 1 : 0;
-    
-    // Common instruction patterns
-    switch (b) {
-        case 0x50: case 0x51: case 0x52: case 0x53:  // push r64
-        case 0x54: case 0x55: case 0x56: case 0x57:
-        case 0x58: case 0x59: case 0x5A: case 0x5B:  // pop r64
-        case 0x5C: case 0x5D: case 0x5E: case 0x5F:
-            return baseLen + 1;
-            
-        case 0x90:  // nop
-        case 0xC3:  // ret
-        case 0xCC:  // int3
-            return baseLen + 1;
-            
-        case 0xB8: case 0xB9: case 0xBA: case 0xBB:  // mov r32, imm32
-        case 0xBC: case 0xBD: case 0xBE: case 0xBF:
-            return baseLen + 5;
-            
-        case 0x89: case 0x8B:  // mov r/m, r or mov r, r/m
-            // Need to decode ModR/M byte
-            if (offset + baseLen + 1 >= code.size()) return -1;
-            {
-                uint8_t modrm = code[offset + baseLen + 1];
-                int mod = (modrm >> 6) & 3;
-                int rm = modrm & 7;
-                int len = baseLen + 2;
-                
-                if (mod == 0 && rm == 5) len += 4;  // disp32
-                else if (mod == 1) len += 1;        // disp8
-                else if (mod == 2) len += 4;        // disp32
-                
-                if (rm == 4 && mod != 3) len += 1;  // SIB byte
-                
-                return len;
-            }
-            
-        case 0x0F:  // Two-byte opcode
-            if (offset + baseLen + 1 >= code.size()) return -1;
-            {
-                uint8_t b2 = code[offset + baseLen + 1];
-                // Conditional jumps
-                if (b2 >= 0x80 && b2 <= 0x8F) {
-                    return baseLen + 6;  // jcc rel32
-                }
-                // setcc
-                if (b2 >= 0x90 && b2 <= 0x9F) {
-                    return baseLen + 3;  // setcc r/m8
-                }
-                return baseLen + 3;  // Default for 0F xx
-            }
-            
-        case 0xE8:  // call rel32
-        case 0xE9:  // jmp rel32
-            return baseLen + 5;
-            
-        case 0xEB:  // jmp rel8
-            return baseLen + 2;
-            
-        default:
-            // Default: assume 3 bytes (common for many instructions)
-            return baseLen + 3;
-    }
-}
-
-bool MachineCodeScheduler::canReorder(const std::vector<uint8_t>& code, size_t i1, size_t i2) {
-    // Very conservative check - only reorder if we're sure it's safe
-    // This would need full register/memory dependency analysis
-    
-    if (i1 >= code.size() || i2 >= code.size()) return false;
-    
-    uint8_t b1 = code[i1];
-    uint8_t b2 = code[i2];
-    
-    // Skip REX prefixes
-    if (b1 >= 0x40 && b1 <= 0x4F && i1 + 1 < code.size()) b1 = code[i1 + 1];
-    if (b2 >= 0x40 && b2 <= 0x4F && i2 + 1 < code.size()) b2 = code[i2 + 1];
-    
-    // Don't reorder control flow instructions
-    if (b1 == 0xE8 || b1 == 0xE9 || b1 == 0xEB || b1 == 0xC3) return false;
-    if (b2 == 0xE8 || b2 == 0xE9 || b2 == 0xEB || b2 == 0xC3) return false;
-    
-    // Don't reorder push/pop (stack operations)
-    if ((b1 >= 0x50 && b1 <= 0x5F) || (b2 >= 0x50 && b2 <= 0x5F)) return false;
-    
-    // For now, be very conservative
-    return false;
-}
-
-InstructionLatency MachineCodeScheduler::getInstructionLatency(uint8_t opcode) {
+InstructionLatency MachineCodeScheduler::getInstructionLatency(const MachineInstr& instr) {
     // Approximate latencies for modern x64 CPUs (Intel Skylake-ish)
-    switch (opcode) {
-        // Simple ALU operations: 1 cycle latency, 0.25 throughput
-        case 0x01: case 0x03:  // add
-        case 0x29: case 0x2B:  // sub
-        case 0x21: case 0x23:  // and
-        case 0x09: case 0x0B:  // or
-        case 0x31: case 0x33:  // xor
+    switch (instr.op) {
+        // Simple ALU operations and register moves: 1 cycle latency
+        case MOpcode::ALU_RR:
+        case MOpcode::ALU_RI:
+        case MOpcode::TEST_RR:
+        case MOpcode::MOV_RR:
+        case MOpcode::MOV_RI:
+        case MOpcode::LEA:
             return {1, 1};
             
-        // Multiply: 3-4 cycle latency
-        case 0x0F:  // imul (with 0FAF)
-            return {3, 1};
-            
-        // Division: 20-80+ cycles
-        case 0xF7:  // div/idiv
-            return {30, 30};
-            
         // Memory operations: 4-5 cycles for L1 hit
-        case 0x89: case 0x8B:  // mov r/m
+        case MOpcode::LOAD:
+        case MOpcode::POP:
             return {4, 1};
+        case MOpcode::STORE:
+        case MOpcode::STORE_IMM:
+        case MOpcode::PUSH:
+            return {1, 1};
             
         // Jumps: 1 cycle (predicted)
-        case 0xE9: case 0xEB:  // jmp
-        case 0xE8:             // call
+        case MOpcode::JMP:
+        case MOpcode::JCC:
+        case MOpcode::CALL:
+        case MOpcode::RET:
             return {1, 1};
             
         default:
-            return {1, 1};  // Default
+            break;
+    }
+    
+    // Skip legacy/REX prefixes to find the opcode byte
+    size_t pos = 0;
+    const auto& bytes = instr.bytes;
+    while (pos < bytes.size() && (bytes[pos] == 0x66 || bytes[pos] == 0xF2 || bytes[pos] == 0xF3 ||
+                                  (bytes[pos] >= 0x40 && bytes[pos] <= 0x4F))) {
+        pos++;
+    }
+    if (pos >= bytes.size()) return {1, 1};
+    uint8_t opcode = bytes[pos];
+    uint8_t second = pos + 1 < bytes.size() ? bytes[pos + 1] : 0;
+    
+    if (opcode == 0x0F) {
+        if (second == 0xAF) return {3, 1};                          // imul r, r/m
+        if (second == 0x51) return {18, 6};                         // sqrtss/sd
+        if (second == 0x59) return {4, 1};                          // mulss/sd
+        if (second == 0x5E) return {14, 4};                         // divss/sd
+        if (second == 0x58 || second == 0x5C) return {4, 1};        // addss/sd, subss/sd
+        if (second == 0x2A || second == 0x2C || second == 0x2D) return {6, 1};  // conversions
+    }
+    if (opcode == 0x69 || opcode == 0x6B) return {3, 1};            // imul r, r/m, imm
+    
+    // Division: 20-80+ cycles
+    if ((opcode == 0xF7 || opcode == 0xF6) && instr.bytes.size() > pos + 1) {
+        uint8_t sub = (bytes[pos + 1] >> 3) & 7;
+        if (sub >= 6) return {30, 30};
+        if (sub >= 4) return {3, 1};
     }
+    if (instr.readsMem) return {4, 1};
+    return {1, 1};  // Default
 }
 
 } // namespace tyl
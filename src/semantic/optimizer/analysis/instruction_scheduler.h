@@ -5,6 +5,7 @@
 
 #include "optimizer.h"
 #include "frontend/ast/ast.h"
+#include "backend/x64/machine_ir.h"
 #include <vector>
 #include <set>
 #include <map>
@@ -17,18 +18,6 @@ struct InstructionLatency {
     int throughput;     // Cycles between issue of same instruction
 };
 
-// Decoded instruction for machine code scheduling
-struct DecodedInstruction {
-    size_t offset;              // Offset in code buffer
-    int length;                 // Instruction length in bytes
-    int latency;                // Execution latency
-    int throughput;             // Throughput
-    std::set<int> regsRead;     // Registers read (0-15 for x64)
-    std::set<int> regsWritten;  // Registers written
-    bool readsMemory = false;   // Does this read memory?
-    bool writesMemory = false;  // Does this write memory?
-};
-
 // Dependency types between instructions
 enum class DependencyType {
     RAW,    // Read After Write (true dependency)
@@ -93,28 +82,22 @@ private:
 };
 
 // Post-codegen instruction scheduler (operates on machine code)
-// This is a more advanced scheduler that works on the generated x64 code
+// Works on the lifted instruction list (backend/x64/machine_ir.h); reorders
+// independent instructions inside each basic block to hide latencies.
 class MachineCodeScheduler {
 public:
-    // Schedule instructions in a basic block
-    void scheduleBlock(std::vector<uint8_t>& code, size_t start, size_t end);
+    // Schedule every basic block; returns the number of blocks reordered
+    int schedule(MachineCode& code);
+    
+    // Schedule instructions in a basic block [start, end)
+    bool scheduleBlock(MachineCode& code, size_t start, size_t end);
     
     // Get latency for an x64 instruction
-    static InstructionLatency getInstructionLatency(uint8_t opcode);
+    static InstructionLatency getInstructionLatency(const MachineInstr& instr);
     
 private:
-    // Decode instruction length
-    int decodeInstructionLength(const std::vector<uint8_t>& code, size_t offset);
-    
-    // Decode register usage for an instruction
-    void decodeRegisterUsage(const std::vector<uint8_t>& code, size_t offset, 
-                             DecodedInstruction& instr);
-    
-    // Check if instruction can be reordered
-    bool canReorder(const std::vector<uint8_t>& code, size_t i1, size_t i2);
-    
-    // Check for data dependency between two instructions
-    bool hasDataDependency(const DecodedInstruction& a, const DecodedInstruction& b);
+    // Check for data dependency between two instructions (a before b)
+    bool hasDataDependency(const MachineInstr& a, const MachineInstr& b);
 };
 
 } // namespace tyl
@@ -64,20 +64,77 @@ void ProfileCollector::instrument(Program& ast) {
     functionsInstrumented_ = 0;
     branchesInstrumented_ = 0;
     loopsInstrumented_ = 0;
+    callSitesInstrumented_ = 0;
     counterIndex_ = 0;
+    siteCounters_.clear();
+    keyCounters_.clear();
+    records_.clear();
+    userFunctions_.clear();
     
+    std::vector<FnDecl*> functions;
     for (auto& stmt : ast.statements) {
         if (auto* fn = dynamic_cast<FnDecl*>(stmt.get())) {
-            instrumentFunction(fn);
+            functions.push_back(fn);
+        } else if (auto* mod = dynamic_cast<ModuleDecl*>(stmt.get())) {
+            for (auto& modStmt : mod->body) {
+                if (auto* fn = dynamic_cast<FnDecl*>(modStmt.get())) {
+                    functions.push_back(fn);
+                }
+            }
         }
     }
+    for (auto* fn : functions) {
+        if (fn->typeParams.empty()) userFunctions_.insert(fn->name);
+    }
+    for (auto* fn : functions) {
+        instrumentFunction(fn);
+    }
+    
+    // The reader attaches BRANCH/LOOP/CALL lines to the FUNC line above them
+    std::stable_sort(records_.begin(), records_.end(),
+        [](const ProfileRecord& a, const ProfileRecord& b) {
+            if (a.function != b.function) return a.function < b.function;
+            return a.kind == ProfileRecord::Kind::Function && b.kind != ProfileRecord::Kind::Function;
+        });
+}
+
+int ProfileCollector::addSite(const ASTNode* site, ProfileRecord::Kind kind, 
+                              const std::string& funcName, size_t line, 
+                              const std::string& callee) {
+    std::string key = std::to_string(static_cast<int>(kind)) + ":" + funcName + ":" +
+                      std::to_string(line) + ":" + callee;
+    auto it = keyCounters_.find(key);
+    if (it != keyCounters_.end()) {
+        siteCounters_[site] = it->second;
+        return it->second;
+    }
+    
+    ProfileRecord record;
+    record.kind = kind;
+    record.function = funcName;
+    record.callee = callee;
+    record.line = line;
+    record.counter = counterIndex_;
+    counterIndex_ += record.counterCount();
+    records_.push_back(record);
+    
+    keyCounters_[key] = record.counter;
+    siteCounters_[site] = record.counter;
+    return record.counter;
+}
+
+int ProfileCollector::counterFor(const ASTNode* site) const {
+    auto it = siteCounters_.find(site);
+    return it != siteCounters_.end() ? it->second : -1;
 }
 
 void ProfileCollector::instrumentFunction(FnDecl* fn) {
     if (!fn || !fn->body) return;
     if (fn->isExtern) return;  // Can't instrument extern functions
+    if (fn->isNaked || !fn->typeParams.empty()) return;
     
     functionsInstrumented_++;
+    addSite(fn, ProfileRecord::Kind::Function, fn->name, fn->location.line);
     
     // Instrument the function body
     instrumentStatement(fn->body, fn->name);
@@ -93,44 +150,90 @@ void ProfileCollector::instrumentStatement(StmtPtr& stmt, const std::string& fun
     }
     else if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt.get())) {
         instrumentBranch(ifStmt, funcName);
+        instrumentExpression(ifStmt->condition.get(), funcName);
         instrumentStatement(ifStmt->thenBranch, funcName);
         for (auto& elif : ifStmt->elifBranches) {
+            instrumentExpression(elif.first.get(), funcName);
             instrumentStatement(elif.second, funcName);
         }
         instrumentStatement(ifStmt->elseBranch, funcName);
     }
     else if (auto* forStmt = dynamic_cast<ForStmt*>(stmt.get())) {
         instrumentLoop(forStmt, funcName);
+        instrumentExpression(forStmt->iterable.get(), funcName);
         instrumentStatement(forStmt->body, funcName);
     }
     else if (auto* whileStmt = dynamic_cast<WhileStmt*>(stmt.get())) {
         instrumentLoop(whileStmt, funcName);
+        instrumentExpression(whileStmt->condition.get(), funcName);
         instrumentStatement(whileStmt->body, funcName);
     }
+    else if (auto* exprStmt = dynamic_cast<ExprStmt*>(stmt.get())) {
+        instrumentExpression(exprStmt->expr.get(), funcName);
+    }
+    else if (auto* varDecl = dynamic_cast<VarDecl*>(stmt.get())) {
+        instrumentExpression(varDecl->initializer.get(), funcName);
+    }
+    else if (auto* assignStmt = dynamic_cast<AssignStmt*>(stmt.get())) {
+        instrumentExpression(assignStmt->value.get(), funcName);
+    }
+    else if (auto* returnStmt = dynamic_cast<ReturnStmt*>(stmt.get())) {
+        instrumentExpression(returnStmt->value.get(), funcName);
+    }
+}
+
+void ProfileCollector::instrumentExpression(Expression* expr, const std::string& funcName) {
+    if (!expr) return;
+    
+    if (auto* call = dynamic_cast<CallExpr*>(expr)) {
+        if (auto* callee = dynamic_cast<Identifier*>(call->callee.get())) {
+            if (userFunctions_.count(callee->name)) {
+                callSitesInstrumented_++;
+                addSite(call, ProfileRecord::Kind::CallSite, funcName, 
+                        call->location.line, callee->name);
+            }
+        }
+        for (auto& arg : call->args) {
+            instrumentExpression(arg.get(), funcName);
+        }
+    }
+    else if (auto* binary = dynamic_cast<BinaryExpr*>(expr)) {
+        instrumentExpression(binary->left.get(), funcName);
+        instrumentExpression(binary->right.get(), funcName);
+    }
+    else if (auto* unary = dynamic_cast<UnaryExpr*>(expr)) {
+        instrumentExpression(unary->operand.get(), funcName);
+    }
+    else if (auto* ternary = dynamic_cast<TernaryExpr*>(expr)) {
+        instrumentExpression(ternary->condition.get(), funcName);
+        instrumentExpression(ternary->thenExpr.get(), funcName);
+        instrumentExpression(ternary->elseExpr.get(), funcName);
+    }
+    else if (auto* assign = dynamic_cast<AssignExpr*>(expr)) {
+        instrumentExpression(assign->value.get(), funcName);
+    }
 }
 
 void ProfileCollector::instrumentBranch(IfStmt* ifStmt, const std::string& funcName) {
-    (void)ifStmt;
-    (void)funcName;
+    // One site per arm, keyed by the line of its condition
     branchesInstrumented_++;
-    counterIndex_++;
-    // In a full implementation, we would insert counter increment code
-    // at the start of each branch
+    addSite(ifStmt->condition.get(), ProfileRecord::Kind::Branch, funcName,
+            ifStmt->condition->location.line);
+    for (auto& elif : ifStmt->elifBranches) {
+        branchesInstrumented_++;
+        addSite(elif.first.get(), ProfileRecord::Kind::Branch, funcName,
+                elif.first->location.line);
+    }
 }
 
 void ProfileCollector::instrumentLoop(ForStmt* forStmt, const std::string& funcName) {
-    (void)forStmt;
-    (void)funcName;
     loopsInstrumented_++;
-    counterIndex_++;
-    // In a full implementation, we would insert iteration counter code
+    addSite(forStmt, ProfileRecord::Kind::Loop, funcName, forStmt->location.line);
 }
 
 void ProfileCollector::instrumentLoop(WhileStmt* whileStmt, const std::string& funcName) {
-    (void)whileStmt;
-    (void)funcName;
     loopsInstrumented_++;
-    counterIndex_++;
+    addSite(whileStmt, ProfileRecord::Kind::Loop, funcName, whileStmt->location.line);
 }
 
 std::string ProfileCollector::generateProfileFormat() const {
@@ -140,6 +243,7 @@ std::string ProfileCollector::generateProfileFormat() const {
     ss << "# Functions: " << functionsInstrumented_ << "\n";
     ss << "# Branches: " << branchesInstrumented_ << "\n";
     ss << "# Loops: " << loopsInstrumented_ << "\n";
+    ss << "# Call sites: " << callSitesInstrumented_ << "\n";
     return ss.str();
 }
 
@@ -372,70 +476,87 @@ void PGOPass::markHotColdFunctions(Program& ast) {
 
 void PGOPass::adjustInliningDecisions(Program& ast) {
     // Mark call sites with their frequency for the inlining pass
-    std::function<void(Statement*, const std::string&)> markCallSites = 
-        [&](Statement* stmt, const std::string& funcName) {
+    const FunctionProfile* funcProfile = nullptr;
+    
+    std::function<void(Expression*)> markExpr = [&](Expression* expr) {
+        if (!expr) return;
+        
+        if (auto* call = dynamic_cast<CallExpr*>(expr)) {
+            if (auto* callee = dynamic_cast<Identifier*>(call->callee.get())) {
+                for (const auto& site : funcProfile->callSites) {
+                    // Mark as hot call site if frequently called
+                    if (site.callee == callee->name && 
+                        site.lineNumber == call->location.line &&
+                        site.callCount >= profile_.hotThreshold) {
+                        call->isHotCallSite = true;
+                        transformations_++;
+                        break;
+                    }
+                }
+            }
+            for (auto& arg : call->args) markExpr(arg.get());
+        }
+        else if (auto* binary = dynamic_cast<BinaryExpr*>(expr)) {
+            markExpr(binary->left.get());
+            markExpr(binary->right.get());
+        }
+        else if (auto* unary = dynamic_cast<UnaryExpr*>(expr)) {
+            markExpr(unary->operand.get());
+        }
+        else if (auto* ternary = dynamic_cast<TernaryExpr*>(expr)) {
+            markExpr(ternary->condition.get());
+            markExpr(ternary->thenExpr.get());
+            markExpr(ternary->elseExpr.get());
+        }
+        else if (auto* assign = dynamic_cast<AssignExpr*>(expr)) {
+            markExpr(assign->value.get());
+        }
+    };
+    
+    std::function<void(Statement*)> markCallSites = [&](Statement* stmt) {
         if (!stmt) return;
         
         if (auto* block = dynamic_cast<Block*>(stmt)) {
             for (auto& s : block->statements) {
-                markCallSites(s.get(), funcName);
+                markCallSites(s.get());
             }
         }
         else if (auto* exprStmt = dynamic_cast<ExprStmt*>(stmt)) {
-            // Check for call expressions
-            if (auto* call = dynamic_cast<CallExpr*>(exprStmt->expr.get())) {
-                if (auto* callee = dynamic_cast<Identifier*>(call->callee.get())) {
-                    // Look up call site frequency
-                    auto funcIt = profile_.functions.find(funcName);
-                    if (funcIt != profile_.functions.end()) {
-                        for (const auto& site : funcIt->second.callSites) {
-                            if (site.callee == callee->name) {
-                                // Mark as hot call site if frequently called
-                                if (site.callCount >= profile_.hotThreshold) {
-                                    call->isHotCallSite = true;
-                                    transformations_++;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+            markExpr(exprStmt->expr.get());
         }
         else if (auto* varDecl = dynamic_cast<VarDecl*>(stmt)) {
-            // Check initializer for calls
-            if (auto* call = dynamic_cast<CallExpr*>(varDecl->initializer.get())) {
-                if (auto* callee = dynamic_cast<Identifier*>(call->callee.get())) {
-                    auto funcIt = profile_.functions.find(funcName);
-                    if (funcIt != profile_.functions.end()) {
-                        for (const auto& site : funcIt->second.callSites) {
-                            if (site.callee == callee->name && 
-                                site.callCount >= profile_.hotThreshold) {
-                                call->isHotCallSite = true;
-                                transformations_++;
-                            }
-                        }
-                    }
-                }
-            }
+            markExpr(varDecl->initializer.get());
+        }
+        else if (auto* assignStmt = dynamic_cast<AssignStmt*>(stmt)) {
+            markExpr(assignStmt->value.get());
+        }
+        else if (auto* returnStmt = dynamic_cast<ReturnStmt*>(stmt)) {
+            markExpr(returnStmt->value.get());
         }
         else if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt)) {
-            markCallSites(ifStmt->thenBranch.get(), funcName);
+            markExpr(ifStmt->condition.get());
+            markCallSites(ifStmt->thenBranch.get());
             for (auto& elif : ifStmt->elifBranches) {
-                markCallSites(elif.second.get(), funcName);
+                markExpr(elif.first.get());
+                markCallSites(elif.second.get());
             }
-            markCallSites(ifStmt->elseBranch.get(), funcName);
+            markCallSites(ifStmt->elseBranch.get());
         }
         else if (auto* forStmt = dynamic_cast<ForStmt*>(stmt)) {
-            markCallSites(forStmt->body.get(), funcName);
+            markCallSites(forStmt->body.get());
         }
         else if (auto* whileStmt = dynamic_cast<WhileStmt*>(stmt)) {
-            markCallSites(whileStmt->body.get(), funcName);
+            markExpr(whileStmt->condition.get());
+            markCallSites(whileStmt->body.get());
         }
     };
     
     for (auto& stmt : ast.statements) {
         if (auto* fn = dynamic_cast<FnDecl*>(stmt.get())) {
-            markCallSites(fn->body.get(), fn->name);
+            auto funcIt = profile_.functions.find(fn->name);
+            if (funcIt == profile_.functions.end()) continue;
+            funcProfile = &funcIt->second;
+            markCallSites(fn->body.get());
         }
     }
 }
@@ -460,6 +581,7 @@ void PGOPass::optimizeFunction(FnDecl* fn) {
         else if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt)) {
             if (branchReordering_) {
                 reorderBranches(ifStmt, fn->name);
+                layoutBranch(ifStmt, fn->name);
             }
             optimize(ifStmt->thenBranch.get());
             for (auto& elif : ifStmt->elifBranches) {
@@ -480,35 +602,38 @@ void PGOPass::optimizeFunction(FnDecl* fn) {
 }
 
 void PGOPass::reorderBranches(IfStmt* ifStmt, const std::string& funcName) {
-    if (!ifStmt || ifStmt->elifBranches.empty()) return;
+    if (!ifStmt || ifStmt->elifBranches.size() < 2) return;
+    
+    // Only arms that can never both match may be tested in another order
+    if (!elifsMutuallyExclusive(ifStmt)) return;
     
     auto funcIt = profile_.functions.find(funcName);
     if (funcIt == profile_.functions.end()) return;
     
-    // Find branch probabilities for elif branches
-    std::vector<std::pair<size_t, double>> branchProbs;
+    // Find how often each elif arm was taken
+    std::vector<std::pair<size_t, uint64_t>> branchCounts;
     
     for (size_t i = 0; i < ifStmt->elifBranches.size(); ++i) {
         size_t line = ifStmt->elifBranches[i].first->location.line;
-        double prob = 0.5;
+        uint64_t taken = 0;
         
         for (const auto& branch : funcIt->second.branches) {
             if (branch.lineNumber == line) {
-                prob = branch.takenProbability();
+                taken = branch.takenCount;
                 break;
             }
         }
-        branchProbs.push_back({i, prob});
+        branchCounts.push_back({i, taken});
     }
     
-    // Sort by probability (highest first)
-    std::sort(branchProbs.begin(), branchProbs.end(),
+    // Sort by taken count (most frequent first)
+    std::stable_sort(branchCounts.begin(), branchCounts.end(),
         [](const auto& a, const auto& b) { return a.second > b.second; });
     
     // Check if reordering would help
     bool needsReorder = false;
-    for (size_t i = 0; i < branchProbs.size(); ++i) {
-        if (branchProbs[i].first != i) {
+    for (size_t i = 0; i < branchCounts.size(); ++i) {
+        if (branchCounts[i].first != i) {
             needsReorder = true;
             break;
         }
@@ -519,7 +644,7 @@ void PGOPass::reorderBranches(IfStmt* ifStmt, const std::string& funcName) {
         std::vector<std::pair<ExprPtr, StmtPtr>> newElifs;
         newElifs.reserve(ifStmt->elifBranches.size());
         
-        for (const auto& [idx, prob] : branchProbs) {
+        for (const auto& [idx, count] : branchCounts) {
             newElifs.push_back(std::move(ifStmt->elifBranches[idx]));
         }
         
@@ -528,6 +653,85 @@ void PGOPass::reorderBranches(IfStmt* ifStmt, const std::string& funcName) {
     }
 }
 
+// Elif arms of the form `x == <literal>` on the same variable with distinct
+// literals are mutually exclusive and side-effect free
+bool PGOPass::elifsMutuallyExclusive(IfStmt* ifStmt) {
+    std::string var;
+    std::set<std::string> seen;
+    
+    for (auto& [cond, body] : ifStmt->elifBranches) {
+        auto* cmp = dynamic_cast<BinaryExpr*>(cond.get());
+        if (!cmp || cmp->op != TokenType::EQ) return false;
+        
+        auto* id = dynamic_cast<Identifier*>(cmp->left.get());
+        Expression* other = cmp->right.get();
+        if (!id) {
+            id = dynamic_cast<Identifier*>(cmp->right.get());
+            other = cmp->left.get();
+        }
+        if (!id) return false;
+        
+        std::string key;
+        if (auto* intLit = dynamic_cast<IntegerLiteral*>(other)) {
+            key = "i" + std::to_string(intLit->value);
+        } else if (auto* strLit = dynamic_cast<StringLiteral*>(other)) {
+            key = "s" + strLit->value;
+        } else {
+            return false;
+        }
+        
+        if (var.empty()) var = id->name;
+        if (id->name != var || !seen.insert(key).second) return false;
+    }
+    return true;
+}
+
+// Put the arm the profile says is usually taken on the fall-through path:
+// `if c: A else: B` with c mostly false becomes `if not c: B else: A`
+void PGOPass::layoutBranch(IfStmt* ifStmt, const std::string& funcName) {
+    if (!ifStmt || !ifStmt->elifBranches.empty() || !ifStmt->elseBranch) return;
+    
+    // The negation must be exact, so only boolean-valued conditions
+    auto* cond = ifStmt->condition.get();
+    auto* binary = dynamic_cast<BinaryExpr*>(cond);
+    auto* unary = dynamic_cast<UnaryExpr*>(cond);
+    bool isBool = unary && unary->op == TokenType::NOT;
+    if (binary) {
+        switch (binary->op) {
+            case TokenType::EQ: case TokenType::NE:
+            case TokenType::LT: case TokenType::LE:
+            case TokenType::GT: case TokenType::GE:
+            case TokenType::AND: case TokenType::OR:
+                isBool = true;
+                break;
+            default:
+                break;
+        }
+    }
+    if (!isBool) return;
+    
+    auto funcIt = profile_.functions.find(funcName);
+    if (funcIt == profile_.functions.end()) return;
+    
+    for (const auto& branch : funcIt->second.branches) {
+        if (branch.lineNumber != cond->location.line) continue;
+        
+        uint64_t total = branch.takenCount + branch.notTakenCount;
+        if (total < 100 || branch.takenProbability() >= 0.25) return;
+        
+        if (unary) {
+            ifStmt->condition = std::move(unary->operand);
+        } else {
+            SourceLocation loc = cond->location;
+            ifStmt->condition = std::make_unique<UnaryExpr>(
+                TokenType::NOT, std::move(ifStmt->condition), loc);
+        }
+        std::swap(ifStmt->thenBranch, ifStmt->elseBranch);
+        transformations_++;
+        return;
+    }
+}
+
 void PGOPass::adjustLoopUnrolling(ForStmt* forStmt, const std::string& funcName) {
     auto funcIt = profile_.functions.find(funcName);
     if (funcIt == profile_.functions.end()) return;
@@ -538,13 +742,14 @@ void PGOPass::adjustLoopUnrolling(ForStmt* forStmt, const std::string& funcName)
         if (loop.lineNumber == line) {
             double avgIters = loop.avgIterations();
             
-            // Store hint for loop optimizer
+            // Store hint for loop optimizer: >= 4 is an unroll factor for
+            // LoopUnrolling, 1-3 is a peel count for LoopPeeling
             if (avgIters > 100) {
                 // Hot loop - suggest more aggressive unrolling
                 forStmt->unrollHint = static_cast<int>(unrollBias_ * 4);
                 transformations_++;
-            } else if (avgIters < 4) {
-                // Small loop - suggest full unrolling
+            } else if (avgIters >= 1 && avgIters < 4) {
+                // Short loop - peel the iterations it usually runs
                 forStmt->unrollHint = static_cast<int>(avgIters);
                 transformations_++;
             }
@@ -6,6 +6,7 @@
 #include "optimizer.h"
 #include "frontend/ast/ast.h"
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <fstream>
@@ -74,7 +75,28 @@ struct ProgramProfile {
     void computeStatistics();
 };
 
-// Profile data collector - generates instrumented code
+// One line of the profile file. The instrumented program fills it from
+// consecutive counters when it exits:
+//   Function: [calls]                 -> FUNC name calls 0
+//   Branch:   [executed, taken]       -> BRANCH line taken notTaken
+//   Loop:     [entries, iterations]   -> LOOP line iterations entries
+//   CallSite: [calls]                 -> CALL callee line calls
+struct ProfileRecord {
+    enum class Kind { Function, Branch, Loop, CallSite };
+    Kind kind = Kind::Function;
+    std::string function;
+    std::string callee;               // CallSite only
+    size_t line = 0;
+    int counter = 0;                  // Index of the first counter
+    
+    int counterCount() const {
+        return kind == Kind::Branch || kind == Kind::Loop ? 2 : 1;
+    }
+};
+
+// Profile data collector - assigns counters to the sites codegen instruments
+// (--profile-generate). Sites are keyed by function and source line so the
+// profile still matches the AST the next build sees before optimization.
 class ProfileCollector {
 public:
     ProfileCollector();
@@ -85,21 +107,38 @@ public:
     // Generate profile data file format
     std::string generateProfileFormat() const;
     
+    // Counter lookup for codegen: first counter of the site, -1 if none
+    int counterFor(const ASTNode* site) const;
+    int counterCount() const { return counterIndex_; }
+    const std::vector<ProfileRecord>& records() const { return records_; }
+    
     // Get instrumentation statistics
     int functionsInstrumented() const { return functionsInstrumented_; }
     int branchesInstrumented() const { return branchesInstrumented_; }
     int loopsInstrumented() const { return loopsInstrumented_; }
+    int callSitesInstrumented() const { return callSitesInstrumented_; }
     
 private:
     void instrumentFunction(FnDecl* fn);
     void instrumentStatement(StmtPtr& stmt, const std::string& funcName);
+    void instrumentExpression(Expression* expr, const std::string& funcName);
     void instrumentBranch(IfStmt* ifStmt, const std::string& funcName);
     void instrumentLoop(ForStmt* forStmt, const std::string& funcName);
     void instrumentLoop(WhileStmt* whileStmt, const std::string& funcName);
     
+    // Assign (or share) the counters for a site
+    int addSite(const ASTNode* site, ProfileRecord::Kind kind, const std::string& funcName,
+                size_t line, const std::string& callee = "");
+    
+    std::map<const ASTNode*, int> siteCounters_;
+    std::map<std::string, int> keyCounters_;   // Sites on the same line share counters
+    std::vector<ProfileRecord> records_;
+    std::set<std::string> userFunctions_;      // Call sites are only counted for these
+    
     int functionsInstrumented_ = 0;
     int branchesInstrumented_ = 0;
     int loopsInstrumented_ = 0;
+    int callSitesInstrumented_ = 0;
     int counterIndex_ = 0;
 };
 
@@ -144,6 +183,7 @@ public:
     
     // Load profile from file
     bool loadProfile(const std::string& filename);
+    bool hasProfile() const { return hasProfile_; }
     
     // Configuration
     void setInliningBias(double bias) { inliningBias_ = bias; }
@@ -155,7 +195,9 @@ private:
     // PGO transformations
     void optimizeFunction(FnDecl* fn);
     void reorderBranches(IfStmt* ifStmt, const std::string& funcName);
+    void layoutBranch(IfStmt* ifStmt, const std::string& funcName);
     void adjustLoopUnrolling(ForStmt* forStmt, const std::string& funcName);
+    bool elifsMutuallyExclusive(IfStmt* ifStmt);
     void markHotColdFunctions(Program& ast);
     void adjustInliningDecisions(Program& ast);
     
@@ -352,8 +352,8 @@ void InliningPass::analyzeFunctions() {
         info.hasRecursion = checkRecursion(info.decl, name);
         if (info.hasRecursion) continue;
         
-        // Check size
-        if (info.statementCount > maxInlineStatements_) continue;
+        // Check size (callees up to the hot limit only inline at hot call sites)
+        if (info.statementCount > maxInlineStatements_ * hotCallSiteBias_) continue;
         
         // Check side effects
         info.hasSideEffects = checkSideEffects(info.decl->body.get());
@@ -382,6 +382,21 @@ void InliningPass::analyzeFunctions() {
     }
 }
 
+bool InliningPass::shouldInlineAt(CallExpr* call, const std::string& name,
+                                  const std::set<std::string>& candidates) {
+    if (!candidates.count(name)) return false;
+    const FunctionInfo& info = functions_[name];
+    
+    // Profile-hot call sites take bigger callees and ignore the per-callee budget
+    if (call->isHotCallSite) {
+        return info.statementCount <= maxInlineStatements_ * hotCallSiteBias_;
+    }
+    // Code in cold functions is not worth growing
+    if (inColdFunction_) return false;
+    return info.statementCount <= maxInlineStatements_ &&
+           inlineCount_[name] < maxInlineCallCount_;
+}
+
 void InliningPass::inlineCalls(Program& ast) {
     processBlock(ast.statements);
 }
@@ -399,12 +414,11 @@ void InliningPass::processStatement(StmtPtr& stmt) {
         // Check if this is a call to an inlinable function
         if (auto* call = dynamic_cast<CallExpr*>(exprStmt->expr.get())) {
             if (auto* callee = dynamic_cast<Identifier*>(call->callee.get())) {
-                if (inlineCandidates_.count(callee->name) && 
-                    inlineCount_[callee->name] < maxInlineCallCount_) {
+                if (shouldInlineAt(call, callee->name, inlineCandidates_)) {
                     auto inlined = inlineCall(call, functions_[callee->name].decl);
                     if (inlined) {
+                        inlineCount_[callee->name]++;  // Before the call node is freed
                         stmt = std::move(inlined);
-                        inlineCount_[callee->name]++;
                         transformations_++;
                         return;
                     }
@@ -462,7 +476,10 @@ void InliningPass::processStatement(StmtPtr& stmt) {
         processBlock(block->statements);
     }
     else if (auto* fnDecl = dynamic_cast<FnDecl*>(stmt.get())) {
+        bool savedCold = inColdFunction_;
+        inColdFunction_ = fnDecl->isCold;
         processStatement(fnDecl->body);
+        inColdFunction_ = savedCold;
     }
     else if (auto* moduleDecl = dynamic_cast<ModuleDecl*>(stmt.get())) {
         processBlock(moduleDecl->body);
@@ -475,8 +492,7 @@ ExprPtr InliningPass::processExpression(ExprPtr& expr) {
     // Check if this is a call to an expression-inlinable function
     if (auto* call = dynamic_cast<CallExpr*>(expr.get())) {
         if (auto* callee = dynamic_cast<Identifier*>(call->callee.get())) {
-            if (exprInlineCandidates_.count(callee->name) && 
-                inlineCount_[callee->name] < maxInlineCallCount_) {
+            if (shouldInlineAt(call, callee->name, exprInlineCandidates_)) {
                 auto inlined = inlineCallAsExpr(call, functions_[callee->name].decl);
                 if (inlined) {
                     inlineCount_[callee->name]++;
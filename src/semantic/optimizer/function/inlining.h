@@ -33,6 +33,7 @@ public:
     void setMaxInlineCallCount(size_t max) { maxInlineCallCount_ = max; }
     void setMaxExpressionComplexity(size_t max) { maxExpressionComplexity_ = max; }
     void setAggressiveInlining(bool aggressive) { aggressiveInlining_ = aggressive; }
+    void setHotCallSiteBias(size_t bias) { hotCallSiteBias_ = bias; }
     
 private:
     // Analysis phase
@@ -47,6 +48,10 @@ private:
     bool isSingleReturnFunction(FnDecl* fn);
     Expression* getSingleReturnExpr(FnDecl* fn);
     
+    // Per-call-site decision (profile hot/cold aware)
+    bool shouldInlineAt(CallExpr* call, const std::string& name, 
+                        const std::set<std::string>& candidates);
+    
     // Transformation phase
     void inlineCalls(Program& ast);
     void processStatement(StmtPtr& stmt);
@@ -71,10 +76,12 @@ private:
     size_t maxInlineCallCount_ = 5;     // Max times a function can be inlined
     size_t maxExpressionComplexity_ = 20;  // Max expression complexity for inline
     bool aggressiveInlining_ = false;   // Inline even with side effects
+    size_t hotCallSiteBias_ = 2;        // Size limit multiplier at profile-hot call sites
     
     // State during inlining
     std::map<std::string, size_t> inlineCount_;  // How many times each function was inlined
     int uniqueVarCounter_ = 0;  // For generating unique variable names
+    bool inColdFunction_ = false;  // Caller is profile-cold: only hot sites inline
     
     std::string generateUniqueName(const std::string& base);
 };
@@ -0,0 +1,360 @@
+// Tyl Compiler - Escape Analysis Implementation
+// Finds record, list and closure allocations that never outlive their function
+#include "escape_analysis.h"
+
+namespace tyl {
+
+void EscapeAnalysisPass::run(Program& ast) {
+    transformations_ = 0;
+    stats_ = EscapeAnalysisStats{};
+    functions_.clear();
+    paramNoEscape_.clear();
+    dropTypes_.clear();
+
+    collectFunctions(ast);
+
+    // Start optimistic (no parameter escapes) and knock summaries down until
+    // nothing changes; a parameter only ever flips from true to false
+    for (auto& [name, fn] : functions_) {
+        paramNoEscape_[name] = std::vector<bool>(fn->params.size(), true);
+    }
+
+    std::map<std::string, FunctionScan> scans;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto& [name, fn] : functions_) {
+            FunctionScan scan = scanFunction(fn);
+            auto& summary = paramNoEscape_[name];
+            for (size_t i = 0; i < fn->params.size(); i++) {
+                if (summary[i] && nameEscapes(scan, fn->params[i].first)) {
+                    summary[i] = false;
+                    changed = true;
+                }
+            }
+            scans[name] = std::move(scan);
+        }
+    }
+
+    for (auto& [name, scan] : scans) {
+        for (auto& candidate : scan.candidates) {
+            if (nameEscapes(scan, candidate.name)) continue;
+
+            if (auto* record = dynamic_cast<RecordExpr*>(candidate.alloc)) {
+                record->noEscape = true;
+                stats_.recordsOnStack++;
+            } else if (auto* list = dynamic_cast<ListExpr*>(candidate.alloc)) {
+                list->noEscape = true;
+                stats_.listsOnStack++;
+            } else if (auto* lambda = dynamic_cast<LambdaExpr*>(candidate.alloc)) {
+                lambda->noEscape = true;
+                stats_.closuresOnStack++;
+            }
+            transformations_++;
+        }
+    }
+}
+
+// Only plain top-level functions get summaries. Module functions, methods
+// and externs are called through paths we don't resolve, so passing a
+// candidate to one of them counts as an escape.
+void EscapeAnalysisPass::collectFunctions(Program& ast) {
+    std::set<std::string> duplicates;
+    for (auto& stmt : ast.statements) {
+        if (auto* fn = dynamic_cast<FnDecl*>(stmt.get())) {
+            if (fn->isExtern || fn->isAsync || fn->isNaked || !fn->body) continue;
+            if (fn->hasVariadicParams()) continue;
+            if (!functions_.emplace(fn->name, fn).second) duplicates.insert(fn->name);
+        }
+        else if (auto* impl = dynamic_cast<ImplBlock*>(stmt.get())) {
+            // Drop receives the object at scope exit and may keep it
+            if (impl->traitName == "Drop") dropTypes_.insert(impl->typeName);
+        }
+    }
+    for (const auto& name : duplicates) functions_.erase(name);
+}
+
+void EscapeAnalysisPass::collectCandidates(Statement* stmt, FunctionScan& scan) {
+    if (!stmt) return;
+
+    if (auto* block = dynamic_cast<Block*>(stmt)) {
+        for (auto& s : block->statements) collectCandidates(s.get(), scan);
+    }
+    else if (auto* varDecl = dynamic_cast<VarDecl*>(stmt)) {
+        if (varDecl->isConst) return;
+        Expression* init = varDecl->initializer.get();
+        if (auto* record = dynamic_cast<RecordExpr*>(init)) {
+            if (!record->fields.empty() && !dropTypes_.count(record->typeName)) {
+                scan.candidates.push_back({varDecl->name, init});
+            }
+        } else if (auto* list = dynamic_cast<ListExpr*>(init)) {
+            if (!list->elements.empty()) scan.candidates.push_back({varDecl->name, init});
+        } else if (dynamic_cast<LambdaExpr*>(init)) {
+            scan.candidates.push_back({varDecl->name, init});
+        }
+    }
+    else if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt)) {
+        collectCandidates(ifStmt->thenBranch.get(), scan);
+        for (auto& elif : ifStmt->elifBranches) collectCandidates(elif.second.get(), scan);
+        collectCandidates(ifStmt->elseBranch.get(), scan);
+    }
+    else if (auto* whileStmt = dynamic_cast<WhileStmt*>(stmt)) {
+        collectCandidates(whileStmt->body.get(), scan);
+    }
+    else if (auto* forStmt = dynamic_cast<ForStmt*>(stmt)) {
+        collectCandidates(forStmt->body.get(), scan);
+    }
+    else if (auto* unsafeBlock = dynamic_cast<UnsafeBlock*>(stmt)) {
+        collectCandidates(unsafeBlock->body.get(), scan);
+    }
+}
+
+EscapeAnalysisPass::FunctionScan EscapeAnalysisPass::scanFunction(FnDecl* fn) {
+    FunctionScan scan;
+    scan_ = &scan;
+    tracked_.clear();
+    declared_.clear();
+    captureDepth_ = 0;
+
+    for (auto& param : fn->params) {
+        tracked_.insert(param.first);
+        declared_.insert(param.first);
+    }
+    collectCandidates(fn->body.get(), scan);
+    for (auto& candidate : scan.candidates) tracked_.insert(candidate.name);
+
+    scanStmt(fn->body.get());
+
+    scan_ = nullptr;
+    return scan;
+}
+
+bool EscapeAnalysisPass::nameEscapes(const FunctionScan& scan, const std::string& name) const {
+    if (scan.opaque || scan.escaped.count(name)) return true;
+    for (const auto& flow : scan.flows) {
+        if (flow.name != name) continue;
+        auto it = paramNoEscape_.find(flow.callee);
+        if (it == paramNoEscape_.end() || flow.index >= it->second.size()) return true;
+        if (!it->second[flow.index]) return true;
+    }
+    return false;
+}
+
+// A name declared twice (shadowing, a loop variable reusing it) is no longer
+// one object, so give up on it rather than track scopes
+void EscapeAnalysisPass::declare(const std::string& name) {
+    if (!declared_.insert(name).second) scan_->escaped.insert(name);
+}
+
+void EscapeAnalysisPass::scanStmt(Statement* stmt) {
+    if (!stmt) return;
+
+    if (auto* block = dynamic_cast<Block*>(stmt)) {
+        for (auto& s : block->statements) scanStmt(s.get());
+    }
+    else if (auto* exprStmt = dynamic_cast<ExprStmt*>(stmt)) {
+        scanExpr(exprStmt->expr.get());
+    }
+    else if (auto* varDecl = dynamic_cast<VarDecl*>(stmt)) {
+        declare(varDecl->name);
+        scanExpr(varDecl->initializer.get());
+    }
+    else if (auto* destructure = dynamic_cast<DestructuringDecl*>(stmt)) {
+        for (const auto& name : destructure->names) declare(name);
+        scanExpr(destructure->initializer.get());
+    }
+    else if (auto* assign = dynamic_cast<AssignStmt*>(stmt)) {
+        // Rebinding the variable itself loses track of the object
+        escape(assign->target.get());
+        scanExpr(assign->value.get());
+    }
+    else if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt)) {
+        scanExpr(ifStmt->condition.get());
+        scanStmt(ifStmt->thenBranch.get());
+        for (auto& elif : ifStmt->elifBranches) {
+            scanExpr(elif.first.get());
+            scanStmt(elif.second.get());
+        }
+        scanStmt(ifStmt->elseBranch.get());
+    }
+    else if (auto* whileStmt = dynamic_cast<WhileStmt*>(stmt)) {
+        scanExpr(whileStmt->condition.get());
+        scanStmt(whileStmt->body.get());
+    }
+    else if (auto* forStmt = dynamic_cast<ForStmt*>(stmt)) {
+        declare(forStmt->var);
+        useInPlace(forStmt->iterable.get());
+        scanStmt(forStmt->body.get());
+    }
+    else if (auto* returnStmt = dynamic_cast<ReturnStmt*>(stmt)) {
+        scanExpr(returnStmt->value.get());
+    }
+    else if (auto* matchStmt = dynamic_cast<MatchStmt*>(stmt)) {
+        scanExpr(matchStmt->value.get());
+        for (auto& matchCase : matchStmt->cases) {
+            scanExpr(matchCase.pattern.get());
+            scanExpr(matchCase.guard.get());
+            scanStmt(matchCase.body.get());
+        }
+        scanStmt(matchStmt->defaultCase.get());
+    }
+    else if (auto* unsafeBlock = dynamic_cast<UnsafeBlock*>(stmt)) {
+        scanStmt(unsafeBlock->body.get());
+    }
+    else if (dynamic_cast<BreakStmt*>(stmt) || dynamic_cast<ContinueStmt*>(stmt)) {
+        // Nothing to scan
+    }
+    else {
+        scan_->opaque = true;
+    }
+}
+
+void EscapeAnalysisPass::scanExpr(Expression* expr) {
+    if (!expr) return;
+
+    if (dynamic_cast<IntegerLiteral*>(expr) || dynamic_cast<FloatLiteral*>(expr) ||
+        dynamic_cast<StringLiteral*>(expr) || dynamic_cast<CharLiteral*>(expr) ||
+        dynamic_cast<BoolLiteral*>(expr) || dynamic_cast<NilLiteral*>(expr) ||
+        dynamic_cast<ByteStringLiteral*>(expr)) {
+        return;
+    }
+    if (dynamic_cast<Identifier*>(expr)) {
+        escape(expr);
+    }
+    else if (auto* interp = dynamic_cast<InterpolatedString*>(expr)) {
+        for (auto& part : interp->parts) {
+            if (auto* partExpr = std::get_if<ExprPtr>(&part)) scanExpr(partExpr->get());
+        }
+    }
+    else if (auto* binary = dynamic_cast<BinaryExpr*>(expr)) {
+        scanExpr(binary->left.get());
+        scanExpr(binary->right.get());
+    }
+    else if (auto* unary = dynamic_cast<UnaryExpr*>(expr)) {
+        scanExpr(unary->operand.get());
+    }
+    else if (auto* ternary = dynamic_cast<TernaryExpr*>(expr)) {
+        scanExpr(ternary->condition.get());
+        scanExpr(ternary->thenExpr.get());
+        scanExpr(ternary->elseExpr.get());
+    }
+    else if (auto* cast = dynamic_cast<CastExpr*>(expr)) {
+        scanExpr(cast->expr.get());
+    }
+    else if (auto* range = dynamic_cast<RangeExpr*>(expr)) {
+        scanExpr(range->start.get());
+        scanExpr(range->end.get());
+        scanExpr(range->step.get());
+    }
+    else if (auto* member = dynamic_cast<MemberExpr*>(expr)) {
+        useInPlace(member->object.get());
+    }
+    else if (auto* index = dynamic_cast<IndexExpr*>(expr)) {
+        useInPlace(index->object.get());
+        scanExpr(index->index.get());
+    }
+    else if (auto* call = dynamic_cast<CallExpr*>(expr)) {
+        scanCall(call);
+    }
+    else if (auto* assign = dynamic_cast<AssignExpr*>(expr)) {
+        escape(assign->target.get());
+        scanExpr(assign->value.get());
+    }
+    else if (auto* list = dynamic_cast<ListExpr*>(expr)) {
+        for (auto& element : list->elements) scanExpr(element.get());
+    }
+    else if (auto* record = dynamic_cast<RecordExpr*>(expr)) {
+        for (auto& field : record->fields) scanExpr(field.second.get());
+    }
+    else if (auto* map = dynamic_cast<MapExpr*>(expr)) {
+        for (auto& entry : map->entries) {
+            scanExpr(entry.first.get());
+            scanExpr(entry.second.get());
+        }
+    }
+    else if (auto* lambda = dynamic_cast<LambdaExpr*>(expr)) {
+        // Captures copy the pointer into the closure, which may outlive us
+        captureDepth_++;
+        scanExpr(lambda->body.get());
+        captureDepth_--;
+    }
+    else if (auto* addrOf = dynamic_cast<AddressOfExpr*>(expr)) {
+        // &p.x hands out an interior pointer
+        captureDepth_++;
+        scanExpr(addrOf->operand.get());
+        captureDepth_--;
+    }
+    else if (auto* borrow = dynamic_cast<BorrowExpr*>(expr)) {
+        captureDepth_++;
+        scanExpr(borrow->operand.get());
+        captureDepth_--;
+    }
+    else if (auto* spawn = dynamic_cast<SpawnExpr*>(expr)) {
+        captureDepth_++;
+        scanExpr(spawn->operand.get());
+        captureDepth_--;
+    }
+    else {
+        scan_->opaque = true;
+    }
+}
+
+void EscapeAnalysisPass::scanCall(CallExpr* call) {
+    for (auto& namedArg : call->namedArgs) scanExpr(namedArg.second.get());
+
+    if (auto* member = dynamic_cast<MemberExpr*>(call->callee.get())) {
+        // p.method() passes p as self
+        escape(member->object.get());
+        for (auto& arg : call->args) scanExpr(arg.get());
+        return;
+    }
+
+    auto* callee = dynamic_cast<Identifier*>(call->callee.get());
+    if (!callee) {
+        scanExpr(call->callee.get());
+        for (auto& arg : call->args) scanExpr(arg.get());
+        return;
+    }
+
+    if (tracked_.count(callee->name)) {
+        // Calling a closure only reads its environment
+        useInPlace(callee);
+        for (auto& arg : call->args) scanExpr(arg.get());
+        return;
+    }
+
+    bool knownFunction = functions_.count(callee->name) && !declared_.count(callee->name);
+    if (knownFunction) {
+        for (size_t i = 0; i < call->args.size(); i++) {
+            auto* argId = dynamic_cast<Identifier*>(call->args[i].get());
+            if (argId && captureDepth_ == 0 && tracked_.count(argId->name)) {
+                scan_->flows.push_back({argId->name, callee->name, i});
+            } else {
+                scanExpr(call->args[i].get());
+            }
+        }
+        return;
+    }
+
+    if (callee->name == "len" && call->args.size() == 1) {
+        useInPlace(call->args[0].get());
+        return;
+    }
+
+    for (auto& arg : call->args) scanExpr(arg.get());
+}
+
+void EscapeAnalysisPass::escape(Expression* expr) {
+    if (auto* id = dynamic_cast<Identifier*>(expr)) {
+        if (tracked_.count(id->name)) scan_->escaped.insert(id->name);
+        return;
+    }
+    scanExpr(expr);
+}
+
+void EscapeAnalysisPass::useInPlace(Expression* expr) {
+    if (dynamic_cast<Identifier*>(expr) && captureDepth_ == 0) return;
+    scanExpr(expr);
+}
+
+} // namespace tyl
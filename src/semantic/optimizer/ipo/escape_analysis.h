@@ -0,0 +1,87 @@
+// Tyl Compiler - Escape Analysis Pass
+// Finds record, list and closure allocations that never outlive their function
+#ifndef TYL_ESCAPE_ANALYSIS_H
+#define TYL_ESCAPE_ANALYSIS_H
+
+#include "../optimizer.h"
+#include "frontend/ast/ast.h"
+#include <map>
+#include <set>
+#include <vector>
+
+namespace tyl {
+
+// Statistics for Escape Analysis
+struct EscapeAnalysisStats {
+    int recordsOnStack = 0;
+    int listsOnStack = 0;
+    int closuresOnStack = 0;
+};
+
+// Escape Analysis Pass
+// Marks `let x = Rec{...}` / `[...]` / `|..| ...` allocations as noEscape when
+// x is only ever used in place:
+// 1. as the object of a field access or index (p.x, p.x = v, xs[i])
+// 2. as the callee of a call (closures), len(xs) or a for-loop iterable
+// 3. as an argument to a parameter that is itself non-escaping
+// Anything else - copying x, returning it, storing it, capturing it in a
+// lambda, calling a method on it - lets the pointer escape. Parameter
+// summaries are solved optimistically to a fixpoint so recursion is fine.
+// The backend places noEscape allocations in the stack frame.
+class EscapeAnalysisPass : public OptimizationPass {
+public:
+    void run(Program& ast) override;
+    std::string name() const override { return "EscapeAnalysis"; }
+
+    const EscapeAnalysisStats& stats() const { return stats_; }
+
+private:
+    struct Candidate {
+        std::string name;
+        Expression* alloc = nullptr;
+    };
+
+    // Where a tracked name is passed as a call argument
+    struct ArgFlow {
+        std::string name;
+        std::string callee;
+        size_t index;
+    };
+
+    struct FunctionScan {
+        std::vector<Candidate> candidates;
+        std::set<std::string> escaped;
+        std::vector<ArgFlow> flows;
+        bool opaque = false;                  // Contains a construct we don't model
+    };
+
+    EscapeAnalysisStats stats_;
+
+    std::map<std::string, FnDecl*> functions_;
+    std::map<std::string, std::vector<bool>> paramNoEscape_;  // Per-function summaries
+    std::set<std::string> dropTypes_;                         // Types with a Drop impl
+
+    // State for the function being scanned
+    FunctionScan* scan_ = nullptr;
+    std::set<std::string> tracked_;
+    std::set<std::string> declared_;
+    int captureDepth_ = 0;                  // Inside a lambda, spawn or &: every use escapes
+
+    void collectFunctions(Program& ast);
+    void collectCandidates(Statement* stmt, FunctionScan& scan);
+    FunctionScan scanFunction(FnDecl* fn);
+    bool nameEscapes(const FunctionScan& scan, const std::string& name) const;
+    void declare(const std::string& name);
+
+    void scanStmt(Statement* stmt);
+    void scanExpr(Expression* expr);
+    void scanCall(CallExpr* call);
+    void escape(Expression* expr);
+
+    // A use of `expr` that does not let it escape (field access, index, callee)
+    void useInPlace(Expression* expr);
+};
+
+} // namespace tyl
+
+#endif // TYL_ESCAPE_ANALYSIS_H
@@ -50,10 +50,14 @@ void LoopUnrollingPass::processStatements(std::vector<StmtPtr>& stmts) {
             bool wasUnrolled = false;
             // Don't unroll labeled loops - they may have break/continue targeting them
             if (forLoop->label.empty() && analyzeLoop(forLoop, info)) {
+                // A profile-hot loop (unrollHint >= 4 from PGO) is unrolled by
+                // the hinted factor whatever its trip count
+                bool profiledHot = forLoop->unrollHint >= minTripCount_;
+                int factor = profiledHot ? forLoop->unrollHint : unrollFactor_;
                 if (info.boundsKnown && 
                     info.tripCount >= minTripCount_ && 
-                    info.tripCount <= maxTripCount_) {
-                    auto unrolled = unrollLoop(forLoop, info);
+                    (info.tripCount <= maxTripCount_ || profiledHot)) {
+                    auto unrolled = unrollLoop(forLoop, info, factor);
                     if (unrolled) {
                         stmts[i] = std::move(unrolled);
                         transformations_++;
@@ -180,11 +184,11 @@ bool LoopUnrollingPass::analyzeLoop(ForStmt* loop, LoopInfo& info) {
     return false;
 }
 
-StmtPtr LoopUnrollingPass::unrollLoop(ForStmt* loop, const LoopInfo& info) {
+StmtPtr LoopUnrollingPass::unrollLoop(ForStmt* loop, const LoopInfo& info, int unrollFactor) {
     SourceLocation loc = loop->location;  // Use the original loop's location
     
     // For small trip counts, fully unroll
-    if (info.tripCount <= unrollFactor_) {
+    if (info.tripCount <= unrollFactor) {
         auto block = std::make_unique<Block>(loc);
         
         // Use <= for inclusive ranges (RangeExpr), < for exclusive (range() function)
@@ -208,12 +212,12 @@ StmtPtr LoopUnrollingPass::unrollLoop(ForStmt* loop, const LoopInfo& info) {
     }
     
     // For larger loops, use partial unrolling with remainder loop
-    // This unrolls by unrollFactor_ and handles the remainder iterations
+    // This unrolls by unrollFactor and handles the remainder iterations
     auto block = std::make_unique<Block>(loc);
     
     // Calculate how many full unrolled iterations we can do
-    int64_t unrolledIterations = (info.tripCount / unrollFactor_) * unrollFactor_;
-    int64_t remainderIterations = info.tripCount % unrollFactor_;
+    int64_t unrolledIterations = (info.tripCount / unrollFactor) * unrollFactor;
+    int64_t remainderIterations = info.tripCount % unrollFactor;
     
     // Calculate the end value for the unrolled portion
     int64_t unrolledEndValue = info.startValue + (unrolledIterations - 1) * info.stepValue;
@@ -222,9 +226,9 @@ StmtPtr LoopUnrollingPass::unrollLoop(ForStmt* loop, const LoopInfo& info) {
     }
     
     // Generate the main unrolled loop (if there are enough iterations)
-    if (unrolledIterations >= unrollFactor_) {
-        // Create a new for loop with step = stepValue * unrollFactor_
-        int64_t newStep = info.stepValue * unrollFactor_;
+    if (unrolledIterations >= unrollFactor) {
+        // Create a new for loop with step = stepValue * unrollFactor
+        int64_t newStep = info.stepValue * unrollFactor;
         
         // Create the range for the unrolled loop
         ExprPtr newIterable;
@@ -232,7 +236,7 @@ StmtPtr LoopUnrollingPass::unrollLoop(ForStmt* loop, const LoopInfo& info) {
             // For inclusive ranges, use RangeExpr with step
             auto rangeExpr = std::make_unique<RangeExpr>(
                 std::make_unique<IntegerLiteral>(info.startValue, loc),
-                std::make_unique<IntegerLiteral>(unrolledEndValue - (unrollFactor_ - 1) * info.stepValue, loc),
+                std::make_unique<IntegerLiteral>(unrolledEndValue - (unrollFactor - 1) * info.stepValue, loc),
                 std::make_unique<IntegerLiteral>(newStep, loc),
                 loc);
             newIterable = std::move(rangeExpr);
@@ -242,7 +246,7 @@ StmtPtr LoopUnrollingPass::unrollLoop(ForStmt* loop, const LoopInfo& info) {
                 std::make_unique<Identifier>("range", loc), loc);
             rangeCall->args.push_back(std::make_unique<IntegerLiteral>(info.startValue, loc));
             rangeCall->args.push_back(std::make_unique<IntegerLiteral>(
-                info.startValue + (unrolledIterations / unrollFactor_) * newStep, loc));
+                info.startValue + (unrolledIterations / unrollFactor) * newStep, loc));
             rangeCall->args.push_back(std::make_unique<IntegerLiteral>(newStep, loc));
             newIterable = std::move(rangeCall);
         }
@@ -250,8 +254,8 @@ StmtPtr LoopUnrollingPass::unrollLoop(ForStmt* loop, const LoopInfo& info) {
         // Create the unrolled loop body
         auto unrolledBody = std::make_unique<Block>(loc);
         
-        // Add unrollFactor_ copies of the original body
-        for (int j = 0; j < unrollFactor_; ++j) {
+        // Add unrollFactor copies of the original body
+        for (int j = 0; j < unrollFactor; ++j) {
             // Clone body with i + j*step offset
             // We need to create expressions like: inductionVar + j*stepValue
             auto cloned = cloneStatementWithOffset(loop->body.get(), info.inductionVar, 
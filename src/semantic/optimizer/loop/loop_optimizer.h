@@ -56,7 +56,7 @@ private:
     bool analyzeLoop(ForStmt* loop, LoopInfo& info);
     
     // Unroll a loop
-    StmtPtr unrollLoop(ForStmt* loop, const LoopInfo& info);
+    StmtPtr unrollLoop(ForStmt* loop, const LoopInfo& info, int unrollFactor);
     
     // Clone a statement, replacing induction variable references
     StmtPtr cloneStatement(Statement* stmt, const std::string& inductionVar, int64_t offset);
@@ -1,5 +1,6 @@
 // Tyl Compiler - Loop Peeling Implementation
 #include "loop_peeling.h"
+#include "semantic/generics/ast_cloner.h"
 #include <algorithm>
 
 namespace tyl {
@@ -34,6 +35,9 @@ void LoopPeelingPass::processStatements(std::vector<StmtPtr>& stmts) {
                 // Statements were inserted, adjust index
                 continue;
             }
+            if (tryPeelProfiledLoop(stmts, i, forLoop)) {
+                continue;
+            }
             
             // Process nested loops
             if (forLoop->body) {
@@ -147,6 +151,96 @@ bool LoopPeelingPass::tryPeelForLoop(std::vector<StmtPtr>& stmts, size_t index,
     return false;
 }
 
+// The profile says this loop usually runs only unrollHint iterations, so run
+// those straight-line behind bound checks and keep the loop for the rest:
+//   for i in range(0, n): body
+// becomes
+//   if 0 < n:
+//       i = 0
+//       body
+//       if 1 < n:
+//           ...
+//               for i in range(k, n): body
+bool LoopPeelingPass::tryPeelProfiledLoop(std::vector<StmtPtr>& stmts, size_t index,
+                                          ForStmt* loop) {
+    int peelCount = loop->unrollHint;
+    if (peelCount < 1 || peelCount > 3 || !loop->label.empty() || !loop->body) return false;
+    
+    // Bounds: constant start, variable end, unit step
+    int64_t start = 0;
+    Expression* end = nullptr;
+    bool inclusive = false;
+    if (auto* range = dynamic_cast<RangeExpr*>(loop->iterable.get())) {
+        if (range->step || !evaluateConstant(range->start.get(), start)) return false;
+        end = range->end.get();
+        inclusive = true;
+    } else if (auto* call = dynamic_cast<CallExpr*>(loop->iterable.get())) {
+        auto* callee = dynamic_cast<Identifier*>(call->callee.get());
+        if (!callee || callee->name != "range") return false;
+        if (call->args.size() == 1) {
+            end = call->args[0].get();
+        } else if (call->args.size() == 2) {
+            if (!evaluateConstant(call->args[0].get(), start)) return false;
+            end = call->args[1].get();
+        } else {
+            return false;
+        }
+    }
+    
+    // The bound is re-read by each check, so it must not change in the body;
+    // the peeled bodies are outside the loop, so no break/continue
+    auto* endVar = dynamic_cast<Identifier*>(end);
+    if (!endVar || endVar->name == loop->var) return false;
+    if (assignsVar(loop->body.get(), endVar->name)) return false;
+    if (assignsVar(loop->body.get(), loop->var)) return false;
+    if (containsLoopExit(loop->body.get())) return false;
+    
+    ASTCloner cloner({}, {});
+    SourceLocation loc = loop->location;
+    
+    // Remaining loop: starts after the peeled iterations
+    ExprPtr restIterable;
+    int64_t restStart = start + peelCount;
+    if (inclusive) {
+        restIterable = std::make_unique<RangeExpr>(
+            std::make_unique<IntegerLiteral>(restStart, loc), cloner.clone(end), nullptr, loc);
+    } else {
+        auto restCall = std::make_unique<CallExpr>(std::make_unique<Identifier>("range", loc), loc);
+        restCall->args.push_back(std::make_unique<IntegerLiteral>(restStart, loc));
+        restCall->args.push_back(cloner.clone(end));
+        restIterable = std::move(restCall);
+    }
+    auto restBody = cloner.clone(loop->body.get());
+    if (!restIterable || !restBody) return false;
+    StmtPtr nested = std::make_unique<ForStmt>(loop->var, std::move(restIterable), 
+                                               std::move(restBody), loc);
+    
+    // Wrap it in the peeled iterations, innermost first
+    for (int k = peelCount - 1; k >= 0; --k) {
+        auto peeledBody = cloner.clone(loop->body.get());
+        if (!peeledBody) return false;
+        
+        auto guarded = std::make_unique<Block>(loc);
+        auto setVar = std::make_unique<VarDecl>(loop->var, "", 
+            std::make_unique<IntegerLiteral>(start + k, loc), loc);
+        guarded->statements.push_back(std::move(setVar));
+        guarded->statements.push_back(std::move(peeledBody));
+        guarded->statements.push_back(std::move(nested));
+        
+        auto cond = std::make_unique<BinaryExpr>(
+            std::make_unique<IntegerLiteral>(start + k, loc),
+            inclusive ? TokenType::LE : TokenType::LT,
+            cloner.clone(end), loc);
+        nested = std::make_unique<IfStmt>(std::move(cond), std::move(guarded), loc);
+    }
+    
+    stmts[index] = std::move(nested);
+    ++stats_.loopsPeeled;
+    stats_.iterationsPeeled += peelCount;
+    stats_.firstIterationsPeeled += peelCount;
+    return true;
+}
+
 bool LoopPeelingPass::shouldPeelLoop(ForStmt* loop) {
     if (!loop || !loop->body) return false;
     
@@ -589,6 +683,104 @@ bool LoopPeelingPass::usesLoopVar(Expression* expr, const std::string& var) {
     return false;
 }
 
+bool LoopPeelingPass::assignsVar(Statement* stmt, const std::string& var) {
+    if (!stmt) return false;
+    
+    if (auto* assignStmt = dynamic_cast<AssignStmt*>(stmt)) {
+        if (auto* id = dynamic_cast<Identifier*>(assignStmt->target.get())) {
+            if (id->name == var) return true;
+        }
+        return assignsVarInExpr(assignStmt->value.get(), var);
+    }
+    if (auto* varDecl = dynamic_cast<VarDecl*>(stmt)) {
+        return varDecl->name == var || assignsVarInExpr(varDecl->initializer.get(), var);
+    }
+    if (auto* exprStmt = dynamic_cast<ExprStmt*>(stmt)) {
+        return assignsVarInExpr(exprStmt->expr.get(), var);
+    }
+    if (auto* block = dynamic_cast<Block*>(stmt)) {
+        for (auto& s : block->statements) {
+            if (assignsVar(s.get(), var)) return true;
+        }
+        return false;
+    }
+    if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt)) {
+        if (assignsVarInExpr(ifStmt->condition.get(), var)) return true;
+        if (assignsVar(ifStmt->thenBranch.get(), var)) return true;
+        for (auto& elif : ifStmt->elifBranches) {
+            if (assignsVarInExpr(elif.first.get(), var)) return true;
+            if (assignsVar(elif.second.get(), var)) return true;
+        }
+        return assignsVar(ifStmt->elseBranch.get(), var);
+    }
+    if (auto* whileStmt = dynamic_cast<WhileStmt*>(stmt)) {
+        return assignsVarInExpr(whileStmt->condition.get(), var) ||
+               assignsVar(whileStmt->body.get(), var);
+    }
+    if (auto* forStmt = dynamic_cast<ForStmt*>(stmt)) {
+        return forStmt->var == var || assignsVar(forStmt->body.get(), var);
+    }
+    if (dynamic_cast<ReturnStmt*>(stmt) || dynamic_cast<BreakStmt*>(stmt) ||
+        dynamic_cast<ContinueStmt*>(stmt)) {
+        return false;
+    }
+    
+    // Unknown statement kinds might write anything
+    return true;
+}
+
+bool LoopPeelingPass::assignsVarInExpr(Expression* expr, const std::string& var) {
+    if (!expr) return false;
+    
+    if (auto* assign = dynamic_cast<AssignExpr*>(expr)) {
+        if (auto* id = dynamic_cast<Identifier*>(assign->target.get())) {
+            if (id->name == var) return true;
+        }
+        return assignsVarInExpr(assign->value.get(), var);
+    }
+    if (auto* walrus = dynamic_cast<WalrusExpr*>(expr)) {
+        return walrus->varName == var || assignsVarInExpr(walrus->value.get(), var);
+    }
+    if (auto* bin = dynamic_cast<BinaryExpr*>(expr)) {
+        return assignsVarInExpr(bin->left.get(), var) || assignsVarInExpr(bin->right.get(), var);
+    }
+    if (auto* un = dynamic_cast<UnaryExpr*>(expr)) {
+        return assignsVarInExpr(un->operand.get(), var);
+    }
+    if (auto* call = dynamic_cast<CallExpr*>(expr)) {
+        for (auto& arg : call->args) {
+            if (assignsVarInExpr(arg.get(), var)) return true;
+        }
+    }
+    if (auto* ternary = dynamic_cast<TernaryExpr*>(expr)) {
+        return assignsVarInExpr(ternary->condition.get(), var) ||
+               assignsVarInExpr(ternary->thenExpr.get(), var) ||
+               assignsVarInExpr(ternary->elseExpr.get(), var);
+    }
+    return false;
+}
+
+bool LoopPeelingPass::containsLoopExit(Statement* stmt) {
+    if (!stmt) return false;
+    
+    if (dynamic_cast<BreakStmt*>(stmt) || dynamic_cast<ContinueStmt*>(stmt)) return true;
+    if (auto* block = dynamic_cast<Block*>(stmt)) {
+        for (auto& s : block->statements) {
+            if (containsLoopExit(s.get())) return true;
+        }
+    }
+    if (auto* ifStmt = dynamic_cast<IfStmt*>(stmt)) {
+        if (containsLoopExit(ifStmt->thenBranch.get())) return true;
+        for (auto& elif : ifStmt->elifBranches) {
+            if (containsLoopExit(elif.second.get())) return true;
+        }
+        return containsLoopExit(ifStmt->elseBranch.get());
+    }
+    // break/continue inside a nested loop targets that loop; this loop has
+    // no label, so labeled ones cannot target it either
+    return false;
+}
+
 bool LoopPeelingPass::containsIndexWithVar(Statement* stmt, const std::string& var) {
     if (!stmt) return false;
     
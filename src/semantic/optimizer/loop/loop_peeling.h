@@ -58,6 +58,9 @@ private:
     // Try to peel a for loop
     bool tryPeelForLoop(std::vector<StmtPtr>& stmts, size_t index, ForStmt* loop);
     
+    // Profile-guided peeling of a runtime-bounded loop (unrollHint 1-3)
+    bool tryPeelProfiledLoop(std::vector<StmtPtr>& stmts, size_t index, ForStmt* loop);
+    
     // Check if peeling would be beneficial
     bool shouldPeelLoop(ForStmt* loop);
     
@@ -85,6 +88,13 @@ private:
     // Check if expression uses the loop variable
     bool usesLoopVar(Expression* expr, const std::string& var);
     
+    // Check if statement assigns to a variable
+    bool assignsVar(Statement* stmt, const std::string& var);
+    bool assignsVarInExpr(Expression* expr, const std::string& var);
+    
+    // Check for break/continue that target this loop
+    bool containsLoopExit(Statement* stmt);
+    
     // Check if statement contains array index with loop variable
     bool containsIndexWithVar(Statement* stmt, const std::string& var);
     
@@ -37,6 +37,7 @@
 #include "ipo/global_opt.h"
 #include "ipo/partial_inlining.h"
 #include "ipo/speculative_devirt.h"
+#include "ipo/escape_analysis.h"
 
 // Function optimizations
 #include "function/inlining.h"
@@ -205,6 +206,10 @@ void Optimizer::optimize(Program& ast) {
     // PHASE 0: Profile-Guided Optimization (if profile data available)
     if (pgoEnabled_ && !profileFile_.empty()) {
         auto pgo = createPGOPass(profileFile_);
+        if (!pgo->hasProfile()) {
+            std::cerr << "warning: could not read profile '" << profileFile_ 
+                      << "', continuing without profile data\n";
+        }
         pgo->run(ast);
         totalTransformations_ += pgo->transformations();
         if (verbose_ && pgo->transformations() > 0) {
@@ -660,6 +665,18 @@ void Optimizer::optimize(Program& ast) {
         }
     }
     
+    // PHASE 9: Escape Analysis - runs last so no later pass can copy or
+    // move an allocation it has proven local
+    if (optLevel_ >= OptLevel::O2) {
+        auto escape = std::make_unique<EscapeAnalysisPass>();
+        escape->run(ast);
+        totalTransformations_ += escape->transformations();
+        if (verbose_ && escape->transformations() > 0) {
+            std::cout << "[Optimizer] EscapeAnalysis: " 
+                      << escape->transformations() << " allocation(s) kept on the stack\n";
+        }
+    }
+    
     if (verbose_) {
         std::cout << "[Optimizer] Total: " << totalTransformations_ << " transformation(s)\n";
     }